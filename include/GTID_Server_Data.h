@@ -11,17 +11,25 @@ class GTID_Server_Data {
 	size_t pos;
 	struct ev_io *w;
 	char uuid_server[64];
+	gtid_uuid_t uuid_server_bin; // binary form of uuid_server
 	unsigned long long events_read;
+	// updated only by the GTID thread while reading events
 	gtid_set_t gtid_executed;
+	// read-only copy of gtid_executed , replaced after every batch of events. See publish_gtid_executed()
+	std::shared_ptr<const gtid_set_t> gtid_executed_snapshot;
 	bool active;
+	// set by read_next_gtid() when an invalid event is received , see dump()
+	bool corrupted;
 	GTID_Server_Data(struct ev_io *_w, char *_address, uint16_t _port, uint16_t _mysql_port);
 	void resize(size_t _s);
 	~GTID_Server_Data();
 	bool readall();
 	bool writeout();
 	bool read_next_gtid();
-	bool gtid_exists(char *gtid_uuid, uint64_t gtid_trxid);
+	bool gtid_exists(const gtid_uuid_t& gtid_uuid, uint64_t gtid_trxid);
+	void publish_gtid_executed();
+	std::shared_ptr<const gtid_set_t> get_gtid_executed() const { return std::atomic_load(&gtid_executed_snapshot); }
 	void read_all_gtids();
-	void dump();
+	bool dump();
 };
 #endif // CLASS_GTID_Server_Data_H
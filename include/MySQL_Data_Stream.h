@@ -24,6 +24,8 @@ typedef struct P_st_ma_pvio_tls {
 
 #define QUEUE_T_DEFAULT_SIZE	32768
 #define MY_SSL_BUFFER	8192
+// maximum number of packets sent by a single call of writev() in array2net()
+#define ARRAY2NET_MAX_IOV	64
 
 typedef struct _queue_t {
 	void *buffer;
@@ -153,6 +155,9 @@ class MySQL_Data_Stream
 
 	int fd; // file descriptor
 	int poll_fds_idx;
+	// result of a recv() already performed by MySQL_Thread through io_uring , consumed by read_from_net()
+	int io_ring_recv_rc;
+	bool io_ring_recv_ready;
 
 
 	int active_transaction; // 1 if there is an active transaction
@@ -182,12 +187,16 @@ class MySQL_Data_Stream
 	~MySQL_Data_Stream();
 
 	int array2buffer_full();
+	int array2net();
 	void init();	// initialize the data stream
 	void init(enum MySQL_DS_type, MySQL_Session *, int); // initialize with arguments
 	void shut_soft();
 	void shut_hard();
 	int read_from_net();
 	int write_to_net();
+	bool io_ring_recv_eligible(short _revents);
+	bool io_ring_prep_recv(ProxySQL_IO_Uring *ring);
+	static void io_ring_recv_completed(uint64_t user_data, int res, void *arg);
 	int write_to_net_poll();
 	bool available_data_out();	
 	void remove_pollout();
@@ -126,9 +126,19 @@ class MySrvC;
 class MySrvList;
 class MyHGC;
 
+/**
+ * @brief Algorithms used by MyHGC::get_random_MySrvC() to choose a server among the candidates.
+ * @details Configured per hostgroup with the 'load_balancing_algorithm' key of
+ *  'mysql_hostgroup_attributes.hostgroup_settings'.
+ */
+enum MyHGC_LB_algorithm {
+	LB_WEIGHTED_RANDOM = 0, // random, proportional to weight. Default
+	LB_POWER_OF_TWO_CHOICES, // the least loaded of two servers chosen with LB_WEIGHTED_RANDOM
+	LB_LEAST_OUTSTANDING_QUERIES, // the server with less queries in flight per weight
+	LB_PEAK_EWMA, // like LB_POWER_OF_TWO_CHOICES , but the load is weighted by the peak EWMA of the query latency
+	LB_ALGORITHM__END
+};
 
-std::string gtid_executed_to_string(gtid_set_t& gtid_executed);
-void addGtid(const gtid_t& gtid, gtid_set_t& gtid_executed);
 
 #include "GTID_Server_Data.h"
 
@@ -163,6 +173,12 @@ class GTID_Server_Data {
 class MySrvConnList {
 	private:
 	MySrvC *mysrvc;
+	// if true, connections are indexed by MySQL_Connection::get_pool_fingerprint() . Used for ConnectionsFree
+	bool indexed;
+	// for each fingerprint, the most recently added connection. Connections with the same fingerprint are linked through pool_index
+	std::unordered_map<uint64_t, MySQL_Connection *> fingerprints;
+	void index_add(MySQL_Connection *c);
+	void index_remove(MySQL_Connection *c);
 	int find_idx(MySQL_Connection *c) {
 		//for (unsigned int i=0; i<conns_length(); i++) {
 		for (unsigned int i=0; i<conns->len; i++) {
@@ -176,17 +192,13 @@ class MySrvConnList {
 	}
 	public:
 	PtrArray *conns;
-	MySrvConnList(MySrvC *);
+	MySrvConnList(MySrvC *, bool _indexed=false);
 	~MySrvConnList();
 	void add(MySQL_Connection *);
-	void remove(MySQL_Connection *c) {
-		int i = -1;
-		i = find_idx(c);
-		assert(i>=0);
-		conns->remove_index_fast((unsigned int)i);
-	}
+	void remove(MySQL_Connection *c);
 	MySQL_Connection *remove(int);
 	MySQL_Connection * get_random_MyConn(MySQL_Session *sess, bool ff);
+	int find_perfect_MyConn_idx(const MySQL_Connection *client_conn, unsigned int& number_of_matching_session_variables);
 	void get_random_MyConn_inner_search(unsigned int start, unsigned int end, unsigned int& conn_found_idx, unsigned int& connection_quality_level, unsigned int& number_of_matching_session_variables, const MySQL_Connection * client_conn);
 	unsigned int conns_length() { return conns->len; }
 	void drop_all_connections();
@@ -219,6 +231,10 @@ class MySrvC {	// MySQL Server Container
 	unsigned long long queries_gtid_sync;
 	unsigned long long bytes_sent;
 	unsigned long long bytes_recv;
+	// queries currently running on this server, and peak EWMA of their latency. Used by the load balancing algorithms
+	unsigned int queries_in_flight;
+	unsigned int latency_ewma_us;
+	unsigned long long latency_ewma_updated_at;
 	bool shunned_automatic;
 	bool shunned_and_kill_all_connections; // if a serious failure is detected, this will cause all connections to die even if the server is just shunned
 	int32_t use_ssl;
@@ -251,6 +267,8 @@ class MySrvC {	// MySQL Server Container
 	~MySrvC();
 	void connect_error(int, bool get_mutex=true);
 	void shun_and_killall();
+	void update_latency_ewma(unsigned long long latency_us, unsigned long long curtime);
+	unsigned int get_latency_ewma_us(unsigned long long curtime);
 	/**
 	 * @brief Update the maximum number of used connections
 	 * @return The maximum number of used connections
@@ -283,6 +301,9 @@ class MySrvList {	// MySQL Server List
 	MySrvC * idx(unsigned int i) {return (MySrvC *)servers->index(i); }
 };
 
+// number of connection profiles tracked by each hostgroup for mysql-connection_prewarm_ms
+#define MYHGC_PREWARM_PROFILES	4
+
 class MyHGC {	// MySQL Host Group Container
 	public:
 	unsigned int hid;
@@ -291,6 +312,12 @@ class MyHGC {	// MySQL Host Group Container
 	unsigned long long current_time_now;
 	uint32_t new_connections_now;
 	MySrvList *mysrvs;
+	// protects the servers and the connection lists of this hostgroup when
+	// MyHGM is locked with rdlock() , see MySQL_HostGroups_Manager::rdlock()
+	pthread_mutex_t mutex;
+#ifdef DEBUG
+	bool is_locked;
+#endif
 	struct { // this is a series of attributes specific for each hostgroup
 		char * init_connect;
 		char * comment;
@@ -301,6 +328,7 @@ class MyHGC {	// MySQL Host Group Container
 		int8_t autocommit;
 		int8_t free_connections_pct;
 		int8_t handle_warnings;
+		int8_t load_balancing_algorithm;
 		bool multiplex;
 		bool connection_warming;
 		bool configured; // this variable controls if attributes are configured or not. If not configured, they do not apply
@@ -312,7 +340,26 @@ class MyHGC {	// MySQL Host Group Container
 		int64_t max_connections;
 		int32_t use_ssl;
 	} servers_defaults;
+	struct { // demand tracking used by mysql-connection_prewarm_ms , see MySQL_HostGroups_Manager::get_connections_to_prewarm()
+		uint32_t connections_created; // connections created on demand since the last round
+		uint32_t connecting; // pre-warmed connections not yet returned to the connection pool
+		double created_per_sec; // rate of connections created on demand, rises immediately and decays slowly
+		unsigned long long last_round;
+		// most common client profiles that required a new connection (space-saving top-k). The credentials
+		// aren't stored: they are read from GloMyAuth when a connection is created
+		struct {
+			char *username;
+			char *schemaname;
+			uint64_t userinfo_hash; // MySQL_Connection_userinfo::hash of the clients with this profile
+			uint32_t client_flag;
+			uint32_t charset;
+			uint32_t count;
+		} profiles[MYHGC_PREWARM_PROFILES];
+	} prewarm;
 	void reset_attributes();
+	void record_connection_demand(MySQL_Session *sess);
+	void clear_prewarm_profile(int idx);
+	MySQL_Connection * new_prewarmed_MyConn(MySrvC *mysrvc);
 	inline
 	bool handle_warnings_enabled() const {
 		return attributes.configured == true && attributes.handle_warnings != -1 ? attributes.handle_warnings : mysql_thread___handle_warnings;
@@ -323,7 +370,11 @@ class MyHGC {	// MySQL Host Group Container
 	}
 	MyHGC(int);
 	~MyHGC();
+	void lock();
+	void unlock();
+	bool trylock();
 	MySrvC *get_random_MySrvC(char * gtid_uuid, uint64_t gtid_trxid, int max_lag_ms, MySQL_Session *sess);
+	MySrvC *get_balanced_MySrvC(MySrvC **candidates, unsigned int num_candidates, unsigned int sum);
 	void refresh_online_server_count();
 	void log_num_online_server_count_error();
 	inline
@@ -468,6 +519,7 @@ struct p_hg_counter {
 		servers_table_version = 0,
 		server_connections_created,
 		server_connections_delayed,
+		server_connections_prewarmed,
 		server_connections_aborted,
 		client_connections_created,
 		client_connections_aborted,
@@ -604,7 +656,7 @@ class MySQL_HostGroups_Manager {
 	std::set<std::string> read_only_set1;
 	std::set<std::string> read_only_set2;
 #ifdef MHM_PTHREAD_MUTEX
-	pthread_mutex_t lock;
+	pthread_rwlock_t lock;
 #else
 	rwlock_t rwlock;
 #endif
@@ -867,6 +919,7 @@ class MySQL_HostGroups_Manager {
 		unsigned long server_connections_aborted;
 		unsigned long server_connections_created;
 		unsigned long server_connections_delayed;
+		unsigned long server_connections_prewarmed;
 		unsigned long server_connections_connected;
 		unsigned long myconnpoll_get;
 		unsigned long myconnpoll_get_ok;
@@ -950,6 +1003,8 @@ class MySQL_HostGroups_Manager {
 	void init();
 	void wrlock();
 	void wrunlock();
+	void rdlock();
+	void rdunlock();
 #ifdef DEBUG
 	bool is_locked = false;
 #endif
@@ -966,15 +1021,22 @@ class MySQL_HostGroups_Manager {
 		bool only_commit_runtime_mysql_servers = true,
 		bool update_version = false
 	);
+	/**
+	 * @brief Extracted from 'commit'. Applies 'mysql_servers_incoming' to the servers in memory, modifying
+	 *  only the servers that differ. Requires the caller to hold 'wrlock()'.
+	 * @param use_gtid Set to 'true' if any of the incoming servers has 'gtid_port' configured.
+	 * @return The number of servers created, changed or removed.
+	 */
+	unsigned int commit_apply_mysql_servers_incoming(bool& use_gtid);
 	/**
 	 * @brief Extracted from 'commit'. Performs the following actions:
-	 *  1. Re-generates the 'myhgm.mysql_servers' table.
-	 *  2. If supplied 'runtime_mysql_servers' is 'nullptr':
-	 *  	1. Gets the contents of the table via 'MYHGM_GEN_CLUSTER_ADMIN_RUNTIME_SERVERS'.
+	 *  1. If supplied 'runtime_mysql_servers' is 'nullptr':
+	 *  	1. Gets the contents of the 'myhgm.mysql_servers' table, already generated by the caller,
+	 *  	   via 'MYHGM_GEN_CLUSTER_ADMIN_RUNTIME_SERVERS'.
 	 *  	2. Save the resultset into 'this->runtime_mysql_servers'.
-	 *  3. If supplied 'runtime_mysql_servers' isn't 'nullptr':
+	 *  2. If supplied 'runtime_mysql_servers' isn't 'nullptr':
 	 *  	1. Updates the 'this->runtime_mysql_servers' with it.
-	 *  4. Updates 'HGM_TABLES::MYSQL_SERVERS' with raw checksum from 'this->runtime_mysql_servers'.
+	 *  3. Updates 'HGM_TABLES::MYSQL_SERVERS' with raw checksum from 'this->runtime_mysql_servers'.
 	 * @param runtime_mysql_servers If not 'nullptr', used to update 'this->runtime_mysql_servers'.
 	 * @return The updated 'MySQL_HostGroups_Manager::runtime_mysql_servers'.
 	 */
@@ -1101,6 +1163,7 @@ class MySQL_HostGroups_Manager {
 
 	void drop_all_idle_connections();
 	int get_multiple_idle_connections(int, unsigned long long, MySQL_Connection **, int);
+	int get_connections_to_prewarm(MySQL_Connection **, int, unsigned long long);
 	SQLite3_result * SQL3_Connection_Pool(bool _reset, int *hid = NULL);
 	SQLite3_result * SQL3_Free_Connections();
 
@@ -1213,7 +1276,7 @@ class MySQL_HostGroups_Manager {
 	SQLite3_result *get_mysql_errors(bool);
 
 	void shutdown();
-	void unshun_server_all_hostgroups(const char * address, uint16_t port, time_t t, int max_wait_sec, unsigned int *skip_hid);
+	void unshun_server_all_hostgroups(const char * address, uint16_t port, time_t t, int max_wait_sec, unsigned int *skip_hid, bool trylock_hostgroups=false);
 	MySrvC* find_server_in_hg(unsigned int _hid, const std::string& addr, int port);
 
 	MySQLServers_SslParams * get_Server_SSL_Params(char *hostname, int port, char *username);
@@ -2,9 +2,21 @@
 #define __CLASS_MYSQL_LOGGER_H
 #include "proxysql.h"
 #include "cpp.h"
+#include "MySQL_Logger_Block.h"
+
+#include <atomic>
 
 #define PROXYSQL_LOGGER_PTHREAD_MUTEX
 
+// maximum size of the events buffered by a single thread, further events are dropped
+#define MYSQL_LOGGER_BUFFER_MAX_SIZE	(32*1024*1024)
+// with 'mysql-eventslog_format=3' , an incomplete block is written after this time (microseconds)
+#define MYSQL_LOGGER_BLOCK_MAX_AGE_US	1000000
+// with 'mysql-eventslog_sample_rate' > 1 , the per digest counters are reset after this time (microseconds)
+#define MYSQL_LOGGER_SAMPLE_WINDOW_US	60000000
+// maximum number of digests tracked by every thread, the counters are reset when reached
+#define MYSQL_LOGGER_SAMPLE_MAX_DIGESTS	65536
+
 class MySQL_Event {
 	private:
 	uint32_t thread_id;
@@ -37,8 +49,10 @@ class MySQL_Event {
 	public:
 	MySQL_Event(log_event_type _et, uint32_t _thread_id, char * _username, char * _schemaname , uint64_t _start_time , uint64_t _end_time , uint64_t _query_digest, char *_client, size_t _client_len);
 	uint64_t write(std::fstream *f, MySQL_Session *sess);
-	uint64_t write_query_format_1(std::fstream *f);
-	uint64_t write_query_format_2_json(std::fstream *f);
+	uint64_t write_query(std::string& buf);
+	uint64_t write_query_format_1(std::string& buf);
+	uint64_t write_query_format_2_json(std::string& buf);
+	void write_query_format_3(MySQL_Logger_Block_Encoder& block);
 	void write_auth(std::fstream *f, MySQL_Session *sess);
 	void set_client_stmt_id(uint32_t client_stmt_id);
 	void set_query(const char *ptr, int len);
@@ -49,6 +63,23 @@ class MySQL_Event {
 	void set_gtid(MySQL_Session *sess);
 };
 
+/**
+ * @brief Query events encoded by a single thread, waiting to be written by the events writer thread.
+ * @details The mutex is only contended when the writer swaps the buffer, so the thread logging the
+ *  events never waits for the disk.
+ */
+class MySQL_Logger_Buffer {
+	public:
+	pthread_mutex_t mutex;
+	std::string data;
+	// events for 'mysql-eventslog_format=3' , 'blocks' contains the completed blocks
+	MySQL_Logger_Block_Encoder block;
+	std::string blocks;
+	unsigned long long dropped;
+	MySQL_Logger_Buffer();
+	~MySQL_Logger_Buffer();
+};
+
 class MySQL_Logger {
 	private:
 	struct {
@@ -57,8 +88,30 @@ class MySQL_Logger {
 		char *datadir;
 		unsigned int log_file_id;
 		unsigned int max_log_file_size;
+		// read without lock by the threads and by the writer thread
+		std::atomic<int> flush_timeout;
+		// the current log file is in the block format: it starts with the file header
+		bool block_file;
 		std::fstream *logfile;
 	} events;
+	// blocks written to the current log file , written as index when the file is closed
+	std::vector<mysql_logger_block_index_entry_t> events_block_index;
+	// events for 'mysql-eventslog_format=3' logged without buffering
+	MySQL_Logger_Block_Encoder events_block;
+	// buffers of all the threads that logged events with 'mysql-eventslog_flush_timeout' > 0
+	std::vector<MySQL_Logger_Buffer *> events_buffers;
+	pthread_mutex_t events_buffers_mutex;
+	// reused by events_collect_buffers() to swap the buffers of the threads , protected by events_buffers_mutex
+	std::string events_collect_buf;
+	// swapped with the incomplete block of the threads , compressed by events_collect_buffers() outside their mutex
+	MySQL_Logger_Block_Encoder events_collect_block;
+	// reused by events_write_block_unlocked()
+	std::string events_drain_buf;
+	pthread_t events_writer_thread;
+	std::atomic<bool> events_writer_started;
+	bool events_writer_shutdown;
+	pthread_mutex_t events_writer_mutex;
+	pthread_cond_t events_writer_cond;
 	struct {
 		bool enabled;
 		char *base_filename;
@@ -78,6 +131,14 @@ class MySQL_Logger {
 	void audit_open_log_unlocked();
 	unsigned int events_find_next_id();
 	unsigned int audit_find_next_id();
+	MySQL_Logger_Buffer * events_get_thread_buffer();
+	unsigned long long events_collect_buffers(std::string& blocks, std::string& data);
+	void events_write_collected_unlocked(std::string& blocks, std::string& data, unsigned long long dropped);
+	void events_drain_buffers_unlocked();
+	void events_start_writer();
+	void events_write_blocks_unlocked(const std::string& blocks);
+	void events_write_block_unlocked();
+	bool events_sample_query(uint64_t digest, unsigned long long duration, unsigned long long curtime);
 	public:
 	MySQL_Logger();
 	~MySQL_Logger();
@@ -94,6 +155,7 @@ class MySQL_Logger {
 	void flush();
 	void wrlock();
 	void wrunlock();
+	void * events_writer_loop();
 };
 
 
@@ -0,0 +1,173 @@
+#ifndef __CLASS_MYSQL_LOGGER_BLOCK_H
+#define __CLASS_MYSQL_LOGGER_BLOCK_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+/**
+ * @file MySQL_Logger_Block.h
+ * @brief Block based format of the events log, 'mysql-eventslog_format=3'.
+ * @details This header has no dependency on the rest of ProxySQL, so it can be used by the tools
+ *  reading the events log.
+ *
+ *  Layout of a file:
+ *  - MYSQL_LOGGER_BLOCK_FILE_MAGIC , followed by the format version (uint32_t) and 4 bytes reserved.
+ *  - Blocks: a 'mysql_logger_block_header_t' followed by 'compressed_len' bytes. The payload is LZ4
+ *    compressed, and once decompressed contains the events of the block stored by column:
+ *    . event type , 1 byte per event
+ *    . thread_id , varint
+ *    . username , schemaname , client : dictionary (number of entries , then length and value of every
+ *      entry) followed by the dictionary index of every event , varint
+ *    . hostgroup + 1 , varint (0 if the event has no hostgroup)
+ *    . server : dictionary , as above
+ *    . start_time : the first value , then the delta from the previous event , zigzag varint
+ *    . end_time - start_time , zigzag varint
+ *    . client_stmt_id , affected_rows , last_insert_id , rows_sent : varint
+ *    . flags , 1 byte per event (MYSQL_LOGGER_BLOCK_FLAG_*)
+ *    . query_digest , 8 bytes per event
+ *    . query : length of every query , varint , followed by all the queries
+ *  - Index, only written when the file is closed: MYSQL_LOGGER_BLOCK_INDEX_MAGIC , number of entries
+ *    (uint32_t) and a 'mysql_logger_block_index_entry_t' for every block. The file ends with the offset
+ *    of the index (uint64_t) and MYSQL_LOGGER_BLOCK_TRAILER_MAGIC.
+ *    A file without index (for example the file currently in use) can still be read scanning the
+ *    headers of the blocks.
+ *
+ *  All the integers are little endian.
+ */
+
+#define MYSQL_LOGGER_BLOCK_FILE_MAGIC	"PSQLEVB3"
+#define MYSQL_LOGGER_BLOCK_TRAILER_MAGIC	"PSQLIDX3"
+#define MYSQL_LOGGER_BLOCK_VERSION	1
+#define MYSQL_LOGGER_BLOCK_MAGIC	0x334B4C42 // "BLK3"
+#define MYSQL_LOGGER_BLOCK_INDEX_MAGIC	0x33584449 // "IDX3"
+#define MYSQL_LOGGER_BLOCK_FILE_HEADER_SIZE	16
+#define MYSQL_LOGGER_BLOCK_TRAILER_SIZE	16
+
+// maximum number of events in a block
+#define MYSQL_LOGGER_BLOCK_MAX_EVENTS	4096
+// a block is also completed when its uncompressed size reaches this size
+#define MYSQL_LOGGER_BLOCK_MAX_SIZE	(4*1024*1024)
+
+#define MYSQL_LOGGER_BLOCK_FLAG_AFFECTED_ROWS	0x01
+#define MYSQL_LOGGER_BLOCK_FLAG_ROWS_SENT	0x02
+
+#pragma pack(push, 1)
+typedef struct {
+	uint32_t magic;
+	uint32_t events;
+	uint32_t raw_len;
+	uint32_t compressed_len;
+	uint64_t min_start_time;
+	uint64_t max_start_time;
+} mysql_logger_block_header_t;
+
+typedef struct {
+	uint64_t offset;
+	uint32_t events;
+	uint32_t reserved;
+	uint64_t min_start_time;
+	uint64_t max_start_time;
+} mysql_logger_block_index_entry_t;
+#pragma pack(pop)
+
+/**
+ * @brief A query event as stored in a block. The strings are not required to be null terminated.
+ */
+typedef struct {
+	uint8_t et;
+	uint8_t flags;
+	uint32_t thread_id;
+	const char *username;
+	size_t username_len;
+	const char *schemaname;
+	size_t schemaname_len;
+	const char *client;
+	size_t client_len;
+	uint64_t hid;  // UINT64_MAX if not set
+	const char *server;
+	size_t server_len;
+	uint64_t start_time;
+	uint64_t end_time;
+	uint64_t client_stmt_id;
+	uint64_t affected_rows;
+	uint64_t last_insert_id;
+	uint64_t rows_sent;
+	uint64_t query_digest;
+	const char *query;
+	size_t query_len;
+} mysql_logger_block_event_t;
+
+/**
+ * @brief A column of strings with few distinct values, encoded as a dictionary and an index per event.
+ */
+class MySQL_Logger_Block_Dict {
+	public:
+	std::unordered_map<std::string, uint32_t> map;
+	std::vector<const std::string *> values;
+	std::string ids;
+	uint32_t last_id;
+	MySQL_Logger_Block_Dict() : last_id(0) {}
+	void add(const char *s, size_t len);
+	void encode(std::string& out);
+	void clear();
+};
+
+/**
+ * @brief Accumulates query events and encodes them into a compressed block.
+ */
+class MySQL_Logger_Block_Encoder {
+	private:
+	uint32_t events;
+	uint64_t min_start_time;
+	uint64_t max_start_time;
+	uint64_t prev_start_time;
+	size_t raw_size;
+	std::string col_et;
+	std::string col_thread_id;
+	MySQL_Logger_Block_Dict col_username;
+	MySQL_Logger_Block_Dict col_schemaname;
+	MySQL_Logger_Block_Dict col_client;
+	std::string col_hid;
+	MySQL_Logger_Block_Dict col_server;
+	std::string col_start_time;
+	std::string col_duration;
+	std::string col_client_stmt_id;
+	std::string col_affected_rows;
+	std::string col_last_insert_id;
+	std::string col_rows_sent;
+	std::string col_flags;
+	std::string col_query_digest;
+	std::string col_query_len;
+	std::string col_query;
+	// reused to build the uncompressed payload
+	std::string raw;
+	public:
+	// monotonic time of the first event of the block, set by the caller
+	unsigned long long first_event_time;
+	MySQL_Logger_Block_Encoder();
+	void add(const mysql_logger_block_event_t& ev);
+	uint32_t size() { return events; }
+	bool full() { return events >= MYSQL_LOGGER_BLOCK_MAX_EVENTS || raw_size >= MYSQL_LOGGER_BLOCK_MAX_SIZE; }
+	size_t encode(std::string& out);
+	void clear();
+};
+
+/**
+ * @brief Decodes a block produced by MySQL_Logger_Block_Encoder.
+ * @details The returned events point to memory owned by the decoder, valid until the next call of decode().
+ */
+class MySQL_Logger_Block_Decoder {
+	private:
+	std::string raw;
+	std::vector<std::string> dicts[4];
+	public:
+	std::vector<mysql_logger_block_event_t> events;
+	bool decode(const mysql_logger_block_header_t& hdr, const char *payload);
+};
+
+size_t mysql_logger_block_file_header(char *buf);
+bool mysql_logger_block_check_file_header(const char *buf);
+#endif // __CLASS_MYSQL_LOGGER_BLOCK_H
@@ -1,6 +1,8 @@
 #ifndef __CLASS_MYSQL_MONITOR_H
 #define __CLASS_MYSQL_MONITOR_H
+#include <atomic>
 #include <future>
+#include <memory>
 #include "prometheus/counter.h"
 #include "prometheus/gauge.h"
 
@@ -266,6 +268,12 @@ public:
 	 * @details This way we avoid non-needed locking on 'MySQL_HostGroups_Manager' for server search.
 	 */
 	const std::vector<gr_host_def_t>* cur_monitored_gr_srvs = nullptr;
+	/**
+	 * @brief Set by the scheduler of 'mysql-monitor_event_loop' when the check runs on the blocking workers.
+	 * @details Cleared when the check is destroyed, so the scheduler doesn't start another check of the same
+	 *  server in the meantime. Shared with the scheduler, that can drop the server before the check completes.
+	 */
+	std::shared_ptr<std::atomic<bool>> blocking_in_flight;
 
 	MySQL_Monitor_State_Data(MySQL_Monitor_State_Data_Task_Type task_type, char* h, int p, bool _use_ssl = 0, int g = 0);
 	~MySQL_Monitor_State_Data();
@@ -442,8 +450,87 @@ struct DNS_Resolve_Data {
 	unsigned int refresh_intv = 0;
 };
 
+#define MONITOR_CHECK_HISTORY_SIZE	16
+
+enum MySQL_Monitor_Check_Type {
+	MON_CHECK_CONNECT = 0,
+	MON_CHECK_PING,
+	MON_CHECK_READ_ONLY,
+	MON_CHECK_REPLICATION_LAG,
+	MON_CHECK__SIZE
+};
+
+// flags of MySQL_Monitor_Check_Result
+#define MON_CHECK_F_ERROR	0x01
+#define MON_CHECK_F_ACCESS_DENIED	0x02	// error starts with "Access denied for user"
+#define MON_CHECK_F_AUTH_ERROR	0x04	// ProxySQL "Access denied" or expired password
+#define MON_CHECK_F_TIMEOUT	0x08	// error starts with "timeout"
+#define MON_CHECK_F_NULL_VALUE	0x10
+
+struct MySQL_Monitor_Check_Result {
+	unsigned long long time_start_us;
+	unsigned long long success_time_us;
+	long long value;
+	unsigned int flags;
+};
+
+/**
+ * @brief Recent check results of a single backend, one ring per check type.
+ * @details Besides the rings, the number of consecutive failures is tracked for the checks that
+ *  compare it against a configurable threshold, that can be bigger than MONITOR_CHECK_HISTORY_SIZE.
+ */
+struct MySQL_Monitor_Server_History {
+	std::string hostname;
+	int port;
+	unsigned long long last_check_us;
+	MySQL_Monitor_Check_Result results[MON_CHECK__SIZE][MONITOR_CHECK_HISTORY_SIZE];
+	unsigned int count[MON_CHECK__SIZE];
+	unsigned int ping_errors;	// consecutive ping errors , excluding "Access denied for user"
+	unsigned int ping_failures;	// consecutive ping errors , excluding all authentication errors
+	unsigned int read_only_timeouts;	// consecutive read_only checks timed out with no value
+};
+
+/**
+ * @brief In-memory history of the monitor checks.
+ * @details Checks results are stored in per-server rings that are the source for shunning, latency
+ *  and read_only decisions. The results are also queued and written to the monitor log tables in
+ *  batches by flush(): the log tables are only used for admin visibility.
+ */
+class MySQL_Monitor_History {
+	private:
+	struct log_row {
+		std::string hostname;
+		int port;
+		unsigned long long time_start_us;
+		unsigned long long success_time_us;
+		long long value;
+		bool has_value;
+		bool has_error;
+		std::string error;
+	};
+	pthread_mutex_t mutex;
+	pthread_mutex_t flush_mutex;
+	std::unordered_map<std::string, MySQL_Monitor_Server_History *> servers;
+	std::vector<log_row> pending[MON_CHECK__SIZE];
+	MySQL_Monitor_Server_History * get_server(const char *hostname, int port);
+
+	public:
+	MySQL_Monitor_History();
+	~MySQL_Monitor_History();
+	void add(MySQL_Monitor_Check_Type type, const char *hostname, int port, unsigned long long time_start_us, unsigned long long success_time_us, bool has_value, long long value, const char *error);
+	bool ping_failed(const char *hostname, int port, unsigned int max_failures, bool exclude_auth_errors);
+	bool read_only_timed_out(const char *hostname, int port, unsigned int max_timeouts);
+	void get_servers_to_shun(unsigned int max_failures, std::vector<std::pair<std::string,int>>& result);
+	void get_ping_latencies(std::vector<std::tuple<std::string,int,unsigned int>>& result);
+	void flush(SQLite3DB *db);
+	void purge(unsigned long long older_than_us);
+};
+
+
+class Monitor_Scheduler;
 
 class MySQL_Monitor {
+	friend class Monitor_Scheduler;
 	public:
 	static std::string dns_lookup(const std::string& hostname, bool return_hostname_if_lookup_fails = true, size_t* ip_count = NULL);
 	static std::string dns_lookup(const char* hostname, bool return_hostname_if_lookup_fails = true, size_t* ip_count = NULL);
@@ -506,6 +593,7 @@ class MySQL_Monitor {
 	SQLite3DB *admindb;	// internal database
 	SQLite3DB *monitordb;	// internal database
 	SQLite3DB *monitor_internal_db;	// internal database
+	MySQL_Monitor_History check_history;
 #ifdef DEBUG
 	bool proxytest_forced_timeout;
 #endif
@@ -524,6 +612,7 @@ class MySQL_Monitor {
 	void * monitor_aws_aurora();
 	void * monitor_replication_lag();
 	void * monitor_dns_cache();
+	void * monitor_scheduler();
 	void * run();
 	void populate_monitor_mysql_server_group_replication_log();
 	void populate_monitor_mysql_server_galera_log();
@@ -202,8 +202,17 @@ class MySQL_Session
 
 	void handler___status_WAITING_CLIENT_DATA___STATE_SLEEP___MYSQL_COM_QUERY___create_mirror_session();
 	int handler_again___status_PINGING_SERVER();
+	int handler_again___status_PREWARMING_CONNECTION();
 	int handler_again___status_RESETTING_CONNECTION();
 	bool handler_again___status_SHOW_WARNINGS(MySQL_Data_Stream *, bool);
+	/**
+	 * @brief Checks again the Query Cache while another session refreshes the entry for the current query.
+	 * @details Called in PROCESSING_QUERY while 'qc_wait_until' is set. If the entry was refreshed the
+	 *   resultset is sent to the client and the request is completed. Otherwise the session is paused
+	 *   again until 'qc_wait_until', after which the query is sent to the backend.
+	 * @return 'true' if the query must not be sent to the backend (yet), 'false' otherwise.
+	 */
+	bool handler_again___query_cache_wait();
 	void handler_again___new_thread_to_kill_connection();
 	void handler_KillConnectionIfNeeded();
 
@@ -293,6 +302,7 @@ class MySQL_Session
 	// uint64_t
 	unsigned long long start_time;
 	unsigned long long pause_until;
+	unsigned long long qc_wait_until; // waiting for another session to refresh the Query Cache entry, see query_cache_refresh_wait_ms
 
 	unsigned long long idle_since;
 	unsigned long long transaction_started_at;
@@ -7,10 +7,12 @@
 #include "proxysql.h"
 #include "cpp.h"
 #include "MySQL_Variables.h"
+#include "ProxySQL_IO_Uring.h"
 #ifdef IDLE_THREADS
 #include <sys/epoll.h>
 #endif // IDLE_THREADS
 #include <atomic>
+#include <memory>
 
 #include "prometheus_helpers.h"
 
@@ -52,6 +54,46 @@ typedef struct _kill_queue_t {
 	std::vector<thr_id_usr *> query_ids;
 } kill_queue_t;
 
+#define PROCESSLIST_COLUMNS	16
+// a thread stops publishing its processlist snapshot if not read for this time (microseconds)
+#define PROCESSLIST_SNAPSHOT_IDLE_US	10000000
+
+/**
+ * @brief Filter applied to the sessions before the rows of stats_mysql_processlist are created.
+ */
+typedef struct _processlist_filter_t {
+	uint32_t session_id; // 0 for any session
+	int hostgroup; // INT_MIN for any hostgroup
+	const char *username; // NULL for any user
+	bool skip_sleeping; // skip the sessions with command 'Sleep'
+} processlist_filter_t;
+
+typedef struct _processlist_snapshot_row_t {
+	uint32_t session_id;
+	int hostgroup;
+	bool sleeping;
+	// offset of the value of every column in MySQL_Processlist_Snapshot::data , UINT32_MAX for NULL
+	uint32_t off[PROCESSLIST_COLUMNS];
+} processlist_snapshot_row_t;
+
+/**
+ * @brief Compact copy of the sessions of a MySQL_Thread, as shown in stats_mysql_processlist.
+ * @details All the values are stored null terminated in a single buffer, so copying the sessions
+ *  requires no allocation per session.
+ */
+class MySQL_Processlist_Snapshot {
+	public:
+	unsigned long long time;
+	int extended;
+	std::vector<processlist_snapshot_row_t> rows;
+	std::string data;
+	MySQL_Processlist_Snapshot();
+	void begin_row(uint32_t session_id, int hostgroup, bool sleeping);
+	void set(int col, const char *s);
+	void set(int col, const char *s, size_t len);
+	void add_rows(SQLite3_result *result, unsigned int thread_idx, const processlist_filter_t *filter);
+};
+
 enum MySQL_Thread_status_variable {
 	st_var_backend_stmt_prepare,
 	st_var_backend_stmt_execute,
@@ -110,6 +152,14 @@ class __attribute__((aligned(64))) MySQL_Thread
 	bool retrieve_gtids_required; // if any of the servers has gtid_port enabled, this needs to be turned on too
 
 	PtrArray *cached_connections;
+	// protects cached_connections while other threads can take its connections , see cached_connections_shared
+	pthread_mutex_t cached_connections_mutex;
+	// connections in cached_connections that other threads can take , read without lock by
+	// steal_MyConn_from_threads() before locking the mutex. Always 0 if cached_connections_shared is false
+	std::atomic<unsigned int> cached_connections_avail;
+	// set at the end of every loop when mysql-connpool_thread_cache_size is not 0 . If false, the cache
+	// is private to this thread and accessed without lock
+	bool cached_connections_shared;
 
 #ifdef IDLE_THREADS
 	struct epoll_event events[MY_EPOLL_THREAD_MAXEVENTS];
@@ -148,6 +198,15 @@ class __attribute__((aligned(64))) MySQL_Thread
 	int run_ComputePollTimeout();
 	void run_StopListener();
 	void run_SetAllSession_ToProcess0();
+	void run_PublishProcesslistSnapshot();
+
+	// snapshot of the processlist published by the thread , if 'mysql-show_processlist_snapshot_ms' > 0
+	std::shared_ptr<MySQL_Processlist_Snapshot> processlist_snapshot;
+	pthread_mutex_t processlist_snapshot_mutex;
+	unsigned long long processlist_snapshot_time;
+	// last time the processlist was read , and its 'show_processlist_extended'
+	std::atomic<unsigned long long> processlist_snapshot_read_time;
+	std::atomic<int> processlist_snapshot_extended;
 
 
 	protected:
@@ -158,6 +217,8 @@ class __attribute__((aligned(64))) MySQL_Thread
 	void *gen_args;	// this is a generic pointer to create any sort of structure
 
 	ProxySQL_Poll mypolls;
+	// used to batch the reads of the data streams , if 'mysql-use_io_uring' is enabled
+	ProxySQL_IO_Uring io_ring;
 	pthread_t thread_id;
 	unsigned long long curtime;
 	unsigned long long pre_poll_time;
@@ -207,9 +268,12 @@ class __attribute__((aligned(64))) MySQL_Thread
 	MySQL_Session * create_new_session_and_client_data_stream(int _fd);
 	bool init();
 	void run___get_multiple_idle_connections(int& num_idles);
+	void run___prewarm_connections();
 	void run___cleanup_mirror_queue();
   	void ProcessAllMyDS_BeforePoll();
   	void ProcessAllMyDS_AfterPoll();
+  	void ProcessReadyMyDS_AfterPoll();
+	void ProcessAllMyDS_BatchedReads();
 	void run();
   void poll_listener_add(int sock);
   void poll_listener_del(int sock);
@@ -229,9 +293,13 @@ class __attribute__((aligned(64))) MySQL_Thread
 	void Get_Memory_Stats();
 	MySQL_Connection * get_MyConn_local(unsigned int, MySQL_Session *sess, char *gtid_uuid, uint64_t gtid_trxid, int max_lag_ms);
 	void push_MyConn_local(MySQL_Connection *);
-	void return_local_connections();
+	void return_local_connections(unsigned int keep=0);
+	MySQL_Connection * find_MyConn_in_cache(PtrArray *cache, unsigned int _hid, MySQL_Session *sess, char *gtid_uuid, uint64_t gtid_trxid, int max_lag_ms);
+	MySQL_Connection * steal_MyConn_from_threads(unsigned int _hid, MySQL_Session *sess, char *gtid_uuid, uint64_t gtid_trxid, int max_lag_ms);
 	void Scan_Sessions_to_Kill(PtrArray *mysess);
 	void Scan_Sessions_to_Kill_All();
+	void build_processlist_snapshot(MySQL_Processlist_Snapshot& snap, int extended);
+	std::shared_ptr<MySQL_Processlist_Snapshot> get_processlist_snapshot(int extended, unsigned long long now, unsigned long long max_age);
 };
 
 
@@ -407,6 +475,7 @@ class MySQL_Threads_Handler
 		bool monitor_wait_timeout;
 		bool monitor_writer_is_also_reader;
 		bool monitor_replication_lag_group_by_host;
+		bool monitor_event_loop;
 		//! How frequently a replication lag check is performed. Unit: 'ms'.
 		int monitor_replication_lag_interval;
 		//! Read only check timeout. Unit: 'ms'.
@@ -449,7 +518,10 @@ class MySQL_Threads_Handler
 		int connect_timeout_server;
 		int connect_timeout_server_max;
 		int free_connections_pct;
+		int connpool_thread_cache_size;
+		int connection_prewarm_ms;
 		int show_processlist_extended;
+		int show_processlist_snapshot_ms;
 #ifdef IDLE_THREADS
 		int session_idle_ms;
 		bool session_idle_show_processlist;
@@ -490,6 +562,8 @@ class MySQL_Threads_Handler
 		bool automatic_detect_sqli;
 		bool firewall_whitelist_enabled;
 		bool use_tcp_keepalive;
+		bool use_io_uring;
+		bool use_writev;
 		int tcp_keepalive_time;
 		int throttle_connections_per_sec_to_hostgroup;
 		int max_transaction_idle_time;
@@ -512,6 +586,7 @@ class MySQL_Threads_Handler
 		int default_query_timeout;
 		int query_processor_iterations;
 		int query_processor_regex;
+		bool query_processor_regex_set;
 		int set_query_lock_on_hostgroup;
 		int set_parser_algorithm;
 		int reset_connection_algorithm;
@@ -532,10 +607,14 @@ class MySQL_Threads_Handler
 		uint32_t server_capabilities;
 		int poll_timeout;
 		int poll_timeout_on_failure;
+		int poll_engine;
 		int connpoll_reset_queue_length;
 		char *eventslog_filename;
 		int eventslog_filesize;
 		int eventslog_default_log;
+		int eventslog_flush_timeout;
+		int eventslog_sample_rate;
+		int eventslog_sample_slow_ms;
 		int eventslog_format;
 		char *auditlog_filename;
 		int auditlog_filesize;
@@ -550,6 +629,12 @@ class MySQL_Threads_Handler
 		int query_cache_size_MB;
 		int query_cache_soft_ttl_pct;
 		int query_cache_handle_warnings;
+		int query_cache_eviction_policy;
+		int query_cache_stale_grace_ms;
+		int query_cache_refresh_wait_ms;
+		bool query_cache_compression;
+		int query_cache_engine;
+		int query_cache_shards;
 		int min_num_servers_lantency_awareness;
 		int aurora_max_lag_ms_only_read_from_replicas;
 		bool stats_time_backend_query;
@@ -674,6 +759,7 @@ class MySQL_Threads_Handler
 	void init(unsigned int num=0, size_t stack=0);
 	proxysql_mysql_thread_t *create_thread(unsigned int tn, void *(*start_routine) (void *), bool);
 	void shutdown_threads();
+	bool is_shutting_down() { return __sync_fetch_and_add(&shutdown_,0); }
 	int listener_add(const char *iface);
 	int listener_add(const char *address, int port);
 	int listener_del(const char *iface);
@@ -681,7 +767,7 @@ class MySQL_Threads_Handler
 	void start_listeners();
 	void stop_listeners();
 	void signal_all_threads(unsigned char _c=0);
-	SQLite3_result * SQL3_Processlist();
+	SQLite3_result * SQL3_Processlist(const processlist_filter_t *filter=NULL);
 	SQLite3_result * SQL3_GlobalStatus(bool _memory);
 	bool kill_session(uint32_t _thread_session_id);
 	unsigned long long get_total_mirror_queue();
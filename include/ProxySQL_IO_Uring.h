@@ -0,0 +1,56 @@
+#ifndef __CLASS_PROXYSQL_IO_URING
+#define __CLASS_PROXYSQL_IO_URING
+
+#include <stdint.h>
+#include <stddef.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define PROXYSQL_IO_URING
+#endif
+#endif
+
+// minimum number of reads to use a single io_uring submission instead of recv()
+#define IO_URING_MIN_BATCH	2
+// number of entries of the submission queue , more reads are split in multiple submissions
+#define IO_URING_ENTRIES	256
+
+/**
+ * @brief Minimal io_uring ring used by MySQL_Thread to batch socket reads.
+ * @details The ring is driven with the raw io_uring syscalls. All the requests prepared with
+ *  prep_recv() are submitted and completed with a single io_uring_enter() in submit_and_wait():
+ *  they are issued with MSG_DONTWAIT , so they never block and no request is left in flight.
+ */
+class ProxySQL_IO_Uring {
+	private:
+	int ring_fd;
+	unsigned int entries;
+	unsigned int pending;
+	unsigned int sqe_tail;
+	// submission queue
+	void *sq_ptr;
+	size_t sq_ring_size;
+	unsigned *sq_head;
+	unsigned *sq_tail;
+	unsigned *sq_mask;
+	unsigned *sq_array;
+	struct io_uring_sqe *sqes;
+	size_t sqes_size;
+	// completion queue
+	void *cq_ptr;
+	size_t cq_ring_size;
+	unsigned *cq_head;
+	unsigned *cq_tail;
+	unsigned *cq_mask;
+	struct io_uring_cqe *cqes;
+
+	public:
+	ProxySQL_IO_Uring();
+	~ProxySQL_IO_Uring();
+	bool init(unsigned int _entries);
+	bool enabled() { return ring_fd >= 0; }
+	unsigned int capacity() { return entries - pending; }
+	bool prep_recv(int fd, void *buf, unsigned int len, uint64_t user_data);
+	int submit_and_wait(void (*cb)(uint64_t user_data, int res, void *arg), void *arg);
+};
+#endif // __CLASS_PROXYSQL_IO_URING
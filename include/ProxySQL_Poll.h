@@ -2,6 +2,10 @@
 #define __CLASS_PROXYSQL_POLL
 
 //#include "MySQL_Data_Stream.h"
+#include <vector>
+
+#define POLL_ENGINE_POLL	0
+#define POLL_ENGINE_EPOLL	1
 
 class iface_info {
 	public:
@@ -26,6 +30,24 @@ class ProxySQL_Poll {
 	private:
 	void shrink();
 	void expand(unsigned int more);
+	void epoll_sync();
+	void set_fd_idx(int fd, int i);
+	void set_dirty(unsigned int i) {
+		if (dirty[i] == 0) {
+			dirty[i]=1;
+			dirty_idx.push_back(i);
+		}
+	}
+	// events currently registered in the epoll instance for each entry of fds
+	uint32_t *registered_events;
+	// entries whose events may differ from registered_events , only used with epoll.
+	// dirty_idx can contain indexes no longer dirty or beyond len , skipped by epoll_sync()
+	unsigned char *dirty;
+	std::vector<unsigned int> dirty_idx;
+	// map from file descriptor to its index in fds , -1 if not present
+	int *fd_idx;
+	unsigned int fd_idx_size;
+	unsigned int epoll_events_size;
 
 	public:
 	unsigned int len;
@@ -39,11 +61,31 @@ class ProxySQL_Poll {
 	unsigned int poll_timeout;
 	unsigned long loops;
 	StatCounters *loop_counters;
+	// epoll instance used instead of poll() , -1 if poll() is used
+	int efd;
+	// events returned by the last epoll_wait() , only the first ready_len are valid
+	struct epoll_event *epoll_events;
+	unsigned int ready_len;
 
 	ProxySQL_Poll();
 	~ProxySQL_Poll();
+	bool init_epoll();
+	int wait(int timeout);
+	int get_fd_idx(int fd);
 	void add(uint32_t _events, int _fd, MySQL_Data_Stream *_myds, unsigned long long sent_time);
 	void remove_index_fast(unsigned int i);
+	/**
+	 * @brief Sets the events of an entry. Every change of fds[i].events must use this function,
+	 *  so that epoll_sync() only has to check the entries that changed.
+	 */
+	void set_events(unsigned int i, short _events) {
+		if (fds[i].events != _events) {
+			fds[i].events=_events;
+			if (efd >= 0) {
+				set_dirty(i);
+			}
+		}
+	}
 	int find_index(int fd);
 };
 #endif // __CLASS_PROXYSQL_POLL
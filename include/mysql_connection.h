@@ -60,6 +60,9 @@ class MySQL_Connection {
 	void update_warning_count_from_statement();
 	bool is_expired(unsigned long long timeout);
 	unsigned long long inserted_into_pool;
+	unsigned long long query_sent_at; // 0 if no query is running, see backend_query_started()
+	void backend_query_started();
+	void backend_query_completed();
 	void connect_start_SetAttributes();
 	void connect_start_SetCharset();
 	void connect_start_SetClientFlag(unsigned long&);
@@ -99,6 +102,14 @@ class MySQL_Connection {
 	std::vector<uint32_t> dynamic_variables_idx;
 	unsigned int reorder_dynamic_variables_idx();
 
+	// used by MySrvConnList to index the free connections of a server
+	struct {
+		uint64_t fingerprint;
+		unsigned int idx; // position in MySrvConnList::conns
+		MySQL_Connection *prev;
+		MySQL_Connection *next;
+	} pool_index;
+
 	struct {
 		unsigned long length;
 		char *ptr;
@@ -157,6 +168,7 @@ class MySQL_Connection {
 	bool async_fetch_row_start;
 	bool send_quit;
 	bool reusable;
+	bool prewarmed; // created by mysql-connection_prewarm_ms and never used by a client session
 	bool processing_multi_statement;
 	bool multiplex_delayed;
 	bool unknown_transaction_status;
@@ -261,6 +273,7 @@ class MySQL_Connection {
 	bool match_tracked_options(const MySQL_Connection *c);
 	bool requires_CHANGE_USER(const MySQL_Connection *client_conn);
 	unsigned int number_of_matching_session_variables(const MySQL_Connection *client_conn, unsigned int& not_matching);
+	uint64_t get_pool_fingerprint() const;
 	unsigned long get_mysql_thread_id() { return mysql ? mysql->thread_id : 0; }
 	static void set_ssl_params(MYSQL *mysql, MySQLServers_SslParams *ssl_params);
 
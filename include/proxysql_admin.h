@@ -231,6 +231,7 @@ class ProxySQL_Admin {
 		bool admin_read_only;
 //		bool hash_passwords;
 		bool vacuum_stats;
+		bool stats_virtual_tables;
 		char * admin_version;
 		char * cluster_username;
 		char * cluster_password;
@@ -292,6 +293,7 @@ class ProxySQL_Admin {
 	void insert_into_tables_defs(std::vector<table_def_t *> *, const char *table_name, const char *table_def);
 	void drop_tables_defs(std::vector<table_def_t *> *tables_defs);
 	void check_and_build_standard_tables(SQLite3DB *db, std::vector<table_def_t *> *tables_defs);
+	bool set_stats_virtual_tables(bool enable);
 
 #ifdef DEBUG
 	void flush_debug_levels_runtime_to_database(SQLite3DB *db, bool replace);
@@ -561,12 +563,14 @@ class ProxySQL_Admin {
 	int stats___mysql_query_digests_v2(bool reset, bool copy, bool use_resultset);
 	//void stats___mysql_query_digests_reset();
 	void stats___mysql_commands_counters();
-	void stats___mysql_processlist();
+	void stats___mysql_processlist(const char *query_no_space=NULL);
 	void stats___mysql_free_connections();
 	void stats___mysql_connection_pool(bool _reset);
 	void stats___mysql_errors(bool reset);
 	void stats___memory_metrics();
 	void stats___mysql_global();
+	SQLite3_result * SQL3_mysql_global();
+	const char * get_stats_table_def(const char *table_name);
 	void stats___mysql_users();
 
 	void stats___proxysql_servers_checksums();
@@ -670,4 +674,19 @@ class ProxySQL_Admin {
 	// FLUSH LOGS
 	void flush_logs();
 };
+
+// SQLite module of the stats tables read directly from the runtime structures, see 'admin-stats_virtual_tables'
+#define PROXYSQL_STATS_VTAB_MODULE "proxysql_stats"
+
+/**
+ * @brief Registers on the connection the SQLite module of the stats virtual tables.
+ * @details The module must be registered on every connection that reads the stats schema while
+ *  'admin-stats_virtual_tables' is enabled: the stats database itself and the databases attaching it.
+ * @return false if the loaded SQLite3 doesn't support virtual tables.
+ */
+bool proxysql_stats_vtab_register(SQLite3DB *db);
+/**
+ * @brief Tells if the stats table is one of the tables that can be replaced by a virtual table.
+ */
+bool proxysql_stats_vtab_supported(const char *table_name);
 #endif /* __CLASS_PROXYSQL_ADMIN_H */
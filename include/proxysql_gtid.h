@@ -2,13 +2,48 @@
 #define PROXYSQL_GTID
 // highly inspired by libslave
 // https://github.com/vozbu/libslave/
-#include <unordered_map>
-#include <list>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <memory>
 #include <utility>
 
-typedef std::pair<std::string, int64_t> gtid_t;
 typedef std::pair<int64_t, int64_t> gtid_interval_t;
-typedef std::unordered_map<std::string, std::list<gtid_interval_t>> gtid_set_t;
+
+/**
+ * @brief Binary form of a server UUID.
+ */
+struct gtid_uuid_t {
+	uint64_t hi;
+	uint64_t lo;
+	bool operator==(const gtid_uuid_t& o) const { return hi == o.hi && lo == o.lo; }
+	bool operator<(const gtid_uuid_t& o) const { return hi < o.hi || (hi == o.hi && lo < o.lo); }
+	/**
+	 * @brief Parses the 32 hexadecimal digits of a UUID , dashes are ignored.
+	 * @param s The UUID , terminated by a null byte or by ':' .
+	 * @return false if the UUID is not valid.
+	 */
+	bool parse(const char *s);
+	std::string to_string() const;
+};
+
+/**
+ * @brief A set of GTIDs , like the 'gtid_executed' of a server.
+ * @details UUIDs are kept sorted, and each UUID has a sorted vector of disjoint and not adjacent intervals.
+ *  A lookup is a binary search on the UUIDs followed by a binary search on the intervals, and contiguous
+ *  transactions are merged in the same interval so that the vectors stay small even on busy writers.
+ */
+class gtid_set_t {
+	private:
+	std::vector<std::pair<gtid_uuid_t, std::vector<gtid_interval_t>>> uuids;
+	std::vector<gtid_interval_t> * find_intervals(const gtid_uuid_t& uuid, bool create);
+	public:
+	void add(const gtid_uuid_t& uuid, int64_t trxid);
+	void add_interval(const gtid_uuid_t& uuid, int64_t trx_from, int64_t trx_to);
+	bool contains(const gtid_uuid_t& uuid, int64_t trxid) const;
+	bool empty() const { return uuids.empty(); }
+	std::string to_string() const;
+};
 
 /*
 class Gtid_Server_Info {
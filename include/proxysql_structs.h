@@ -259,6 +259,7 @@ enum session_status {
 	SHOW_WARNINGS,
 	SETTING_NEXT_ISOLATION_LEVEL,
 	SETTING_NEXT_TRANSACTION_READ,
+	PREWARMING_CONNECTION,
 	session_status___NONE // special marker
 };
 
@@ -792,6 +793,7 @@ __thread int mysql_thread___max_allowed_packet;
 __thread bool mysql_thread___automatic_detect_sqli;
 __thread bool mysql_thread___firewall_whitelist_enabled;
 __thread bool mysql_thread___use_tcp_keepalive;
+__thread bool mysql_thread___use_writev;
 __thread int mysql_thread___tcp_keepalive_time;
 __thread int mysql_thread___throttle_connections_per_sec_to_hostgroup;
 __thread int mysql_thread___max_transaction_idle_time;
@@ -811,6 +813,8 @@ __thread int mysql_thread___default_query_delay;
 __thread int mysql_thread___default_query_timeout;
 __thread int mysql_thread___long_query_time;
 __thread int mysql_thread___free_connections_pct;
+__thread int mysql_thread___connpool_thread_cache_size;
+__thread int mysql_thread___connection_prewarm_ms;
 __thread int mysql_thread___ping_interval_server_msec;
 __thread int mysql_thread___ping_timeout_server;
 __thread int mysql_thread___shun_on_failures;
@@ -826,6 +830,7 @@ __thread int mysql_thread___connect_timeout_server;
 __thread int mysql_thread___connect_timeout_server_max;
 __thread int mysql_thread___query_processor_iterations;
 __thread int mysql_thread___query_processor_regex;
+__thread bool mysql_thread___query_processor_regex_set;
 __thread int mysql_thread___set_query_lock_on_hostgroup;
 __thread int mysql_thread___set_parser_algorithm;
 __thread int mysql_thread___reset_connection_algorithm;
@@ -857,6 +862,7 @@ __thread int mysql_thread___query_digests_max_digest_length;
 __thread int mysql_thread___query_digests_max_query_length;
 __thread bool mysql_thread___parse_failure_logs_digest;
 __thread int mysql_thread___show_processlist_extended;
+__thread int mysql_thread___show_processlist_snapshot_ms;
 __thread int mysql_thread___session_idle_ms;
 __thread int mysql_thread___hostgroup_manager_verbose;
 __thread bool mysql_thread___default_reconnect;
@@ -880,6 +886,10 @@ __thread int mysql_thread___evaluate_replication_lag_on_servers_load;
 __thread int mysql_thread___query_cache_size_MB;
 __thread int mysql_thread___query_cache_soft_ttl_pct;
 __thread int mysql_thread___query_cache_handle_warnings;
+__thread int mysql_thread___query_cache_eviction_policy;
+__thread int mysql_thread___query_cache_stale_grace_ms;
+__thread int mysql_thread___query_cache_refresh_wait_ms;
+__thread bool mysql_thread___query_cache_compression;
 
 /* variables used for SSL , from proxy to server (p2s) */
 __thread char * mysql_thread___ssl_p2s_ca;
@@ -894,6 +904,9 @@ __thread char * mysql_thread___ssl_p2s_crlpath;
 __thread char * mysql_thread___eventslog_filename;
 __thread int mysql_thread___eventslog_filesize;
 __thread int mysql_thread___eventslog_default_log;
+__thread int mysql_thread___eventslog_flush_timeout;
+__thread int mysql_thread___eventslog_sample_rate;
+__thread int mysql_thread___eventslog_sample_slow_ms;
 __thread int mysql_thread___eventslog_format;
 
 /* variables used by audit log */
@@ -915,6 +928,7 @@ __thread int mysql_thread___monitor_read_only_max_timeout_count;
 __thread bool mysql_thread___monitor_wait_timeout;
 __thread bool mysql_thread___monitor_writer_is_also_reader;
 __thread int mysql_thread___monitor_replication_lag_group_by_host;
+__thread bool mysql_thread___monitor_event_loop;
 __thread int mysql_thread___monitor_replication_lag_interval;
 __thread int mysql_thread___monitor_replication_lag_timeout;
 __thread int mysql_thread___monitor_replication_lag_count;
@@ -965,6 +979,7 @@ extern __thread int mysql_thread___max_allowed_packet;
 extern __thread bool mysql_thread___automatic_detect_sqli;
 extern __thread bool mysql_thread___firewall_whitelist_enabled;
 extern __thread bool mysql_thread___use_tcp_keepalive;
+extern __thread bool mysql_thread___use_writev;
 extern __thread int mysql_thread___tcp_keepalive_time;
 extern __thread int mysql_thread___throttle_connections_per_sec_to_hostgroup;
 extern __thread int mysql_thread___max_transaction_idle_time;
@@ -984,6 +999,8 @@ extern __thread int mysql_thread___default_query_delay;
 extern __thread int mysql_thread___default_query_timeout;
 extern __thread int mysql_thread___long_query_time;
 extern __thread int mysql_thread___free_connections_pct;
+extern __thread int mysql_thread___connpool_thread_cache_size;
+extern __thread int mysql_thread___connection_prewarm_ms;
 extern __thread int mysql_thread___ping_interval_server_msec;
 extern __thread int mysql_thread___ping_timeout_server;
 extern __thread int mysql_thread___shun_on_failures;
@@ -999,6 +1016,7 @@ extern __thread int mysql_thread___connect_timeout_server;
 extern __thread int mysql_thread___connect_timeout_server_max;
 extern __thread int mysql_thread___query_processor_iterations;
 extern __thread int mysql_thread___query_processor_regex;
+extern __thread bool mysql_thread___query_processor_regex_set;
 extern __thread int mysql_thread___set_query_lock_on_hostgroup;
 extern __thread int mysql_thread___set_parser_algorithm;
 extern __thread int mysql_thread___reset_connection_algorithm;
@@ -1030,6 +1048,7 @@ extern __thread int mysql_thread___query_digests_max_digest_length;
 extern __thread int mysql_thread___query_digests_max_query_length;
 extern __thread bool mysql_thread___parse_failure_logs_digest;
 extern __thread int mysql_thread___show_processlist_extended;
+extern __thread int mysql_thread___show_processlist_snapshot_ms;
 extern __thread int mysql_thread___session_idle_ms;
 extern __thread int mysql_thread___hostgroup_manager_verbose;
 extern __thread bool mysql_thread___default_reconnect;
@@ -1053,6 +1072,10 @@ extern __thread int mysql_thread___evaluate_replication_lag_on_servers_load;
 extern __thread int mysql_thread___query_cache_size_MB;
 extern __thread int mysql_thread___query_cache_soft_ttl_pct;
 extern __thread int mysql_thread___query_cache_handle_warnings;
+extern __thread int mysql_thread___query_cache_eviction_policy;
+extern __thread int mysql_thread___query_cache_stale_grace_ms;
+extern __thread int mysql_thread___query_cache_refresh_wait_ms;
+extern __thread bool mysql_thread___query_cache_compression;
 
 /* variables used for SSL , from proxy to server (p2s) */
 extern __thread char * mysql_thread___ssl_p2s_ca;
@@ -1067,6 +1090,9 @@ extern __thread char * mysql_thread___ssl_p2s_crlpath;
 extern __thread char * mysql_thread___eventslog_filename;
 extern __thread int mysql_thread___eventslog_filesize;
 extern __thread int mysql_thread___eventslog_default_log;
+extern __thread int mysql_thread___eventslog_flush_timeout;
+extern __thread int mysql_thread___eventslog_sample_rate;
+extern __thread int mysql_thread___eventslog_sample_slow_ms;
 extern __thread int mysql_thread___eventslog_format;
 
 /* variables used by audit log */
@@ -1088,6 +1114,7 @@ extern __thread int mysql_thread___monitor_read_only_max_timeout_count;
 extern __thread bool mysql_thread___monitor_wait_timeout;
 extern __thread bool mysql_thread___monitor_writer_is_also_reader;
 extern __thread bool mysql_thread___monitor_replication_lag_group_by_host;
+extern __thread bool mysql_thread___monitor_event_loop;
 extern __thread int mysql_thread___monitor_replication_lag_interval;
 extern __thread int mysql_thread___monitor_replication_lag_timeout;
 extern __thread int mysql_thread___monitor_replication_lag_count;
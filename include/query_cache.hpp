@@ -7,6 +7,12 @@
 
 #define EXPIRE_DROPIT   0
 #define SHARED_QUERY_CACHE_HASH_TABLES  32
+#define QUERY_CACHE_ENGINE_BTREE 0 // KV_BtreeArray : readers and writers share a rwlock per shard
+#define QUERY_CACHE_ENGINE_LOCKFREE 1 // KV_LockFreeHashTable : lock-free readers, epoch based reclamation
+#define QUERY_CACHE_EVICTION_TTL 0 // TTL expiry, and purge of the least recently accessed entries above purge_threshold_pct_max
+#define QUERY_CACHE_EVICTION_TINYLFU 1 // frequency and size aware admission, CLOCK eviction within max_memory_size
+#define QUERY_CACHE_EVICTION_POLICIES 2
+#define QUERY_CACHE_REFRESH_WAIT_POLL_US 2000 // how often a session waiting for a refresh checks the Query Cache again
 #define HASH_EXPIRE_MAX 3600*24*365*10
 #define DEFAULT_purge_loop_time 500000
 #define DEFAULT_purge_total_time 10000000
@@ -27,14 +33,18 @@ struct __QC_entry_t {
 	QC_entry_t *self; // pointer to itself
 	uint32_t klen; // length of the key : FIXME: not sure if still relevant
 	uint32_t length; // length of the value
+	uint32_t compressed_length; // length of the LZ4 compressed value stored in 'value', 0 if not compressed
 	unsigned long long create_ms; // when the entry was created, monotonic, millisecond granularity
 	unsigned long long expire_ms; // when the entry will expire, monotonic , millisecond granularity
 	unsigned long long access_ms; // when the entry was read last , monotonic , millisecond granularity
 	bool refreshing; // true when a client will hit the backend to refresh the entry
+	unsigned long long refresh_ms; // when a client started to refresh the expired entry, 0 if none. See query_cache_stale_grace_ms
 	uint32_t column_eof_pkt_offset = 0;
 	uint32_t row_eof_pkt_offset = 0;
 	uint32_t ok_pkt_offset = 0;
 	uint32_t ref_count; // reference counter
+	QC_entry_t *next; // next entry in the same bucket, only for KV_LockFreeHashTable
+	uint8_t clock_freq; // CLOCK counter, incremented on hits and decremented by eviction sweeps
 };
 
 struct p_qc_counter {
@@ -64,10 +74,22 @@ struct qc_metrics_map_idx {
 	};
 };
 
-class KV_BtreeArray;
+class KV_Store;
+class QC_frequency_sketch;
 class Query_Cache {
 	private:
-	KV_BtreeArray * KVs[SHARED_QUERY_CACHE_HASH_TABLES];
+	KV_Store ** KVs; // 'size' shards
+	int engine; // QUERY_CACHE_ENGINE_BTREE or QUERY_CACHE_ENGINE_LOCKFREE , set at startup
+	QC_frequency_sketch *sketch; // access frequencies for QUERY_CACHE_EVICTION_TINYLFU
+	// GET counters split by the eviction policy active when they were collected.
+	// Counters of the active policy are 'policy_cntGet' plus the global counters since 'policy_base_cntGet'
+	int eviction_policy;
+	uint64_t policy_cntGet[QUERY_CACHE_EVICTION_POLICIES];
+	uint64_t policy_cntGetOK[QUERY_CACHE_EVICTION_POLICIES];
+	uint64_t policy_base_cntGet;
+	uint64_t policy_base_cntGetOK;
+	void set_eviction_policy(int policy);
+	bool admit(unsigned int shard, uint64_t hk, uint32_t vl, unsigned long long curtime_ms);
 	uint64_t get_data_size_total();
 	unsigned int current_used_memory_pct();
 	struct {
@@ -90,7 +112,7 @@ class Query_Cache {
 	~Query_Cache();
 	void print_version();
 	bool set(uint64_t user_hash, const unsigned char *kp, uint32_t kl, unsigned char *vp, uint32_t vl, unsigned long long create_ms, unsigned long long curtime_ms, unsigned long long expire_ms, bool deprecate_eof_active);
-	unsigned char * get(uint64_t , const unsigned char *, const uint32_t, uint32_t *, unsigned long long, unsigned long long, bool deprecate_eof_active);
+	unsigned char * get(uint64_t , const unsigned char *, const uint32_t, uint32_t *, unsigned long long, unsigned long long, bool deprecate_eof_active, bool *wait_refresh=NULL);
 	uint64_t flush();
 	SQLite3_result * SQL3_getStats();
 };
@@ -63,6 +63,11 @@ class QP_query_digest_stats {
 		unsigned long long t, unsigned long long n, unsigned long long ra, unsigned long long rs,
 		unsigned long long cnt = 1
 	);
+	/**
+	 * @brief Aggregates into this entry the stats of another entry for the same digest.
+	 * @param qds The entry whose counters, times and seen timestamps are merged.
+	 */
+	void add_stats(const QP_query_digest_stats *qds);
 	~QP_query_digest_stats();
 	char *get_digest_text(const umap_query_digest_text *digest_text_umap);
 	char **get_row(umap_query_digest_text *digest_text_umap, query_digest_stats_pointers_t *qdsp);
@@ -107,6 +112,8 @@ struct _Query_Processor_rule_t {
   char *comment; // #643
 	void *regex_engine1;
 	void *regex_engine2;
+	int regex_set_idx1; // index of 'match_digest' in the multi-pattern set of its flagIN, -1 if not present
+	int regex_set_idx2; // index of 'match_pattern' in the multi-pattern set of its flagIN, -1 if not present
 	uint64_t hits;
 	struct _Query_Processor_rule_t *parent; // pointer to parent, to speed up parent update
 	std::vector<int> * flagOUT_ids;
@@ -297,13 +304,32 @@ struct rules_mem_sts_t {
 	khash_t(khStrInt)* rules_fast_routing;
 };
 
+struct QP_rules_snapshot_t;
+struct QP_digest_buffer_t;
+
 class Query_Processor {
 	private:
 	char rand_del[16];
 	umap_query_digest digest_umap;
 	umap_query_digest_text digest_text_umap;
 	pthread_rwlock_t digest_rwlock;
+	// per-thread digests accumulators, merged into 'digest_umap' by their threads or when digests are read
+	std::vector<QP_digest_buffer_t *> digest_buffers;
+	pthread_mutex_t digest_buffers_mutex;
+	// digests moved out of 'digest_umap' while they are read by the stats virtual table
+	umap_query_digest digest_snapshot_umap;
+	umap_query_digest_text digest_snapshot_text_umap;
+	unsigned int digest_snapshot_refs;
+	pthread_mutex_t digest_snapshot_mutex;
+	// signaled when the last snapshot is released
+	pthread_cond_t digest_snapshot_cond;
+	void merge_digest_buffers();
+	// locks digest_snapshot_mutex once no snapshot is held, so that the functions reading, resetting
+	// or purging the digests can't miss the ones in the snapshot. The caller unlocks digest_snapshot_mutex
+	void wait_query_digests_snapshot();
 	enum MYSQL_COM_QUERY_command __query_parser_command_type(SQP_par_t *qp);
+	QP_rules_snapshot_t * build_rules_snapshot();
+	void refresh_thread_rules_snapshot();
 	protected:
 	pthread_rwlock_t rwlock;
 	std::vector<QP_rule_t *> rules;
@@ -311,6 +337,7 @@ class Query_Processor {
 	char * rules_fast_routing___keys_values;
 	unsigned long long rules_fast_routing___keys_values___size;
 	unsigned long long rules_fast_routing___number;
+	QP_rules_snapshot_t * rules_snapshot; // active rules shared by all threads, replaced on commit()
 	Command_Counter * commands_counters[MYSQL_COM_QUERY___NONE];
 
 	// firewall
@@ -344,6 +371,13 @@ class Query_Processor {
 	void sort(bool lock=true);
 
 	void init_thread();
+	/**
+	 * @brief Creates the digests accumulator of the calling thread.
+	 * @details Only for threads that also call 'end_thread()', otherwise digests are written directly
+	 *  into the global map. Buffered digests are merged by 'update_query_processor_stats()', 'end_thread()'
+	 *  and by all the functions reading or purging digests.
+	 */
+	void init_thread_digest_buffer();
 	void end_thread();
 	void commit();	// this applies all the changes in memory
 	SQLite3_result * get_current_query_rules();
@@ -371,6 +405,21 @@ class Query_Processor {
 		const bool copy, const bool use_resultset = true
 	);
 	void get_query_digests_reset(umap_query_digest *uqd, umap_query_digest_text *uqdt);
+	/**
+	 * @brief Gives read access to the query digests without copying them.
+	 * @details The digests are moved out of the map updated by the threads, as get_query_digests_v2()
+	 *  does, so the caller can iterate them without holding any lock while new digests are collected.
+	 *  Nested calls share the same maps. Every call must be paired with release_query_digests_snapshot().
+	 *  The other functions reading, resetting or purging the digests wait for the last release, so they
+	 *  must not be called while holding a snapshot.
+	 * @return The digests and the digest texts, valid until the matching release.
+	 */
+	std::pair<const umap_query_digest *, const umap_query_digest_text *> get_query_digests_snapshot();
+	/**
+	 * @brief Releases the maps returned by get_query_digests_snapshot(). The last release merges them back
+	 *  with the digests collected in the meantime.
+	 */
+	void release_query_digests_snapshot();
 	unsigned long long purge_query_digests(bool async_purge, bool parallel, char **msg);
 	unsigned long long purge_query_digests_async(char **msg);
 	unsigned long long purge_query_digests_sync(bool parallel);
@@ -67,6 +67,19 @@ extern int (*proxy_sqlite3_exec)(
   void *,                                    /* 1st argument to callback */
   char **errmsg                              /* Error msg written here */
 );
+
+// virtual tables , only used by the stats tables of Admin. Not mandatory for the plugins
+extern int (*proxy_sqlite3_create_module_v2)(sqlite3*, const char *zName, const sqlite3_module *p, void *pClientData, void(*xDestroy)(void*));
+extern int (*proxy_sqlite3_declare_vtab)(sqlite3*, const char *zSQL);
+extern const char *(*proxy_sqlite3_vtab_collation)(sqlite3_index_info*, int);
+extern void (*proxy_sqlite3_result_int64)(sqlite3_context*, sqlite3_int64);
+extern void (*proxy_sqlite3_result_text)(sqlite3_context*, const char*, int, void(*)(void*));
+extern void (*proxy_sqlite3_result_null)(sqlite3_context*);
+extern int (*proxy_sqlite3_value_type)(sqlite3_value*);
+extern int (*proxy_sqlite3_value_numeric_type)(sqlite3_value*);
+extern sqlite3_int64 (*proxy_sqlite3_value_int64)(sqlite3_value*);
+extern double (*proxy_sqlite3_value_double)(sqlite3_value*);
+extern const unsigned char *(*proxy_sqlite3_value_text)(sqlite3_value*);
 #else
 int (*proxy_sqlite3_bind_double)(sqlite3_stmt*, int, double);
 int (*proxy_sqlite3_bind_int)(sqlite3_stmt*, int, int);
@@ -114,6 +127,19 @@ int (*proxy_sqlite3_exec)(
   void *,                                    /* 1st argument to callback */
   char **errmsg                              /* Error msg written here */
 );
+
+// virtual tables , only used by the stats tables of Admin. Not mandatory for the plugins
+int (*proxy_sqlite3_create_module_v2)(sqlite3*, const char *zName, const sqlite3_module *p, void *pClientData, void(*xDestroy)(void*));
+int (*proxy_sqlite3_declare_vtab)(sqlite3*, const char *zSQL);
+const char *(*proxy_sqlite3_vtab_collation)(sqlite3_index_info*, int);
+void (*proxy_sqlite3_result_int64)(sqlite3_context*, sqlite3_int64);
+void (*proxy_sqlite3_result_text)(sqlite3_context*, const char*, int, void(*)(void*));
+void (*proxy_sqlite3_result_null)(sqlite3_context*);
+int (*proxy_sqlite3_value_type)(sqlite3_value*);
+int (*proxy_sqlite3_value_numeric_type)(sqlite3_value*);
+sqlite3_int64 (*proxy_sqlite3_value_int64)(sqlite3_value*);
+double (*proxy_sqlite3_value_double)(sqlite3_value*);
+const unsigned char *(*proxy_sqlite3_value_text)(sqlite3_value*);
 #endif //MAIN_PROXY_SQLITE3
 
 class SQLite3_row {
@@ -2,6 +2,7 @@
 
 #include "ev.h"
 #include <iterator>
+#include <algorithm>
 
 
 extern ProxySQL_Admin *GloAdmin;
@@ -45,25 +46,39 @@ void reader_cb(struct ev_loop *loop, struct ev_io *w, int revents) {
 	if (revents & EV_READ) {
 		GTID_Server_Data *sd = (GTID_Server_Data *)w->data;
 		bool rc = true;
+		bool corrupted = false;
 		rc = sd->readall();
+		if (rc == true) {
+			rc = sd->dump();
+			corrupted = (rc == false);
+		}
 		if (rc == false) {
 			//delete sd;
 			std::string s1 = sd->address;
 			s1.append(":");
 			s1.append(std::to_string(sd->mysql_port));
 			MyHGM->gtid_missing_nodes = true;
-			proxy_warning("GTID: failed to connect to ProxySQL binlog reader on port %d for server %s:%d\n", sd->port, sd->address, sd->mysql_port);
+			if (corrupted) {
+				// the stream is closed: the next connection restarts from the bootstrap of gtid_executed
+				proxy_error("GTID: invalid event from ProxySQL binlog reader on port %d for server %s:%d , closing the connection\n", sd->port, sd->address, sd->mysql_port);
+			} else {
+				proxy_warning("GTID: failed to connect to ProxySQL binlog reader on port %d for server %s:%d\n", sd->port, sd->address, sd->mysql_port);
+			}
 			std::unordered_map <string, GTID_Server_Data *>::iterator it2;
+			// readers of gtid_map hold gtid_rwlock , see MySQL_HostGroups_Manager::gtid_exists()
+			pthread_rwlock_wrlock(&MyHGM->gtid_rwlock);
 			it2 = MyHGM->gtid_map.find(s1);
 			if (it2 != MyHGM->gtid_map.end()) {
 				//MyHGM->gtid_map.erase(it2);
 				it2->second = NULL;
 				delete sd;
 			}
+			pthread_rwlock_unlock(&MyHGM->gtid_rwlock);
 			ev_io_stop(MyHGM->gtid_ev_loop, w);
+			if (corrupted) {
+				close(w->fd);
+			}
 			free(w);
-		} else {
-			sd->dump();
 		}
 	}
 	pthread_mutex_unlock(&ev_loop_mutex);
@@ -89,12 +104,15 @@ void connect_cb(EV_P_ ev_io *w, int revents) {
 			s1.append(std::to_string(sd->mysql_port));
 			proxy_warning("GTID: failed to connect to ProxySQL binlog reader on port %d for server %s:%d\n", sd->port, sd->address, sd->mysql_port);
 			std::unordered_map <string, GTID_Server_Data *>::iterator it2;
+			// readers of gtid_map hold gtid_rwlock , see MySQL_HostGroups_Manager::gtid_exists()
+			pthread_rwlock_wrlock(&MyHGM->gtid_rwlock);
 			it2 = MyHGM->gtid_map.find(s1);
 			if (it2 != MyHGM->gtid_map.end()) {
 				//MyHGM->gtid_map.erase(it2);
 				it2->second = NULL;
 				delete sd;
 			}
+			pthread_rwlock_unlock(&MyHGM->gtid_rwlock);
 			//delete custom_data;
 			free(c);
 		} else {
@@ -166,12 +184,16 @@ GTID_Server_Data::GTID_Server_Data(struct ev_io *_w, char *_address, uint16_t _p
 	size = 1024; // 1KB buffer
 	data = (char *)malloc(size);
 	memset(uuid_server, 0, sizeof(uuid_server));
+	uuid_server_bin.hi = 0;
+	uuid_server_bin.lo = 0;
+	gtid_executed_snapshot = std::make_shared<const gtid_set_t>();
 	pos = 0;
 	len = 0;
 	address = strdup(_address);
 	port = _port;
 	mysql_port = _mysql_port;
 	events_read = 0;
+	corrupted = false;
 }
 
 void GTID_Server_Data::resize(size_t _s) {
@@ -211,22 +233,24 @@ bool GTID_Server_Data::readall() {
 }
 
 
-bool GTID_Server_Data::gtid_exists(char *gtid_uuid, uint64_t gtid_trxid) {
-	std::string s = gtid_uuid;
-	auto it = gtid_executed.find(s);
-//	fprintf(stderr,"Checking if server %s:%d has GTID %s:%lu ... ", address, port, gtid_uuid, gtid_trxid);
-	if (it == gtid_executed.end()) {
-//		fprintf(stderr,"NO\n");
-		return false;
-	}
-	for (auto itr = it->second.begin(); itr != it->second.end(); ++itr) {
-		if ((int64_t)gtid_trxid >= itr->first && (int64_t)gtid_trxid <= itr->second) {
-//			fprintf(stderr,"YES\n");
-			return true;
-		}
-	}
-//	fprintf(stderr,"NO\n");
-	return false;
+/**
+ * @brief Checks if the GTID is in the last published copy of gtid_executed .
+ * @details It can be called by any thread: the published copy is never modified, and it is kept alive by
+ *  the shared pointer even if a new copy is published meanwhile.
+ */
+bool GTID_Server_Data::gtid_exists(const gtid_uuid_t& gtid_uuid, uint64_t gtid_trxid) {
+	std::shared_ptr<const gtid_set_t> snapshot = get_gtid_executed();
+	return snapshot->contains(gtid_uuid, (int64_t)gtid_trxid);
+}
+
+/**
+ * @brief Makes the events read so far visible to gtid_exists() , replacing the published copy of gtid_executed .
+ * @details Called by the GTID thread after every batch of events, so that readers never lock and never see
+ *  gtid_executed while it is being modified.
+ */
+void GTID_Server_Data::publish_gtid_executed() {
+	std::shared_ptr<const gtid_set_t> snapshot = std::make_shared<const gtid_set_t>(gtid_executed);
+	std::atomic_store(&gtid_executed_snapshot, snapshot);
 }
 
 void GTID_Server_Data::read_all_gtids() {
@@ -234,11 +258,20 @@ void GTID_Server_Data::read_all_gtids() {
 		}
 	}
 
-void GTID_Server_Data::dump() {
+/**
+ * @brief Reads the complete events received so far, and publishes them.
+ * @return false if an invalid event was received: the stream must be closed.
+ */
+bool GTID_Server_Data::dump() {
 	if (len==0) {
-		return;
+		return true;
 	}
+	unsigned long long events_before = events_read;
+	size_t pos_before = pos;
 	read_all_gtids();
+	if (events_read != events_before || pos != pos_before) {
+		publish_gtid_executed();
+	}
 	//int rc = write(1,data+pos,len-pos);
 	fflush(stdout);
 	///pos += rc;
@@ -247,6 +280,7 @@ void GTID_Server_Data::dump() {
 		len = len-pos;
 		pos = 0;
 	}
+	return (corrupted == false);
 }
 
 bool GTID_Server_Data::writeout() {
@@ -267,8 +301,13 @@ bool GTID_Server_Data::writeout() {
 	return ret;
 }
 
+/**
+ * @brief Reads the next event from the received data.
+ * @return false if no complete event is available, or if the event is invalid. In the latter case
+ *  'corrupted' is set, and the event is not applied to gtid_executed .
+ */
 bool GTID_Server_Data::read_next_gtid() {
-	if (len==0) {
+	if (len==0 || corrupted) {
 		return false;
 	}
 	void *nlp = NULL;
@@ -306,27 +345,41 @@ bool GTID_Server_Data::read_next_gtid() {
 				j++;
 				if (j%2 == 1) { // we are reading the uuid
 					char *p = uuid_server;
-					for (unsigned int k=0; k<strlen(subtoken); k++) {
+					for (unsigned int k=0; k<strlen(subtoken) && p < uuid_server+sizeof(uuid_server)-1; k++) {
 						if (subtoken[k]!='-') {
 							*p = subtoken[k];
 							p++;
 						}
 					}
+					*p = 0;
+					if (uuid_server_bin.parse(uuid_server) == false) {
+						corrupted = true;
+						break;
+					}
 					//fprintf(stdout,"BS from %s\n", uuid_server);
 				} else { // we are reading the trxids
 					uint64_t trx_from;
 					uint64_t trx_to;
 					sscanf(subtoken,"%lu-%lu",&trx_from,&trx_to);
 					//fprintf(stdout,"BS from %s:%lu-%lu\n", uuid_server, trx_from, trx_to);
-					std::string s = uuid_server;
-					gtid_executed[s].emplace_back(trx_from, trx_to);
+					gtid_executed.add_interval(uuid_server_bin, trx_from, trx_to);
 			   }
 			}
+			if (corrupted) {
+				break;
+			}
 		}
-		pos += l+1;
 		free(bs);
+		if (corrupted) {
+			return false;
+		}
+		pos += l+1;
 		//return true;
 	} else {
+		if (l >= (int)sizeof(rec_msg)) {
+			corrupted = true;
+			return false;
+		}
 		strncpy(rec_msg,data+pos,l);
 		pos += l+1;
 		rec_msg[l] = 0;
@@ -341,9 +394,17 @@ bool GTID_Server_Data::read_next_gtid() {
 				case '1':
 					//sscanf(rec_msg+3,"%s\:%lu",uuid_server,&rec_trxid);
 					a = strchr(rec_msg+3,':');
+					if (a == NULL || a-rec_msg-3 >= (int)sizeof(uuid_server)) {
+						corrupted = true;
+						return false;
+					}
 					ul = a-rec_msg-3;
 					strncpy(uuid_server,rec_msg+3,ul);
 					uuid_server[ul] = 0;
+					if (uuid_server_bin.parse(uuid_server) == false) {
+						corrupted = true;
+						return false;
+					}
 					rec_trxid=atoll(a+1);
 					break;
 				case '2':
@@ -354,89 +415,142 @@ bool GTID_Server_Data::read_next_gtid() {
 					break;
 			}
 			//fprintf(stdout,"%s:%lu\n", uuid_server, rec_trxid);
-			std::string s = uuid_server;
-			gtid_t new_gtid = std::make_pair(s,rec_trxid);
-			addGtid(new_gtid,gtid_executed);
+			gtid_executed.add(uuid_server_bin, rec_trxid);
 			events_read++;
 			//return true;
 		}
 	}
-	//std::cout << "current pos " << gtid_executed_to_string(gtid_executed) << std::endl << std::endl;
 	return true;
 }
 
-std::string gtid_executed_to_string(gtid_set_t& gtid_executed) {
-	std::string gtid_set;
-	for (auto it=gtid_executed.begin(); it!=gtid_executed.end(); ++it) {
-		std::string s = it->first;
-		s.insert(8,"-");
-		s.insert(13,"-");
-		s.insert(18,"-");
-		s.insert(23,"-");
-		s = s + ":";
-		for (auto itr = it->second.begin(); itr != it->second.end(); ++itr) {
-			std::string s2 = s;
-			s2 = s2 + std::to_string(itr->first);
-			s2 = s2 + "-";
-			s2 = s2 + std::to_string(itr->second);
-			s2 = s2 + ",";
-			gtid_set = gtid_set + s2;
+static inline int hex_digit(char c) {
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	return -1;
+}
+
+bool gtid_uuid_t::parse(const char *s) {
+	uint64_t h = 0;
+	uint64_t l = 0;
+	int n = 0;
+	for (; *s && *s != ':'; s++) {
+		if (*s == '-') continue;
+		int d = hex_digit(*s);
+		if (d < 0 || n == 32) {
+			return false;
 		}
+		if (n < 16) {
+			h = (h << 4) | d;
+		} else {
+			l = (l << 4) | d;
+		}
+		n++;
 	}
-	// Extract latest comma only in case 'gtid_executed' isn't empty
-	if (gtid_set.empty() == false) {
-		gtid_set.pop_back();
+	if (n != 32) {
+		return false;
 	}
-	return gtid_set;
+	hi = h;
+	lo = l;
+	return true;
 }
 
+std::string gtid_uuid_t::to_string() const {
+	char buf[40];
+	sprintf(buf, "%08x-%04x-%04x-%04x-%04x%08x",
+		(unsigned int)(hi >> 32), (unsigned int)((hi >> 16) & 0xffff), (unsigned int)(hi & 0xffff),
+		(unsigned int)(lo >> 48), (unsigned int)((lo >> 32) & 0xffff), (unsigned int)(lo & 0xffffffff)
+	);
+	return std::string(buf);
+}
 
+std::vector<gtid_interval_t> * gtid_set_t::find_intervals(const gtid_uuid_t& uuid, bool create) {
+	auto it = std::lower_bound(uuids.begin(), uuids.end(), uuid,
+		[](const std::pair<gtid_uuid_t, std::vector<gtid_interval_t>>& e, const gtid_uuid_t& u) { return e.first < u; }
+	);
+	if (it != uuids.end() && it->first == uuid) {
+		return &it->second;
+	}
+	if (create == false) {
+		return NULL;
+	}
+	it = uuids.emplace(it, uuid, std::vector<gtid_interval_t>());
+	return &it->second;
+}
 
-void addGtid(const gtid_t& gtid, gtid_set_t& gtid_executed) {
-	auto it = gtid_executed.find(gtid.first);
-	if (it == gtid_executed.end())
-	{
-		gtid_executed[gtid.first].emplace_back(gtid.second, gtid.second);
+/**
+ * @brief Adds the transactions from trx_from to trx_to , merging the intervals that overlap or are adjacent.
+ */
+void gtid_set_t::add_interval(const gtid_uuid_t& uuid, int64_t trx_from, int64_t trx_to) {
+	if (trx_from > trx_to) {
 		return;
 	}
-
-	bool flag = true;
-	for (auto itr = it->second.begin(); itr != it->second.end(); ++itr)
-	{
-		if (gtid.second >= itr->first && gtid.second <= itr->second)
-			return;
-		if (gtid.second + 1 == itr->first)
-		{
-			--itr->first;
-			flag = false;
-			break;
-		}
-		else if (gtid.second == itr->second + 1)
-		{
-			++itr->second;
-			flag = false;
-			break;
-		}
-		else if (gtid.second < itr->first)
-		{
-			it->second.emplace(itr, gtid.second, gtid.second);
+	std::vector<gtid_interval_t>& intervals = *find_intervals(uuid, true);
+	// the common case: transactions are added in order, extending the last interval
+	if (intervals.empty() == false) {
+		gtid_interval_t& last = intervals.back();
+		if (trx_from >= last.first && trx_from <= last.second + 1) {
+			if (trx_to > last.second) {
+				last.second = trx_to;
+			}
 			return;
 		}
 	}
+	// first interval that ends at or after trx_from-1 , it is the first that can be merged
+	auto it = std::lower_bound(intervals.begin(), intervals.end(), trx_from - 1,
+		[](const gtid_interval_t& i, int64_t v) { return i.second < v; }
+	);
+	auto last = it;
+	while (last != intervals.end() && last->first <= trx_to + 1) {
+		if (last->first < trx_from) trx_from = last->first;
+		if (last->second > trx_to) trx_to = last->second;
+		last++;
+	}
+	if (it == last) {
+		intervals.emplace(it, trx_from, trx_to);
+	} else {
+		it->first = trx_from;
+		it->second = trx_to;
+		intervals.erase(it + 1, last);
+	}
+}
+
+void gtid_set_t::add(const gtid_uuid_t& uuid, int64_t trxid) {
+	add_interval(uuid, trxid, trxid);
+}
+
+bool gtid_set_t::contains(const gtid_uuid_t& uuid, int64_t trxid) const {
+	auto it = std::lower_bound(uuids.begin(), uuids.end(), uuid,
+		[](const std::pair<gtid_uuid_t, std::vector<gtid_interval_t>>& e, const gtid_uuid_t& u) { return e.first < u; }
+	);
+	if (it == uuids.end() || !(it->first == uuid)) {
+		return false;
+	}
+	const std::vector<gtid_interval_t>& intervals = it->second;
+	// first interval that ends at or after trxid
+	auto itr = std::lower_bound(intervals.begin(), intervals.end(), trxid,
+		[](const gtid_interval_t& i, int64_t v) { return i.second < v; }
+	);
+	return (itr != intervals.end() && itr->first <= trxid);
+}
 
-	if (flag)
-		it->second.emplace_back(gtid.second, gtid.second);
-
-	for (auto itr = it->second.begin(); itr != it->second.end(); ++itr)
-	{
-		auto next_itr = std::next(itr);
-		if (next_itr != it->second.end() && itr->second + 1 == next_itr->first)
-		{
-			itr->second = next_itr->second;
-			it->second.erase(next_itr);
-			break;
+/**
+ * @brief Returns the set in the same format of MySQL 'gtid_executed' , for example
+ *  '3e11fa47-71ca-11e1-9e33-c80aa9429562:1-5,3e11fa47-71ca-11e1-9e33-c80aa9429562:7-9' .
+ */
+std::string gtid_set_t::to_string() const {
+	std::string gtid_set;
+	for (auto it=uuids.begin(); it!=uuids.end(); ++it) {
+		std::string s = it->first.to_string() + ":";
+		for (auto itr = it->second.begin(); itr != it->second.end(); ++itr) {
+			gtid_set += s + std::to_string(itr->first) + "-" + std::to_string(itr->second) + ",";
 		}
 	}
+	// Extract latest comma only in case 'gtid_executed' isn't empty
+	if (gtid_set.empty() == false) {
+		gtid_set.pop_back();
+	}
+	return gtid_set;
 }
 
 void * GTID_syncer_run() {
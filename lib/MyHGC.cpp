@@ -1,17 +1,38 @@
 #include "MySQL_HostGroups_Manager.h"
 
+#include "MySQL_Data_Stream.h"
+#include "MySQL_Authentication.hpp"
+#include "MySQL_encode.h"
+
 #ifdef TEST_AURORA
 static unsigned long long array_mysrvc_total = 0;
 static unsigned long long array_mysrvc_cands = 0;
 #endif // TEST_AURORA
 
 extern MySQL_Threads_Handler *GloMTH;
+extern MySQL_Authentication *GloMyAuth;
 
 MyHGC::MyHGC(int _hid) {
 	hid=_hid;
 	mysrvs=new MySrvList(this);
+	pthread_mutex_init(&mutex, NULL);
+#ifdef DEBUG
+	is_locked = false;
+#endif
 	current_time_now = 0;
 	new_connections_now = 0;
+	prewarm.connections_created = 0;
+	prewarm.connecting = 0;
+	prewarm.created_per_sec = 0;
+	prewarm.last_round = 0;
+	for (int i = 0; i < MYHGC_PREWARM_PROFILES; i++) {
+		prewarm.profiles[i].username = NULL;
+		prewarm.profiles[i].schemaname = NULL;
+		prewarm.profiles[i].userinfo_hash = 0;
+		prewarm.profiles[i].client_flag = 0;
+		prewarm.profiles[i].charset = 0;
+		prewarm.profiles[i].count = 0;
+	}
 	attributes.initialized = false;
 	reset_attributes();
 	// Uninitialized server defaults. Should later be initialized via 'mysql_hostgroup_attributes'.
@@ -35,6 +56,7 @@ void MyHGC::reset_attributes() {
 	attributes.autocommit = -1;
 	attributes.free_connections_pct = 10;
 	attributes.handle_warnings = -1;
+	attributes.load_balancing_algorithm = LB_WEIGHTED_RANDOM;
 	attributes.monitor_slave_lag_when_null = -1;
 	attributes.multiplex = true;
 	attributes.connection_warming = false;
@@ -49,7 +71,236 @@ void MyHGC::reset_attributes() {
 	
 MyHGC::~MyHGC() {
 	reset_attributes(); // free all memory
+	for (int i = 0; i < MYHGC_PREWARM_PROFILES; i++) {
+		clear_prewarm_profile(i);
+	}
 	delete mysrvs;
+	pthread_mutex_destroy(&mutex);
+}
+
+// client flags that must match between a client and a backend connection, see MySQL_Connection::match_tracked_options()
+#define PREWARM_CLIENT_FLAGS	(CLIENT_FOUND_ROWS | CLIENT_MULTI_STATEMENTS | CLIENT_MULTI_RESULTS | CLIENT_IGNORE_SPACE)
+
+/**
+ * @brief Records that a session needed a new connection to this hostgroup.
+ * @details Called with the hostgroup locked when a connection is created on demand, or when a connection
+ *  created by mysql-connection_prewarm_ms is used for the first time. The counter is used to estimate the
+ *  rate of new connections, while the client profile (username, schema, charset and tracked client
+ *  flags) is added to the most common profiles using the space-saving algorithm: a profile not yet tracked
+ *  replaces the least frequent one, inheriting its count.
+ * @param sess The session requesting the connection, it can be NULL.
+ */
+void MyHGC::record_connection_demand(MySQL_Session *sess) {
+	prewarm.connections_created++;
+	if (sess == NULL || sess->client_myds == NULL || sess->client_myds->myconn == NULL) {
+		return;
+	}
+	MySQL_Connection *client_conn = sess->client_myds->myconn;
+	MySQL_Connection_userinfo *ui = client_conn->userinfo;
+	if (ui == NULL || ui->username == NULL) {
+		return;
+	}
+	const char *csname = client_conn->variables[SQL_CHARACTER_SET].value;
+	uint32_t charset = (csname ? atoi(csname) : 0);
+	uint32_t client_flag = client_conn->options.client_flag & PREWARM_CLIENT_FLAGS;
+	int min_idx = 0;
+	for (int i = 0; i < MYHGC_PREWARM_PROFILES; i++) {
+		auto& profile = prewarm.profiles[i];
+		if (profile.username && profile.userinfo_hash == ui->hash && profile.client_flag == client_flag && profile.charset == charset) {
+			profile.count++;
+			return;
+		}
+		if (profile.count < prewarm.profiles[min_idx].count) {
+			min_idx = i;
+		}
+	}
+	uint32_t count = prewarm.profiles[min_idx].count;
+	clear_prewarm_profile(min_idx);
+	auto& profile = prewarm.profiles[min_idx];
+	profile.username = strdup(ui->username);
+	profile.schemaname = (ui->schemaname ? strdup(ui->schemaname) : NULL);
+	profile.userinfo_hash = ui->hash;
+	profile.client_flag = client_flag;
+	profile.charset = charset;
+	profile.count = count + 1;
+}
+
+/**
+ * @brief Removes a profile recorded by record_connection_demand() .
+ */
+void MyHGC::clear_prewarm_profile(int idx) {
+	auto& profile = prewarm.profiles[idx];
+	free(profile.username);
+	profile.username = NULL;
+	free(profile.schemaname);
+	profile.schemaname = NULL;
+	profile.userinfo_hash = 0;
+	profile.client_flag = 0;
+	profile.charset = 0;
+	profile.count = 0;
+}
+
+/**
+ * @brief Creates a new, not yet connected, connection to the server for one of the most common profiles.
+ * @details The profile is chosen randomly, weighted by its count. The connection is created with the
+ *  credentials, schema, charset and client flags of the profile, so that it can be used without CHANGE USER
+ *  or SET NAMES by the clients with the same profile. The credentials are read from GloMyAuth : if the user
+ *  was removed or its password changed, the profile is cleared.
+ * @return The new connection, or NULL if no profile was recorded yet.
+ */
+MySQL_Connection * MyHGC::new_prewarmed_MyConn(MySrvC *mysrvc) {
+	uint32_t sum = 0;
+	for (int i = 0; i < MYHGC_PREWARM_PROFILES; i++) {
+		if (prewarm.profiles[i].username) {
+			sum += prewarm.profiles[i].count;
+		}
+	}
+	if (sum == 0) {
+		return NULL;
+	}
+	uint32_t k = fastrand() % sum;
+	int idx = 0;
+	for (idx = 0; idx < MYHGC_PREWARM_PROFILES; idx++) {
+		if (prewarm.profiles[idx].username == NULL) continue;
+		if (k < prewarm.profiles[idx].count) break;
+		k -= prewarm.profiles[idx].count;
+	}
+	auto& profile = prewarm.profiles[idx];
+	void *sha1_pass = NULL;
+	char *password = GloMyAuth->lookup(profile.username, USERNAME_FRONTEND, NULL, NULL, NULL, NULL, NULL, NULL, NULL, &sha1_pass, NULL);
+	if (password == NULL) {
+		clear_prewarm_profile(idx);
+		return NULL;
+	}
+	char *sha1_hex = (sha1_pass ? sha1_pass_hex((char *)sha1_pass) : NULL);
+	MySQL_Connection *conn = new MySQL_Connection();
+	conn->userinfo->set(profile.username, password, profile.schemaname, sha1_hex);
+	free(password);
+	free(sha1_pass);
+	free(sha1_hex);
+	if (conn->userinfo->hash != profile.userinfo_hash) {
+		// the clients of this profile authenticated with different credentials
+		delete conn;
+		clear_prewarm_profile(idx);
+		return NULL;
+	}
+	conn->parent = mysrvc;
+	// if attributes.multiplex == true , STATUS_MYSQL_CONNECTION_NO_MULTIPLEX_HG is set to false. And vice-versa
+	conn->set_status(!attributes.multiplex, STATUS_MYSQL_CONNECTION_NO_MULTIPLEX_HG);
+	conn->options.client_flag = profile.client_flag;
+	if (profile.charset) {
+		conn->variables[SQL_CHARACTER_SET].value = strdup(std::to_string(profile.charset).c_str());
+	}
+	conn->prewarmed = true;
+	return conn;
+}
+
+void MyHGC::lock() {
+	pthread_mutex_lock(&mutex);
+#ifdef DEBUG
+	is_locked = true;
+#endif
+}
+
+void MyHGC::unlock() {
+#ifdef DEBUG
+	is_locked = false;
+#endif
+	pthread_mutex_unlock(&mutex);
+}
+
+bool MyHGC::trylock() {
+	if (pthread_mutex_trylock(&mutex) == 0) {
+#ifdef DEBUG
+		is_locked = true;
+#endif
+		return true;
+	}
+	return false;
+}
+
+/**
+ * @brief Chooses a server among the candidates, with a probability proportional to its weight.
+ * @param sum The sum of the weights of the candidates, must be greater than 0.
+ */
+static MySrvC * get_weighted_random_MySrvC(MySrvC **candidates, unsigned int num_candidates, unsigned int sum) {
+	unsigned int k;
+	if (sum > 32768) {
+		k=rand()%sum;
+	} else {
+		k=fastrand()%sum;
+	}
+	k++;
+	unsigned int New_sum=0;
+	for (unsigned int j=0; j<num_candidates; j++) {
+		New_sum+=candidates[j]->weight;
+		if (k<=New_sum) {
+			return candidates[j];
+		}
+	}
+	return NULL; // never reached if sum is correct
+}
+
+/**
+ * @brief Returns the load of a server for the load balancing algorithms: lower is better.
+ * @details The load is the number of queries in flight, including the new one, divided by the weight.
+ *  For LB_PEAK_EWMA it is also multiplied by the peak EWMA of the query latency.
+ */
+static double get_MySrvC_load(MySrvC *mysrvc, int algorithm, unsigned long long curtime) {
+	double load = (double)(mysrvc->queries_in_flight + 1) / mysrvc->weight;
+	if (algorithm == LB_PEAK_EWMA) {
+		load *= (double)(mysrvc->get_latency_ewma_us(curtime) + 1);
+	}
+	return load;
+}
+
+/**
+ * @brief Chooses a server among the candidates according to 'attributes.load_balancing_algorithm' .
+ * @details Candidates are the servers already filtered by get_random_MySrvC() . Servers with weight 0
+ *  are never chosen.
+ * @param sum The sum of the weights of the candidates, must be greater than 0.
+ * @return The chosen server.
+ */
+MySrvC *MyHGC::get_balanced_MySrvC(MySrvC **candidates, unsigned int num_candidates, unsigned int sum) {
+	int algorithm = attributes.load_balancing_algorithm;
+	unsigned long long curtime = (algorithm == LB_PEAK_EWMA ? monotonic_time() : 0);
+	MySrvC *mysrvc = NULL;
+	switch (algorithm) {
+		case LB_POWER_OF_TWO_CHOICES:
+		case LB_PEAK_EWMA:
+			{
+				MySrvC *a = get_weighted_random_MySrvC(candidates, num_candidates, sum);
+				MySrvC *b = get_weighted_random_MySrvC(candidates, num_candidates, sum);
+				if (a == b && num_candidates > 1) {
+					// one more attempt to compare two different servers
+					b = get_weighted_random_MySrvC(candidates, num_candidates, sum);
+				}
+				mysrvc = (get_MySrvC_load(b, algorithm, curtime) < get_MySrvC_load(a, algorithm, curtime) ? b : a);
+			}
+			break;
+		case LB_LEAST_OUTSTANDING_QUERIES:
+			{
+				double min_load = 0;
+				// start from a random candidate, so that ties are not always resolved with the same server
+				unsigned int start = fastrand()%num_candidates;
+				for (unsigned int j=0; j<num_candidates; j++) {
+					MySrvC *c = candidates[(start+j)%num_candidates];
+					if (c->weight == 0) {
+						continue;
+					}
+					double load = get_MySrvC_load(c, algorithm, curtime);
+					if (mysrvc == NULL || load < min_load) {
+						mysrvc = c;
+						min_load = load;
+					}
+				}
+			}
+			break;
+		default:
+			mysrvc = get_weighted_random_MySrvC(candidates, num_candidates, sum);
+			break;
+	}
+	return mysrvc;
 }
 
 MySrvC *MyHGC::get_random_MySrvC(char * gtid_uuid, uint64_t gtid_trxid, int max_lag_ms, MySQL_Session *sess) {
@@ -145,11 +396,10 @@ MySrvC *MyHGC::get_random_MySrvC(char * gtid_uuid, uint64_t gtid_trxid, int max_
 								mysrvc->connect_ERR_at_time_last_detected_error=0;
 								mysrvc->time_last_detected_error=0;
 								// note: the following function scans all the hostgroups.
-								// This is ok for now because we only have a global mutex.
-								// If one day we implement a mutex per hostgroup (unlikely,
-								// but possible), this must be taken into consideration
+								// Only this hostgroup is locked, therefore the other hostgroups
+								// are locked with trylock() and skipped if busy
 								if (mysql_thread___unshun_algorithm == 1) {
-									MyHGM->unshun_server_all_hostgroups(mysrvc->address, mysrvc->port, t, max_wait_sec, &mysrvc->myhgc->hid);
+									MyHGM->unshun_server_all_hostgroups(mysrvc->address, mysrvc->port, t, max_wait_sec, &mysrvc->myhgc->hid, true);
 								}
 								// if a server is taken back online, consider it immediately
 								if ( mysrvc->current_latency_us < ( mysrvc->max_latency_us ? mysrvc->max_latency_us : mysql_thread___default_max_latency_ms*1000 ) ) { // consider the host only if not too far
@@ -352,6 +602,17 @@ MySrvC *MyHGC::get_random_MySrvC(char * gtid_uuid, uint64_t gtid_trxid, int max_
 			}
 		}
 
+		if (attributes.configured == true && attributes.load_balancing_algorithm != LB_WEIGHTED_RANDOM) {
+			mysrvc = get_balanced_MySrvC(mysrvcCandidates, num_candidates, New_sum);
+			proxy_debug(PROXY_DEBUG_MYSQL_CONNPOOL, 7, "Returning MySrvC %p, server %s:%d, load_balancing_algorithm %d\n", mysrvc, mysrvc->address, mysrvc->port, attributes.load_balancing_algorithm);
+			if (l>32) {
+				free(mysrvcCandidates);
+			}
+#ifdef TEST_AURORA
+			array_mysrvc_cands += num_candidates;
+#endif // TEST_AURORA
+			return mysrvc;
+		}
 
 		unsigned int k;
 		if (New_sum > 32768) {
@@ -398,7 +659,7 @@ void MyHGC::refresh_online_server_count() {
 	if (__sync_fetch_and_add(&glovars.shutdown, 0) != 0)
 		return;
 #ifdef DEBUG
-	assert(MyHGM->is_locked);
+	assert(MyHGM->is_locked || is_locked);
 #endif
 	unsigned int online_servers_count = 0;
 	for (unsigned int i = 0; i < mysrvs->servers->len; i++) {
@@ -270,7 +270,7 @@ hg_metrics_map = std::make_tuple(
 		std::make_tuple (
 			p_hg_counter::server_connections_created,
 			"proxysql_server_connections_total",
-			"Total number of server connections (created|delayed|aborted).",
+			"Total number of server connections (created|delayed|aborted|prewarmed). Prewarmed connections are created ahead of demand by mysql-connection_prewarm_ms, and are also counted as created.",
 			metric_tags {
 				{ "status", "created" }
 			}
@@ -278,15 +278,23 @@ hg_metrics_map = std::make_tuple(
 		std::make_tuple (
 			p_hg_counter::server_connections_delayed,
 			"proxysql_server_connections_total",
-			"Total number of server connections (created|delayed|aborted).",
+			"Total number of server connections (created|delayed|aborted|prewarmed). Prewarmed connections are created ahead of demand by mysql-connection_prewarm_ms, and are also counted as created.",
 			metric_tags {
 				{ "status", "delayed" }
 			}
 		),
+		std::make_tuple (
+			p_hg_counter::server_connections_prewarmed,
+			"proxysql_server_connections_total",
+			"Total number of server connections (created|delayed|aborted|prewarmed). Prewarmed connections are created ahead of demand by mysql-connection_prewarm_ms, and are also counted as created.",
+			metric_tags {
+				{ "status", "prewarmed" }
+			}
+		),
 		std::make_tuple (
 			p_hg_counter::server_connections_aborted,
 			"proxysql_server_connections_total",
-			"Total number of server connections (created|delayed|aborted).",
+			"Total number of server connections (created|delayed|aborted|prewarmed). Prewarmed connections are created ahead of demand by mysql-connection_prewarm_ms, and are also counted as created.",
 			metric_tags {
 				{ "status", "aborted" }
 			}
@@ -584,6 +592,7 @@ MySQL_HostGroups_Manager::MySQL_HostGroups_Manager() {
 	status.server_connections_aborted=0;
 	status.server_connections_created=0;
 	status.server_connections_delayed=0;
+	status.server_connections_prewarmed=0;
 	status.servers_table_version=0;
 	pthread_mutex_init(&status.servers_table_version_lock, NULL);
 	pthread_cond_init(&status.servers_table_version_cond, NULL);
@@ -615,7 +624,14 @@ MySQL_HostGroups_Manager::MySQL_HostGroups_Manager() {
 	pthread_mutex_init(&Galera_Info_mutex, NULL);
 	pthread_mutex_init(&AWS_Aurora_Info_mutex, NULL);
 #ifdef MHM_PTHREAD_MUTEX
-	pthread_mutex_init(&lock, NULL);
+	{
+		pthread_rwlockattr_t attr;
+		pthread_rwlockattr_init(&attr);
+		// commit() and the other writers must not be starved by the connection pool readers
+		pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+		pthread_rwlock_init(&lock, &attr);
+		pthread_rwlockattr_destroy(&attr);
+	}
 #else
 	spinlock_rwlock_init(&rwlock);
 #endif
@@ -710,14 +726,18 @@ MySQL_HostGroups_Manager::~MySQL_HostGroups_Manager() {
 	if (gtid_ev_timer)
 		free(gtid_ev_timer);
 #ifdef MHM_PTHREAD_MUTEX
-	pthread_mutex_destroy(&lock);
+	pthread_rwlock_destroy(&lock);
 #endif
 }
 
 // wrlock() is only required during commit()
+// wrlock() gives exclusive access to all the hostgroups, while the connection pool hot path
+// (get_MyConn_from_pool() , push_MyConn_to_pool() and destroy_MyConn_from_pool()) only
+// acquires rdlock() and the mutex of the hostgroup it operates on.
+// Therefore, functions called with wrlock() don't need to lock the single hostgroups.
 void MySQL_HostGroups_Manager::wrlock() {
 #ifdef MHM_PTHREAD_MUTEX
-	pthread_mutex_lock(&lock);
+	pthread_rwlock_wrlock(&lock);
 #else
 	spin_wrlock(&rwlock);
 #endif
@@ -762,12 +782,30 @@ void MySQL_HostGroups_Manager::wrunlock() {
 	is_locked = false;
 #endif
 #ifdef MHM_PTHREAD_MUTEX
-	pthread_mutex_unlock(&lock);
+	pthread_rwlock_unlock(&lock);
 #else
 	spin_wrunlock(&rwlock);
 #endif
 }
 
+// rdlock() prevents any reconfiguration of the hostgroups, and must be followed by
+// MyHGC::lock() to access the servers and the connections of a hostgroup
+void MySQL_HostGroups_Manager::rdlock() {
+#ifdef MHM_PTHREAD_MUTEX
+	pthread_rwlock_rdlock(&lock);
+#else
+	spin_rdlock(&rwlock);
+#endif
+}
+
+void MySQL_HostGroups_Manager::rdunlock() {
+#ifdef MHM_PTHREAD_MUTEX
+	pthread_rwlock_unlock(&lock);
+#else
+	spin_rdunlock(&rwlock);
+#endif
+}
+
 
 void MySQL_HostGroups_Manager::wait_servers_table_version(unsigned v, unsigned w) {
 	struct timespec ts;
@@ -1165,18 +1203,15 @@ void update_glovars_mysql_servers_v2_checksum(
  * @brief Commit and update checksum from the MySQL servers.
  *
  * This function commits updates and calculates the checksum from the MySQL servers. It performs the following steps:
- * 1. Deletes existing data from the 'mysql_servers' table.
- * 2. Generates a new 'mysql_servers' table.
- * 3. Saves the runtime MySQL servers data obtained from the provided result set or from the database if the result set is null.
- * 4. Calculates the checksum of the runtime MySQL servers data and updates the checksum value in the 'table_resultset_checksum' array.
+ * 1. Saves the runtime MySQL servers data obtained from the provided result set or from the database if the result set is null.
+ * 2. Calculates the checksum of the runtime MySQL servers data and updates the checksum value in the 'table_resultset_checksum' array.
+ *
+ * The 'mysql_servers' table must be already generated by the caller.
  *
  * @param runtime_mysql_servers A pointer to the result set containing runtime MySQL servers data.
  * @return The raw checksum value calculated from the runtime MySQL servers data.
  */
 uint64_t MySQL_HostGroups_Manager::commit_update_checksum_from_mysql_servers(SQLite3_result* runtime_mysql_servers) {
-	mydb->execute("DELETE FROM mysql_servers");
-	generate_mysql_servers_table();
-
 	if (runtime_mysql_servers == nullptr) {
 		unique_ptr<SQLite3_result> resultset { get_admin_runtime_mysql_servers(mydb) };
 		save_runtime_mysql_servers(resultset.release());
@@ -1238,6 +1273,168 @@ std::string MySQL_HostGroups_Manager::gen_global_mysql_servers_v2_checksum(uint6
 	return mysrvs_checksum;
 }
 
+/**
+ * @brief Applies the content of 'mysql_servers_incoming' to the servers in memory.
+ * @details The incoming servers are compared with the ones in 'MyHostGroups' with a hash lookup, and only
+ *  the servers that differ are modified: new servers are created, changed servers are updated in place,
+ *  and servers no longer present are set OFFLINE_HARD. Neither the 'mysql_servers' table nor the
+ *  unchanged servers are touched, so the cost doesn't depend on the joins of the two tables.
+ *  Requires the caller to hold 'wrlock()'.
+ * @param use_gtid Set to 'true' if any of the incoming servers has 'gtid_port' configured.
+ * @return The number of servers created, changed or removed.
+ */
+unsigned int MySQL_HostGroups_Manager::commit_apply_mysql_servers_incoming(bool& use_gtid) {
+	char *error=NULL;
+	int cols=0;
+	int affected_rows=0;
+	SQLite3_result *resultset=NULL;
+	unsigned int changes=0;
+
+	const char *query=(char *)"SELECT hostgroup_id, hostname, port, gtid_port, weight, status, compression, max_connections, max_replication_lag, use_ssl, max_latency_ms, comment FROM mysql_servers_incoming";
+	proxy_debug(PROXY_DEBUG_MYSQL_CONNPOOL, 4, "%s\n", query);
+	mydb->execute_statement(query, &error , &cols , &affected_rows , &resultset);
+	if (error) {
+		proxy_error("Error on %s : %s\n", query, error);
+		free(error);
+		return 0;
+	}
+
+	// servers currently in memory, removed from the map as they are found in 'mysql_servers_incoming'
+	std::unordered_map<std::string, MySrvC *> current_servers {};
+	for (unsigned int i=0; i<MyHostGroups->len; i++) {
+		MyHGC *myhgc=(MyHGC *)MyHostGroups->index(i);
+		for (unsigned int j=0; j<myhgc->mysrvs->servers->len; j++) {
+			MySrvC *mysrvc=myhgc->mysrvs->idx(j);
+			current_servers.emplace(std::to_string(myhgc->hid) + ":" + mysrvc->address + ":" + std::to_string(mysrvc->port), mysrvc);
+		}
+	}
+
+	for (std::vector<SQLite3_row *>::iterator it = resultset->rows.begin() ; it != resultset->rows.end(); ++it) {
+		SQLite3_row *r=*it;
+		const std::string key { std::string(r->fields[0]) + ":" + r->fields[1] + ":" + r->fields[2] };
+		std::unordered_map<std::string, MySrvC *>::iterator it2 = current_servers.find(key);
+		MySrvC *mysrvc=NULL;
+		if (it2 == current_servers.end()) {
+			if (GloMTH->variables.hostgroup_manager_verbose) {
+				proxy_info("Creating new server in HG %d : %s:%d , gtid_port=%d, weight=%d, status=%d\n", atoi(r->fields[0]), r->fields[1], atoi(r->fields[2]), atoi(r->fields[3]), atoi(r->fields[4]), atoi(r->fields[5]));
+			}
+			mysrvc=new MySrvC(r->fields[1], atoi(r->fields[2]), atoi(r->fields[3]), atoi(r->fields[4]), (MySerStatus)atoi(r->fields[5]), atoi(r->fields[6]), atoi(r->fields[7]), atoi(r->fields[8]), atoi(r->fields[9]), atoi(r->fields[10]), r->fields[11]); // add new fields here if adding more columns in mysql_servers
+			proxy_debug(PROXY_DEBUG_MYSQL_CONNPOOL, 5, "Adding new server %s:%d , weight=%d, status=%d, mem_ptr=%p into hostgroup=%d\n", r->fields[1], atoi(r->fields[2]), atoi(r->fields[4]), atoi(r->fields[5]), mysrvc, atoi(r->fields[0]));
+			add(mysrvc,atoi(r->fields[0]));
+			changes++;
+		} else {
+			mysrvc=it2->second;
+			current_servers.erase(it2);
+			bool changed=false;
+			if (mysrvc->gtid_port!=atoi(r->fields[3])) {
+				if (GloMTH->variables.hostgroup_manager_verbose)
+					proxy_info("Changing gtid_port for server %u:%s:%d from %d to %d\n" , mysrvc->myhgc->hid , mysrvc->address, mysrvc->port, mysrvc->gtid_port , atoi(r->fields[3]));
+				mysrvc->gtid_port=atoi(r->fields[3]);
+				changed=true;
+			}
+			if (mysrvc->weight!=atoi(r->fields[4])) {
+				if (GloMTH->variables.hostgroup_manager_verbose)
+					proxy_debug(PROXY_DEBUG_MYSQL_CONNPOOL, 5, "Changing weight for server %d:%s:%d from %ld to %d\n" , mysrvc->myhgc->hid , mysrvc->address, mysrvc->port, mysrvc->weight , atoi(r->fields[4]));
+				mysrvc->weight=atoi(r->fields[4]);
+				changed=true;
+			}
+			if ((int)mysrvc->get_status()!=atoi(r->fields[5])) {
+				bool change_server_status = true;
+				if (GloMTH->variables.evaluate_replication_lag_on_servers_load == 1) {
+					if (mysrvc->get_status() == MYSQL_SERVER_STATUS_SHUNNED_REPLICATION_LAG && // currently server is shunned due to replication lag
+						(MySerStatus)atoi(r->fields[5]) == MYSQL_SERVER_STATUS_ONLINE) { // new server status is online
+						if (mysrvc->cur_replication_lag != -2) { // Master server? Seconds_Behind_Master column is not present
+							const unsigned int new_max_repl_lag = atoi(r->fields[8]);
+							if (mysrvc->cur_replication_lag < 0 ||
+								(new_max_repl_lag > 0 &&
+								((unsigned int)mysrvc->cur_replication_lag > new_max_repl_lag))) { // we check if current replication lag is greater than new max_replication_lag
+								change_server_status = false;
+							}
+						}
+					}
+				}
+				if (change_server_status == true) {
+					if (GloMTH->variables.hostgroup_manager_verbose)
+						proxy_info("Changing status for server %d:%s:%d from %d to %d\n", mysrvc->myhgc->hid, mysrvc->address, mysrvc->port, (int)mysrvc->get_status(), atoi(r->fields[5]));
+					mysrvc->set_status((MySerStatus)atoi(r->fields[5]));
+				}
+				if (mysrvc->get_status() == MYSQL_SERVER_STATUS_SHUNNED) {
+					mysrvc->shunned_automatic=false;
+				}
+				changed=true;
+			}
+			if (mysrvc->compression!=(unsigned int)atoi(r->fields[6])) {
+				if (GloMTH->variables.hostgroup_manager_verbose)
+					proxy_info("Changing compression for server %d:%s:%d from %d to %d\n" , mysrvc->myhgc->hid , mysrvc->address, mysrvc->port, mysrvc->compression , atoi(r->fields[6]));
+				mysrvc->compression=atoi(r->fields[6]);
+				changed=true;
+			}
+			if (mysrvc->max_connections!=atoi(r->fields[7])) {
+				if (GloMTH->variables.hostgroup_manager_verbose)
+					proxy_info("Changing max_connections for server %d:%s:%d from %ld to %d\n" , mysrvc->myhgc->hid , mysrvc->address, mysrvc->port, mysrvc->max_connections , atoi(r->fields[7]));
+				mysrvc->max_connections=atoi(r->fields[7]);
+				changed=true;
+			}
+			if (mysrvc->max_replication_lag!=(unsigned int)atoi(r->fields[8])) {
+				if (GloMTH->variables.hostgroup_manager_verbose)
+					proxy_info("Changing max_replication_lag for server %u:%s:%d from %d to %d\n" , mysrvc->myhgc->hid , mysrvc->address, mysrvc->port, mysrvc->max_replication_lag , atoi(r->fields[8]));
+				mysrvc->max_replication_lag=atoi(r->fields[8]);
+				if (mysrvc->max_replication_lag == 0) { // we just changed it to 0
+					if (mysrvc->get_status() == MYSQL_SERVER_STATUS_SHUNNED_REPLICATION_LAG) {
+						// the server is currently shunned due to replication lag
+						// but we reset max_replication_lag to 0
+						// therefore we immediately reset the status too
+						mysrvc->set_status(MYSQL_SERVER_STATUS_ONLINE);
+					}
+				}
+				changed=true;
+			}
+			if (mysrvc->use_ssl!=atoi(r->fields[9])) {
+				if (GloMTH->variables.hostgroup_manager_verbose)
+					proxy_info("Changing use_ssl for server %d:%s:%d from %d to %d\n" , mysrvc->myhgc->hid , mysrvc->address, mysrvc->port, mysrvc->use_ssl , atoi(r->fields[9]));
+				mysrvc->use_ssl=atoi(r->fields[9]);
+				changed=true;
+			}
+			if (mysrvc->max_latency_us/1000!=(unsigned int)atoi(r->fields[10])) {
+				if (GloMTH->variables.hostgroup_manager_verbose)
+					proxy_info("Changing max_latency_ms for server %d:%s:%d from %d to %d\n" , mysrvc->myhgc->hid , mysrvc->address, mysrvc->port, mysrvc->max_latency_us/1000 , atoi(r->fields[10]));
+				mysrvc->max_latency_us=1000*atoi(r->fields[10]);
+				changed=true;
+			}
+			if (strcmp(mysrvc->comment,r->fields[11])) {
+				if (GloMTH->variables.hostgroup_manager_verbose)
+					proxy_info("Changing comment for server %d:%s:%d from '%s' to '%s'\n" , mysrvc->myhgc->hid , mysrvc->address, mysrvc->port, mysrvc->comment, r->fields[11]);
+				free(mysrvc->comment);
+				mysrvc->comment=strdup(r->fields[11]);
+				changed=true;
+			}
+			if (changed) {
+				changes++;
+			}
+		}
+		if (mysrvc->gtid_port) {
+			// this server has gtid_port configured, we set use_gtid
+			proxy_debug(PROXY_DEBUG_MYSQL_CONNPOOL, 6, "Server %u:%s:%d has gtid_port enabled, setting use_gitd=true if not already set\n", mysrvc->myhgc->hid , mysrvc->address, mysrvc->port);
+			use_gtid = true;
+		}
+	}
+	delete resultset;
+
+	// the servers left are not present in 'mysql_servers_incoming'
+	for (std::unordered_map<std::string, MySrvC *>::iterator it = current_servers.begin(); it != current_servers.end(); ++it) {
+		MySrvC *mysrvc=it->second;
+		proxy_warning("Removed server at address %lld, hostgroup %u, address %s port %d. Setting status OFFLINE HARD and immediately dropping all free connections. Used connections will be dropped when trying to use them\n", (long long)(uintptr_t)mysrvc, mysrvc->myhgc->hid, mysrvc->address, mysrvc->port);
+		mysrvc->set_status(MYSQL_SERVER_STATUS_OFFLINE_HARD);
+		mysrvc->ConnectionsFree->drop_all_connections();
+		changes++;
+	}
+
+	if (GloMTH->variables.hostgroup_manager_verbose) {
+		proxy_info("Applied %u changes from mysql_servers_incoming\n", changes);
+	}
+	return changes;
+}
+
 bool MySQL_HostGroups_Manager::commit(
 	const peer_runtime_mysql_servers_t& peer_runtime_mysql_servers,
 	const peer_mysql_servers_v2_t& peer_mysql_servers_v2,
@@ -1258,9 +1455,6 @@ bool MySQL_HostGroups_Manager::commit(
 	// if any server has gtid_port enabled, use_gtid is set to true
 	// and then has_gtid_port is set too
 	bool use_gtid = false;
-	proxy_debug(PROXY_DEBUG_MYSQL_CONNPOOL, 4, "DELETE FROM mysql_servers\n");
-	mydb->execute("DELETE FROM mysql_servers");
-	generate_mysql_servers_table();
 
 	char *error=NULL;
 	int cols=0;
@@ -1278,200 +1472,18 @@ bool MySQL_HostGroups_Manager::commit(
 		}
 		if (resultset) { delete resultset; resultset=NULL; }
 	}
-	char *query=NULL;
-	query=(char *)"SELECT mem_pointer, t1.hostgroup_id, t1.hostname, t1.port FROM mysql_servers t1 LEFT OUTER JOIN mysql_servers_incoming t2 ON (t1.hostgroup_id=t2.hostgroup_id AND t1.hostname=t2.hostname AND t1.port=t2.port) WHERE t2.hostgroup_id IS NULL";
-	mydb->execute_statement(query, &error , &cols , &affected_rows , &resultset);
-	if (error) {
-		proxy_error("Error on %s : %s\n", query, error);
-	} else {
-		if (GloMTH->variables.hostgroup_manager_verbose) {
-			proxy_info("Dumping mysql_servers LEFT JOIN mysql_servers_incoming\n");
-			resultset->dump_to_stderr();
-		}
-		for (std::vector<SQLite3_row *>::iterator it = resultset->rows.begin() ; it != resultset->rows.end(); ++it) {
-			SQLite3_row *r=*it;
-			long long ptr=atoll(r->fields[0]);
-			proxy_warning("Removed server at address %lld, hostgroup %s, address %s port %s. Setting status OFFLINE HARD and immediately dropping all free connections. Used connections will be dropped when trying to use them\n", ptr, r->fields[1], r->fields[2], r->fields[3]);
-			MySrvC *mysrvc=(MySrvC *)ptr;
-			mysrvc->set_status(MYSQL_SERVER_STATUS_OFFLINE_HARD);
-			mysrvc->ConnectionsFree->drop_all_connections();
-			char *q1=(char *)"DELETE FROM mysql_servers WHERE mem_pointer=%lld";
-			char *q2=(char *)malloc(strlen(q1)+32);
-			sprintf(q2,q1,ptr);
-			mydb->execute(q2);
-			free(q2);
-		}
-	}
-	if (resultset) { delete resultset; resultset=NULL; }
-
-	// This seems unnecessary. Removed as part of issue #829
-	//mydb->execute("DELETE FROM mysql_servers");
-	//generate_mysql_servers_table();
-
-	mydb->execute("INSERT OR IGNORE INTO mysql_servers(hostgroup_id, hostname, port, gtid_port, weight, status, compression, max_connections, max_replication_lag, use_ssl, max_latency_ms, comment) SELECT hostgroup_id, hostname, port, gtid_port, weight, status, compression, max_connections, max_replication_lag, use_ssl, max_latency_ms, comment FROM mysql_servers_incoming");
-
-	// SELECT FROM mysql_servers whatever is not identical in mysql_servers_incoming, or where mem_pointer=0 (where there is no pointer yet)
-	query=(char *)"SELECT t1.*, t2.gtid_port, t2.weight, t2.status, t2.compression, t2.max_connections, t2.max_replication_lag, t2.use_ssl, t2.max_latency_ms, t2.comment FROM mysql_servers t1 JOIN mysql_servers_incoming t2 ON (t1.hostgroup_id=t2.hostgroup_id AND t1.hostname=t2.hostname AND t1.port=t2.port) WHERE mem_pointer=0 OR t1.gtid_port<>t2.gtid_port OR t1.weight<>t2.weight OR t1.status<>t2.status OR t1.compression<>t2.compression OR t1.max_connections<>t2.max_connections OR t1.max_replication_lag<>t2.max_replication_lag OR t1.use_ssl<>t2.use_ssl OR t1.max_latency_ms<>t2.max_latency_ms or t1.comment<>t2.comment";
-	proxy_debug(PROXY_DEBUG_MYSQL_CONNPOOL, 4, "%s\n", query);
-	mydb->execute_statement(query, &error , &cols , &affected_rows , &resultset);
-	if (error) {
-		proxy_error("Error on %s : %s\n", query, error);
-	} else {
-
-		if (GloMTH->variables.hostgroup_manager_verbose) {
-			proxy_info("Dumping mysql_servers JOIN mysql_servers_incoming\n");
-			resultset->dump_to_stderr();
-		}
-		// optimization #829
-		int rc;
-		sqlite3_stmt *statement1=NULL;
-		sqlite3_stmt *statement2=NULL;
-		//sqlite3 *mydb3=mydb->get_db();
-		char *query1=(char *)"UPDATE mysql_servers SET mem_pointer = ?1 WHERE hostgroup_id = ?2 AND hostname = ?3 AND port = ?4";
-		//rc=(*proxy_sqlite3_prepare_v2)(mydb3, query1, -1, &statement1, 0);
-		rc = mydb->prepare_v2(query1, &statement1);
-		ASSERT_SQLITE_OK(rc, mydb);
-		char *query2=(char *)"UPDATE mysql_servers SET weight = ?1 , status = ?2 , compression = ?3 , max_connections = ?4 , max_replication_lag = ?5 , use_ssl = ?6 , max_latency_ms = ?7 , comment = ?8 , gtid_port = ?9 WHERE hostgroup_id = ?10 AND hostname = ?11 AND port = ?12";
-		//rc=(*proxy_sqlite3_prepare_v2)(mydb3, query2, -1, &statement2, 0);
-		rc = mydb->prepare_v2(query2, &statement2);
-		ASSERT_SQLITE_OK(rc, mydb);
-
-		for (std::vector<SQLite3_row *>::iterator it = resultset->rows.begin() ; it != resultset->rows.end(); ++it) {
-			SQLite3_row *r=*it;
-			long long ptr=atoll(r->fields[12]); // increase this index every time a new column is added
-			proxy_debug(PROXY_DEBUG_MYSQL_CONNPOOL, 5, "Server %s:%d , weight=%d, status=%d, mem_pointer=%llu, hostgroup=%d, compression=%d\n", r->fields[1], atoi(r->fields[2]), atoi(r->fields[4]), atoi(r->fields[5]), ptr, atoi(r->fields[0]), atoi(r->fields[6]));
-			//fprintf(stderr,"%lld\n", ptr);
-			if (ptr==0) {
-				if (GloMTH->variables.hostgroup_manager_verbose) {
-					proxy_info("Creating new server in HG %d : %s:%d , gtid_port=%d, weight=%d, status=%d\n", atoi(r->fields[0]), r->fields[1], atoi(r->fields[2]), atoi(r->fields[3]), atoi(r->fields[4]), atoi(r->fields[5]));
-				}
-				MySrvC *mysrvc=new MySrvC(r->fields[1], atoi(r->fields[2]), atoi(r->fields[3]), atoi(r->fields[4]), (MySerStatus)atoi(r->fields[5]), atoi(r->fields[6]), atoi(r->fields[7]), atoi(r->fields[8]), atoi(r->fields[9]), atoi(r->fields[10]), r->fields[11]); // add new fields here if adding more columns in mysql_servers
-				proxy_debug(PROXY_DEBUG_MYSQL_CONNPOOL, 5, "Adding new server %s:%d , weight=%d, status=%d, mem_ptr=%p into hostgroup=%d\n", r->fields[1], atoi(r->fields[2]), atoi(r->fields[4]), atoi(r->fields[5]), mysrvc, atoi(r->fields[0]));
-				add(mysrvc,atoi(r->fields[0]));
-				ptr=(uintptr_t)mysrvc;
-				rc=(*proxy_sqlite3_bind_int64)(statement1, 1, ptr); ASSERT_SQLITE_OK(rc, mydb);
-				rc=(*proxy_sqlite3_bind_int64)(statement1, 2, atoi(r->fields[0])); ASSERT_SQLITE_OK(rc, mydb);
-				rc=(*proxy_sqlite3_bind_text)(statement1, 3,  r->fields[1], -1, SQLITE_TRANSIENT); ASSERT_SQLITE_OK(rc, mydb);
-				rc=(*proxy_sqlite3_bind_int64)(statement1, 4, atoi(r->fields[2])); ASSERT_SQLITE_OK(rc, mydb);
-				SAFE_SQLITE3_STEP2(statement1);
-				rc=(*proxy_sqlite3_clear_bindings)(statement1); ASSERT_SQLITE_OK(rc, mydb);
-				rc=(*proxy_sqlite3_reset)(statement1); ASSERT_SQLITE_OK(rc, mydb);
-				if (mysrvc->gtid_port) {
-					// this server has gtid_port configured, we set use_gtid
-					proxy_debug(PROXY_DEBUG_MYSQL_CONNPOOL, 6, "Server %u:%s:%d has gtid_port enabled, setting use_gitd=true if not already set\n", mysrvc->myhgc->hid , mysrvc->address, mysrvc->port);
-					use_gtid = true;
-				}
-			} else {
-				bool run_update=false;
-				MySrvC *mysrvc=(MySrvC *)ptr;
-				// carefully increase the 2nd index by 1 for every new column added
-				if (atoi(r->fields[3])!=atoi(r->fields[13])) {
-					if (GloMTH->variables.hostgroup_manager_verbose)
-						proxy_info("Changing gtid_port for server %u:%s:%d (%s:%d) from %d (%d) to %d\n" , mysrvc->myhgc->hid , mysrvc->address, mysrvc->port, r->fields[1], atoi(r->fields[2]), atoi(r->fields[3]) , mysrvc->gtid_port , atoi(r->fields[13]));
-					mysrvc->gtid_port=atoi(r->fields[13]);
-				}
+	commit_apply_mysql_servers_incoming(use_gtid);
+	// 'mysql_servers' is generated once, after all the changes are applied. It is used by the
+	// generation of the other tables and to compute the checksum
+	proxy_debug(PROXY_DEBUG_MYSQL_CONNPOOL, 4, "DELETE FROM mysql_servers\n");
+	mydb->execute("DELETE FROM mysql_servers");
+	generate_mysql_servers_table();
 
-				if (atoi(r->fields[4])!=atoi(r->fields[14])) {
-					if (GloMTH->variables.hostgroup_manager_verbose)
-						proxy_debug(PROXY_DEBUG_MYSQL_CONNPOOL, 5, "Changing weight for server %d:%s:%d (%s:%d) from %d (%ld) to %d\n" , mysrvc->myhgc->hid , mysrvc->address, mysrvc->port, r->fields[1], atoi(r->fields[2]), atoi(r->fields[4]) , mysrvc->weight , atoi(r->fields[14]));
-					mysrvc->weight=atoi(r->fields[14]);
-				}
-				if (atoi(r->fields[5])!=atoi(r->fields[15])) {
-					bool change_server_status = true;
-					if (GloMTH->variables.evaluate_replication_lag_on_servers_load == 1) {
-						if (mysrvc->get_status() == MYSQL_SERVER_STATUS_SHUNNED_REPLICATION_LAG && // currently server is shunned due to replication lag
-							(MySerStatus)atoi(r->fields[15]) == MYSQL_SERVER_STATUS_ONLINE) { // new server status is online
-							if (mysrvc->cur_replication_lag != -2) { // Master server? Seconds_Behind_Master column is not present
-								const unsigned int new_max_repl_lag = atoi(r->fields[18]);
-								if (mysrvc->cur_replication_lag < 0 ||
-									(new_max_repl_lag > 0 &&
-									((unsigned int)mysrvc->cur_replication_lag > new_max_repl_lag))) { // we check if current replication lag is greater than new max_replication_lag
-									change_server_status = false;
-								}
-							}
-						}
-					}
-					if (change_server_status == true) {
-						if (GloMTH->variables.hostgroup_manager_verbose)
-							proxy_info("Changing status for server %d:%s:%d (%s:%d) from %d (%d) to %d\n", mysrvc->myhgc->hid, mysrvc->address, mysrvc->port, r->fields[1], atoi(r->fields[2]), atoi(r->fields[5]), (int)mysrvc->get_status(), atoi(r->fields[15]));
-						mysrvc->set_status((MySerStatus)atoi(r->fields[15]));
-					}
-					if (mysrvc->get_status() == MYSQL_SERVER_STATUS_SHUNNED) {
-						mysrvc->shunned_automatic=false;
-					}
-				}
-				if (atoi(r->fields[6])!=atoi(r->fields[16])) {
-					if (GloMTH->variables.hostgroup_manager_verbose)
-						proxy_info("Changing compression for server %d:%s:%d (%s:%d) from %d (%d) to %d\n" , mysrvc->myhgc->hid , mysrvc->address, mysrvc->port, r->fields[1], atoi(r->fields[2]), atoi(r->fields[6]) , mysrvc->compression , atoi(r->fields[16]));
-					mysrvc->compression=atoi(r->fields[16]);
-				}
-				if (atoi(r->fields[7])!=atoi(r->fields[17])) {
-					if (GloMTH->variables.hostgroup_manager_verbose)
-					proxy_info("Changing max_connections for server %d:%s:%d (%s:%d) from %d (%ld) to %d\n" , mysrvc->myhgc->hid , mysrvc->address, mysrvc->port, r->fields[1], atoi(r->fields[2]), atoi(r->fields[7]) , mysrvc->max_connections , atoi(r->fields[17]));
-					mysrvc->max_connections=atoi(r->fields[17]);
-				}
-				if (atoi(r->fields[8])!=atoi(r->fields[18])) {
-					if (GloMTH->variables.hostgroup_manager_verbose)
-						proxy_info("Changing max_replication_lag for server %u:%s:%d (%s:%d) from %d (%d) to %d\n" , mysrvc->myhgc->hid , mysrvc->address, mysrvc->port, r->fields[1], atoi(r->fields[2]), atoi(r->fields[8]) , mysrvc->max_replication_lag , atoi(r->fields[18]));
-					mysrvc->max_replication_lag=atoi(r->fields[18]);
-					if (mysrvc->max_replication_lag == 0) { // we just changed it to 0
-						if (mysrvc->get_status() == MYSQL_SERVER_STATUS_SHUNNED_REPLICATION_LAG) {
-							// the server is currently shunned due to replication lag
-							// but we reset max_replication_lag to 0
-							// therefore we immediately reset the status too
-							mysrvc->set_status(MYSQL_SERVER_STATUS_ONLINE);
-						}
-					}
-				}
-				if (atoi(r->fields[9])!=atoi(r->fields[19])) {
-					if (GloMTH->variables.hostgroup_manager_verbose)
-						proxy_info("Changing use_ssl for server %d:%s:%d (%s:%d) from %d (%d) to %d\n" , mysrvc->myhgc->hid , mysrvc->address, mysrvc->port, r->fields[1], atoi(r->fields[2]), atoi(r->fields[9]) , mysrvc->use_ssl , atoi(r->fields[19]));
-					mysrvc->use_ssl=atoi(r->fields[19]);
-				}
-				if (atoi(r->fields[10])!=atoi(r->fields[20])) {
-					if (GloMTH->variables.hostgroup_manager_verbose)
-						proxy_info("Changing max_latency_ms for server %d:%s:%d (%s:%d) from %d (%d) to %d\n" , mysrvc->myhgc->hid , mysrvc->address, mysrvc->port, r->fields[1], atoi(r->fields[2]), atoi(r->fields[10]) , mysrvc->max_latency_us/1000 , atoi(r->fields[20]));
-					mysrvc->max_latency_us=1000*atoi(r->fields[20]);
-				}
-				if (strcmp(r->fields[11],r->fields[21])) {
-					if (GloMTH->variables.hostgroup_manager_verbose)
-						proxy_info("Changing comment for server %d:%s:%d (%s:%d) from '%s' to '%s'\n" , mysrvc->myhgc->hid , mysrvc->address, mysrvc->port, r->fields[1], atoi(r->fields[2]), r->fields[11], r->fields[21]);
-					free(mysrvc->comment);
-					mysrvc->comment=strdup(r->fields[21]);
-				}
-				if (run_update) {
-					rc=(*proxy_sqlite3_bind_int64)(statement2, 1, mysrvc->weight); ASSERT_SQLITE_OK(rc, mydb);
-					rc=(*proxy_sqlite3_bind_int64)(statement2, 2, (int)mysrvc->get_status()); ASSERT_SQLITE_OK(rc, mydb);
-					rc=(*proxy_sqlite3_bind_int64)(statement2, 3, mysrvc->compression); ASSERT_SQLITE_OK(rc, mydb);
-					rc=(*proxy_sqlite3_bind_int64)(statement2, 4, mysrvc->max_connections); ASSERT_SQLITE_OK(rc, mydb);
-					rc=(*proxy_sqlite3_bind_int64)(statement2, 5, mysrvc->max_replication_lag); ASSERT_SQLITE_OK(rc, mydb);
-					rc=(*proxy_sqlite3_bind_int64)(statement2, 6, mysrvc->use_ssl); ASSERT_SQLITE_OK(rc, mydb);
-					rc=(*proxy_sqlite3_bind_int64)(statement2, 7, mysrvc->max_latency_us/1000); ASSERT_SQLITE_OK(rc, mydb);
-					rc=(*proxy_sqlite3_bind_text)(statement2, 8,  mysrvc->comment, -1, SQLITE_TRANSIENT); ASSERT_SQLITE_OK(rc, mydb);
-					rc=(*proxy_sqlite3_bind_int64)(statement2, 9, mysrvc->gtid_port); ASSERT_SQLITE_OK(rc, mydb);
-					rc=(*proxy_sqlite3_bind_int64)(statement2, 10, mysrvc->myhgc->hid); ASSERT_SQLITE_OK(rc, mydb);
-					rc=(*proxy_sqlite3_bind_text)(statement2, 11,  mysrvc->address, -1, SQLITE_TRANSIENT); ASSERT_SQLITE_OK(rc, mydb);
-					rc=(*proxy_sqlite3_bind_int64)(statement2, 12, mysrvc->port); ASSERT_SQLITE_OK(rc, mydb);
-					SAFE_SQLITE3_STEP2(statement2);
-					rc=(*proxy_sqlite3_clear_bindings)(statement2); ASSERT_SQLITE_OK(rc, mydb);
-					rc=(*proxy_sqlite3_reset)(statement2); ASSERT_SQLITE_OK(rc, mydb);
-				}
-				if (mysrvc->gtid_port) {
-					// this server has gtid_port configured, we set use_gtid
-					proxy_debug(PROXY_DEBUG_MYSQL_CONNPOOL, 6, "Server %u:%s:%d has gtid_port enabled, setting use_gitd=true if not already set\n", mysrvc->myhgc->hid , mysrvc->address, mysrvc->port);
-					use_gtid = true;
-				}
-			}
-		}
-		(*proxy_sqlite3_finalize)(statement1);
-		(*proxy_sqlite3_finalize)(statement2);
-	}
 	if (use_gtid) {
 		has_gtid_port = true;
 	} else {
 		has_gtid_port = false;
 	}
-	if (resultset) { delete resultset; resultset=NULL; }
 	proxy_debug(PROXY_DEBUG_MYSQL_CONNPOOL, 4, "DELETE FROM mysql_servers_incoming\n");
 	mydb->execute("DELETE FROM mysql_servers_incoming");
 
@@ -1635,11 +1647,15 @@ uint64_t MySQL_HostGroups_Manager::get_mysql_servers_checksum(SQLite3_result* ru
  * @return True if the specified GTID exists for the MySQL server connection, false otherwise.
  */
 bool MySQL_HostGroups_Manager::gtid_exists(MySrvC *mysrvc, char * gtid_uuid, uint64_t gtid_trxid) {
-	bool ret = false;
-	pthread_rwlock_rdlock(&gtid_rwlock);
+	gtid_uuid_t uuid;
+	if (uuid.parse(gtid_uuid) == false) {
+		return false;
+	}
+	std::shared_ptr<const gtid_set_t> gtid_executed = nullptr;
 	std::string s1 = mysrvc->address;
 	s1.append(":");
 	s1.append(std::to_string(mysrvc->port));
+	pthread_rwlock_rdlock(&gtid_rwlock);
 	std::unordered_map <string, GTID_Server_Data *>::iterator it2;
 	it2 = gtid_map.find(s1);
 	GTID_Server_Data *gtid_is=NULL;
@@ -1647,12 +1663,14 @@ bool MySQL_HostGroups_Manager::gtid_exists(MySrvC *mysrvc, char * gtid_uuid, uin
 		gtid_is=it2->second;
 		if (gtid_is) {
 			if (gtid_is->active == true) {
-				ret = gtid_is->gtid_exists(gtid_uuid,gtid_trxid);
+				gtid_executed = gtid_is->get_gtid_executed();
 			}
 		}
 	}
-	//proxy_info("Checking if server %s has GTID %s:%lu . %s\n", s1.c_str(), gtid_uuid, gtid_trxid, (ret ? "YES" : "NO"));
 	pthread_rwlock_unlock(&gtid_rwlock);
+	// the published gtid_executed is immutable: the search doesn't need any lock
+	bool ret = (gtid_executed ? gtid_executed->contains(uuid, (int64_t)gtid_trxid) : false);
+	//proxy_info("Checking if server %s has GTID %s:%lu . %s\n", s1.c_str(), gtid_uuid, gtid_trxid, (ret ? "YES" : "NO"));
 	return ret;
 }
 
@@ -2315,6 +2333,8 @@ void MySQL_HostGroups_Manager::increase_reset_counter() {
  *
  * @param c The MySQL_Connection object to be pushed back to the pool.
  * @param _lock Boolean flag indicating whether to acquire a lock before performing the operation. Default is true.
+ *  If true, only rdlock() and the lock of the connection's hostgroup are acquired. If false, the caller must
+ *  hold either wrlock() , or rdlock() and the lock of the connection's hostgroup.
  *
  * @note The method assumes that the provided MySQL_Connection object has a valid parent server (MySrvC).
  * If the parent server is not valid, unexpected behavior may occur.
@@ -2326,20 +2346,21 @@ void MySQL_HostGroups_Manager::push_MyConn_to_pool(MySQL_Connection *c, bool _lo
 	// Ensure that the provided connection has a valid parent server
 	assert(c->parent);
 
-	MySrvC *mysrvc = nullptr; // Pointer to the parent server object
+	// Obtain a pointer to the parent server (MySrvC)
+	MySrvC *mysrvc = static_cast<MySrvC *>(c->parent);
+	MyHGC *myhgc = mysrvc->myhgc;
 
 	// Acquire a lock if specified
-	if (_lock)
-		wrlock();
+	if (_lock) {
+		rdlock();
+		myhgc->lock();
+	}
 
 	// Reset the auto-increment delay token associated with the connection
 	c->auto_increment_delay_token = 0;
 
 	// Increment the counter tracking the number of connections pushed back to the pool
-	status.myconnpoll_push++;
-
-	// Obtain a pointer to the parent server (MySrvC)
-	mysrvc = static_cast<MySrvC *>(c->parent);
+	__sync_fetch_and_add(&status.myconnpoll_push, 1);
 
 	// Log debug information about the connection being returned to the pool
 	proxy_debug(PROXY_DEBUG_MYSQL_CONNPOOL, 7, "Returning MySQL_Connection %p, server %s:%d with status %d\n", c, mysrvc->address, mysrvc->port, (int)mysrvc->get_status());
@@ -2386,8 +2407,11 @@ void MySQL_HostGroups_Manager::push_MyConn_to_pool(MySQL_Connection *c, bool _lo
 
 // Exit point for releasing the lock
 __exit_push_MyConn_to_pool:
-	if (_lock)
-		wrunlock(); // Release the lock if acquired
+	if (_lock) {
+		// Release the locks if acquired
+		myhgc->unlock();
+		rdunlock();
+	}
 }
 
 /**
@@ -2395,7 +2419,8 @@ __exit_push_MyConn_to_pool:
  *
  * This method is responsible for returning an array of MySQL_Connection objects back to their associated
  * connection pool after they have been used. It iterates through the array and calls the push_MyConn_to_pool
- * method for each connection without acquiring a lock for each individual push operation.
+ * method for each connection acquiring rdlock() only once , and the lock of each hostgroup only when the
+ * hostgroup of the connection changes.
  *
  * @param ca An array of MySQL_Connection pointers representing the connections to be pushed back to the pool.
  * @param cnt The number of connections in the array.
@@ -2406,13 +2431,21 @@ __exit_push_MyConn_to_pool:
 void MySQL_HostGroups_Manager::push_MyConn_to_pool_array(MySQL_Connection **ca, unsigned int cnt) {
 	unsigned int i=0; // Index variable for iterating through the array
 	MySQL_Connection *c = nullptr; // Pointer to hold the current connection from the array
+	MyHGC *myhgc = nullptr; // Hostgroup currently locked
 	c=ca[i];
 
-	// Acquire a write lock to perform the operations atomically
-	wrlock();
+	// Prevent any reconfiguration while the connections are returned
+	rdlock();
 
 	// Iterate through the array of connections
 	while (i<cnt) {
+		// Connections are often from the same hostgroup, keep its lock as long as possible
+		if (c->parent->myhgc != myhgc) {
+			if (myhgc)
+				myhgc->unlock();
+			myhgc = c->parent->myhgc;
+			myhgc->lock();
+		}
 		// Push the current connection back to the pool without acquiring a lock for each individual push
 		push_MyConn_to_pool(c,false);
 		i++;
@@ -2420,13 +2453,18 @@ void MySQL_HostGroups_Manager::push_MyConn_to_pool_array(MySQL_Connection **ca,
 			c=ca[i];
 	}
 
-	// Release the write lock after processing all connections in the array
-	wrunlock();
+	// Release the locks after processing all connections in the array
+	if (myhgc)
+		myhgc->unlock();
+	rdunlock();
 }
 
-void MySQL_HostGroups_Manager::unshun_server_all_hostgroups(const char * address, uint16_t port, time_t t, int max_wait_sec, unsigned int *skip_hid) {
+void MySQL_HostGroups_Manager::unshun_server_all_hostgroups(const char * address, uint16_t port, time_t t, int max_wait_sec, unsigned int *skip_hid, bool trylock_hostgroups) {
 	// we scan all hostgroups looking for a specific server to unshun
 	// if skip_hid is not NULL , the specific hostgroup is skipped
+	// if trylock_hostgroups is true the caller holds only rdlock() and the lock of its own hostgroup:
+	// the other hostgroups are locked with trylock() to avoid deadlocks, and skipped if busy.
+	// This is only an attempt to unshun the server: a busy hostgroup will unshun it on its own
 	if (GloMTH->variables.hostgroup_manager_verbose >= 3) {
 		char buf[64];
 		if (skip_hid == NULL) {
@@ -2443,6 +2481,9 @@ void MySQL_HostGroups_Manager::unshun_server_all_hostgroups(const char * address
 			// if skip_hid is not NULL, we skip that specific hostgroup
 			continue;
 		}
+		if (trylock_hostgroups && myhgc->trylock() == false) {
+			continue;
+		}
 		bool found = false; // was this server already found in this hostgroup?
 		for (j=0; found==false && j<(int)myhgc->mysrvs->cnt(); j++) {
 			MySrvC *mysrvc=(MySrvC *)myhgc->mysrvs->servers->index(j);
@@ -2474,6 +2515,9 @@ void MySQL_HostGroups_Manager::unshun_server_all_hostgroups(const char * address
 				}
 			}
 		}
+		if (trylock_hostgroups) {
+			myhgc->unlock();
+		}
 	}
 }
 
@@ -2496,19 +2540,31 @@ void MySQL_HostGroups_Manager::unshun_server_all_hostgroups(const char * address
  *         is available in the pool.
  *
  * @note This method locks the connection pool to ensure thread safety during access. It releases the lock once
- *       the operation is completed.
+ *       the operation is completed. Only rdlock() and the lock of the hostgroup are acquired, therefore
+ *       sessions using different hostgroups are not serialized.
  */
 MySQL_Connection * MySQL_HostGroups_Manager::get_MyConn_from_pool(unsigned int _hid, MySQL_Session *sess, bool ff, char * gtid_uuid, uint64_t gtid_trxid, int max_lag_ms) {
 	MySQL_Connection * conn = nullptr; // Pointer to hold the retrieved MySQL_Connection
 
-	// Acquire a write lock to access the connection pool
-	wrlock();
+	// Acquire a read lock to prevent reconfiguration of the connection pool
+	rdlock();
 
 	// Increment the counter for connection pool retrieval attempts
-	status.myconnpoll_get++;
+	__sync_fetch_and_add(&status.myconnpoll_get, 1);
 
 	// Look up the hostgroup by ID and retrieve a random MySQL server from it based on specified criteria
-	MyHGC *myhgc=MyHGC_lookup(_hid);
+	MyHGC *myhgc=MyHGC_find(_hid);
+	if (myhgc == NULL) {
+		// creating the hostgroup requires the write lock. Hostgroups are never removed , so
+		// the new hostgroup is still there once the read lock is acquired again
+		rdunlock();
+		wrlock();
+		MyHGC_lookup(_hid);
+		wrunlock();
+		rdlock();
+		myhgc=MyHGC_find(_hid);
+	}
+	myhgc->lock();
 	MySrvC *mysrvc = NULL;
 #ifdef TEST_AURORA
 	for (int i=0; i<10; i++)
@@ -2521,13 +2577,14 @@ MySQL_Connection * MySQL_HostGroups_Manager::get_MyConn_from_pool(unsigned int _
 		// If a connection is obtained, mark it as used and update connection pool statistics
 		if (conn) {
 			mysrvc->ConnectionsUsed->add(conn);
-			status.myconnpoll_get_ok++;
+			__sync_fetch_and_add(&status.myconnpoll_get_ok, 1);
 			mysrvc->update_max_connections_used();
 		}
 	}
 
-	// Release the write lock after accessing the connection pool
-	wrunlock();
+	// Release the locks after accessing the connection pool
+	myhgc->unlock();
+	rdunlock();
 
 	// Debug message indicating the retrieved MySQL_Connection and its server details
 	proxy_debug(PROXY_DEBUG_MYSQL_CONNPOOL, 7, "Returning MySQL Connection %p, server %s:%d\n", conn, (conn ? conn->parent->address : "") , (conn ? conn->parent->port : 0 ));
@@ -2601,13 +2658,15 @@ void MySQL_HostGroups_Manager::destroy_MyConn_from_pool(MySQL_Connection *c, boo
 	if (to_del) {
 		// we lock only this part of the code because we need to remove the connection from ConnectionsUsed
 		if (_lock) {
-			wrlock();
+			rdlock();
+			mysrvc->myhgc->lock();
 		}
 		proxy_debug(PROXY_DEBUG_MYSQL_CONNPOOL, 7, "Destroying MySQL_Connection %p, server %s:%d\n", c, mysrvc->address, mysrvc->port);
 		mysrvc->ConnectionsUsed->remove(c);
-		status.myconnpoll_destroy++;
-                if (_lock) {
-			wrunlock();
+		__sync_fetch_and_add(&status.myconnpoll_destroy, 1);
+		if (_lock) {
+			mysrvc->myhgc->unlock();
+			rdunlock();
 		}
 		delete c;
 	}
@@ -3092,6 +3151,112 @@ __exit_get_multiple_idle_connections:
 	return num_conn_current;
 }
 
+/**
+ * @brief Creates the connections that mysql-connection_prewarm_ms expects to be needed soon.
+ * @details For each hostgroup, the rate of connections needed by the sessions (see
+ *  MyHGC::record_connection_demand() ) is updated using the time elapsed since the previous round. The rate
+ *  rises immediately and decays slowly, and it is used to estimate how many connections will be needed in
+ *  the next 'mysql-connection_prewarm_ms' milliseconds. For every connection missing in ConnectionsFree, a new
+ *  connection is created with MyHGC::new_prewarmed_MyConn() and moved to ConnectionsUsed : the caller is
+ *  responsible to connect it and return it to the connection pool.
+ *  No connection is created beyond 'max_connections' or 'free_connections_pct' of the selected server, and
+ *  new connections are accounted in the same 'throttle_connections_per_sec' budget used by the sessions.
+ *  As in get_MyConn_from_pool() , only rdlock() and the lock of one hostgroup at a time are acquired.
+ *
+ * @param conn_list Array where the new connections are stored.
+ * @param num_conn The size of conn_list.
+ * @param curtime The current monotonic time, in microseconds.
+ * @return The number of connections stored in conn_list.
+ */
+int MySQL_HostGroups_Manager::get_connections_to_prewarm(MySQL_Connection **conn_list, int num_conn, unsigned long long curtime) {
+	int num_conn_current=0;
+	rdlock();
+	for (unsigned int i=0; i<MyHostGroups->len; i++) {
+		MyHGC *myhgc=(MyHGC *)MyHostGroups->index(i);
+		myhgc->lock();
+		if (curtime <= myhgc->prewarm.last_round) {
+			myhgc->unlock();
+			continue;
+		}
+		double rate = myhgc->prewarm.connections_created * 1000000.0 / (curtime - myhgc->prewarm.last_round);
+		if (rate > myhgc->prewarm.created_per_sec) {
+			myhgc->prewarm.created_per_sec = rate;
+		} else {
+			myhgc->prewarm.created_per_sec = myhgc->prewarm.created_per_sec * 0.75 + rate * 0.25;
+		}
+		myhgc->prewarm.connections_created = 0;
+		myhgc->prewarm.last_round = curtime;
+		uint32_t profiles_count = 0;
+		for (int k=0; k<MYHGC_PREWARM_PROFILES; k++) {
+			profiles_count += myhgc->prewarm.profiles[k].count;
+		}
+		if (profiles_count > 1024) {
+			// older demand is progressively forgotten
+			for (int k=0; k<MYHGC_PREWARM_PROFILES; k++) {
+				myhgc->prewarm.profiles[k].count /= 2;
+			}
+		}
+		if (myhgc->prewarm.created_per_sec < 0.1) {
+			// no demand: the profiles are no longer needed
+			for (int k=0; k<MYHGC_PREWARM_PROFILES; k++) {
+				myhgc->clear_prewarm_profile(k);
+			}
+			myhgc->unlock();
+			continue;
+		}
+		if (num_conn_current >= num_conn) {
+			myhgc->unlock();
+			continue;
+		}
+		unsigned int expected_free = (unsigned int)ceil(myhgc->prewarm.created_per_sec * mysql_thread___connection_prewarm_ms / 1000);
+		// connections pre-warmed in the previous rounds are counted as free even if still connecting
+		unsigned int conns_free = __sync_fetch_and_add(&myhgc->prewarm.connecting, 0);
+		for (unsigned int j=0; j<myhgc->mysrvs->cnt(); j++) {
+			MySrvC *mysrvc=myhgc->mysrvs->idx(j);
+			conns_free += mysrvc->ConnectionsFree->conns_length();
+		}
+		int free_connections_pct = mysql_thread___free_connections_pct;
+		unsigned int throttle_connections_per_sec = (unsigned int) mysql_thread___throttle_connections_per_sec_to_hostgroup;
+		if (myhgc->attributes.configured == true) {
+			// mysql_hostgroup_attributes takes priority
+			free_connections_pct = myhgc->attributes.free_connections_pct;
+			throttle_connections_per_sec = myhgc->attributes.throttle_connections_per_sec;
+		}
+		unsigned long long cursec = curtime / 1000 / 1000; // same unit used by MySrvConnList::get_random_MyConn()
+		if (cursec > myhgc->current_time_now) {
+			myhgc->current_time_now = cursec;
+			myhgc->new_connections_now = 0;
+		}
+		while (conns_free < expected_free && num_conn_current < num_conn && myhgc->new_connections_now < throttle_connections_per_sec) {
+			MySrvC *mysrvc = myhgc->get_random_MySrvC(NULL, 0, -1, NULL);
+			if (mysrvc == NULL) {
+				break;
+			}
+			unsigned int srv_free = mysrvc->ConnectionsFree->conns_length();
+			unsigned int srv_used = mysrvc->ConnectionsUsed->conns_length();
+			if (srv_free + srv_used >= (unsigned int)mysrvc->max_connections || srv_free >= free_connections_pct*mysrvc->max_connections/100) {
+				break;
+			}
+			MySQL_Connection *conn = myhgc->new_prewarmed_MyConn(mysrvc);
+			if (conn == NULL) {
+				break;
+			}
+			mysrvc->ConnectionsUsed->add(conn);
+			__sync_fetch_and_add(&myhgc->prewarm.connecting, 1);
+			myhgc->new_connections_now++;
+			__sync_fetch_and_add(&status.server_connections_created, 1);
+			__sync_fetch_and_add(&status.server_connections_prewarmed, 1);
+			conn_list[num_conn_current] = conn;
+			num_conn_current++;
+			conns_free++;
+		}
+		myhgc->unlock();
+	}
+	rdunlock();
+	proxy_debug(PROXY_DEBUG_MYSQL_CONNPOOL, 7, "Returning %d connections to pre-warm\n", num_conn_current);
+	return num_conn_current;
+}
+
 void MySQL_HostGroups_Manager::save_incoming_mysql_table(SQLite3_result *s, const string& name) {
 	SQLite3_result ** inc = NULL;
 	if (name == "mysql_aws_aurora_hostgroups") {
@@ -4148,6 +4313,7 @@ void MySQL_HostGroups_Manager::p_update_metrics() {
 	p_update_counter(status.p_counter_array[p_hg_counter::server_connections_aborted], status.server_connections_aborted);
 	p_update_counter(status.p_counter_array[p_hg_counter::server_connections_created], status.server_connections_created);
 	p_update_counter(status.p_counter_array[p_hg_counter::server_connections_delayed], status.server_connections_delayed);
+	p_update_counter(status.p_counter_array[p_hg_counter::server_connections_prewarmed], status.server_connections_prewarmed);
 
 	// Update *client_connections* related metrics
 	p_update_counter(status.p_counter_array[p_hg_counter::client_connections_created], status.client_connections_created);
@@ -5872,7 +6038,7 @@ SQLite3_result * MySQL_HostGroups_Manager::get_stats_mysql_gtid_executed() {
 	result->add_column_definition(SQLITE_TEXT,"gtid_executed");
 	result->add_column_definition(SQLITE_TEXT,"events");
 	int k;
-	pthread_rwlock_wrlock(&gtid_rwlock);
+	pthread_rwlock_rdlock(&gtid_rwlock);
 	std::unordered_map<string, GTID_Server_Data *>::iterator it = gtid_map.begin();
 	while(it != gtid_map.end()) {
 		GTID_Server_Data * gtid_si = it->second;
@@ -5883,7 +6049,7 @@ SQLite3_result * MySQL_HostGroups_Manager::get_stats_mysql_gtid_executed() {
 			sprintf(buf,"%d", (int)gtid_si->mysql_port);
 			pta[1]=strdup(buf);
 			//sprintf(buf,"%d", mysrvc->port);
-			string s1 = gtid_executed_to_string(gtid_si->gtid_executed);
+			string s1 = gtid_si->get_gtid_executed()->to_string();
 			pta[2]=strdup(s1.c_str());
 			sprintf(buf,"%llu", gtid_si->events_read);
 			pta[3]=strdup(buf);
@@ -6238,6 +6404,7 @@ bool AWS_Aurora_Info::update(int r, int _port, char *_end_addr, int maxl, int al
  * @details Input verification is performed in the supplied 'hostgroup_settings'. It's expected to be a valid
  *  JSON that may contain the following fields:
  *   - handle_warnings: Value must be >= 0.
+ *   - load_balancing_algorithm: Value must be between 0 and 3, see 'MyHGC_LB_algorithm'.
  *
  *  In case input verification fails for a field, supplied 'MyHGC' is NOT updated for that field. An error
  *  message is logged specifying the source of the error.
@@ -6260,6 +6427,13 @@ void init_myhgc_hostgroup_settings(const char* hostgroup_settings, MyHGC* myhgc)
 				{ return (monitor_slave_lag_when_null >= 0 && monitor_slave_lag_when_null <= 604800); };
 			const int32_t monitor_slave_lag_when_null = j_get_srv_default_int_val<int32_t>(j, hid, "monitor_slave_lag_when_null", monitor_slave_lag_when_null_check);
 			myhgc->attributes.monitor_slave_lag_when_null = monitor_slave_lag_when_null;
+
+			const auto load_balancing_algorithm_check = [](int32_t load_balancing_algorithm) -> bool
+				{ return (load_balancing_algorithm >= LB_WEIGHTED_RANDOM && load_balancing_algorithm < LB_ALGORITHM__END); };
+			const int32_t load_balancing_algorithm = j_get_srv_default_int_val<int32_t>(j, hid, "load_balancing_algorithm", load_balancing_algorithm_check);
+			if (load_balancing_algorithm != -1) {
+				myhgc->attributes.load_balancing_algorithm = load_balancing_algorithm;
+			}
 		}
 		catch (const json::exception& e) {
 			proxy_error(
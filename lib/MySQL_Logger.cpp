@@ -111,10 +111,15 @@ uint64_t MySQL_Event::write(std::fstream *f, MySQL_Session *sess) {
 		case PROXYSQL_COM_QUERY:
 		case PROXYSQL_COM_STMT_EXECUTE:
 		case PROXYSQL_COM_STMT_PREPARE:
-			if (mysql_thread___eventslog_format==1) { // format 1 , binary
-				total_bytes=write_query_format_1(f);
-			} else { // format 2 , json
-				total_bytes=write_query_format_2_json(f);
+			{
+				// the event is encoded in memory and written with a single call
+				std::string buf {};
+				total_bytes=write_query(buf);
+				f->write(buf.data(),buf.size());
+				if (mysql_thread___eventslog_format!=1) {
+					// JSON events are flushed one by one, as with std::endl
+					f->flush();
+				}
 			}
 			break;
 		case PROXYSQL_MYSQL_AUTH_OK:
@@ -138,6 +143,18 @@ uint64_t MySQL_Event::write(std::fstream *f, MySQL_Session *sess) {
 	return total_bytes;
 }
 
+/**
+ * @brief Appends the query event to 'buf', in the format set by 'mysql-eventslog_format'.
+ * @return The length of the event for format 1, 0 for format 2.
+ */
+uint64_t MySQL_Event::write_query(std::string& buf) {
+	if (mysql_thread___eventslog_format==1) { // format 1 , binary
+		return write_query_format_1(buf);
+	} else { // format 2 , json
+		return write_query_format_2_json(buf);
+	}
+}
+
 void MySQL_Event::write_auth(std::fstream *f, MySQL_Session *sess) {
 	json j = {};
 	j["timestamp"] = start_time/1000;
@@ -259,7 +276,7 @@ void MySQL_Event::write_auth(std::fstream *f, MySQL_Session *sess) {
 	*f << j.dump(-1, ' ', false, json::error_handler_t::replace) << std::endl;
 }
 
-uint64_t MySQL_Event::write_query_format_1(std::fstream *f) {
+uint64_t MySQL_Event::write_query_format_1(std::string& f) {
 	uint64_t total_bytes=0;
 	total_bytes+=1; // et
 	total_bytes+=mysql_encode_length(thread_id, NULL);
@@ -286,89 +303,124 @@ uint64_t MySQL_Event::write_query_format_1(std::fstream *f) {
 
 	total_bytes+=mysql_encode_length(query_len,NULL)+query_len;
 
-	// for performance reason, we are moving the write lock
-	// right before the write to disk
-	//GloMyLogger->wrlock();
-        //move wrlock() function to log_request() function, avoid to get a null pointer in a multithreaded environment
-
 	// write total length , fixed size
-	f->write((const char *)&total_bytes,sizeof(uint64_t));
+	f.append((const char *)&total_bytes,sizeof(uint64_t));
 	//char prefix;
 	uint8_t len;
 
-	f->write((char *)&et,1);
+	f.append((char *)&et,1);
 
 	len=mysql_encode_length(thread_id,buf);
 	write_encoded_length(buf,thread_id,len,buf[0]);
-	f->write((char *)buf,len);
+	f.append((char *)buf,len);
 
 	len=mysql_encode_length(username_len,buf);
 	write_encoded_length(buf,username_len,len,buf[0]);
-	f->write((char *)buf,len);
-	f->write(username,username_len);
+	f.append((char *)buf,len);
+	f.append(username,username_len);
 
 	len=mysql_encode_length(schemaname_len,buf);
 	write_encoded_length(buf,schemaname_len,len,buf[0]);
-	f->write((char *)buf,len);
-	f->write(schemaname,schemaname_len);
+	f.append((char *)buf,len);
+	f.append(schemaname,schemaname_len);
 
 	len=mysql_encode_length(client_len,buf);
 	write_encoded_length(buf,client_len,len,buf[0]);
-	f->write((char *)buf,len);
-	f->write(client,client_len);
+	f.append((char *)buf,len);
+	f.append(client,client_len);
 
 	len=mysql_encode_length(hid,buf);
 	write_encoded_length(buf,hid,len,buf[0]);
-	f->write((char *)buf,len);
+	f.append((char *)buf,len);
 
 	if (hid!=UINT64_MAX) {
 		len=mysql_encode_length(server_len,buf);
 		write_encoded_length(buf,server_len,len,buf[0]);
-		f->write((char *)buf,len);
-		f->write(server,server_len);
+		f.append((char *)buf,len);
+		f.append(server,server_len);
 	}
 
 	len=mysql_encode_length(start_time,buf);
 	write_encoded_length(buf,start_time,len,buf[0]);
-	f->write((char *)buf,len);
+	f.append((char *)buf,len);
 
 	len=mysql_encode_length(end_time,buf);
 	write_encoded_length(buf,end_time,len,buf[0]);
-	f->write((char *)buf,len);
+	f.append((char *)buf,len);
 
 	if (et == PROXYSQL_COM_STMT_PREPARE || et == PROXYSQL_COM_STMT_EXECUTE) {
 		len=mysql_encode_length(client_stmt_id,buf);
 		write_encoded_length(buf,client_stmt_id,len,buf[0]);
-		f->write((char *)buf,len);
+		f.append((char *)buf,len);
 	}
 
 	len=mysql_encode_length(affected_rows,buf);
 	write_encoded_length(buf,affected_rows,len,buf[0]);
-	f->write((char *)buf,len);
+	f.append((char *)buf,len);
 
 	len=mysql_encode_length(last_insert_id,buf);
 	write_encoded_length(buf,last_insert_id,len,buf[0]);
-	f->write((char *)buf,len);
+	f.append((char *)buf,len);
 
 	len=mysql_encode_length(rows_sent,buf);
 	write_encoded_length(buf,rows_sent,len,buf[0]);
-	f->write((char *)buf,len);
+	f.append((char *)buf,len);
 
 	len=mysql_encode_length(query_digest,buf);
 	write_encoded_length(buf,query_digest,len,buf[0]);
-	f->write((char *)buf,len);
+	f.append((char *)buf,len);
 
 	len=mysql_encode_length(query_len,buf);
 	write_encoded_length(buf,query_len,len,buf[0]);
-	f->write((char *)buf,len);
+	f.append((char *)buf,len);
 	if (query_len) {
-		f->write(query_ptr,query_len);
+		f.append(query_ptr,query_len);
 	}
 
 	return total_bytes;
 }
 
-uint64_t MySQL_Event::write_query_format_2_json(std::fstream *f) {
+/**
+ * @brief Adds the query event to a block of 'mysql-eventslog_format=3'.
+ */
+void MySQL_Event::write_query_format_3(MySQL_Logger_Block_Encoder& block) {
+	mysql_logger_block_event_t ev;
+	ev.et=et;
+	ev.flags=0;
+	if (have_affected_rows) {
+		ev.flags|=MYSQL_LOGGER_BLOCK_FLAG_AFFECTED_ROWS;
+	}
+	if (have_rows_sent) {
+		ev.flags|=MYSQL_LOGGER_BLOCK_FLAG_ROWS_SENT;
+	}
+	ev.thread_id=thread_id;
+	ev.username=username;
+	ev.username_len=strlen(username);
+	ev.schemaname=schemaname;
+	ev.schemaname_len=strlen(schemaname);
+	ev.client=client;
+	ev.client_len=client_len;
+	ev.hid=hid;
+	if (hid!=UINT64_MAX) {
+		ev.server=server;
+		ev.server_len=server_len;
+	} else {
+		ev.server=NULL;
+		ev.server_len=0;
+	}
+	ev.start_time=start_time;
+	ev.end_time=end_time;
+	ev.client_stmt_id=client_stmt_id;
+	ev.affected_rows=affected_rows;
+	ev.last_insert_id=last_insert_id;
+	ev.rows_sent=rows_sent;
+	ev.query_digest=query_digest;
+	ev.query=query_ptr;
+	ev.query_len=query_len;
+	block.add(ev);
+}
+
+uint64_t MySQL_Event::write_query_format_2_json(std::string& f) {
 	json j = {};
 	uint64_t total_bytes=0;
 	if (hid!=UINT64_MAX) {
@@ -456,17 +508,34 @@ uint64_t MySQL_Event::write_query_format_2_json(std::fstream *f) {
 		j["client_stmt_id"] = client_stmt_id;
 	}
 
-	// for performance reason, we are moving the write lock
-	// right before the write to disk
-	//GloMyLogger->wrlock();
-        //move wrlock() function to log_request() function, avoid to get a null pointer in a multithreaded environment
-
-	*f << j.dump(-1, ' ', false, json::error_handler_t::replace) << std::endl;
+	f.append(j.dump(-1, ' ', false, json::error_handler_t::replace));
+	f.push_back('\n');
 	return total_bytes; // always 0
 }
 
 extern Query_Processor *GloQPro;
 
+// buffer of the current thread , registered in MySQL_Logger::events_buffers
+static __thread MySQL_Logger_Buffer *events_thread_buffer = NULL;
+
+// per digest counters of the current thread , used when 'mysql-eventslog_sample_rate' > 1
+static __thread std::unordered_map<uint64_t, uint64_t> *events_sample_counters = NULL;
+static __thread unsigned long long events_sample_window_start = 0;
+
+MySQL_Logger_Buffer::MySQL_Logger_Buffer() {
+	pthread_mutex_init(&mutex,NULL);
+	dropped=0;
+}
+
+MySQL_Logger_Buffer::~MySQL_Logger_Buffer() {
+	pthread_mutex_destroy(&mutex);
+}
+
+static void * events_writer_pthread(void *arg) {
+	set_thread_name("MyLogWriter");
+	return ((MySQL_Logger *)arg)->events_writer_loop();
+}
+
 MySQL_Logger::MySQL_Logger() {
 	events.enabled=false;
 	events.base_filename=NULL;
@@ -484,12 +553,36 @@ MySQL_Logger::MySQL_Logger() {
 	events.logfile=NULL;
 	events.log_file_id=0;
 	events.max_log_file_size=100*1024*1024;
+	events.flush_timeout=0;
+	events.block_file=false;
+	pthread_mutex_init(&events_buffers_mutex,NULL);
+	events_writer_started=false;
+	events_writer_shutdown=false;
+	pthread_mutex_init(&events_writer_mutex,NULL);
+	pthread_cond_init(&events_writer_cond,NULL);
 	audit.logfile=NULL;
 	audit.log_file_id=0;
 	audit.max_log_file_size=100*1024*1024;
 };
 
 MySQL_Logger::~MySQL_Logger() {
+	if (events_writer_started) {
+		pthread_mutex_lock(&events_writer_mutex);
+		events_writer_shutdown=true;
+		pthread_cond_signal(&events_writer_cond);
+		pthread_mutex_unlock(&events_writer_mutex);
+		pthread_join(events_writer_thread,NULL);
+	}
+	// write the events still buffered
+	wrlock();
+	events_drain_buffers_unlocked();
+	// closing the log also writes the index of a file in the block format
+	events_close_log_unlocked();
+	wrunlock();
+	for (MySQL_Logger_Buffer *lb : events_buffers) {
+		delete lb;
+	}
+	events_buffers.clear();
 	if (events.datadir) {
 		free(events.datadir);
 	}
@@ -519,6 +612,7 @@ void MySQL_Logger::wrunlock() {
 void MySQL_Logger::flush_log() {
 	if (audit.enabled==false && events.enabled==false) return;
 	wrlock();
+	events_drain_buffers_unlocked();
 	events_flush_log_unlocked();
 	audit_flush_log_unlocked();
 	wrunlock();
@@ -527,11 +621,26 @@ void MySQL_Logger::flush_log() {
 
 void MySQL_Logger::events_close_log_unlocked() {
 	if (events.logfile) {
+		if (events.block_file) {
+			// the index of the blocks, and the trailer pointing to it
+			uint64_t index_offset=events.logfile->tellp();
+			uint32_t magic=MYSQL_LOGGER_BLOCK_INDEX_MAGIC;
+			uint32_t entries=events_block_index.size();
+			events.logfile->write((char *)&magic,sizeof(uint32_t));
+			events.logfile->write((char *)&entries,sizeof(uint32_t));
+			if (entries) {
+				events.logfile->write((char *)events_block_index.data(),entries*sizeof(mysql_logger_block_index_entry_t));
+			}
+			events.logfile->write((char *)&index_offset,sizeof(uint64_t));
+			events.logfile->write(MYSQL_LOGGER_BLOCK_TRAILER_MAGIC,8);
+		}
 		events.logfile->flush();
 		events.logfile->close();
 		delete events.logfile;
 		events.logfile=NULL;
 	}
+	events.block_file=false;
+	events_block_index.clear();
 }
 
 void MySQL_Logger::audit_close_log_unlocked() {
@@ -617,10 +726,13 @@ void MySQL_Logger::events_set_base_filename() {
 	// if filename is the same, return
 	wrlock();
 	events.max_log_file_size=mysql_thread___eventslog_filesize;
+	events.flush_timeout=mysql_thread___eventslog_flush_timeout;
 	if (strcmp(events.base_filename,mysql_thread___eventslog_filename)==0) {
 		wrunlock();
 		return;
 	}
+	// the buffered events belong to the current log
+	events_drain_buffers_unlocked();
 	// close current log
 	events_close_log_unlocked();
 	// set file id to 0 , so that find_next_id() will be called
@@ -684,6 +796,21 @@ void MySQL_Logger::log_request(MySQL_Session *sess, MySQL_Data_Stream *myds) {
 
 	uint64_t curtime_real=realtime_time();
 	uint64_t curtime_mono=sess->thread->curtime;
+
+	uint64_t query_digest = 0;
+
+	if (sess->status != PROCESSING_STMT_EXECUTE) {
+		query_digest = GloQPro->get_digest(&sess->CurrentQuery.QueryParserArgs);
+	} else {
+		query_digest = sess->CurrentQuery.stmt_info->digest;
+	}
+
+	if (mysql_thread___eventslog_sample_rate > 1) {
+		if (events_sample_query(query_digest, sess->CurrentQuery.end_time - sess->CurrentQuery.start_time, curtime_mono) == false) {
+			return;
+		}
+	}
+
 	int cl=0;
 	char *ca=(char *)""; // default
 	if (sess->client_myds->addr.addr) {
@@ -721,14 +848,6 @@ void MySQL_Logger::log_request(MySQL_Session *sess, MySQL_Data_Stream *myds) {
 			break;
 	}
 
-	uint64_t query_digest = 0;
-
-	if (sess->status != PROCESSING_STMT_EXECUTE) {
-		query_digest = GloQPro->get_digest(&sess->CurrentQuery.QueryParserArgs);
-	} else {
-		query_digest = sess->CurrentQuery.stmt_info->digest;
-	}
-
 	MySQL_Event me(let,
 		sess->thread_session_id,ui->username,ui->schemaname,
 		sess->CurrentQuery.start_time + curtime_real - curtime_mono,
@@ -787,6 +906,28 @@ void MySQL_Logger::log_request(MySQL_Session *sess, MySQL_Data_Stream *myds) {
 		me.set_server(hid,sa,sl);
 	}
 
+	if (mysql_thread___eventslog_flush_timeout > 0) {
+		// the event is only encoded in the buffer of this thread, the writer thread writes it to disk
+		if (events_writer_started == false) {
+			events_start_writer();
+		}
+		MySQL_Logger_Buffer *lb = events_get_thread_buffer();
+		pthread_mutex_lock(&lb->mutex);
+		if (lb->data.size() + lb->blocks.size() < MYSQL_LOGGER_BUFFER_MAX_SIZE) {
+			if (mysql_thread___eventslog_format==3) {
+				me.write_query_format_3(lb->block);
+				if (lb->block.full()) {
+					// compressed by this thread: the writer thread only writes it
+					lb->block.encode(lb->blocks);
+				}
+			} else {
+				me.write_query(lb->data);
+			}
+		} else {
+			lb->dropped++;
+		}
+		pthread_mutex_unlock(&lb->mutex);
+	} else {
 	// for performance reason, we are moving the write lock
 	// right before the write to disk
 	//wrlock();
@@ -794,14 +935,33 @@ void MySQL_Logger::log_request(MySQL_Session *sess, MySQL_Data_Stream *myds) {
 	//add a mutex lock in a multithreaded environment, avoid to get a null pointer of events.logfile that leads to the program coredump
         GloMyLogger->wrlock();
 
-	me.write(events.logfile, sess);
-
-
-	unsigned long curpos=events.logfile->tellp();
-	if (curpos > events.max_log_file_size) {
-		events_flush_log_unlocked();
+	if (events.logfile) {
+		if (mysql_thread___eventslog_format==3) {
+			if (events_block.size() == 0) {
+				events_block.first_event_time=curtime_mono;
+			}
+			me.write_query_format_3(events_block);
+			if (events_block.full()) {
+				events_write_block_unlocked();
+			}
+		} else {
+			if (events.block_file) {
+				// the format was just changed, the events can't be mixed with the blocks
+				events_flush_log_unlocked();
+			}
+			if (events.logfile) {
+				me.write(events.logfile, sess);
+			}
+		}
+	}
+	if (events.logfile) {
+		unsigned long curpos=events.logfile->tellp();
+		if (curpos > events.max_log_file_size) {
+			events_flush_log_unlocked();
+		}
 	}
 	wrunlock();
+	}
 
 	if (cl && sess->client_myds->addr.port) {
 		free(ca);
@@ -960,7 +1120,15 @@ void MySQL_Logger::log_audit_entry(log_event_type _et, MySQL_Session *sess, MySQ
 }
 
 void MySQL_Logger::flush() {
+	// called by every MySQL_Thread at each loop. When the events are buffered the writer thread
+	// writes and flushes the logs, so the threads don't wait for the disk
+	if (events_writer_started && events.flush_timeout > 0) {
+		return;
+	}
 	wrlock();
+	if (events_block.size() && monotonic_time() > events_block.first_event_time + MYSQL_LOGGER_BLOCK_MAX_AGE_US) {
+		events_write_block_unlocked();
+	}
 	if (events.logfile) {
 		events.logfile->flush();
 	}
@@ -970,6 +1138,230 @@ void MySQL_Logger::flush() {
 	wrunlock();
 }
 
+/**
+ * @brief Decides if a query event has to be logged when 'mysql-eventslog_sample_rate' > 1.
+ * @details Queries slower than 'mysql-eventslog_sample_slow_ms' are always logged. The other queries are
+ *  logged 1 every 'mysql-eventslog_sample_rate' per digest, starting from the first one: the counters are
+ *  reset every MYSQL_LOGGER_SAMPLE_WINDOW_US, so every digest is logged at least once per window, no
+ *  matter how rare it is. The counters are private to every thread, no lock is required.
+ *
+ * @param digest The digest of the query, as computed by 'Query_Processor::get_digest()'.
+ * @param duration The duration of the query, in microseconds.
+ * @param curtime The current monotonic time, in microseconds.
+ * @return true if the event has to be logged.
+ */
+bool MySQL_Logger::events_sample_query(uint64_t digest, unsigned long long duration, unsigned long long curtime) {
+	if (mysql_thread___eventslog_sample_slow_ms > 0 && duration >= (unsigned long long)mysql_thread___eventslog_sample_slow_ms * 1000) {
+		return true;
+	}
+	if (events_sample_counters == NULL) {
+		events_sample_counters = new std::unordered_map<uint64_t, uint64_t>();
+		events_sample_window_start = curtime;
+	}
+	if (curtime > events_sample_window_start + MYSQL_LOGGER_SAMPLE_WINDOW_US || events_sample_counters->size() >= MYSQL_LOGGER_SAMPLE_MAX_DIGESTS) {
+		events_sample_counters->clear();
+		events_sample_window_start = curtime;
+	}
+	uint64_t& count = (*events_sample_counters)[digest];
+	bool ret = (count % mysql_thread___eventslog_sample_rate) == 0;
+	count++;
+	return ret;
+}
+
+/**
+ * @brief Returns the events buffer of the calling thread, creating and registering it on first use.
+ */
+MySQL_Logger_Buffer * MySQL_Logger::events_get_thread_buffer() {
+	if (events_thread_buffer == NULL) {
+		events_thread_buffer = new MySQL_Logger_Buffer();
+		pthread_mutex_lock(&events_buffers_mutex);
+		events_buffers.push_back(events_thread_buffer);
+		pthread_mutex_unlock(&events_buffers_mutex);
+	}
+	return events_thread_buffer;
+}
+
+/**
+ * @brief Moves the events buffered by all the threads into 'blocks' and 'data'.
+ * @details Every buffer and incomplete block is swapped with an empty one while holding its mutex, so the
+ *  threads logging the events are blocked only for the swap: the incomplete block is compressed after the
+ *  mutex is released. No lock of the log files is required.
+ * @return The number of events dropped because the buffers were full.
+ */
+unsigned long long MySQL_Logger::events_collect_buffers(std::string& blocks, std::string& data) {
+	unsigned long long dropped=0;
+	pthread_mutex_lock(&events_buffers_mutex);
+	for (MySQL_Logger_Buffer *lb : events_buffers) {
+		pthread_mutex_lock(&lb->mutex);
+		lb->blocks.swap(events_collect_buf);
+		std::swap(lb->block, events_collect_block);
+		pthread_mutex_unlock(&lb->mutex);
+		blocks.append(events_collect_buf);
+		// the incomplete block is completed, so no event is older than 'mysql-eventslog_flush_timeout'
+		events_collect_block.encode(blocks);
+		// the capacity is kept, and returned to a thread on the next swap
+		events_collect_buf.clear();
+		pthread_mutex_lock(&lb->mutex);
+		lb->data.swap(events_collect_buf);
+		dropped+=lb->dropped;
+		lb->dropped=0;
+		pthread_mutex_unlock(&lb->mutex);
+		data.append(events_collect_buf);
+		events_collect_buf.clear();
+	}
+	pthread_mutex_unlock(&events_buffers_mutex);
+	return dropped;
+}
+
+/**
+ * @brief Writes to the events log the events returned by events_collect_buffers(), and rotates the log
+ *  if needed. 'blocks' and 'data' are cleared, keeping their capacity.
+ *  Requires the caller to hold 'wrlock()'.
+ */
+void MySQL_Logger::events_write_collected_unlocked(std::string& blocks, std::string& data, unsigned long long dropped) {
+	bool written=false;
+	if (events_block.size()) {
+		events_write_block_unlocked();
+	}
+	if (blocks.size()) {
+		events_write_blocks_unlocked(blocks);
+		written=true;
+		blocks.clear();
+	}
+	if (data.size()) {
+		if (events.logfile && events.block_file) {
+			// the format was just changed, the events can't be mixed with the blocks
+			events_flush_log_unlocked();
+		}
+		if (events.logfile) {
+			events.logfile->write(data.data(), data.size());
+			written=true;
+		}
+		data.clear();
+	}
+	if (dropped) {
+		proxy_warning("Dropped %llu events: the events log buffers are full. Consider decreasing mysql-eventslog_flush_timeout\n", dropped);
+	}
+	if (written && events.logfile) {
+		events.logfile->flush();
+		unsigned long curpos=events.logfile->tellp();
+		if (curpos > events.max_log_file_size) {
+			events_flush_log_unlocked();
+		}
+	}
+}
+
+/**
+ * @brief Writes to the events log the events buffered by all the threads.
+ *  Requires the caller to hold 'wrlock()'.
+ */
+void MySQL_Logger::events_drain_buffers_unlocked() {
+	std::string blocks;
+	std::string data;
+	unsigned long long dropped=events_collect_buffers(blocks, data);
+	events_write_collected_unlocked(blocks, data, dropped);
+}
+
+/**
+ * @brief Writes the block of events logged without buffering.
+ */
+void MySQL_Logger::events_write_block_unlocked() {
+	events_block.encode(events_drain_buf);
+	events_write_blocks_unlocked(events_drain_buf);
+	events_drain_buf.clear();
+}
+
+/**
+ * @brief Writes encoded blocks to the events log, adding them to the index of the file.
+ * @details The file header is written before the first block. If the file already contains events in
+ *  another format, a new file is started.
+ */
+void MySQL_Logger::events_write_blocks_unlocked(const std::string& blocks) {
+	if (events.logfile == NULL || blocks.size() == 0) {
+		return;
+	}
+	if (events.block_file == false) {
+		if (events.logfile->tellp() > 0) {
+			events_flush_log_unlocked();
+			if (events.logfile == NULL) {
+				return;
+			}
+		}
+		char hdr[MYSQL_LOGGER_BLOCK_FILE_HEADER_SIZE];
+		size_t l=mysql_logger_block_file_header(hdr);
+		events.logfile->write(hdr,l);
+		events.block_file=true;
+	}
+	uint64_t base=events.logfile->tellp();
+	size_t pos=0;
+	while (pos + sizeof(mysql_logger_block_header_t) <= blocks.size()) {
+		mysql_logger_block_header_t bh;
+		memcpy(&bh, blocks.data()+pos, sizeof(bh));
+		mysql_logger_block_index_entry_t ie;
+		ie.offset=base+pos;
+		ie.events=bh.events;
+		ie.reserved=0;
+		ie.min_start_time=bh.min_start_time;
+		ie.max_start_time=bh.max_start_time;
+		events_block_index.push_back(ie);
+		pos+=sizeof(bh)+bh.compressed_len;
+	}
+	events.logfile->write(blocks.data(),blocks.size());
+}
+
+void MySQL_Logger::events_start_writer() {
+	pthread_mutex_lock(&events_writer_mutex);
+	if (events_writer_started == false) {
+		if (pthread_create(&events_writer_thread, NULL, events_writer_pthread, this) != 0) {
+			// LCOV_EXCL_START
+			proxy_error("Thread creation\n");
+			assert(0);
+			// LCOV_EXCL_STOP
+		}
+		events_writer_started=true;
+	}
+	pthread_mutex_unlock(&events_writer_mutex);
+}
+
+/**
+ * @brief Main loop of the events writer thread: writes the buffered events every
+ *  'mysql-eventslog_flush_timeout' milliseconds.
+ */
+void * MySQL_Logger::events_writer_loop() {
+	// reused at every loop, only the file writes are performed holding 'wrlock()'
+	std::string blocks;
+	std::string data;
+	pthread_mutex_lock(&events_writer_mutex);
+	while (events_writer_shutdown == false) {
+		int timeout_ms = events.flush_timeout;
+		if (timeout_ms <= 0) {
+			// buffering was disabled: the events still buffered are written at the next check
+			timeout_ms = 1000;
+		}
+		struct timespec ts;
+		clock_gettime(CLOCK_REALTIME, &ts);
+		ts.tv_sec += timeout_ms / 1000;
+		ts.tv_nsec += (long)(timeout_ms % 1000) * 1000000;
+		if (ts.tv_nsec >= 1000000000) {
+			ts.tv_sec++;
+			ts.tv_nsec -= 1000000000;
+		}
+		pthread_cond_timedwait(&events_writer_cond, &events_writer_mutex, &ts);
+		pthread_mutex_unlock(&events_writer_mutex);
+		unsigned long long dropped=events_collect_buffers(blocks, data);
+		wrlock();
+		events_write_collected_unlocked(blocks, data, dropped);
+		// flush() skips the logs while the events are buffered
+		if (audit.logfile) {
+			audit.logfile->flush();
+		}
+		wrunlock();
+		pthread_mutex_lock(&events_writer_mutex);
+	}
+	pthread_mutex_unlock(&events_writer_mutex);
+	return NULL;
+}
+
 unsigned int MySQL_Logger::events_find_next_id() {
 	int maxidx=0;
 	DIR *dir;
@@ -0,0 +1,340 @@
+#include <string.h>
+#include "MySQL_Logger_Block.h"
+#include "lz4.h"
+
+/**
+ * @file MySQL_Logger_Block.cpp
+ *
+ * Encoder and decoder of the blocks of 'mysql-eventslog_format=3'. See MySQL_Logger_Block.h for the
+ * layout. Integers are stored as LEB128 varints: the columns group similar values together, so small
+ * values and repeated bytes are left to LZ4.
+ */
+
+// one byte for the type and the flags , 8 for the digest , and at least one for each of the 13 varints
+#define MYSQL_LOGGER_BLOCK_MIN_EVENT_SIZE	(2 + sizeof(uint64_t) + 13)
+
+static inline void put_varint(std::string& out, uint64_t v) {
+	char buf[10];
+	int i=0;
+	while (v >= 0x80) {
+		buf[i++]=(char)(v | 0x80);
+		v >>= 7;
+	}
+	buf[i++]=(char)v;
+	out.append(buf,i);
+}
+
+static inline uint64_t zigzag(int64_t v) {
+	return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static inline int64_t unzigzag(uint64_t v) {
+	return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+/**
+ * @brief Reads a varint, advancing 'p'.
+ * @return false if the varint exceeds 'end'.
+ */
+static inline bool get_varint(const char *& p, const char *end, uint64_t& v) {
+	v=0;
+	int shift=0;
+	while (p < end && shift < 64) {
+		uint8_t c=(uint8_t)*p++;
+		v |= (uint64_t)(c & 0x7f) << shift;
+		if ((c & 0x80) == 0) {
+			return true;
+		}
+		shift+=7;
+	}
+	return false;
+}
+
+size_t mysql_logger_block_file_header(char *buf) {
+	uint32_t version=MYSQL_LOGGER_BLOCK_VERSION;
+	memcpy(buf, MYSQL_LOGGER_BLOCK_FILE_MAGIC, 8);
+	memcpy(buf+8, &version, sizeof(uint32_t));
+	memset(buf+12, 0, 4);
+	return MYSQL_LOGGER_BLOCK_FILE_HEADER_SIZE;
+}
+
+bool mysql_logger_block_check_file_header(const char *buf) {
+	uint32_t version=0;
+	if (memcmp(buf, MYSQL_LOGGER_BLOCK_FILE_MAGIC, 8)) {
+		return false;
+	}
+	memcpy(&version, buf+8, sizeof(uint32_t));
+	return version == MYSQL_LOGGER_BLOCK_VERSION;
+}
+
+void MySQL_Logger_Block_Dict::add(const char *s, size_t len) {
+	uint32_t id;
+	// consecutive events often come from the same client , check the last value first
+	if (values.size() && ids.size()) {
+		const std::string *last=values[last_id];
+		if (last->size() == len && memcmp(last->data(), s, len) == 0) {
+			put_varint(ids, last_id);
+			return;
+		}
+	}
+	auto it=map.emplace(std::string(s, len), (uint32_t)values.size());
+	if (it.second) {
+		values.push_back(&it.first->first);
+	}
+	id=it.first->second;
+	last_id=id;
+	put_varint(ids, id);
+}
+
+void MySQL_Logger_Block_Dict::encode(std::string& out) {
+	put_varint(out, values.size());
+	for (const std::string *v : values) {
+		put_varint(out, v->size());
+		out.append(*v);
+	}
+	out.append(ids);
+}
+
+void MySQL_Logger_Block_Dict::clear() {
+	map.clear();
+	values.clear();
+	ids.clear();
+	last_id=0;
+}
+
+MySQL_Logger_Block_Encoder::MySQL_Logger_Block_Encoder() {
+	first_event_time=0;
+	clear();
+}
+
+void MySQL_Logger_Block_Encoder::clear() {
+	events=0;
+	min_start_time=UINT64_MAX;
+	max_start_time=0;
+	prev_start_time=0;
+	raw_size=0;
+	col_et.clear();
+	col_thread_id.clear();
+	col_username.clear();
+	col_schemaname.clear();
+	col_client.clear();
+	col_hid.clear();
+	col_server.clear();
+	col_start_time.clear();
+	col_duration.clear();
+	col_client_stmt_id.clear();
+	col_affected_rows.clear();
+	col_last_insert_id.clear();
+	col_rows_sent.clear();
+	col_flags.clear();
+	col_query_digest.clear();
+	col_query_len.clear();
+	col_query.clear();
+}
+
+void MySQL_Logger_Block_Encoder::add(const mysql_logger_block_event_t& ev) {
+	col_et.push_back((char)ev.et);
+	put_varint(col_thread_id, ev.thread_id);
+	col_username.add(ev.username, ev.username_len);
+	col_schemaname.add(ev.schemaname, ev.schemaname_len);
+	col_client.add(ev.client, ev.client_len);
+	if (ev.hid == UINT64_MAX) {
+		put_varint(col_hid, 0);
+		col_server.add("", 0);
+	} else {
+		put_varint(col_hid, ev.hid+1);
+		col_server.add(ev.server, ev.server_len);
+	}
+	put_varint(col_start_time, zigzag((int64_t)(ev.start_time - prev_start_time)));
+	prev_start_time=ev.start_time;
+	put_varint(col_duration, zigzag((int64_t)(ev.end_time - ev.start_time)));
+	put_varint(col_client_stmt_id, ev.client_stmt_id);
+	put_varint(col_affected_rows, ev.affected_rows);
+	put_varint(col_last_insert_id, ev.last_insert_id);
+	put_varint(col_rows_sent, ev.rows_sent);
+	col_flags.push_back((char)ev.flags);
+	col_query_digest.append((const char *)&ev.query_digest, sizeof(uint64_t));
+	put_varint(col_query_len, ev.query_len);
+	col_query.append(ev.query, ev.query_len);
+	if (ev.start_time < min_start_time) {
+		min_start_time=ev.start_time;
+	}
+	if (ev.start_time > max_start_time) {
+		max_start_time=ev.start_time;
+	}
+	// estimate of the encoded size , without the dictionaries
+	raw_size+=32+ev.query_len;
+	events++;
+}
+
+/**
+ * @brief Appends the block, header and compressed payload, to 'out' and clears the encoder.
+ * @return The number of bytes appended, 0 if the block is empty.
+ */
+size_t MySQL_Logger_Block_Encoder::encode(std::string& out) {
+	if (events == 0) {
+		return 0;
+	}
+	raw.clear();
+	raw.append(col_et);
+	raw.append(col_thread_id);
+	col_username.encode(raw);
+	col_schemaname.encode(raw);
+	col_client.encode(raw);
+	raw.append(col_hid);
+	col_server.encode(raw);
+	raw.append(col_start_time);
+	raw.append(col_duration);
+	raw.append(col_client_stmt_id);
+	raw.append(col_affected_rows);
+	raw.append(col_last_insert_id);
+	raw.append(col_rows_sent);
+	raw.append(col_flags);
+	raw.append(col_query_digest);
+	raw.append(col_query_len);
+	raw.append(col_query);
+
+	mysql_logger_block_header_t hdr;
+	hdr.magic=MYSQL_LOGGER_BLOCK_MAGIC;
+	hdr.events=events;
+	hdr.raw_len=raw.size();
+	hdr.min_start_time=min_start_time;
+	hdr.max_start_time=max_start_time;
+
+	size_t hdr_pos=out.size();
+	int bound=LZ4_compressBound(raw.size());
+	out.resize(hdr_pos + sizeof(hdr) + bound);
+	int clen=LZ4_compress_default(raw.data(), &out[hdr_pos + sizeof(hdr)], raw.size(), bound);
+	hdr.compressed_len=clen;
+	memcpy(&out[hdr_pos], &hdr, sizeof(hdr));
+	out.resize(hdr_pos + sizeof(hdr) + clen);
+	clear();
+	return sizeof(hdr) + clen;
+}
+
+/**
+ * @brief Decompresses and decodes a block.
+ * @param hdr The header of the block.
+ * @param payload The 'hdr.compressed_len' bytes following the header.
+ * @return false if the block is corrupted.
+ */
+bool MySQL_Logger_Block_Decoder::decode(const mysql_logger_block_header_t& hdr, const char *payload) {
+	events.clear();
+	if (hdr.magic != MYSQL_LOGGER_BLOCK_MAGIC) {
+		return false;
+	}
+	// LZ4 can't expand a block more than 255 times
+	if (hdr.raw_len > LZ4_MAX_INPUT_SIZE || hdr.compressed_len > LZ4_MAX_INPUT_SIZE
+		|| (uint64_t)hdr.raw_len > (uint64_t)hdr.compressed_len * 255) {
+		return false;
+	}
+	raw.resize(hdr.raw_len);
+	int rc=LZ4_decompress_safe(payload, &raw[0], hdr.compressed_len, hdr.raw_len);
+	if (rc < 0 || (uint32_t)rc != hdr.raw_len) {
+		return false;
+	}
+	const char *p=raw.data();
+	const char *end=p+raw.size();
+	uint32_t n=hdr.events;
+	uint64_t v;
+	// every event takes at least MYSQL_LOGGER_BLOCK_MIN_EVENT_SIZE bytes of the payload
+	if (n > MYSQL_LOGGER_BLOCK_MAX_EVENTS || (size_t)(end-p) / MYSQL_LOGGER_BLOCK_MIN_EVENT_SIZE < n) {
+		return false;
+	}
+	events.resize(n);
+
+	for (uint32_t i=0; i<n; i++) {
+		memset(&events[i], 0, sizeof(mysql_logger_block_event_t));
+		events[i].et=(uint8_t)*p++;
+	}
+	for (uint32_t i=0; i<n; i++) {
+		if (!get_varint(p, end, v)) return false;
+		events[i].thread_id=v;
+	}
+	// username , schemaname , client , then hid and server
+	for (int c=0; c<4; c++) {
+		if (c == 3) {
+			for (uint32_t i=0; i<n; i++) {
+				if (!get_varint(p, end, v)) return false;
+				events[i].hid = (v == 0 ? UINT64_MAX : v-1);
+			}
+		}
+		std::vector<std::string>& dict=dicts[c];
+		dict.clear();
+		if (!get_varint(p, end, v)) return false;
+		uint64_t entries=v;
+		for (uint64_t e=0; e<entries; e++) {
+			if (!get_varint(p, end, v)) return false;
+			if ((uint64_t)(end-p) < v) return false;
+			dict.emplace_back(p, v);
+			p+=v;
+		}
+		for (uint32_t i=0; i<n; i++) {
+			if (!get_varint(p, end, v)) return false;
+			if (v >= dict.size()) return false;
+			const std::string& s=dict[v];
+			switch (c) {
+				case 0:
+					events[i].username=s.c_str();
+					events[i].username_len=s.size();
+					break;
+				case 1:
+					events[i].schemaname=s.c_str();
+					events[i].schemaname_len=s.size();
+					break;
+				case 2:
+					events[i].client=s.c_str();
+					events[i].client_len=s.size();
+					break;
+				default:
+					events[i].server=s.c_str();
+					events[i].server_len=s.size();
+					break;
+			}
+		}
+	}
+	uint64_t prev=0;
+	for (uint32_t i=0; i<n; i++) {
+		if (!get_varint(p, end, v)) return false;
+		prev+=unzigzag(v);
+		events[i].start_time=prev;
+	}
+	for (uint32_t i=0; i<n; i++) {
+		if (!get_varint(p, end, v)) return false;
+		events[i].end_time=events[i].start_time+unzigzag(v);
+	}
+	for (uint32_t i=0; i<n; i++) {
+		if (!get_varint(p, end, v)) return false;
+		events[i].client_stmt_id=v;
+	}
+	for (uint32_t i=0; i<n; i++) {
+		if (!get_varint(p, end, v)) return false;
+		events[i].affected_rows=v;
+	}
+	for (uint32_t i=0; i<n; i++) {
+		if (!get_varint(p, end, v)) return false;
+		events[i].last_insert_id=v;
+	}
+	for (uint32_t i=0; i<n; i++) {
+		if (!get_varint(p, end, v)) return false;
+		events[i].rows_sent=v;
+	}
+	if ((size_t)(end-p) < n + n*sizeof(uint64_t)) return false;
+	for (uint32_t i=0; i<n; i++) {
+		events[i].flags=(uint8_t)*p++;
+	}
+	for (uint32_t i=0; i<n; i++) {
+		memcpy(&events[i].query_digest, p, sizeof(uint64_t));
+		p+=sizeof(uint64_t);
+	}
+	for (uint32_t i=0; i<n; i++) {
+		if (!get_varint(p, end, v)) return false;
+		events[i].query_len=v;
+	}
+	for (uint32_t i=0; i<n; i++) {
+		if ((size_t)(end-p) < events[i].query_len) return false;
+		events[i].query=p;
+		p+=events[i].query_len;
+	}
+	return true;
+}
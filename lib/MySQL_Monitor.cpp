@@ -582,6 +582,10 @@ MySQL_Monitor_State_Data::~MySQL_Monitor_State_Data() {
 	if (mysql_error_msg) {
 		free(mysql_error_msg);
 	}
+
+	if (blocking_in_flight) {
+		blocking_in_flight->store(false);
+	}
 }
 
 void MySQL_Monitor_State_Data::init_async() {
@@ -831,6 +835,20 @@ void * monitor_replication_lag_pthread(void *arg) {
 	return NULL;
 }
 
+void * monitor_scheduler_pthread(void *arg) {
+#ifndef NOJEM
+	bool cache=false;
+	mallctl("thread.tcache.enabled", NULL, NULL, &cache, sizeof(bool));
+#endif
+	set_thread_name("MonitorSched");
+	while (GloMTH==NULL) {
+		usleep(50000);
+	}
+	usleep(100000);
+	GloMyMon->monitor_scheduler();
+	return NULL;
+}
+
 void* monitor_dns_cache_pthread(void* arg) {
 #ifndef NOJEM
 	bool cache = false;
@@ -1316,25 +1334,9 @@ void * monitor_connect_thread(void *arg) {
 	mmsd->t1=start_time;
 	mmsd->t2=monotonic_time();
 
-	sqlite3_stmt *statement=NULL;
-	//sqlite3 *mondb=mmsd->mondb->get_db();
-	int rc;
-	char *query=NULL;
-	query=(char *)"INSERT OR REPLACE INTO mysql_server_connect_log VALUES (?1 , ?2 , ?3 , ?4 , ?5)";
-	//rc=(*proxy_sqlite3_prepare_v2)(mondb, query, -1, &statement, 0);
-	rc = mmsd->mondb->prepare_v2(query, &statement);
-	ASSERT_SQLITE_OK(rc, mmsd->mondb);
-	rc=(*proxy_sqlite3_bind_text)(statement, 1, mmsd->hostname, -1, SQLITE_TRANSIENT); ASSERT_SQLITE_OK(rc, mmsd->mondb);
-	rc=(*proxy_sqlite3_bind_int)(statement, 2, mmsd->port); ASSERT_SQLITE_OK(rc, mmsd->mondb);
 	unsigned long long time_now=realtime_time();
 	time_now=time_now-(mmsd->t2 - start_time);
-	rc=(*proxy_sqlite3_bind_int64)(statement, 3, time_now); ASSERT_SQLITE_OK(rc, mmsd->mondb);
-	rc=(*proxy_sqlite3_bind_int64)(statement, 4, (mmsd->mysql_error_msg ? 0 : mmsd->t2-mmsd->t1)); ASSERT_SQLITE_OK(rc, mmsd->mondb);
-	rc=(*proxy_sqlite3_bind_text)(statement, 5, mmsd->mysql_error_msg, -1, SQLITE_TRANSIENT); ASSERT_SQLITE_OK(rc, mmsd->mondb);
-	SAFE_SQLITE3_STEP2(statement);
-	rc=(*proxy_sqlite3_clear_bindings)(statement); ASSERT_SQLITE_OK(rc, mmsd->mondb);
-	rc=(*proxy_sqlite3_reset)(statement); ASSERT_SQLITE_OK(rc, mmsd->mondb);
-	(*proxy_sqlite3_finalize)(statement);
+	GloMyMon->check_history.add(MON_CHECK_CONNECT, mmsd->hostname, mmsd->port, time_now, (mmsd->mysql_error_msg ? 0 : mmsd->t2-mmsd->t1), false, 0, mmsd->mysql_error_msg);
 	if (mmsd->mysql_error_msg) {
 		if (
 			(strncmp(mmsd->mysql_error_msg,"Access denied for user",strlen("Access denied for user"))==0)
@@ -1427,28 +1429,12 @@ void * monitor_ping_thread(void *arg) {
 __exit_monitor_ping_thread:
 	mmsd->t2=monotonic_time();
 	{
-		sqlite3_stmt *statement=NULL;
-		//sqlite3 *mondb=mmsd->mondb->get_db();
-		int rc;
 #ifdef TEST_AURORA
 //		if ((rand() % 10) ==0) {
 #endif // TEST_AURORA
-		char *query=NULL;
-		query=(char *)"INSERT OR REPLACE INTO mysql_server_ping_log VALUES (?1 , ?2 , ?3 , ?4 , ?5)";
-		//rc=(*proxy_sqlite3_prepare_v2)(mondb, query, -1, &statement, 0);
-		rc = mmsd->mondb->prepare_v2(query, &statement);
-		ASSERT_SQLITE_OK(rc, mmsd->mondb);
-		rc=(*proxy_sqlite3_bind_text)(statement, 1, mmsd->hostname, -1, SQLITE_TRANSIENT); ASSERT_SQLITE_OK(rc, mmsd->mondb);
-		rc=(*proxy_sqlite3_bind_int)(statement, 2, mmsd->port); ASSERT_SQLITE_OK(rc, mmsd->mondb);
 		unsigned long long time_now=realtime_time();
 		time_now=time_now-(mmsd->t2 - start_time);
-		rc=(*proxy_sqlite3_bind_int64)(statement, 3, time_now); ASSERT_SQLITE_OK(rc, mmsd->mondb);
-		rc=(*proxy_sqlite3_bind_int64)(statement, 4, (mmsd->mysql_error_msg ? 0 : mmsd->t2-mmsd->t1)); ASSERT_SQLITE_OK(rc, mmsd->mondb);
-		rc=(*proxy_sqlite3_bind_text)(statement, 5, mmsd->mysql_error_msg, -1, SQLITE_TRANSIENT); ASSERT_SQLITE_OK(rc, mmsd->mondb);
-		SAFE_SQLITE3_STEP2(statement);
-		rc=(*proxy_sqlite3_clear_bindings)(statement); ASSERT_SQLITE_OK(rc, mmsd->mondb);
-		rc=(*proxy_sqlite3_reset)(statement); ASSERT_SQLITE_OK(rc, mmsd->mondb);
-		(*proxy_sqlite3_finalize)(statement);
+		GloMyMon->check_history.add(MON_CHECK_PING, mmsd->hostname, mmsd->port, time_now, (mmsd->mysql_error_msg ? 0 : mmsd->t2-mmsd->t1), false, 0, mmsd->mysql_error_msg);
 		if (mmsd->mysql_error_msg == NULL) {
 			ping_success = true;
 		}
@@ -1724,21 +1710,10 @@ void * monitor_read_only_thread(void *arg) {
 __exit_monitor_read_only_thread:
 	mmsd->t2=monotonic_time();
 	{
-		sqlite3_stmt *statement=NULL;
-		//sqlite3 *mondb=mmsd->mondb->get_db();
-		int rc;
-		char *query=NULL;
-		query=(char *)"INSERT OR REPLACE INTO mysql_server_read_only_log VALUES (?1 , ?2 , ?3 , ?4 , ?5 , ?6)";
-		//rc=(*proxy_sqlite3_prepare_v2)(mondb, query, -1, &statement, 0);
-		rc = mmsd->mondb->prepare_v2(query, &statement);
-		ASSERT_SQLITE_OK(rc, mmsd->mondb);
 		int read_only=1; // as a safety mechanism , read_only=1 is the default
-		rc=(*proxy_sqlite3_bind_text)(statement, 1, mmsd->hostname, -1, SQLITE_TRANSIENT); ASSERT_SQLITE_OK(rc, mmsd->mondb);
-		rc=(*proxy_sqlite3_bind_int)(statement, 2, mmsd->port); ASSERT_SQLITE_OK(rc, mmsd->mondb);
+		bool has_value=false;
 		unsigned long long time_now=realtime_time();
 		time_now=time_now-(mmsd->t2 - start_time);
-		rc=(*proxy_sqlite3_bind_int64)(statement, 3, time_now); ASSERT_SQLITE_OK(rc, mmsd->mondb);
-		rc=(*proxy_sqlite3_bind_int64)(statement, 4, (mmsd->mysql_error_msg ? 0 : mmsd->t2-mmsd->t1)); ASSERT_SQLITE_OK(rc, mmsd->mondb);
 		if (mmsd->interr == 0 && mmsd->result) {
 			int num_fields=0;
 			int k=0;
@@ -1763,30 +1738,19 @@ VALGRIND_DISABLE_ERROR_REPORTING;
 VALGRIND_ENABLE_ERROR_REPORTING;
 					}
 				}
-//					if (repl_lag>=0) {
-				rc=(*proxy_sqlite3_bind_int64)(statement, 5, read_only); ASSERT_SQLITE_OK(rc, mmsd->mondb);
-//					} else {
-//						rc=(*proxy_sqlite3_bind_null)(statement, 5); ASSERT_SQLITE_OK(rc, mmsd->mondb);
-//					}
+				has_value=true;
 			} else {
 				proxy_error("mysql_fetch_fields returns NULL, or mysql_num_fields is incorrect. Server %s:%d . See bug #1994\n", mmsd->hostname, mmsd->port);
-				rc=(*proxy_sqlite3_bind_null)(statement, 5); ASSERT_SQLITE_OK(rc, mmsd->mondb);
 			}
 			mysql_free_result(mmsd->result);
 			mmsd->result=NULL;
-		} else {
-			rc=(*proxy_sqlite3_bind_null)(statement, 5); ASSERT_SQLITE_OK(rc, mmsd->mondb);
 		}
 		if (mmsd->result) {
 			// make sure it is clear
 			mysql_free_result(mmsd->result);
 			mmsd->result=NULL;
 		}
-		rc=(*proxy_sqlite3_bind_text)(statement, 6, mmsd->mysql_error_msg, -1, SQLITE_TRANSIENT); ASSERT_SQLITE_OK(rc, mmsd->mondb);
-		SAFE_SQLITE3_STEP2(statement);
-		rc=(*proxy_sqlite3_clear_bindings)(statement); ASSERT_SQLITE_OK(rc, mmsd->mondb);
-		rc=(*proxy_sqlite3_reset)(statement); ASSERT_SQLITE_OK(rc, mmsd->mondb);
-		(*proxy_sqlite3_finalize)(statement);
+		GloMyMon->check_history.add(MON_CHECK_READ_ONLY, mmsd->hostname, mmsd->port, time_now, (mmsd->mysql_error_msg ? 0 : mmsd->t2-mmsd->t1), has_value, read_only, mmsd->mysql_error_msg);
 
 		if (mmsd->mysql_error_msg == NULL) {
 			read_only_success = true;
@@ -1797,34 +1761,15 @@ VALGRIND_ENABLE_ERROR_REPORTING;
 										read_only_server_t { mmsd->hostname, mmsd->port, read_only }
 										} ); // default behavior
 		} else {
-			char *error=NULL;
-			int cols=0;
-			int affected_rows=0;
-			SQLite3_result *resultset=NULL;
-			char *new_query=NULL;
-			SQLite3DB *mondb=mmsd->mondb;
-			new_query=(char *)"SELECT 1 FROM (SELECT hostname,port,read_only,error FROM mysql_server_read_only_log WHERE hostname='%s' AND port='%d' ORDER BY time_start_us DESC LIMIT %d) a WHERE read_only IS NULL AND SUBSTR(error,1,7) = 'timeout' GROUP BY hostname,port HAVING COUNT(*)=%d";
-			char *buff=(char *)malloc(strlen(new_query)+strlen(mmsd->hostname)+32);
 			int max_failures=mysql_thread___monitor_read_only_max_timeout_count;
-			sprintf(buff,new_query, mmsd->hostname, mmsd->port, max_failures, max_failures);
-			mondb->execute_statement(buff, &error , &cols , &affected_rows , &resultset);
-			if (!error) {
-				if (resultset) {
-					if (resultset->rows_count) {
-						// disable host
-						proxy_error("Server %s:%d missed %d read_only checks. Assuming read_only=1\n", mmsd->hostname, mmsd->port, max_failures);
-						MyHGM->p_update_mysql_error_counter(p_mysql_error_type::proxysql, mmsd->hostgroup_id, mmsd->hostname, mmsd->port, ER_PROXYSQL_READ_ONLY_CHECKS_MISSED);
-						MyHGM->read_only_action_v2( std::list<read_only_server_t> {
-													read_only_server_t { mmsd->hostname, mmsd->port, read_only }
-													} ); // N timeouts reached
-					}
-					delete resultset;
-					resultset=NULL;
-				}
-			} else {
-				proxy_error("Error on %s : %s\n", buff, error);
+			if (GloMyMon->check_history.read_only_timed_out(mmsd->hostname, mmsd->port, max_failures)) {
+				// disable host
+				proxy_error("Server %s:%d missed %d read_only checks. Assuming read_only=1\n", mmsd->hostname, mmsd->port, max_failures);
+				MyHGM->p_update_mysql_error_counter(p_mysql_error_type::proxysql, mmsd->hostgroup_id, mmsd->hostname, mmsd->port, ER_PROXYSQL_READ_ONLY_CHECKS_MISSED);
+				MyHGM->read_only_action_v2( std::list<read_only_server_t> {
+											read_only_server_t { mmsd->hostname, mmsd->port, read_only }
+											} ); // N timeouts reached
 			}
-			free(buff);
 		}
 	}
 	if (mmsd->interr || mmsd->mysql_error_msg) { // check failed
@@ -2765,24 +2710,11 @@ void * monitor_replication_lag_thread(void *arg) {
 __exit_monitor_replication_lag_thread:
 	mmsd->t2=monotonic_time();
 	{
-		sqlite3_stmt *statement=NULL;
-		//sqlite3 *mondb=mmsd->mondb->get_db();
-		int rc;
-		char *query=NULL;
-
-			query=(char *)"INSERT OR REPLACE INTO mysql_server_replication_lag_log VALUES (?1 , ?2 , ?3 , ?4 , ?5 , ?6)";
-			//rc=(*proxy_sqlite3_prepare_v2)(mondb, query, -1, &statement, 0);
-			rc = mmsd->mondb->prepare_v2(query, &statement);
-			ASSERT_SQLITE_OK(rc, mmsd->mondb);
 				// 'replication_lag' to be feed to 'replication_lag_action'
 				int repl_lag=-2;
 				bool override_repl_lag = true;
-				rc=(*proxy_sqlite3_bind_text)(statement, 1, mmsd->hostname, -1, SQLITE_TRANSIENT); ASSERT_SQLITE_OK(rc, mmsd->mondb);
-				rc=(*proxy_sqlite3_bind_int)(statement, 2, mmsd->port); ASSERT_SQLITE_OK(rc, mmsd->mondb);
 				unsigned long long time_now=realtime_time();
 				time_now=time_now-(mmsd->t2 - start_time);
-				rc=(*proxy_sqlite3_bind_int64)(statement, 3, time_now); ASSERT_SQLITE_OK(rc, mmsd->mondb);
-				rc=(*proxy_sqlite3_bind_int64)(statement, 4, (mmsd->mysql_error_msg ? 0 : mmsd->t2-mmsd->t1)); ASSERT_SQLITE_OK(rc, mmsd->mondb);
 				if (mmsd->interr == 0 && mmsd->result) {
 					int num_fields=0;
 					int k=0;
@@ -2822,30 +2754,19 @@ __exit_monitor_replication_lag_thread:
 								}
 							}
 						}
-						if (/*repl_lag >= 0 ||*/ override_repl_lag == false) {
-							rc=(*proxy_sqlite3_bind_int64)(statement, 5, repl_lag); ASSERT_SQLITE_OK(rc, mmsd->mondb);
-						} else {
-							rc=(*proxy_sqlite3_bind_null)(statement, 5); ASSERT_SQLITE_OK(rc, mmsd->mondb);
-						}
 					} else {
 							proxy_error("mysql_fetch_fields returns NULL, or mysql_num_fields is incorrect. Server %s:%d . See bug #1994\n", mmsd->hostname, mmsd->port);
-							rc=(*proxy_sqlite3_bind_null)(statement, 5); ASSERT_SQLITE_OK(rc, mmsd->mondb);
 					}
 					mysql_free_result(mmsd->result);
 					mmsd->result=NULL;
 				} else {
-					rc=(*proxy_sqlite3_bind_null)(statement, 5); ASSERT_SQLITE_OK(rc, mmsd->mondb);
 					// 'replication_lag_check' timed out, we set 'repl_lag' to '-3' to avoid server to be 're-enabled'.
 					repl_lag=-3;
 				}
-				rc=(*proxy_sqlite3_bind_text)(statement, 6, mmsd->mysql_error_msg, -1, SQLITE_TRANSIENT); ASSERT_SQLITE_OK(rc, mmsd->mondb);
-				SAFE_SQLITE3_STEP2(statement);
-				rc=(*proxy_sqlite3_clear_bindings)(statement); ASSERT_SQLITE_OK(rc, mmsd->mondb);
-				rc=(*proxy_sqlite3_reset)(statement); ASSERT_SQLITE_OK(rc, mmsd->mondb);
+				GloMyMon->check_history.add(MON_CHECK_REPLICATION_LAG, mmsd->hostname, mmsd->port, time_now, (mmsd->mysql_error_msg ? 0 : mmsd->t2-mmsd->t1), (override_repl_lag == false), repl_lag, mmsd->mysql_error_msg);
 				MyHGM->replication_lag_action( std::list<replication_lag_server_t> {
 												replication_lag_server_t {mmsd->hostgroup_id, mmsd->hostname, mmsd->port, repl_lag, override_repl_lag }
 												} );
-			(*proxy_sqlite3_finalize)(statement);
 			if (mmsd->mysql_error_msg == NULL) {
 				replication_lag_success = true;
 			}
@@ -3007,6 +2928,7 @@ void * MySQL_Monitor::monitor_connect() {
 
 __end_monitor_connect_loop:
 		if (mysql_thread___monitor_enabled==true) {
+			check_history.flush(monitordb);
 			sqlite3_stmt *statement=NULL;
 			//sqlite3 *mondb=monitordb->get_db();
 			int rc;
@@ -3106,11 +3028,15 @@ void * MySQL_Monitor::monitor_ping() {
 		}
 		
 		// resultset must be initialized before calling monitor_ping_async
-		monitor_ping_async(resultset);
+		// with 'monitor_event_loop' the checks are scheduled by monitor_scheduler()
+		if (mysql_thread___monitor_event_loop == false) {
+			monitor_ping_async(resultset);
+		}
 		if (shutdown) return NULL;
 
 __end_monitor_ping_loop:
 		if (mysql_thread___monitor_enabled==true) {
+			check_history.flush(monitordb);
 			sqlite3_stmt *statement=NULL;
 			//sqlite3 *mondb=monitordb->get_db();
 			int rc;
@@ -3129,6 +3055,7 @@ __end_monitor_ping_loop:
 			rc=(*proxy_sqlite3_clear_bindings)(statement); ASSERT_SQLITE_OK(rc, monitordb);
 			rc=(*proxy_sqlite3_reset)(statement); ASSERT_SQLITE_OK(rc, monitordb);
 			(*proxy_sqlite3_finalize)(statement);
+			check_history.purge(time_now-(unsigned long long)mysql_thread___monitor_history*1000);
 		}
 
 		if (resultset) {
@@ -3137,121 +3064,27 @@ __end_monitor_ping_loop:
 		}
 
 		// now it is time to shun all problematic hosts
-		query=(char *)"SELECT DISTINCT a.hostname, a.port FROM monitor_internal.mysql_servers a JOIN monitor.mysql_server_ping_log b ON a.hostname=b.hostname WHERE b.ping_error IS NOT NULL AND b.ping_error NOT LIKE 'Access denied for user\%'";
-		proxy_debug(PROXY_DEBUG_ADMIN, 4, "%s\n", query);
-// we disable valgrind here. Probably a bug in SQLite3
-VALGRIND_DISABLE_ERROR_REPORTING;
-		admindb->execute_statement(query, &error , &cols , &affected_rows , &resultset);
-VALGRIND_ENABLE_ERROR_REPORTING;
-		if (error) {
-			proxy_error("Error on %s : %s\n", query, error);
-		} else {
-			// get all addresses and ports
-			int i=0;
-			int j=0;
-			char **addresses=(char **)malloc(resultset->rows_count * sizeof(char *));
-			char **ports=(char **)malloc(resultset->rows_count * sizeof(char *));
-			for (std::vector<SQLite3_row *>::iterator it = resultset->rows.begin() ; it != resultset->rows.end(); ++it) {
-				SQLite3_row *r=*it;
-				addresses[i]=strdup(r->fields[0]);
-				ports[i]=strdup(r->fields[1]);
-				i++;
-			}
-			if (resultset) {
-				delete resultset;
-				resultset=NULL;
-			}
-			char *new_query=NULL;
-			new_query=(char *)"SELECT 1 FROM (SELECT hostname,port,ping_error FROM mysql_server_ping_log WHERE hostname='%s' AND port='%s' ORDER BY time_start_us DESC LIMIT %d) a WHERE ping_error IS NOT NULL AND ping_error NOT LIKE 'Access denied for user%%' AND ping_error NOT LIKE 'ProxySQL Error: Access denied for user%%' AND ping_error NOT LIKE 'Your password has expired.%%' GROUP BY hostname,port HAVING COUNT(*)=%d";
-			for (j=0;j<i;j++) {
-				char *buff=(char *)malloc(strlen(new_query)+strlen(addresses[j])+strlen(ports[j])+16);
-				int max_failures=mysql_thread___monitor_ping_max_failures;
-				sprintf(buff,new_query,addresses[j],ports[j],max_failures,max_failures);
-				monitordb->execute_statement(buff, &error , &cols , &affected_rows , &resultset);
-				if (!error) {
-					if (resultset) {
-						if (resultset->rows_count) {
-							// disable host
-							bool rc_shun = false;
-							rc_shun = MyHGM->shun_and_killall(addresses[j],atoi(ports[j]));
-							if (rc_shun) {
-								proxy_error("Server %s:%s missed %d heartbeats, shunning it and killing all the connections. Disabling other checks until the node comes back online.\n", addresses[j], ports[j], max_failures);
-							}
-						}
-						delete resultset;
-						resultset=NULL;
-					}
-				} else {
-					proxy_error("Error on %s : %s\n", query, error);
+		{
+			std::vector<std::pair<std::string,int>> servers_to_shun {};
+			int max_failures=mysql_thread___monitor_ping_max_failures;
+			check_history.get_servers_to_shun(max_failures, servers_to_shun);
+			for (const std::pair<std::string,int>& srv : servers_to_shun) {
+				// disable host
+				bool rc_shun = false;
+				rc_shun = MyHGM->shun_and_killall((char *)srv.first.c_str(), srv.second);
+				if (rc_shun) {
+					proxy_error("Server %s:%d missed %d heartbeats, shunning it and killing all the connections. Disabling other checks until the node comes back online.\n", srv.first.c_str(), srv.second, max_failures);
 				}
-				free(buff);
-			}
-
-			while (i) { // now free all the addresses/ports
-				i--;
-				free(addresses[i]);
-				free(ports[i]);
 			}
-			free(addresses);
-			free(ports);
 		}
 
-
 		// now it is time to update current_lantency_ms
-		query=(char *)"SELECT DISTINCT a.hostname, a.port FROM monitor_internal.mysql_servers a JOIN monitor.mysql_server_ping_log b ON a.hostname=b.hostname WHERE b.ping_error IS NULL";
-		proxy_debug(PROXY_DEBUG_ADMIN, 4, "%s\n", query);
-VALGRIND_DISABLE_ERROR_REPORTING;
-		admindb->execute_statement(query, &error , &cols , &affected_rows , &resultset);
-VALGRIND_ENABLE_ERROR_REPORTING;
-		if (error) {
-			proxy_error("Error on %s : %s\n", query, error);
-		} else {
-			// get all addresses and ports
-			int i=0;
-			int j=0;
-			char **addresses=(char **)malloc(resultset->rows_count * sizeof(char *));
-			char **ports=(char **)malloc(resultset->rows_count * sizeof(char *));
-			for (std::vector<SQLite3_row *>::iterator it = resultset->rows.begin() ; it != resultset->rows.end(); ++it) {
-				SQLite3_row *r=*it;
-				addresses[i]=strdup(r->fields[0]);
-				ports[i]=strdup(r->fields[1]);
-				i++;
-			}
-			if (resultset) {
-				delete resultset;
-				resultset=NULL;
-			}
-			char *new_query=NULL;
-
-			new_query=(char *)"SELECT hostname,port,COALESCE(CAST(AVG(ping_success_time_us) AS INTEGER),10000) FROM (SELECT hostname,port,ping_success_time_us,ping_error FROM mysql_server_ping_log WHERE hostname='%s' AND port='%s' ORDER BY time_start_us DESC LIMIT 3) a WHERE ping_error IS NULL GROUP BY hostname,port";
-			for (j=0;j<i;j++) {
-				char *buff=(char *)malloc(strlen(new_query)+strlen(addresses[j])+strlen(ports[j])+16);
-				sprintf(buff,new_query,addresses[j],ports[j]);
-				monitordb->execute_statement(buff, &error , &cols , &affected_rows , &resultset);
-				if (!error) {
-					if (resultset) {
-						if (resultset->rows_count) {
-							for (std::vector<SQLite3_row *>::iterator it = resultset->rows.begin() ; it != resultset->rows.end(); ++it) {
-								SQLite3_row *r=*it; // this should be called just once, but we create a generic for loop
-								// update current_latency_ms
-								MyHGM->set_server_current_latency_us(addresses[j],atoi(ports[j]), atoi(r->fields[2]));
-							}
-						}
-						delete resultset;
-						resultset=NULL;
-					}
-				} else {
-					proxy_error("Error on %s : %s\n", query, error);
-				}
-				free(buff);
-			}
-			while (i) { // now free all the addresses/ports
-				i--;
-				free(addresses[i]);
-				free(ports[i]);
+		{
+			std::vector<std::tuple<std::string,int,unsigned int>> latencies {};
+			check_history.get_ping_latencies(latencies);
+			for (const std::tuple<std::string,int,unsigned int>& srv : latencies) {
+				MyHGM->set_server_current_latency_us((char *)std::get<0>(srv).c_str(), std::get<1>(srv), std::get<2>(srv));
 			}
-			free(addresses);
-			free(ports);
 		}
 
 __sleep_monitor_ping_loop:
@@ -3279,36 +3112,8 @@ __sleep_monitor_ping_loop:
 
 
 bool MySQL_Monitor::server_responds_to_ping(char *address, int port) {
-	bool ret = true; // default
-	char *error=NULL;
-	int cols=0;
-	int affected_rows=0;
-	SQLite3_result *resultset=NULL;
-	char *new_query=NULL;
-	new_query=(char *)"SELECT 1 FROM (SELECT hostname,port,ping_error FROM mysql_server_ping_log WHERE hostname='%s' AND port=%d ORDER BY time_start_us DESC LIMIT %d) a WHERE ping_error IS NOT NULL AND ping_error NOT LIKE 'Access denied for user%%' GROUP BY hostname,port HAVING COUNT(*)=%d";
-	char *buff=(char *)malloc(strlen(new_query)+strlen(address)+32);
 	int max_failures = mysql_thread___monitor_ping_max_failures;
-	sprintf(buff,new_query,address,port,max_failures,max_failures);
-VALGRIND_DISABLE_ERROR_REPORTING;
-	monitordb->execute_statement(buff, &error , &cols , &affected_rows , &resultset);
-VALGRIND_ENABLE_ERROR_REPORTING;
-	if (!error) {
-		if (resultset) {
-			if (resultset->rows_count) {
-				ret = false;
-			}
-			delete resultset;
-			resultset=NULL;
-		}
-	} else {
-		proxy_error("Error on %s : %s\n", buff, error);
-	}
-	if (resultset) {
-		delete resultset;
-		resultset=NULL;
-	}
-	free(buff);
-	return ret;
+	return (check_history.ping_failed(address, port, max_failures, false) == false);
 }
 
 /**
@@ -3462,11 +3267,15 @@ void * MySQL_Monitor::monitor_read_only() {
 		}
 
 		// resultset must be initialized before calling monitor_read_only_async
-		monitor_read_only_async(resultset, do_discovery_check);
+		// with 'monitor_event_loop' the checks are scheduled by monitor_scheduler()
+		if (mysql_thread___monitor_event_loop == false) {
+			monitor_read_only_async(resultset, do_discovery_check);
+		}
 		if (shutdown) return NULL;
 
 __end_monitor_read_only_loop:
 		if (mysql_thread___monitor_enabled==true) {
+			check_history.flush(monitordb);
 			sqlite3_stmt *statement=NULL;
 			//sqlite3 *mondb=monitordb->get_db();
 			int rc;
@@ -4507,11 +4316,15 @@ void * MySQL_Monitor::monitor_replication_lag() {
 		}
 
 		// resultset must be initialized before calling monitor_replication_lag_async
-		monitor_replication_lag_async(resultset);
+		// with 'monitor_event_loop' the checks are scheduled by monitor_scheduler()
+		if (mysql_thread___monitor_event_loop == false) {
+			monitor_replication_lag_async(resultset);
+		}
 		if (shutdown) return NULL;
 
 __end_monitor_replication_lag_loop:
 		if (mysql_thread___monitor_enabled==true) {
+			check_history.flush(monitordb);
 			sqlite3_stmt *statement=NULL;
 			//sqlite3 *mondb=monitordb->get_db();
 			int rc;
@@ -5109,6 +4922,13 @@ __monitor_run:
 		assert(0);
 		// LCOV_EXCL_STOP
 	}
+	pthread_t monitor_scheduler_thread;
+	if (pthread_create(&monitor_scheduler_thread, &attr, &monitor_scheduler_pthread,NULL) != 0) {
+		// LCOV_EXCL_START
+		proxy_error("Thread creation\n");
+		assert(0);
+		// LCOV_EXCL_STOP
+	}
 	while (shutdown==false && mysql_thread___monitor_enabled==true) {
 		unsigned int glover;
 		if (GloMTH) {
@@ -5202,6 +5022,7 @@ __monitor_run:
 	pthread_join(monitor_galera_thread,NULL);
 	pthread_join(monitor_aws_aurora_thread,NULL);
 	pthread_join(monitor_replication_lag_thread,NULL);
+	pthread_join(monitor_scheduler_thread,NULL);
 	
 	My_Conn_Pool->purge_all_connections();
 
@@ -6739,6 +6560,256 @@ void MySQL_Monitor::trigger_dns_cache_update() {
 	}
 }
 
+MySQL_Monitor_History::MySQL_Monitor_History() {
+	pthread_mutex_init(&mutex, NULL);
+	pthread_mutex_init(&flush_mutex, NULL);
+}
+
+MySQL_Monitor_History::~MySQL_Monitor_History() {
+	for (auto it = servers.begin(); it != servers.end(); ++it) {
+		delete it->second;
+	}
+	servers.clear();
+	pthread_mutex_destroy(&mutex);
+	pthread_mutex_destroy(&flush_mutex);
+}
+
+// must be called with the mutex held
+MySQL_Monitor_Server_History * MySQL_Monitor_History::get_server(const char *hostname, int port) {
+	std::string key = std::string(hostname) + ":" + std::to_string(port);
+	auto it = servers.find(key);
+	if (it != servers.end()) {
+		return it->second;
+	}
+	MySQL_Monitor_Server_History *srv = new MySQL_Monitor_Server_History();
+	srv->hostname = hostname;
+	srv->port = port;
+	servers.emplace(key, srv);
+	return srv;
+}
+
+/**
+ * @brief Records the result of a check in the server history, and queues it for the log tables.
+ *
+ * @param type The type of the check.
+ * @param time_start_us Start time of the check, realtime.
+ * @param success_time_us Duration of the check, 0 if the check failed.
+ * @param has_value If false, the value is written as NULL in the log table.
+ * @param value The value retrieved by the check: read_only or repl_lag.
+ * @param error The error of the check, or NULL.
+ */
+void MySQL_Monitor_History::add(MySQL_Monitor_Check_Type type, const char *hostname, int port, unsigned long long time_start_us, unsigned long long success_time_us, bool has_value, long long value, const char *error) {
+	MySQL_Monitor_Check_Result res;
+	res.time_start_us = time_start_us;
+	res.success_time_us = success_time_us;
+	res.value = value;
+	res.flags = 0;
+	if (error) {
+		res.flags |= MON_CHECK_F_ERROR;
+		if (strncmp(error, "Access denied for user", strlen("Access denied for user")) == 0) {
+			res.flags |= MON_CHECK_F_ACCESS_DENIED;
+		} else if (
+			(strncmp(error, "ProxySQL Error: Access denied for user", strlen("ProxySQL Error: Access denied for user")) == 0)
+			||
+			(strncmp(error, "Your password has expired.", strlen("Your password has expired.")) == 0)
+		) {
+			res.flags |= MON_CHECK_F_AUTH_ERROR;
+		} else if (strncmp(error, "timeout", strlen("timeout")) == 0) {
+			res.flags |= MON_CHECK_F_TIMEOUT;
+		}
+	}
+	if (has_value == false) {
+		res.flags |= MON_CHECK_F_NULL_VALUE;
+	}
+
+	pthread_mutex_lock(&mutex);
+	MySQL_Monitor_Server_History *srv = get_server(hostname, port);
+	srv->results[type][srv->count[type] % MONITOR_CHECK_HISTORY_SIZE] = res;
+	srv->count[type]++;
+	srv->last_check_us = time_start_us;
+	switch (type) {
+		case MON_CHECK_PING:
+			if ((res.flags & MON_CHECK_F_ERROR) && (res.flags & MON_CHECK_F_ACCESS_DENIED) == 0) {
+				srv->ping_errors++;
+			} else {
+				srv->ping_errors = 0;
+			}
+			if ((res.flags & MON_CHECK_F_ERROR) && (res.flags & (MON_CHECK_F_ACCESS_DENIED|MON_CHECK_F_AUTH_ERROR)) == 0) {
+				srv->ping_failures++;
+			} else {
+				srv->ping_failures = 0;
+			}
+			break;
+		case MON_CHECK_READ_ONLY:
+			if ((res.flags & MON_CHECK_F_TIMEOUT) && (res.flags & MON_CHECK_F_NULL_VALUE)) {
+				srv->read_only_timeouts++;
+			} else {
+				srv->read_only_timeouts = 0;
+			}
+			break;
+		default:
+			break;
+	}
+	pending[type].push_back(log_row { hostname, port, time_start_us, success_time_us, value, has_value, error != NULL, (error ? error : "") });
+	pthread_mutex_unlock(&mutex);
+}
+
+/**
+ * @brief Returns true if the last 'max_failures' pings of the server failed.
+ *
+ * @param exclude_auth_errors If true, the errors generated by the monitor user not being able to
+ *  authenticate are not considered failures. "Access denied for user" is never considered a failure.
+ */
+bool MySQL_Monitor_History::ping_failed(const char *hostname, int port, unsigned int max_failures, bool exclude_auth_errors) {
+	bool ret = false;
+	std::string key = std::string(hostname) + ":" + std::to_string(port);
+	pthread_mutex_lock(&mutex);
+	auto it = servers.find(key);
+	if (it != servers.end()) {
+		unsigned int failures = (exclude_auth_errors ? it->second->ping_failures : it->second->ping_errors);
+		ret = (failures >= max_failures);
+	}
+	pthread_mutex_unlock(&mutex);
+	return ret;
+}
+
+/**
+ * @brief Returns true if the last 'max_timeouts' read_only checks of the server timed out.
+ */
+bool MySQL_Monitor_History::read_only_timed_out(const char *hostname, int port, unsigned int max_timeouts) {
+	bool ret = false;
+	std::string key = std::string(hostname) + ":" + std::to_string(port);
+	pthread_mutex_lock(&mutex);
+	auto it = servers.find(key);
+	if (it != servers.end()) {
+		ret = (it->second->read_only_timeouts >= max_timeouts);
+	}
+	pthread_mutex_unlock(&mutex);
+	return ret;
+}
+
+/**
+ * @brief Returns the servers whose last 'max_failures' pings failed, excluding authentication errors.
+ */
+void MySQL_Monitor_History::get_servers_to_shun(unsigned int max_failures, std::vector<std::pair<std::string,int>>& result) {
+	pthread_mutex_lock(&mutex);
+	for (auto it = servers.begin(); it != servers.end(); ++it) {
+		MySQL_Monitor_Server_History *srv = it->second;
+		if (srv->ping_failures >= max_failures) {
+			result.push_back(std::pair<std::string,int> { srv->hostname, srv->port });
+		}
+	}
+	pthread_mutex_unlock(&mutex);
+}
+
+/**
+ * @brief Returns the average duration of the successful pings among the last 3 pings of every server.
+ * @details Servers without successful pings in the last 3 are not returned.
+ */
+void MySQL_Monitor_History::get_ping_latencies(std::vector<std::tuple<std::string,int,unsigned int>>& result) {
+	pthread_mutex_lock(&mutex);
+	for (auto it = servers.begin(); it != servers.end(); ++it) {
+		MySQL_Monitor_Server_History *srv = it->second;
+		unsigned int cnt = srv->count[MON_CHECK_PING];
+		unsigned int n = (cnt < 3 ? cnt : 3);
+		unsigned long long tot = 0;
+		unsigned int ok = 0;
+		for (unsigned int i = 1; i <= n; i++) {
+			const MySQL_Monitor_Check_Result& r = srv->results[MON_CHECK_PING][(cnt - i) % MONITOR_CHECK_HISTORY_SIZE];
+			if ((r.flags & MON_CHECK_F_ERROR) == 0) {
+				tot += r.success_time_us;
+				ok++;
+			}
+		}
+		if (ok) {
+			result.push_back(std::tuple<std::string,int,unsigned int> { srv->hostname, srv->port, (unsigned int)(tot/ok) });
+		}
+	}
+	pthread_mutex_unlock(&mutex);
+}
+
+/**
+ * @brief Writes all the queued results to the monitor log tables, in a single transaction.
+ * @details Multiple monitor threads can call this function: flushes are serialized, so that only one
+ *  transaction at a time is open on the shared connection.
+ */
+void MySQL_Monitor_History::flush(SQLite3DB *db) {
+	static const char *queries[MON_CHECK__SIZE] = {
+		"INSERT OR REPLACE INTO mysql_server_connect_log VALUES (?1 , ?2 , ?3 , ?4 , ?5)",
+		"INSERT OR REPLACE INTO mysql_server_ping_log VALUES (?1 , ?2 , ?3 , ?4 , ?5)",
+		"INSERT OR REPLACE INTO mysql_server_read_only_log VALUES (?1 , ?2 , ?3 , ?4 , ?5 , ?6)",
+		"INSERT OR REPLACE INTO mysql_server_replication_lag_log VALUES (?1 , ?2 , ?3 , ?4 , ?5 , ?6)",
+	};
+	std::vector<log_row> rows[MON_CHECK__SIZE];
+	bool empty = true;
+
+	pthread_mutex_lock(&flush_mutex);
+	pthread_mutex_lock(&mutex);
+	for (int t = 0; t < MON_CHECK__SIZE; t++) {
+		rows[t].swap(pending[t]);
+		if (rows[t].empty() == false) {
+			empty = false;
+		}
+	}
+	pthread_mutex_unlock(&mutex);
+	if (empty) {
+		pthread_mutex_unlock(&flush_mutex);
+		return;
+	}
+
+	db->execute("BEGIN");
+	for (int t = 0; t < MON_CHECK__SIZE; t++) {
+		if (rows[t].empty()) {
+			continue;
+		}
+		bool has_value_col = (t == MON_CHECK_READ_ONLY || t == MON_CHECK_REPLICATION_LAG);
+		int error_col = (has_value_col ? 6 : 5);
+		sqlite3_stmt *statement = NULL;
+		int rc = db->prepare_v2(queries[t], &statement);
+		ASSERT_SQLITE_OK(rc, db);
+		for (const log_row& row : rows[t]) {
+			rc = (*proxy_sqlite3_bind_text)(statement, 1, row.hostname.c_str(), -1, SQLITE_TRANSIENT); ASSERT_SQLITE_OK(rc, db);
+			rc = (*proxy_sqlite3_bind_int)(statement, 2, row.port); ASSERT_SQLITE_OK(rc, db);
+			rc = (*proxy_sqlite3_bind_int64)(statement, 3, row.time_start_us); ASSERT_SQLITE_OK(rc, db);
+			rc = (*proxy_sqlite3_bind_int64)(statement, 4, row.success_time_us); ASSERT_SQLITE_OK(rc, db);
+			if (has_value_col) {
+				if (row.has_value) {
+					rc = (*proxy_sqlite3_bind_int64)(statement, 5, row.value); ASSERT_SQLITE_OK(rc, db);
+				} else {
+					rc = (*proxy_sqlite3_bind_null)(statement, 5); ASSERT_SQLITE_OK(rc, db);
+				}
+			}
+			if (row.has_error) {
+				rc = (*proxy_sqlite3_bind_text)(statement, error_col, row.error.c_str(), -1, SQLITE_TRANSIENT); ASSERT_SQLITE_OK(rc, db);
+			} else {
+				rc = (*proxy_sqlite3_bind_null)(statement, error_col); ASSERT_SQLITE_OK(rc, db);
+			}
+			SAFE_SQLITE3_STEP2(statement);
+			rc = (*proxy_sqlite3_clear_bindings)(statement); ASSERT_SQLITE_OK(rc, db);
+			rc = (*proxy_sqlite3_reset)(statement); ASSERT_SQLITE_OK(rc, db);
+		}
+		(*proxy_sqlite3_finalize)(statement);
+	}
+	db->execute("COMMIT");
+	pthread_mutex_unlock(&flush_mutex);
+}
+
+/**
+ * @brief Removes the history of the servers not checked since 'older_than_us' (realtime).
+ */
+void MySQL_Monitor_History::purge(unsigned long long older_than_us) {
+	pthread_mutex_lock(&mutex);
+	for (auto it = servers.begin(); it != servers.end(); ) {
+		if (it->second->last_check_us < older_than_us) {
+			delete it->second;
+			it = servers.erase(it);
+		} else {
+			++it;
+		}
+	}
+	pthread_mutex_unlock(&mutex);
+}
+
 bool DNS_Cache::add(const std::string& hostname, std::vector<std::string>&& ips) {
 
 	if (!enabled) return false;
@@ -7072,7 +7143,36 @@ public:
 		return true;
 	}
 
-	inline 
+	/**
+	 * @brief Polls the tasks once, without waiting for all of them to complete.
+	 * @details Used by Monitor_Scheduler, that keeps adding new tasks while others are running.
+	 * @param ready_tasks Filled with the completed tasks, that are removed from the poll.
+	 * @return false if poll() failed.
+	 */
+	bool poll_once(int poll_timeout_ms, std::vector<MySQL_Monitor_State_Data*>& ready_tasks) {
+		int rc = poll(fds_, len_, poll_timeout_ms);
+		if (rc == -1) {
+			return (errno == EINTR);
+		}
+		for (unsigned int i = 0; i < len_;) {
+			if (mmsds_[i]->task_handler(fds_[i].revents, fds_[i].events) != MySQL_Monitor_State_Data_Task_Result::TASK_RESULT_PENDING) {
+#ifdef DEBUG
+				if (mmsds_[i]->get_task_result() != MySQL_Monitor_State_Data_Task_Result::TASK_RESULT_SUCCESS)
+					GloMyMon->My_Conn_Pool->conn_unregister(mmsds_[i]);
+#endif // DEBUG
+				ready_tasks.push_back(mmsds_[i]);
+				remove_index_fast(i);
+				continue;
+			} else {
+				assert(fds_[i].events != 0);
+			}
+			fds_[i].revents = 0;
+			i++;
+		}
+		return true;
+	}
+
+	inline
 	unsigned int count() const {
 		return len_;
 	}
@@ -7216,21 +7316,9 @@ bool MySQL_Monitor::monitor_ping_process_ready_tasks(const std::vector<MySQL_Mon
 			return false;
 		}
 
-		sqlite3_stmt* statement = NULL;
-		const char* query = "INSERT OR REPLACE INTO mysql_server_ping_log VALUES (?1 , ?2 , ?3 , ?4 , ?5)";
-		int rc = mmsd->mondb->prepare_v2(query, &statement);
-		ASSERT_SQLITE_OK(rc, mmsd->mondb);
-		rc = (*proxy_sqlite3_bind_text)(statement, 1, mmsd->hostname, -1, SQLITE_TRANSIENT); ASSERT_SQLITE_OK(rc, mmsd->mondb);
-		rc = (*proxy_sqlite3_bind_int)(statement, 2, mmsd->port); ASSERT_SQLITE_OK(rc, mmsd->mondb);
 		unsigned long long time_now = realtime_time();
 		time_now = time_now - (mmsd->t2 - mmsd->t1);
-		rc = (*proxy_sqlite3_bind_int64)(statement, 3, time_now); ASSERT_SQLITE_OK(rc, mmsd->mondb);
-		rc = (*proxy_sqlite3_bind_int64)(statement, 4, (mmsd->mysql_error_msg ? 0 : mmsd->t2 - mmsd->t1)); ASSERT_SQLITE_OK(rc, mmsd->mondb);
-		rc = (*proxy_sqlite3_bind_text)(statement, 5, mmsd->mysql_error_msg, -1, SQLITE_TRANSIENT); ASSERT_SQLITE_OK(rc, mmsd->mondb);
-		SAFE_SQLITE3_STEP2(statement);
-		rc = (*proxy_sqlite3_clear_bindings)(statement); ASSERT_SQLITE_OK(rc, mmsd->mondb);
-		rc = (*proxy_sqlite3_reset)(statement); ASSERT_SQLITE_OK(rc, mmsd->mondb);
-		(*proxy_sqlite3_finalize)(statement);
+		check_history.add(MON_CHECK_PING, mmsd->hostname, mmsd->port, time_now, (mmsd->mysql_error_msg ? 0 : mmsd->t2 - mmsd->t1), false, 0, mmsd->mysql_error_msg);
 	}
 
 	return true;
@@ -7416,17 +7504,10 @@ bool MySQL_Monitor::monitor_read_only_process_ready_tasks(const std::vector<MySQ
 			return false;
 		}
 
-		sqlite3_stmt* statement = NULL;
-		const char* query = (char*)"INSERT OR REPLACE INTO mysql_server_read_only_log VALUES (?1 , ?2 , ?3 , ?4 , ?5 , ?6)";
-		int rc = mmsd->mondb->prepare_v2(query, &statement);
-		ASSERT_SQLITE_OK(rc, mmsd->mondb);
 		int read_only = 1; // as a safety mechanism , read_only=1 is the default
-		rc = (*proxy_sqlite3_bind_text)(statement, 1, mmsd->hostname, -1, SQLITE_TRANSIENT); ASSERT_SQLITE_OK(rc, mmsd->mondb);
-		rc = (*proxy_sqlite3_bind_int)(statement, 2, mmsd->port); ASSERT_SQLITE_OK(rc, mmsd->mondb);
+		bool has_value = false;
 		unsigned long long time_now = realtime_time();
 		time_now = time_now - (mmsd->t2 - mmsd->t1);
-		rc = (*proxy_sqlite3_bind_int64)(statement, 3, time_now); ASSERT_SQLITE_OK(rc, mmsd->mondb);
-		rc = (*proxy_sqlite3_bind_int64)(statement, 4, (mmsd->mysql_error_msg ? 0 : mmsd->t2 - mmsd->t1)); ASSERT_SQLITE_OK(rc, mmsd->mondb);
 		if (mmsd->interr == 0 && mmsd->result) {
 			int num_fields = 0;
 			int k = 0;
@@ -7452,7 +7533,7 @@ VALGRIND_ENABLE_ERROR_REPORTING;
 					}
 				}
 
-				rc = (*proxy_sqlite3_bind_int64)(statement, 5, read_only); ASSERT_SQLITE_OK(rc, mmsd->mondb);
+				has_value = true;
 			} else if (fields && mmsd->get_task_type() == MON_READ_ONLY__AND__AWS_RDS_TOPOLOGY_DISCOVERY) {
 				// Process the read_only field as above and store the first server
 				vector<MYSQL_ROW> discovered_servers;
@@ -7487,55 +7568,29 @@ VALGRIND_ENABLE_ERROR_REPORTING;
 				}
 			} else {
 				proxy_error("mysql_fetch_fields returns NULL, or mysql_num_fields is incorrect. Server %s:%d . See bug #1994\n", mmsd->hostname, mmsd->port);
-				rc = (*proxy_sqlite3_bind_null)(statement, 5); ASSERT_SQLITE_OK(rc, mmsd->mondb);
 			}
 			mysql_free_result(mmsd->result);
 			mmsd->result = NULL;
-		} else {
-			rc = (*proxy_sqlite3_bind_null)(statement, 5); ASSERT_SQLITE_OK(rc, mmsd->mondb);
 		}
 		if (mmsd->result) {
 			// make sure it is clear
 			mysql_free_result(mmsd->result);
 			mmsd->result = NULL;
 		}
-		rc = (*proxy_sqlite3_bind_text)(statement, 6, mmsd->mysql_error_msg, -1, SQLITE_TRANSIENT); ASSERT_SQLITE_OK(rc, mmsd->mondb);
-		SAFE_SQLITE3_STEP2(statement);
-		rc = (*proxy_sqlite3_clear_bindings)(statement); ASSERT_SQLITE_OK(rc, mmsd->mondb);
-		rc = (*proxy_sqlite3_reset)(statement); ASSERT_SQLITE_OK(rc, mmsd->mondb);
-		(*proxy_sqlite3_finalize)(statement);
+		check_history.add(MON_CHECK_READ_ONLY, mmsd->hostname, mmsd->port, time_now, (mmsd->mysql_error_msg ? 0 : mmsd->t2 - mmsd->t1), has_value, read_only, mmsd->mysql_error_msg);
 
 		if (task_result == MySQL_Monitor_State_Data_Task_Result::TASK_RESULT_SUCCESS) {
 			//MyHGM->read_only_action_v2(mmsd->hostname, mmsd->port, read_only); // default behavior
 			mysql_servers.push_back( std::tuple<std::string,int,int> { mmsd->hostname, mmsd->port, read_only });
 		} else {
-			char* error = NULL;
-			int cols = 0;
-			int affected_rows = 0;
-			SQLite3_result* resultset = NULL;
-			char* new_query = NULL;
-			SQLite3DB* mondb = mmsd->mondb;
-			new_query = (char*)"SELECT 1 FROM (SELECT hostname,port,read_only,error FROM mysql_server_read_only_log WHERE hostname='%s' AND port='%d' ORDER BY time_start_us DESC LIMIT %d) a WHERE read_only IS NULL AND SUBSTR(error,1,7) = 'timeout' GROUP BY hostname,port HAVING COUNT(*)=%d";
-			char* buff = (char*)malloc(strlen(new_query) + strlen(mmsd->hostname) + 32);
 			int max_failures = mysql_thread___monitor_read_only_max_timeout_count;
-			sprintf(buff, new_query, mmsd->hostname, mmsd->port, max_failures, max_failures);
-			mondb->execute_statement(buff, &error, &cols, &affected_rows, &resultset);
-			if (!error) {
-				if (resultset) {
-					if (resultset->rows_count) {
-						// disable host
-						proxy_error("Server %s:%d missed %d read_only checks. Assuming read_only=1\n", mmsd->hostname, mmsd->port, max_failures);
-						MyHGM->p_update_mysql_error_counter(p_mysql_error_type::proxysql, mmsd->hostgroup_id, mmsd->hostname, mmsd->port, ER_PROXYSQL_READ_ONLY_CHECKS_MISSED);
-						//MyHGM->read_only_action_v2(mmsd->hostname, mmsd->port, read_only); // N timeouts reached
-						mysql_servers.push_back( std::tuple<std::string,int,int> { mmsd->hostname, mmsd->port, read_only });
-					}
-					delete resultset;
-					resultset = NULL;
-				}
-			} else {
-				proxy_error("Error on %s : %s\n", buff, error);
+			if (check_history.read_only_timed_out(mmsd->hostname, mmsd->port, max_failures)) {
+				// disable host
+				proxy_error("Server %s:%d missed %d read_only checks. Assuming read_only=1\n", mmsd->hostname, mmsd->port, max_failures);
+				MyHGM->p_update_mysql_error_counter(p_mysql_error_type::proxysql, mmsd->hostgroup_id, mmsd->hostname, mmsd->port, ER_PROXYSQL_READ_ONLY_CHECKS_MISSED);
+				//MyHGM->read_only_action_v2(mmsd->hostname, mmsd->port, read_only); // N timeouts reached
+				mysql_servers.push_back( std::tuple<std::string,int,int> { mmsd->hostname, mmsd->port, read_only });
 			}
-			free(buff);
 		}
 	}
 
@@ -7881,19 +7936,11 @@ bool MySQL_Monitor::monitor_replication_lag_process_ready_tasks(const std::vecto
 			return false;
 		}
 
-		sqlite3_stmt* statement = NULL;
-		const char* query = (char*)"INSERT OR REPLACE INTO mysql_server_replication_lag_log VALUES (?1 , ?2 , ?3 , ?4 , ?5 , ?6)";
-		int rc = mmsd->mondb->prepare_v2(query, &statement);
-		ASSERT_SQLITE_OK(rc, mmsd->mondb);
 		// 'replication_lag' to be feed to 'replication_lag_action'
 		int repl_lag = -2;
 		bool override_repl_lag = true;
-		rc = (*proxy_sqlite3_bind_text)(statement, 1, mmsd->hostname, -1, SQLITE_TRANSIENT); ASSERT_SQLITE_OK(rc, mmsd->mondb);
-		rc = (*proxy_sqlite3_bind_int)(statement, 2, mmsd->port); ASSERT_SQLITE_OK(rc, mmsd->mondb);
 		unsigned long long time_now = realtime_time();
 		time_now = time_now - (mmsd->t2 - mmsd->t1);
-		rc = (*proxy_sqlite3_bind_int64)(statement, 3, time_now); ASSERT_SQLITE_OK(rc, mmsd->mondb);
-		rc = (*proxy_sqlite3_bind_int64)(statement, 4, (mmsd->mysql_error_msg ? 0 : mmsd->t2 - mmsd->t1)); ASSERT_SQLITE_OK(rc, mmsd->mondb);
 		if (mmsd->interr == 0 && mmsd->result) {
 			int num_fields = 0;
 			int k = 0;
@@ -7933,28 +7980,17 @@ bool MySQL_Monitor::monitor_replication_lag_process_ready_tasks(const std::vecto
 						}
 					}
 				}
-				if (/*repl_lag >= 0 ||*/ override_repl_lag == false) {
-					rc = (*proxy_sqlite3_bind_int64)(statement, 5, repl_lag); ASSERT_SQLITE_OK(rc, mmsd->mondb);
-				} else {
-					rc = (*proxy_sqlite3_bind_null)(statement, 5); ASSERT_SQLITE_OK(rc, mmsd->mondb);
-				}
 			} else {
 				proxy_error("mysql_fetch_fields returns NULL, or mysql_num_fields is incorrect. Server %s:%d . See bug #1994\n", mmsd->hostname, mmsd->port);
-				rc = (*proxy_sqlite3_bind_null)(statement, 5); ASSERT_SQLITE_OK(rc, mmsd->mondb);
 			}
 			mysql_free_result(mmsd->result);
 			mmsd->result = NULL;
 		} else {
-			rc = (*proxy_sqlite3_bind_null)(statement, 5); ASSERT_SQLITE_OK(rc, mmsd->mondb);
 			// 'replication_lag_check' timed out, we set 'repl_lag' to '-3' to avoid server to be 're-enabled'.
 			repl_lag = -3;
 		}
-		rc = (*proxy_sqlite3_bind_text)(statement, 6, mmsd->mysql_error_msg, -1, SQLITE_TRANSIENT); ASSERT_SQLITE_OK(rc, mmsd->mondb);
-		SAFE_SQLITE3_STEP2(statement);
-		rc = (*proxy_sqlite3_clear_bindings)(statement); ASSERT_SQLITE_OK(rc, mmsd->mondb);
-		rc = (*proxy_sqlite3_reset)(statement); ASSERT_SQLITE_OK(rc, mmsd->mondb);
+		check_history.add(MON_CHECK_REPLICATION_LAG, mmsd->hostname, mmsd->port, time_now, (mmsd->mysql_error_msg ? 0 : mmsd->t2 - mmsd->t1), (override_repl_lag == false), repl_lag, mmsd->mysql_error_msg);
 		//MyHGM->replication_lag_action(mmsd->hostgroup_id, mmsd->hostname, mmsd->port, repl_lag);
-		(*proxy_sqlite3_finalize)(statement);
 		mysql_servers.push_back( replication_lag_server_t { mmsd->hostgroup_id, mmsd->hostname, mmsd->port, repl_lag, override_repl_lag });
 	}
 
@@ -8003,6 +8039,477 @@ void MySQL_Monitor::monitor_replication_lag_async(SQLite3_result* resultset) {
 	}
 }
 
+// granularity of the timer wheel used by Monitor_Scheduler
+#define MONITOR_WHEEL_TICK_US	2000
+// number of slots of the timer wheel: a full turn is ~8 seconds, longer intervals take more turns
+#define MONITOR_WHEEL_SLOTS	4096
+// how often Monitor_Scheduler reloads the servers to check
+#define MONITOR_SCHEDULER_REFRESH_US	1000000
+
+/**
+ * @brief A periodic check of a single server, scheduled by Monitor_Scheduler.
+ */
+struct Monitor_Check_Entry {
+	MySQL_Monitor_Check_Type type;
+	MySQL_Monitor_State_Data_Task_Type task_type;
+	std::string hostname;
+	int port;
+	int use_ssl;
+	int hostgroup_id; // reader_hostgroup for read_only checks, hostgroup_id for replication lag checks
+	unsigned long long deadline;
+	unsigned int generation;
+	int rounds; // read_only checks since the last AWS RDS topology discovery
+	bool in_flight;
+	// the check was passed to the blocking workers and is still running
+	std::shared_ptr<std::atomic<bool>> blocking_in_flight;
+	bool removed;
+};
+
+/**
+ * @brief Hashed timer wheel of Monitor_Check_Entry, ordered by deadline.
+ * @details Entries with a deadline farther than a full turn stay in their slot until their deadline
+ *  is reached. Inserting and expiring an entry is O(1).
+ */
+class Monitor_Timer_Wheel {
+	std::vector<Monitor_Check_Entry *> slots[MONITOR_WHEEL_SLOTS];
+	unsigned long long current_tick;
+	unsigned int count;
+	public:
+	Monitor_Timer_Wheel(unsigned long long now) : current_tick(now / MONITOR_WHEEL_TICK_US), count(0) {}
+	void add(Monitor_Check_Entry *e) {
+		unsigned long long tick = e->deadline / MONITOR_WHEEL_TICK_US;
+		if (tick < current_tick) {
+			tick = current_tick;
+		}
+		slots[tick % MONITOR_WHEEL_SLOTS].push_back(e);
+		count++;
+	}
+	/**
+	 * @brief Moves to 'expired' all the entries with a deadline before or at 'now'.
+	 */
+	void advance(unsigned long long now, std::vector<Monitor_Check_Entry *>& expired) {
+		unsigned long long now_tick = now / MONITOR_WHEEL_TICK_US;
+		if (now_tick < current_tick) {
+			return;
+		}
+		if (now_tick - current_tick >= MONITOR_WHEEL_SLOTS) {
+			// no need to scan a slot twice
+			current_tick = now_tick - MONITOR_WHEEL_SLOTS + 1;
+		}
+		while (current_tick <= now_tick) {
+			std::vector<Monitor_Check_Entry *>& slot = slots[current_tick % MONITOR_WHEEL_SLOTS];
+			for (size_t i = 0; i < slot.size(); ) {
+				if (slot[i]->deadline / MONITOR_WHEEL_TICK_US <= now_tick) {
+					expired.push_back(slot[i]);
+					slot[i] = slot.back();
+					slot.pop_back();
+					count--;
+				} else {
+					i++;
+				}
+			}
+			current_tick++;
+		}
+	}
+	unsigned long long next_tick_us() const { return current_tick * MONITOR_WHEEL_TICK_US; }
+	bool empty() const { return count == 0; }
+	void clear(std::vector<Monitor_Check_Entry *>& entries) {
+		for (unsigned int i = 0; i < MONITOR_WHEEL_SLOTS; i++) {
+			entries.insert(entries.end(), slots[i].begin(), slots[i].end());
+			slots[i].clear();
+		}
+		count = 0;
+	}
+};
+
+/**
+ * @brief Runs the ping, read_only and replication lag checks of all the servers from a single event loop.
+ * @details Every check of every server has its own deadline, spread over the check interval, kept in a
+ *  timer wheel. When a deadline expires the check is started asynchronously on a connection from
+ *  My_Conn_Pool and added to a Monitor_Poll shared by all the checks in flight: there are no bursts at
+ *  the start of every interval, and no thread is blocked waiting for a slow server. Completed checks are
+ *  processed by the same functions used by monitor_*_async(). If no connection is available in the
+ *  pool the check falls back to the blocking workers, as monitor_*_async() do.
+ */
+class Monitor_Scheduler {
+	MySQL_Monitor *mon;
+	Monitor_Timer_Wheel wheel;
+	Monitor_Poll monitor_poll;
+	std::unordered_map<std::string, Monitor_Check_Entry *> entries[MON_CHECK__SIZE];
+	std::unordered_map<MySQL_Monitor_State_Data *, Monitor_Check_Entry *> in_flight;
+	unsigned int generation;
+
+	static unsigned long long interval_us(MySQL_Monitor_Check_Type type) {
+		int interval_ms = 0;
+		switch (type) {
+			case MON_CHECK_PING:
+				interval_ms = mysql_thread___monitor_ping_interval;
+				break;
+			case MON_CHECK_READ_ONLY:
+				interval_ms = mysql_thread___monitor_read_only_interval;
+				break;
+			case MON_CHECK_REPLICATION_LAG:
+				interval_ms = mysql_thread___monitor_replication_lag_interval;
+				break;
+			default:
+				assert(0);
+				break;
+		}
+		if (interval_ms < 1) {
+			interval_ms = 1;
+		}
+		return (unsigned long long)interval_ms * 1000;
+	}
+
+	void update_entry(MySQL_Monitor_Check_Type type, const std::string& key, MySQL_Monitor_State_Data_Task_Type task_type, const char *hostname, int port, int use_ssl, int hostgroup_id, unsigned long long now) {
+		Monitor_Check_Entry *e = NULL;
+		auto it = entries[type].find(key);
+		if (it == entries[type].end()) {
+			e = new Monitor_Check_Entry();
+			e->type = type;
+			e->hostname = hostname;
+			e->port = port;
+			e->rounds = 0;
+			e->in_flight = false;
+			e->blocking_in_flight = std::make_shared<std::atomic<bool>>(false);
+			e->removed = false;
+			// spread the first checks over the interval, so that they never run all together
+			e->deadline = now + std::hash<std::string>{}(key) % interval_us(type);
+			entries[type].emplace(key, e);
+			wheel.add(e);
+		} else {
+			e = it->second;
+		}
+		e->task_type = task_type;
+		e->use_ssl = use_ssl;
+		e->hostgroup_id = hostgroup_id;
+		e->generation = generation;
+	}
+
+	void start_check(Monitor_Check_Entry *e) {
+		if (e->type != MON_CHECK_PING) {
+			if (mon->server_responds_to_ping((char *)e->hostname.c_str(), e->port) == false) {
+				return;
+			}
+		}
+		MySQL_Monitor_State_Data_Task_Type task_type = e->task_type;
+		if (e->type == MON_CHECK_READ_ONLY && e->hostname.find(AWS_ENDPOINT_SUFFIX_STRING) != std::string::npos) {
+			int topology_loop_max = mysql_thread___monitor_aws_rds_topology_discovery_interval;
+			if (topology_loop_max > 0) { // if the discovery interval is set to zero, do not query for the topology
+				if (e->rounds >= topology_loop_max) {
+					task_type = MON_READ_ONLY__AND__AWS_RDS_TOPOLOGY_DISCOVERY;
+					e->rounds = 0;
+				}
+				e->rounds++;
+			}
+		}
+		MySQL_Monitor_State_Data *mmsd = NULL;
+		void *(*blocking_routine)(void *) = NULL;
+		switch (e->type) {
+			case MON_CHECK_PING:
+				mmsd = new MySQL_Monitor_State_Data(MON_PING, (char *)e->hostname.c_str(), e->port, e->use_ssl);
+				blocking_routine = monitor_ping_thread;
+				break;
+			case MON_CHECK_READ_ONLY:
+				mmsd = new MySQL_Monitor_State_Data(task_type, (char *)e->hostname.c_str(), e->port, e->use_ssl);
+				mmsd->reader_hostgroup = e->hostgroup_id;
+				blocking_routine = monitor_read_only_thread;
+				break;
+			case MON_CHECK_REPLICATION_LAG:
+				mmsd = new MySQL_Monitor_State_Data(MON_REPLICATION_LAG, (char *)e->hostname.c_str(), e->port, e->use_ssl, e->hostgroup_id);
+				blocking_routine = monitor_replication_lag_thread;
+				break;
+			default:
+				assert(0);
+				break;
+		}
+		mmsd->mondb = mon->monitordb;
+		mmsd->mysql = mon->My_Conn_Pool->get_connection(mmsd->hostname, mmsd->port, mmsd);
+		if (mmsd->mysql) {
+			monitor_poll.add((POLLIN|POLLOUT|POLLPRI), mmsd);
+			in_flight.emplace(mmsd, e);
+			e->in_flight = true;
+		} else {
+			e->blocking_in_flight->store(true);
+			mmsd->blocking_in_flight = e->blocking_in_flight;
+			WorkItem<MySQL_Monitor_State_Data>* item = new WorkItem<MySQL_Monitor_State_Data>(mmsd, blocking_routine);
+			mon->queue->add(item);
+		}
+	}
+
+	public:
+	Monitor_Scheduler(MySQL_Monitor *_mon, unsigned long long now) : mon(_mon), wheel(now), monitor_poll(64), generation(0) {}
+
+	~Monitor_Scheduler() {
+		for (auto it = in_flight.begin(); it != in_flight.end(); ++it) {
+			MySQL_Monitor_State_Data *mmsd = it->first;
+			if (mmsd->mysql) {
+#ifdef DEBUG
+				mon->My_Conn_Pool->conn_unregister(mmsd);
+#endif // DEBUG
+				mysql_close(mmsd->mysql);
+				mmsd->mysql = NULL;
+			}
+			delete mmsd;
+			if (it->second->removed && it->second->deadline == 0) {
+				// already out of the wheel
+				delete it->second;
+			}
+		}
+		std::vector<Monitor_Check_Entry *> all {};
+		wheel.clear(all);
+		for (Monitor_Check_Entry *e : all) {
+			delete e;
+		}
+	}
+
+	/**
+	 * @brief Reloads the servers to check, using the same queries of monitor_ping(),
+	 *  monitor_read_only() and monitor_replication_lag().
+	 */
+	void refresh(unsigned long long now) {
+		char *error = NULL;
+		int cols = 0;
+		int affected_rows = 0;
+		SQLite3_result *resultset = NULL;
+		generation++;
+
+		const char *query = "SELECT hostname, port, MAX(use_ssl) use_ssl FROM monitor_internal.mysql_servers GROUP BY hostname, port";
+		mon->admindb->execute_statement(query, &error, &cols, &affected_rows, &resultset);
+		if (error) {
+			proxy_error("Error on %s : %s\n", query, error);
+			free(error);
+			error = NULL;
+		} else {
+			for (const SQLite3_row *r : resultset->rows) {
+				const std::string key = std::string(r->fields[0]) + ":" + r->fields[1];
+				update_entry(MON_CHECK_PING, key, MON_PING, r->fields[0], atoi(r->fields[1]), atoi(r->fields[2]), 0, now);
+			}
+		}
+		if (resultset) {
+			delete resultset;
+			resultset = NULL;
+		}
+
+		query = "SELECT hostname, port, MAX(use_ssl) use_ssl, check_type, reader_hostgroup FROM mysql_servers JOIN mysql_replication_hostgroups ON hostgroup_id=writer_hostgroup OR hostgroup_id=reader_hostgroup WHERE status NOT IN (2,3) GROUP BY hostname, port";
+		resultset = MyHGM->execute_query((char *)query, &error);
+		if (error) {
+			proxy_error("Error on %s : %s\n", query, error);
+			free(error);
+			error = NULL;
+		} else if (resultset) {
+			for (const SQLite3_row *r : resultset->rows) {
+				MySQL_Monitor_State_Data_Task_Type task_type = MON_READ_ONLY;
+				if (r->fields[3]) {
+					if (strcasecmp(r->fields[3], (char*)"innodb_read_only") == 0) {
+						task_type = MON_INNODB_READ_ONLY;
+					} else if (strcasecmp(r->fields[3], (char*)"super_read_only") == 0) {
+						task_type = MON_SUPER_READ_ONLY;
+					} else if (strcasecmp(r->fields[3], (char*)"read_only&innodb_read_only") == 0) {
+						task_type = MON_READ_ONLY__AND__INNODB_READ_ONLY;
+					} else if (strcasecmp(r->fields[3], (char*)"read_only|innodb_read_only") == 0) {
+						task_type = MON_READ_ONLY__OR__INNODB_READ_ONLY;
+					}
+				}
+				const std::string key = std::string(r->fields[0]) + ":" + r->fields[1];
+				update_entry(MON_CHECK_READ_ONLY, key, task_type, r->fields[0], atoi(r->fields[1]), atoi(r->fields[2]), atoi(r->fields[4]), now);
+			}
+		}
+		if (resultset) {
+			delete resultset;
+			resultset = NULL;
+		}
+
+		if (mysql_thread___monitor_replication_lag_group_by_host == true) {
+			query = "SELECT MIN(hostgroup_id), hostname, port, MIN(max_replication_lag), MAX(use_ssl) FROM mysql_servers WHERE max_replication_lag > 0 AND status NOT IN (2,3) GROUP BY hostname, port";
+		} else {
+			query = "SELECT hostgroup_id, hostname, port, max_replication_lag, use_ssl FROM mysql_servers WHERE max_replication_lag > 0 AND status NOT IN (2,3)";
+		}
+		resultset = MyHGM->execute_query((char *)query, &error);
+		if (error) {
+			proxy_error("Error on %s : %s\n", query, error);
+			free(error);
+			error = NULL;
+		} else if (resultset) {
+			for (const SQLite3_row *r : resultset->rows) {
+				const std::string key = std::string(r->fields[0]) + ":" + r->fields[1] + ":" + r->fields[2];
+				update_entry(MON_CHECK_REPLICATION_LAG, key, MON_REPLICATION_LAG, r->fields[1], atoi(r->fields[2]), atoi(r->fields[4]), atoi(r->fields[0]), now);
+			}
+		}
+		if (resultset) {
+			delete resultset;
+			resultset = NULL;
+		}
+
+		// servers no longer configured are deleted once expired from the wheel
+		for (int t = 0; t < MON_CHECK__SIZE; t++) {
+			for (auto it = entries[t].begin(); it != entries[t].end(); ) {
+				if (it->second->generation != generation) {
+					it->second->removed = true;
+					it = entries[t].erase(it);
+				} else {
+					++it;
+				}
+			}
+		}
+	}
+
+	/**
+	 * @brief Starts all the checks whose deadline expired, and schedules their next execution.
+	 * @details The next deadline is computed from the previous one and not from the current time,
+	 *  so that a late start doesn't shift the following checks.
+	 */
+	void dispatch(unsigned long long now) {
+		std::vector<Monitor_Check_Entry *> expired {};
+		wheel.advance(now, expired);
+		for (Monitor_Check_Entry *e : expired) {
+			if (e->removed) {
+				if (e->in_flight == false) {
+					delete e;
+				} else {
+					// out of the wheel, deleted by process() when the check completes
+					e->deadline = 0;
+				}
+				continue;
+			}
+			// a check still running when the next one is due is skipped
+			if (e->in_flight == false && e->blocking_in_flight->load() == false) {
+				start_check(e);
+			}
+			unsigned long long interval = interval_us(e->type);
+			e->deadline += interval;
+			if (e->deadline <= now) {
+				e->deadline = now + interval;
+			}
+			wheel.add(e);
+			if (mon->shutdown) {
+				return;
+			}
+		}
+	}
+
+	/**
+	 * @brief Waits for events on the checks in flight until the next tick of the wheel, and processes
+	 *  the completed checks.
+	 * @return false if the scheduler must stop.
+	 */
+	bool process(unsigned long long now) {
+		int timeout_ms = 100;
+		if (wheel.empty() == false) {
+			unsigned long long next = wheel.next_tick_us();
+			timeout_ms = (next > now ? (next - now + 999) / 1000 : 0);
+			if (timeout_ms > 100) {
+				timeout_ms = 100;
+			}
+		}
+		std::vector<MySQL_Monitor_State_Data *> ready_tasks {};
+		if (monitor_poll.poll_once(timeout_ms, ready_tasks) == false) {
+			return false;
+		}
+		if (ready_tasks.empty()) {
+			return true;
+		}
+		std::vector<MySQL_Monitor_State_Data *> mmsds[MON_CHECK__SIZE];
+		for (MySQL_Monitor_State_Data *mmsd : ready_tasks) {
+			auto it = in_flight.find(mmsd);
+			assert(it != in_flight.end());
+			mmsds[it->second->type].push_back(mmsd);
+		}
+		bool ret = true;
+		if (mmsds[MON_CHECK_PING].empty() == false) {
+			ret = mon->monitor_ping_process_ready_tasks(mmsds[MON_CHECK_PING]) && ret;
+		}
+		if (mmsds[MON_CHECK_READ_ONLY].empty() == false) {
+			ret = mon->monitor_read_only_process_ready_tasks(mmsds[MON_CHECK_READ_ONLY]) && ret;
+		}
+		if (mmsds[MON_CHECK_REPLICATION_LAG].empty() == false) {
+			ret = mon->monitor_replication_lag_process_ready_tasks(mmsds[MON_CHECK_REPLICATION_LAG]) && ret;
+		}
+		for (MySQL_Monitor_State_Data *mmsd : ready_tasks) {
+			auto it = in_flight.find(mmsd);
+			Monitor_Check_Entry *e = it->second;
+			in_flight.erase(it);
+			e->in_flight = false;
+			if (e->removed && e->deadline == 0) {
+				// already out of the wheel
+				delete e;
+			}
+			if (mmsd->mysql) {
+				// not returned to the pool by the process function, i.e. during shutdown
+				mysql_close(mmsd->mysql);
+				mmsd->mysql = NULL;
+			}
+			delete mmsd;
+		}
+		return ret;
+	}
+};
+
+/**
+ * @brief Main loop of the scheduler thread, active when 'mysql-monitor_event_loop' is enabled.
+ * @details The scheduler replaces the checks started by monitor_ping(), monitor_read_only() and
+ *  monitor_replication_lag(): these threads keep performing the other periodic tasks, like shunning
+ *  and the cleanup of the log tables.
+ */
+void * MySQL_Monitor::monitor_scheduler() {
+	mysql_close(mysql_init(NULL));
+	// initialize the MySQL Thread (note: this is not a real thread, just the structures associated with it)
+	unsigned int MySQL_Monitor__thread_MySQL_Thread_Variables_version;
+	MySQL_Thread * mysql_thr = new MySQL_Thread();
+	mysql_thr->curtime=monotonic_time();
+	MySQL_Monitor__thread_MySQL_Thread_Variables_version=GloMTH->get_global_version();
+	mysql_thr->refresh_variables();
+	if (!GloMTH) return NULL;	// quick exit during shutdown/restart
+
+	Monitor_Scheduler *scheduler = NULL;
+	unsigned long long next_refresh_at = 0;
+
+	while (GloMyMon->shutdown==false && mysql_thread___monitor_enabled==true) {
+		if (!GloMTH) break;	// quick exit during shutdown/restart
+		unsigned int glover=GloMTH->get_global_version();
+		if (MySQL_Monitor__thread_MySQL_Thread_Variables_version < glover ) {
+			MySQL_Monitor__thread_MySQL_Thread_Variables_version=glover;
+			mysql_thr->refresh_variables();
+			next_refresh_at=0;
+		}
+		if (mysql_thread___monitor_event_loop == false) {
+			if (scheduler) {
+				delete scheduler;
+				scheduler = NULL;
+			}
+			usleep(200000);
+			continue;
+		}
+		unsigned long long now = monotonic_time();
+		if (scheduler == NULL) {
+			scheduler = new Monitor_Scheduler(this, now);
+		}
+		if (now >= next_refresh_at) {
+			scheduler->refresh(now);
+			next_refresh_at = now + MONITOR_SCHEDULER_REFRESH_US;
+		}
+		scheduler->dispatch(now);
+		if (scheduler->process(monotonic_time()) == false) {
+			if (GloMyMon->shutdown) {
+				break;
+			}
+			// the ping, read_only and replication lag threads don't issue checks while
+			// 'monitor_event_loop' is enabled: the scheduler must keep running
+			proxy_error("Monitor scheduler failed to process the completed checks, retrying\n");
+			usleep(100000);
+		}
+	}
+	if (scheduler) {
+		delete scheduler;
+		scheduler = NULL;
+	}
+	if (mysql_thr) {
+		delete mysql_thr;
+		mysql_thr=NULL;
+	}
+	return NULL;
+}
+
 bool MySQL_Monitor::monitor_galera_process_ready_tasks(const std::vector<MySQL_Monitor_State_Data*>& mmsds) {
 
 	for (auto& mmsd : mmsds) {
@@ -691,6 +691,7 @@ MySQL_Session::MySQL_Session() {
 	thread_session_id=0;
 	//handler_ret = 0;
 	pause_until=0;
+	qc_wait_until=0;
 	qpo=new Query_Processor_Output();
 	start_time=0;
 	command_counters=new StatCounters(15,10);
@@ -1032,7 +1033,14 @@ void MySQL_Session::writeout() {
 	if (session_type!=PROXYSQL_SESSION_MYSQL) {
 		disable_throttle = true;
 	}
-	if (client_myds) client_myds->array2buffer_full();
+	if (client_myds) {
+		// large resultsets are sent directly from PSarrayOUT, without being copied into queueOUT.
+		// Not used with throttling, that relies on the size of queueOUT to measure the writes
+		if (mysql_thread___use_writev && disable_throttle && mirror==false && session_type==PROXYSQL_SESSION_MYSQL && thread->curtime >= client_myds->pause_until) {
+			total_written+=client_myds->array2net();
+		}
+		client_myds->array2buffer_full();
+	}
 	if (mybe && mybe->server_myds && mybe->server_myds->myds_type==MYDS_BACKEND) {
 		if (session_type==PROXYSQL_SESSION_MYSQL) {
 			if (mybe->server_myds->net_failure==false) {
@@ -1993,6 +2001,51 @@ int MySQL_Session::handler_again___status_PINGING_SERVER() {
 	return 0;
 }
 
+/**
+ * @brief Handles the connection of a new backend connection in the PREWARMING_CONNECTION status.
+ *
+ * Sessions in PREWARMING_CONNECTION status have no client: they are created by
+ * MySQL_Thread::run___prewarm_connections() to connect the connections returned by
+ * MySQL_HostGroups_Manager::get_connections_to_prewarm() . Once connected, the connection is returned to
+ * the connection pool. If the connection fails, the connection is destroyed and the error was already
+ * accounted by MySQL_Connection::handler() .
+ *
+ * @return -1 if the session should be terminated, 0 otherwise.
+ */
+int MySQL_Session::handler_again___status_PREWARMING_CONNECTION() {
+	assert(mybe->server_myds->myconn);
+	MySQL_Data_Stream *myds=mybe->server_myds;
+	MySQL_Connection *myconn=myds->myconn;
+	int rc=myconn->async_connect(myds->revents);
+	if (myds->mypolls==NULL) {
+		// connection yet not in mypolls
+		myds->assign_fd_from_mysql_conn();
+		thread->mypolls.add(POLLIN|POLLOUT, myds->fd, myds, thread->curtime);
+	}
+	if (rc==0) {
+		__sync_fetch_and_sub(&myconn->parent->myhgc->prewarm.connecting, 1);
+		myds->myds_type=MYDS_BACKEND;
+		myds->DSS=STATE_MARIADB_GENERIC;
+		myconn->reusable=true;
+		myds->return_MySQL_Connection_To_Pool();
+		delete mybe->server_myds;
+		mybe->server_myds=NULL;
+		set_status(session_status___NONE);
+		return -1;
+	} else {
+		if (rc==-1 || rc==-2) {
+			__sync_fetch_and_sub(&myconn->parent->myhgc->prewarm.connecting, 1);
+			myds->destroy_MySQL_Connection_From_Pool(false);
+			myds->fd=0;
+			delete mybe->server_myds;
+			mybe->server_myds=NULL;
+			return -1;
+		}
+		// rc==1 , nothing to do for now
+	}
+	return 0;
+}
+
 /**
  * @brief Handles the process of resetting the connection in the RESETTING_CONNECTION status.
  *
@@ -5278,6 +5331,16 @@ handler_again:
 			}
 			break;
 
+		case PREWARMING_CONNECTION:
+			{
+				int rc=handler_again___status_PREWARMING_CONNECTION();
+				if (rc==-1) { // the connection is either in the connection pool or destroyed
+					handler_ret = -1;
+					return handler_ret;
+				}
+			}
+			break;
+
 		case RESETTING_CONNECTION:
 			{
 				int rc = handler_again___status_RESETTING_CONNECTION();
@@ -5299,6 +5362,12 @@ handler_again:
 				handler_ret = 0;
 				return handler_ret;
 			}
+			if (qc_wait_until && status==PROCESSING_QUERY) {
+				if (handler_again___query_cache_wait()) {
+					handler_ret = 0;
+					return handler_ret;
+				}
+			}
 			if (mysql_thread___connect_timeout_server_max) {
 				if (mybe->server_myds->max_connect_time==0) {
 					// set max_connect_time to the current time plus the specified timeout value
@@ -7327,9 +7396,11 @@ bool MySQL_Session::handler___status_WAITING_CLIENT_DATA___STATE_SLEEP___MYSQL_C
 			return true;
 		}
 	//}
+	qc_wait_until=0;
 	if (qpo->cache_ttl>0 && ((prepare_stmt_type & ps_type_prepare_stmt) == 0)) {
 		bool deprecate_eof_active = client_myds->myconn->options.client_flag & CLIENT_DEPRECATE_EOF;
 		uint32_t resbuf=0;
+		bool wait_refresh=false;
 		unsigned char *aa=GloQC->get(
 			client_myds->myconn->userinfo->hash,
 			(const unsigned char *)CurrentQuery.QueryPointer ,
@@ -7337,8 +7408,14 @@ bool MySQL_Session::handler___status_WAITING_CLIENT_DATA___STATE_SLEEP___MYSQL_C
 			&resbuf ,
 			thread->curtime/1000 ,
 			qpo->cache_ttl,
-			deprecate_eof_active
+			deprecate_eof_active,
+			&wait_refresh
 		);
+		if (wait_refresh && mirror==false && prepare_stmt_type==ps_type_not_set) {
+			// another session is refreshing the entry. The query is queued as usual, but it is
+			// sent to the backend only if the entry isn't refreshed within query_cache_refresh_wait_ms
+			qc_wait_until=thread->curtime+(unsigned long long)mysql_thread___query_cache_refresh_wait_ms*1000;
+		}
 		if (aa) {
 			client_myds->buffer2resultset(aa,resbuf);
 			free(aa);
@@ -7382,6 +7459,47 @@ __exit_set_destination_hostgroup:
 	return false;
 }
 
+bool MySQL_Session::handler_again___query_cache_wait() {
+	bool deprecate_eof_active = client_myds->myconn->options.client_flag & CLIENT_DEPRECATE_EOF;
+	uint32_t resbuf=0;
+	bool wait_refresh=false;
+	unsigned char *aa=GloQC->get(
+		client_myds->myconn->userinfo->hash,
+		(const unsigned char *)CurrentQuery.QueryPointer ,
+		CurrentQuery.QueryLength ,
+		&resbuf ,
+		thread->curtime/1000 ,
+		qpo->cache_ttl,
+		deprecate_eof_active,
+		&wait_refresh
+	);
+	if (aa) {
+		qc_wait_until=0;
+		client_myds->buffer2resultset(aa,resbuf);
+		free(aa);
+		client_myds->PSarrayOUT->copy_add(client_myds->resultset,0,client_myds->resultset->len);
+		while (client_myds->resultset->len) client_myds->resultset->remove_index(client_myds->resultset->len-1,NULL);
+		if (transaction_persistent_hostgroup == -1) {
+			// not active, we can change it
+			current_hostgroup=-1;
+		}
+		// the backend was never reached: free the queued query, and end the request without the
+		// backend connection (if any is attached) as in the regular Query Cache hit
+		mybe->server_myds->free_mysql_real_query();
+		RequestEnd(NULL);
+		return true;
+	}
+	if (wait_refresh && thread->curtime < qc_wait_until) {
+		pause_until=thread->curtime+QUERY_CACHE_REFRESH_WAIT_POLL_US;
+		if (pause_until > qc_wait_until) {
+			pause_until=qc_wait_until;
+		}
+		return true;
+	}
+	qc_wait_until=0;
+	return false;
+}
+
 void MySQL_Session::handler___status_WAITING_CLIENT_DATA___STATE_SLEEP___MYSQL_COM_STATISTICS(PtrSize_t *pkt) {
 	proxy_debug(PROXY_DEBUG_MYSQL_COM, 5, "Got COM_STATISTICS packet\n");
 	l_free(pkt->size,pkt->ptr);
@@ -108,6 +108,9 @@ extern MySQL_Threads_Handler *GloMTH;
 extern MySQL_Monitor *GloMyMon;
 extern MySQL_Logger *GloMyLogger;
 
+// threads running steal_MyConn_from_threads() , waited by ~MySQL_Thread() before destroying the cache
+static int cached_connections_stealers = 0;
+
 typedef struct mythr_st_vars {
 	enum MySQL_Thread_status_variable v_idx;
 	p_th_counter::metric m_idx;
@@ -350,12 +353,17 @@ static char * mysql_thread_variables_names[]= {
 	(char *)"eventslog_filename",
 	(char *)"eventslog_filesize",
 	(char *)"eventslog_default_log",
+	(char *)"eventslog_flush_timeout",
+	(char *)"eventslog_sample_rate",
+	(char *)"eventslog_sample_slow_ms",
 	(char *)"eventslog_format",
 	(char *)"auditlog_filename",
 	(char *)"auditlog_filesize",
 	//(char *)"default_charset", // removed in 2.0.13 . Obsoleted previously using MySQL_Variables instead
 	(char *)"handle_unknown_charset",
 	(char *)"free_connections_pct",
+	(char *)"connpool_thread_cache_size",
+	(char *)"connection_prewarm_ms",
 	(char *)"connection_warming",
 #ifdef IDLE_THREADS
 	(char *)"session_idle_ms",
@@ -376,6 +384,7 @@ static char * mysql_thread_variables_names[]= {
 	(char *)"monitor_read_only_timeout",
 	(char *)"monitor_read_only_max_timeout_count",
 	(char *)"monitor_replication_lag_group_by_host",
+	(char *)"monitor_event_loop",
 	(char *)"monitor_replication_lag_interval",
 	(char *)"monitor_replication_lag_timeout",
 	(char *)"monitor_replication_lag_count",
@@ -438,6 +447,7 @@ static char * mysql_thread_variables_names[]= {
 	(char *)"default_query_timeout",
 	(char *)"query_processor_iterations",
 	(char *)"query_processor_regex",
+	(char *)"query_processor_regex_set",
 	(char *)"set_query_lock_on_hostgroup",
 	(char *)"set_parser_algorithm",
 	(char *)"reset_connection_algorithm",
@@ -447,11 +457,20 @@ static char * mysql_thread_variables_names[]= {
 	(char *)"query_cache_size_MB",
 	(char *)"query_cache_soft_ttl_pct",
 	(char *)"query_cache_handle_warnings",
+	(char *)"query_cache_eviction_policy",
+	(char *)"query_cache_stale_grace_ms",
+	(char *)"query_cache_refresh_wait_ms",
+	(char *)"query_cache_compression",
+	(char *)"query_cache_engine",
+	(char *)"query_cache_shards",
 	(char *)"ping_interval_server_msec",
 	(char *)"ping_timeout_server",
 	(char *)"default_schema",
 	(char *)"poll_timeout",
 	(char *)"poll_timeout_on_failure",
+	(char *)"poll_engine",
+	(char *)"use_io_uring",
+	(char *)"use_writev",
 	(char *)"server_capabilities",
 	(char *)"server_version",
 	(char *)"keep_multiplexing_variables",
@@ -463,6 +482,7 @@ static char * mysql_thread_variables_names[]= {
 	(char *)"session_idle_show_processlist",
 #endif // IDLE_THREADS
 	(char *)"show_processlist_extended",
+	(char *)"show_processlist_snapshot_ms",
 	(char *)"commands_stats",
 	(char *)"query_digests",
 	(char *)"query_digests_lowercase",
@@ -978,6 +998,8 @@ MySQL_Threads_Handler::MySQL_Threads_Handler() {
 	variables.connect_timeout_server=1000;
 	variables.connect_timeout_server_max=10000;
 	variables.free_connections_pct=10;
+	variables.connpool_thread_cache_size=0;
+	variables.connection_prewarm_ms=0;
 	variables.connect_retries_delay=1;
 	variables.monitor_enabled=true;
 	variables.monitor_history=7200000; // changed in 2.6.0 : was 600000
@@ -991,6 +1013,7 @@ MySQL_Threads_Handler::MySQL_Threads_Handler() {
 	variables.monitor_read_only_timeout=800;
 	variables.monitor_read_only_max_timeout_count=3;
 	variables.monitor_replication_lag_group_by_host=false;
+	variables.monitor_event_loop=false;
 	variables.monitor_replication_lag_interval=10000;
 	variables.monitor_replication_lag_timeout=1000;
 	variables.monitor_replication_lag_count=1;
@@ -1046,6 +1069,7 @@ MySQL_Threads_Handler::MySQL_Threads_Handler() {
 	variables.default_query_timeout=24*3600*1000;
 	variables.query_processor_iterations=0;
 	variables.query_processor_regex=1;
+	variables.query_processor_regex_set=false;
 	variables.set_query_lock_on_hostgroup=1;
 	variables.set_parser_algorithm=2; // before 2.6.0 this was 1
 	variables.reset_connection_algorithm=2;
@@ -1055,6 +1079,12 @@ MySQL_Threads_Handler::MySQL_Threads_Handler() {
 	variables.query_cache_size_MB=256;
 	variables.query_cache_soft_ttl_pct=0;
 	variables.query_cache_handle_warnings=0;
+	variables.query_cache_eviction_policy=0;
+	variables.query_cache_stale_grace_ms=0;
+	variables.query_cache_refresh_wait_ms=0;
+	variables.query_cache_compression=false;
+	variables.query_cache_engine=0;
+	variables.query_cache_shards=SHARED_QUERY_CACHE_HASH_TABLES;
 	variables.init_connect=NULL;
 	variables.ldap_user_variable=NULL;
 	variables.add_ldap_user_comment=NULL;
@@ -1071,6 +1101,9 @@ MySQL_Threads_Handler::MySQL_Threads_Handler() {
 	variables.eventslog_filename=strdup((char *)""); // proxysql-mysql-eventslog is recommended
 	variables.eventslog_filesize=100*1024*1024;
 	variables.eventslog_default_log=0;
+	variables.eventslog_flush_timeout=0;
+	variables.eventslog_sample_rate=0;
+	variables.eventslog_sample_slow_ms=0;
 	variables.eventslog_format=1;
 	variables.auditlog_filename=strdup((char *)"");
 	variables.auditlog_filesize=100*1024*1024;
@@ -1079,6 +1112,9 @@ MySQL_Threads_Handler::MySQL_Threads_Handler() {
 	variables.server_capabilities = CLIENT_MYSQL | CLIENT_FOUND_ROWS | CLIENT_PROTOCOL_41 | CLIENT_IGNORE_SIGPIPE | CLIENT_TRANSACTIONS | CLIENT_SECURE_CONNECTION | CLIENT_CONNECT_WITH_DB | CLIENT_PLUGIN_AUTH;;
 	variables.poll_timeout=2000;
 	variables.poll_timeout_on_failure=100;
+	variables.poll_engine=POLL_ENGINE_POLL;
+	variables.use_io_uring=false;
+	variables.use_writev=false;
 	variables.have_compress=true;
 	variables.have_ssl = true; // changed in 2.6.0 , was false by default for performance reason
 	variables.commands_stats=true;
@@ -1110,6 +1146,7 @@ MySQL_Threads_Handler::MySQL_Threads_Handler() {
 	variables.session_idle_show_processlist=true;
 #endif // IDLE_THREADS
 	variables.show_processlist_extended = 0;
+	variables.show_processlist_snapshot_ms=0;
 	variables.servers_stats=true;
 	variables.default_reconnect=true;
 	variables.ssl_p2s_ca=NULL;
@@ -1732,7 +1769,7 @@ bool MySQL_Threads_Handler::set_variable(char *name, const char *value) {	// thi
 	}
 	if (!strcasecmp(name,"eventslog_format")) {
 		int intv=atoi(value);
-		if (intv >= 1 && intv <= 2) {
+		if (intv >= 1 && intv <= 3) {
 			if (variables.eventslog_format!=intv) {
 				// if we are switching format, we need to switch file too
 				if (GloMyLogger) {
@@ -2139,9 +2176,11 @@ char ** MySQL_Threads_Handler::get_variables_list() {
 		VariablesPointers_bool["log_unhealthy_connections"]       = make_tuple(&variables.log_unhealthy_connections,       false);
 		VariablesPointers_bool["monitor_enabled"]                 = make_tuple(&variables.monitor_enabled,                 false);
 		VariablesPointers_bool["monitor_replication_lag_group_by_host"] = make_tuple(&variables.monitor_replication_lag_group_by_host, false);
+		VariablesPointers_bool["monitor_event_loop"]              = make_tuple(&variables.monitor_event_loop,              false);
 		VariablesPointers_bool["monitor_wait_timeout"]            = make_tuple(&variables.monitor_wait_timeout,            false);
 		VariablesPointers_bool["monitor_writer_is_also_reader"]   = make_tuple(&variables.monitor_writer_is_also_reader,   false);
 		VariablesPointers_bool["multiplexing"]                    = make_tuple(&variables.multiplexing,                    false);
+		VariablesPointers_bool["query_cache_compression"]         = make_tuple(&variables.query_cache_compression,         false);
 		VariablesPointers_bool["query_cache_stores_empty_result"] = make_tuple(&variables.query_cache_stores_empty_result, false);
 		VariablesPointers_bool["query_digests"]                   = make_tuple(&variables.query_digests,                   false);
 		VariablesPointers_bool["query_digests_lowercase"]         = make_tuple(&variables.query_digests_lowercase,         false);
@@ -2150,11 +2189,15 @@ char ** MySQL_Threads_Handler::get_variables_list() {
 		VariablesPointers_bool["query_digests_normalize_digest_text"] = make_tuple(&variables.query_digests_normalize_digest_text, false);
 		VariablesPointers_bool["query_digests_track_hostname"]    = make_tuple(&variables.query_digests_track_hostname,    false);
 		VariablesPointers_bool["query_digests_keep_comment"]      = make_tuple(&variables.query_digests_keep_comment,      false);
+		VariablesPointers_bool["query_processor_regex_set"]       = make_tuple(&variables.query_processor_regex_set,       false);
 		VariablesPointers_bool["parse_failure_logs_digest"]       = make_tuple(&variables.parse_failure_logs_digest,       false);
 		VariablesPointers_bool["servers_stats"]                   = make_tuple(&variables.servers_stats,                   false);
 		VariablesPointers_bool["sessions_sort"]                   = make_tuple(&variables.sessions_sort,                   false);
 		VariablesPointers_bool["stats_time_backend_query"]        = make_tuple(&variables.stats_time_backend_query,        false);
 		VariablesPointers_bool["stats_time_query_processor"]      = make_tuple(&variables.stats_time_query_processor,      false);
+		// use_io_uring is read only when the worker threads are initialized
+		VariablesPointers_bool["use_io_uring"]                    = make_tuple(&variables.use_io_uring,                    false);
+		VariablesPointers_bool["use_writev"]                      = make_tuple(&variables.use_writev,                      false);
 		VariablesPointers_bool["use_tcp_keepalive"]               = make_tuple(&variables.use_tcp_keepalive,               false);
 		VariablesPointers_bool["verbose_query_error"]             = make_tuple(&variables.verbose_query_error,             false);
 #ifdef IDLE_THREADS
@@ -2241,8 +2284,12 @@ char ** MySQL_Threads_Handler::get_variables_list() {
 		VariablesPointers_int["connpoll_reset_queue_length"] = make_tuple(&variables.connpoll_reset_queue_length, 0,           10000, false);
 		VariablesPointers_int["default_max_latency_ms"]      = make_tuple(&variables.default_max_latency_ms,      0, 20*24*3600*1000, false);
 		VariablesPointers_int["free_connections_pct"]        = make_tuple(&variables.free_connections_pct,        0,             100, false);
+		VariablesPointers_int["connpool_thread_cache_size"]  = make_tuple(&variables.connpool_thread_cache_size,  0,            1024, false);
+		VariablesPointers_int["connection_prewarm_ms"]      = make_tuple(&variables.connection_prewarm_ms,      0,           60000, false);
 		VariablesPointers_int["poll_timeout"]                = make_tuple(&variables.poll_timeout,               10,           20000, false);
 		VariablesPointers_int["poll_timeout_on_failure"]     = make_tuple(&variables.poll_timeout_on_failure,    10,           20000, false);
+		// poll_engine is read only when the worker threads are initialized
+		VariablesPointers_int["poll_engine"]                 = make_tuple(&variables.poll_engine,                 0,               1, false);
 		VariablesPointers_int["reset_connection_algorithm"]  = make_tuple(&variables.reset_connection_algorithm,  1,               2, false);
 		VariablesPointers_int["shun_on_failures"]            = make_tuple(&variables.shun_on_failures,            0,        10000000, false);
 		VariablesPointers_int["shun_recovery_time_sec"]      = make_tuple(&variables.shun_recovery_time_sec,      0,     3600*24*365, false);
@@ -2271,6 +2318,9 @@ char ** MySQL_Threads_Handler::get_variables_list() {
 		VariablesPointers_int["auditlog_filesize"]     = make_tuple(&variables.auditlog_filesize,    1024*1024, 1*1024*1024*1024, false);
 		VariablesPointers_int["eventslog_filesize"]    = make_tuple(&variables.eventslog_filesize,   1024*1024, 1*1024*1024*1024, false);
 		VariablesPointers_int["eventslog_default_log"] = make_tuple(&variables.eventslog_default_log,        0,                1, false);
+		VariablesPointers_int["eventslog_flush_timeout"] = make_tuple(&variables.eventslog_flush_timeout, 0, 60000, false);
+		VariablesPointers_int["eventslog_sample_rate"] = make_tuple(&variables.eventslog_sample_rate, 0, 1000000, false);
+		VariablesPointers_int["eventslog_sample_slow_ms"] = make_tuple(&variables.eventslog_sample_slow_ms, 0, 3600000, false);
 		// various
 		VariablesPointers_int["long_query_time"]           = make_tuple(&variables.long_query_time,              0,  20*24*3600*1000, false);
 		VariablesPointers_int["max_allowed_packet"]        = make_tuple(&variables.max_allowed_packet,        8192,   1024*1024*1024, false);
@@ -2282,11 +2332,18 @@ char ** MySQL_Threads_Handler::get_variables_list() {
 		VariablesPointers_int["query_cache_size_mb"]       = make_tuple(&variables.query_cache_size_MB,          0,       1024*10240, false);
 		VariablesPointers_int["query_cache_soft_ttl_pct"]  = make_tuple(&variables.query_cache_soft_ttl_pct,     0,              100, false);
 		VariablesPointers_int["query_cache_handle_warnings"] = make_tuple(&variables.query_cache_handle_warnings,	 0,				   1, false);
+		VariablesPointers_int["query_cache_eviction_policy"] = make_tuple(&variables.query_cache_eviction_policy, 0,			   1, false);
+		VariablesPointers_int["query_cache_stale_grace_ms"] = make_tuple(&variables.query_cache_stale_grace_ms,   0,          3600000, false);
+		VariablesPointers_int["query_cache_refresh_wait_ms"] = make_tuple(&variables.query_cache_refresh_wait_ms,  0,            60000, false);
+		// query_cache_engine and query_cache_shards are read only when the Query Cache is created
+		VariablesPointers_int["query_cache_engine"]        = make_tuple(&variables.query_cache_engine,           0,                1, false);
+		VariablesPointers_int["query_cache_shards"]        = make_tuple(&variables.query_cache_shards,           1,             1024, false);
 
 #ifdef IDLE_THREADS
 		VariablesPointers_int["session_idle_ms"]           = make_tuple(&variables.session_idle_ms,              1,        3600*1000, false);
 #endif // IDLE_THREADS
 		VariablesPointers_int["show_processlist_extended"] = make_tuple(&variables.show_processlist_extended,    0,                2, false);
+		VariablesPointers_int["show_processlist_snapshot_ms"] = make_tuple(&variables.show_processlist_snapshot_ms, 0, 60000, false);
 		VariablesPointers_int["threshold_query_length"]    = make_tuple(&variables.threshold_query_length,    1024, 1*1024*1024*1024, false);
 		VariablesPointers_int["threshold_resultset_size"]  = make_tuple(&variables.threshold_resultset_size,  1024, 1*1024*1024*1024, false);
 
@@ -2843,9 +2900,22 @@ MySQL_Thread::~MySQL_Thread() {
 #endif // IDLE_THREADS
 
 	if (cached_connections) {
+		// the cache becomes private: other threads no longer access it, but they can still be
+		// locking the mutex in steal_MyConn_from_threads()
 		return_local_connections();
+		while (__sync_fetch_and_add(&cached_connections_stealers,0)) {
+			usleep(1000);
+		}
 		delete cached_connections;
+		cached_connections=NULL;
 	}
+	pthread_mutex_destroy(&cached_connections_mutex);
+
+	// frees the last published snapshot of the processlist, unless a reader still holds it
+	pthread_mutex_lock(&processlist_snapshot_mutex);
+	processlist_snapshot.reset();
+	pthread_mutex_unlock(&processlist_snapshot_mutex);
+	pthread_mutex_destroy(&processlist_snapshot_mutex);
 
 	unsigned int i;
 	for (i=0;i<mypolls.len;i++) {
@@ -3014,7 +3084,21 @@ bool MySQL_Thread::init() {
 	my_idle_conns=(MySQL_Connection **)malloc(sizeof(MySQL_Connection *)*SESSIONS_FOR_CONNECTIONS_HANDLER);
 	memset(my_idle_conns,0,sizeof(MySQL_Connection *)*SESSIONS_FOR_CONNECTIONS_HANDLER);
 	GloQPro->init_thread();
+	GloQPro->init_thread_digest_buffer();
 	refresh_variables();
+#ifdef IDLE_THREADS
+	// idle threads already use their own epoll instance
+	if (epoll_thread==false && GloMTH->get_variable_int((char *)"poll_engine")==POLL_ENGINE_EPOLL) {
+		if (mypolls.init_epoll()==false) {
+			proxy_error("Unable to create epoll instance: %s . Using poll()\n", strerror(errno));
+		}
+	}
+#endif // IDLE_THREADS
+	if (epoll_thread==false && GloMTH->get_variable_int((char *)"use_io_uring")) {
+		if (io_ring.init(IO_URING_ENTRIES) == false) {
+			proxy_error("Unable to initialize io_uring . Using recv()\n");
+		}
+	}
 	i=pipe(pipefd);
 	ioctl_FIONBIO(pipefd[0],1);
 	ioctl_FIONBIO(pipefd[1],1);
@@ -3127,6 +3211,53 @@ void MySQL_Thread::run___get_multiple_idle_connections(int& num_idles) {
 	last_processing_idles=curtime;
 }
 
+// interval between two rounds of mysql-connection_prewarm_ms , shared by all the threads
+#define PREWARM_ROUND_INTERVAL_US	100000
+static unsigned long long prewarm_last_round = 0;
+
+/**
+ * @brief Creates backend connections ahead of demand, if mysql-connection_prewarm_ms is enabled.
+ *
+ * At most one thread every PREWARM_ROUND_INTERVAL_US runs a round: it gets the new connections from
+ * MySQL_HostGroups_Manager::get_connections_to_prewarm() and, for each of them, creates a session without
+ * client in PREWARMING_CONNECTION status, registered with the connection handler. The session connects the
+ * connection asynchronously and returns it to the connection pool.
+ */
+void MySQL_Thread::run___prewarm_connections() {
+	unsigned long long last_round = __sync_fetch_and_add(&prewarm_last_round, 0);
+	if (curtime < last_round + PREWARM_ROUND_INTERVAL_US) {
+		return;
+	}
+	if (__sync_bool_compare_and_swap(&prewarm_last_round, last_round, curtime) == false) {
+		return; // another thread is running this round
+	}
+	int num_conns=MyHGM->get_connections_to_prewarm(my_idle_conns, SESSIONS_FOR_CONNECTIONS_HANDLER, curtime);
+	for (int i=0; i<num_conns; i++) {
+		MySQL_Data_Stream *myds;
+		MySQL_Connection *mc=my_idle_conns[i];
+		MySQL_Session *sess=new MySQL_Session();
+		sess->mybe=sess->find_or_create_backend(mc->parent->myhgc->hid);
+
+		myds=sess->mybe->server_myds;
+		myds->attach_connection(mc);
+		myds->myds_type=MYDS_BACKEND;
+
+		sess->to_process=1;
+		myds->wait_until=curtime+mysql_thread___connect_timeout_server*1000;	// max_timeout
+		mc->last_time_used=curtime;
+		myds->myprot.init(&myds, myds->myconn->userinfo, NULL);
+		sess->status=PREWARMING_CONNECTION;
+		myds->DSS=STATE_MARIADB_CONNECTING;
+		register_session_connection_handler(sess,true);
+		int rc=sess->handler();
+		if (rc==-1) {
+			unsigned int sess_idx=mysql_sessions->len-1;
+			unregister_session(sess_idx);
+			delete sess;
+		}
+	}
+}
+
 // this function was inline in MySQL_Thread::run()
 void MySQL_Thread::ProcessAllMyDS_BeforePoll() {
 	bool check_if_move_to_idle_thread = false;
@@ -3185,8 +3316,18 @@ void MySQL_Thread::ProcessAllMyDS_BeforePoll() {
  * If there are events, it checks for invalid file descriptors and handles new connections 
  * for listener type data streams. For other types of data streams, it processes data and 
  * handles any potential errors.
+ *
+ * When epoll is used and no session needs to be checked for timeout, only the data streams
+ * returned by epoll_wait() are processed.
  */
 void MySQL_Thread::ProcessAllMyDS_AfterPoll() {
+	if (io_ring.enabled()) {
+		ProcessAllMyDS_BatchedReads();
+	}
+	if (mypolls.efd >= 0 && poll_timeout_bool == false) {
+		ProcessReadyMyDS_AfterPoll();
+		return;
+	}
 	for (unsigned int n = 0; n < mypolls.len; n++) {
 		proxy_debug(PROXY_DEBUG_NET,3, "poll for fd %d events %d revents %d\n", mypolls.fds[n].fd , mypolls.fds[n].events, mypolls.fds[n].revents);
 
@@ -3221,6 +3362,75 @@ void MySQL_Thread::ProcessAllMyDS_AfterPoll() {
 }
 
 
+/**
+ * @brief Performs with a single io_uring submission the reads of all the data streams with pending data.
+ *
+ * The data is read into queueIN exactly as MySQL_Data_Stream::read_from_net() would do, and the result
+ * is stored in the data stream: read_from_net() consumes it instead of calling recv(). Only the data
+ * streams for which read_from_net() would call recv() directly are considered, and the submission is
+ * performed only if there are at least IO_URING_MIN_BATCH of them.
+ */
+void MySQL_Thread::ProcessAllMyDS_BatchedReads() {
+	bool ready_only=(mypolls.efd >= 0 && poll_timeout_bool == false);
+	unsigned int cnt = ready_only ? mypolls.ready_len : mypolls.len;
+	unsigned int eligible=0;
+	for (unsigned int k = 0; k < cnt && eligible < IO_URING_MIN_BATCH; k++) {
+		int n = ready_only ? mypolls.get_fd_idx(mypolls.epoll_events[k].data.fd) : (int)k;
+		if (n >= 0 && mypolls.myds[n] && mypolls.myds[n]->io_ring_recv_eligible(mypolls.fds[n].revents)) {
+			eligible++;
+		}
+	}
+	if (eligible < IO_URING_MIN_BATCH) {
+		return;
+	}
+	for (unsigned int k = 0; k < cnt; k++) {
+		int n = ready_only ? mypolls.get_fd_idx(mypolls.epoll_events[k].data.fd) : (int)k;
+		if (n >= 0 && mypolls.myds[n] && mypolls.myds[n]->io_ring_recv_eligible(mypolls.fds[n].revents)) {
+			if (mypolls.myds[n]->io_ring_prep_recv(&io_ring) == false) {
+				// the ring is full
+				io_ring.submit_and_wait(MySQL_Data_Stream::io_ring_recv_completed, NULL);
+				mypolls.myds[n]->io_ring_prep_recv(&io_ring);
+			}
+		}
+	}
+	io_ring.submit_and_wait(MySQL_Data_Stream::io_ring_recv_completed, NULL);
+}
+
+/**
+ * @brief Processes only the MySQL Data Streams reported ready by epoll_wait().
+ *
+ * Processing a data stream can remove other entries from mypolls , moving the last entry in
+ * their place, therefore the index of every ready FD is resolved again before processing it.
+ * Entries added during this loop (new connections) have 'revents' set to 0 and are skipped.
+ */
+void MySQL_Thread::ProcessReadyMyDS_AfterPoll() {
+	for (unsigned int k = 0; k < mypolls.ready_len; k++) {
+		int idx=mypolls.get_fd_idx(mypolls.epoll_events[k].data.fd);
+		if (idx < 0) {
+			continue;
+		}
+		unsigned int n=idx;
+		proxy_debug(PROXY_DEBUG_NET,3, "epoll for fd %d events %d revents %d\n", mypolls.fds[n].fd , mypolls.fds[n].events, mypolls.fds[n].revents);
+		if (mypolls.fds[n].revents==0) {
+			continue;
+		}
+		MySQL_Data_Stream *myds=mypolls.myds[n];
+		if (myds==NULL) {
+			read_one_byte_from_pipe(n);
+			continue;
+		}
+		check_for_invalid_fd(n); // this is designed to assert in case of failure
+		if (myds->myds_type==MYDS_LISTENER) {
+			// we got a new connection!
+			listener_handle_new_connection(myds,n);
+			continue;
+		}
+		// data on exiting connection
+		process_data_on_data_stream(myds, n);
+	}
+}
+
+
 // this function was inline in MySQL_Thread::run()
 /**
  * @brief Cleans up the mirror queue by removing excess sessions.
@@ -3413,6 +3623,9 @@ void MySQL_Thread::run() {
 	if (processing_idles==false &&  (last_processing_idles < curtime-mysql_thread___ping_interval_server_msec*1000) ) {
 		run___get_multiple_idle_connections(num_idles);
 	}
+	if (mysql_thread___connection_prewarm_ms) {
+		run___prewarm_connections();
+	}
 
 #ifdef IDLE_THREADS
 __run_skip_1:
@@ -3449,7 +3662,8 @@ __run_skip_1:
 		//this is the only portion of code not protected by a global mutex
 		proxy_debug(PROXY_DEBUG_NET,5,"Calling poll with timeout %d\n", ttw );
 		// poll is called with a timeout of mypolls.poll_timeout if set , or mysql_thread___poll_timeout
-		rc=poll(mypolls.fds,mypolls.len, ttw);
+		// if 'mysql-poll_engine' is epoll , epoll_wait() is called instead
+		rc=mypolls.wait(ttw);
 		proxy_debug(PROXY_DEBUG_NET,5,"%s\n", "Returning poll");
 #ifdef IDLE_THREADS
 		}
@@ -3495,6 +3709,10 @@ __run_skip_1:
 
 		handle_kill_queues();
 
+		if (mysql_thread___show_processlist_snapshot_ms) {
+			run_PublishProcesslistSnapshot();
+		}
+
 		// update polls statistics
 		mypolls.loops++;
 		mypolls.loop_counters->incr(curtime/1000000);
@@ -3545,7 +3763,8 @@ __run_skip_1:
 			ProcessAllMyDS_AfterPoll();
 			// iterate through all sessions and process the session logic
 			process_all_sessions();
-			return_local_connections();
+			// connections are kept in the thread cache at most until the next maintenance loop
+			return_local_connections(maintenance_loop ? 0 : mysql_thread___connpool_thread_cache_size);
 #ifdef IDLE_THREADS
 		}
 #endif // IDLE_THREADS
@@ -4282,6 +4501,7 @@ void MySQL_Thread::refresh_variables() {
 	REFRESH_VARIABLE_BOOL(automatic_detect_sqli);
 	REFRESH_VARIABLE_BOOL(firewall_whitelist_enabled);
 	REFRESH_VARIABLE_BOOL(use_tcp_keepalive);
+	REFRESH_VARIABLE_BOOL(use_writev);
 	REFRESH_VARIABLE_INT(tcp_keepalive_time);
 	REFRESH_VARIABLE_INT(throttle_connections_per_sec_to_hostgroup);
 	REFRESH_VARIABLE_INT(max_transaction_idle_time);
@@ -4302,6 +4522,7 @@ void MySQL_Thread::refresh_variables() {
 	REFRESH_VARIABLE_INT(default_query_timeout);
 	REFRESH_VARIABLE_INT(query_processor_iterations);
 	REFRESH_VARIABLE_INT(query_processor_regex);
+	REFRESH_VARIABLE_BOOL(query_processor_regex_set);
 	REFRESH_VARIABLE_INT(set_query_lock_on_hostgroup);
 	REFRESH_VARIABLE_INT(set_parser_algorithm);
 	REFRESH_VARIABLE_INT(reset_connection_algorithm);
@@ -4312,6 +4533,10 @@ void MySQL_Thread::refresh_variables() {
 	REFRESH_VARIABLE_INT(query_cache_size_MB);
 	REFRESH_VARIABLE_INT(query_cache_soft_ttl_pct);
 	REFRESH_VARIABLE_INT(query_cache_handle_warnings);
+	REFRESH_VARIABLE_INT(query_cache_eviction_policy);
+	REFRESH_VARIABLE_INT(query_cache_stale_grace_ms);
+	REFRESH_VARIABLE_INT(query_cache_refresh_wait_ms);
+	REFRESH_VARIABLE_BOOL(query_cache_compression);
 	REFRESH_VARIABLE_INT(ping_interval_server_msec);
 	REFRESH_VARIABLE_INT(ping_timeout_server);
 	REFRESH_VARIABLE_INT(shun_on_failures);
@@ -4325,6 +4550,8 @@ void MySQL_Thread::refresh_variables() {
 	REFRESH_VARIABLE_INT(connect_timeout_server);
 	REFRESH_VARIABLE_INT(connect_timeout_server_max);
 	REFRESH_VARIABLE_INT(free_connections_pct);
+	REFRESH_VARIABLE_INT(connpool_thread_cache_size);
+	REFRESH_VARIABLE_INT(connection_prewarm_ms);
 #ifdef IDLE_THREADS
 	REFRESH_VARIABLE_INT(session_idle_ms);
 #endif // IDLE_THREADS
@@ -4357,6 +4584,7 @@ void MySQL_Thread::refresh_variables() {
 	REFRESH_VARIABLE_INT(monitor_read_only_timeout);
 	REFRESH_VARIABLE_INT(monitor_read_only_max_timeout_count);
 	REFRESH_VARIABLE_BOOL(monitor_replication_lag_group_by_host);
+	REFRESH_VARIABLE_BOOL(monitor_event_loop);
 	REFRESH_VARIABLE_INT(monitor_replication_lag_interval);
 	REFRESH_VARIABLE_INT(monitor_replication_lag_timeout);
 	REFRESH_VARIABLE_INT(monitor_replication_lag_count);
@@ -4399,6 +4627,9 @@ void MySQL_Thread::refresh_variables() {
 	REFRESH_VARIABLE_CHAR(server_version);
 	REFRESH_VARIABLE_INT(eventslog_filesize);
 	REFRESH_VARIABLE_INT(eventslog_default_log);
+	REFRESH_VARIABLE_INT(eventslog_flush_timeout);
+	REFRESH_VARIABLE_INT(eventslog_sample_rate);
+	REFRESH_VARIABLE_INT(eventslog_sample_slow_ms);
 	REFRESH_VARIABLE_INT(eventslog_format);
 	REFRESH_VARIABLE_CHAR(eventslog_filename);
 	REFRESH_VARIABLE_INT(auditlog_filesize);
@@ -4447,6 +4678,7 @@ void MySQL_Thread::refresh_variables() {
 	REFRESH_VARIABLE_BOOL(session_idle_show_processlist);
 #endif // IDLE_THREADS
 	REFRESH_VARIABLE_INT(show_processlist_extended);
+	REFRESH_VARIABLE_INT(show_processlist_snapshot_ms);
 	REFRESH_VARIABLE_BOOL(servers_stats);
 	REFRESH_VARIABLE_BOOL(default_reconnect);
 	REFRESH_VARIABLE_BOOL(enable_client_deprecate_eof);
@@ -4468,6 +4700,13 @@ MySQL_Thread::MySQL_Thread() {
 	pthread_mutex_init(&thread_mutex,NULL);
 	my_idle_conns=NULL;
 	cached_connections=NULL;
+	pthread_mutex_init(&cached_connections_mutex,NULL);
+	cached_connections_avail=0;
+	cached_connections_shared=false;
+	pthread_mutex_init(&processlist_snapshot_mutex,NULL);
+	processlist_snapshot_time=0;
+	processlist_snapshot_read_time=0;
+	processlist_snapshot_extended=0;
 	mysql_sessions=NULL;
 	mirror_queue_mysql_sessions=NULL;
 	mirror_queue_mysql_sessions_cache=NULL;
@@ -4729,6 +4968,13 @@ SQLite3_result * MySQL_Threads_Handler::SQL3_GlobalStatus(bool _memory) {
 		pta[1]=buf;
 		result->add_row(pta);
 	}
+	{
+		// Connections created ahead of demand by mysql-connection_prewarm_ms
+		pta[0]=(char *)"Server_Connections_prewarmed";
+		sprintf(buf,"%lu",MyHGM->status.server_connections_prewarmed);
+		pta[1]=buf;
+		result->add_row(pta);
+	}
 #ifdef IDLE_THREADS
 	{	// Connections non idle
 		pta[0]=(char *)"Client_Connections_non_idle";
@@ -5046,9 +5292,333 @@ void MySQL_Threads_Handler::Get_Memory_Stats() {
 	}
 }
 
-SQLite3_result * MySQL_Threads_Handler::SQL3_Processlist() {
-	const int colnum=16;
-        char port[NI_MAXSERV];
+MySQL_Processlist_Snapshot::MySQL_Processlist_Snapshot() {
+	time=0;
+	extended=0;
+}
+
+void MySQL_Processlist_Snapshot::begin_row(uint32_t session_id, int hostgroup, bool sleeping) {
+	processlist_snapshot_row_t r;
+	r.session_id=session_id;
+	r.hostgroup=hostgroup;
+	r.sleeping=sleeping;
+	for (int k=0; k<PROCESSLIST_COLUMNS; k++) {
+		r.off[k]=UINT32_MAX;
+	}
+	rows.push_back(r);
+}
+
+void MySQL_Processlist_Snapshot::set(int col, const char *s, size_t len) {
+	rows.back().off[col]=data.size();
+	data.append(s, len);
+	data.push_back('\0');
+}
+
+void MySQL_Processlist_Snapshot::set(int col, const char *s) {
+	set(col, s, strlen(s));
+}
+
+/**
+ * @brief Adds to 'result' the rows of the sessions that match 'filter'.
+ *
+ * @param result The resultset with the columns of stats_mysql_processlist.
+ * @param thread_idx The value of the column ThreadID.
+ * @param filter Filter applied before creating the rows, can be NULL.
+ */
+void MySQL_Processlist_Snapshot::add_rows(SQLite3_result *result, unsigned int thread_idx, const processlist_filter_t *filter) {
+	char thr_buf[16];
+	char sess_buf[16];
+	const char *pta[PROCESSLIST_COLUMNS];
+	sprintf(thr_buf,"%u", thread_idx);
+	for (const processlist_snapshot_row_t& r : rows) {
+		if (filter) {
+			if (filter->session_id && filter->session_id != r.session_id) continue;
+			if (filter->hostgroup != INT_MIN && filter->hostgroup != r.hostgroup) continue;
+			if (filter->skip_sleeping && r.sleeping) continue;
+			if (filter->username && (r.off[2] == UINT32_MAX || strcmp(filter->username, data.c_str() + r.off[2]))) continue;
+		}
+		sprintf(sess_buf,"%u", r.session_id);
+		pta[0]=thr_buf;
+		pta[1]=sess_buf;
+		for (int k=2; k<PROCESSLIST_COLUMNS; k++) {
+			pta[k]=(r.off[k] == UINT32_MAX ? NULL : data.c_str() + r.off[k]);
+		}
+		result->add_row(pta);
+	}
+}
+
+/**
+ * @brief Copies the state of all the sessions of the thread in a compact snapshot.
+ * @details Requires 'thread_mutex', or to be called by the thread itself.
+ *
+ * @param snap The snapshot to fill.
+ * @param extended The value of 'show_processlist_extended' used for the column extended_info.
+ */
+void MySQL_Thread::build_processlist_snapshot(MySQL_Processlist_Snapshot& snap, int extended) {
+	char port[NI_MAXSERV];
+	snap.time=curtime;
+	snap.extended=extended;
+	for (unsigned int j=0; j<mysql_sessions->len; j++) {
+		MySQL_Session *sess=(MySQL_Session *)mysql_sessions->pdata[j];
+		if (sess->client_myds) {
+			char buf[1024];
+			bool sleeping=(sess->status==WAITING_CLIENT_DATA);
+			snap.begin_row(sess->thread_session_id, sess->current_hostgroup, sleeping);
+			MySQL_Connection_userinfo *ui=sess->client_myds->myconn->userinfo;
+			if (ui) {
+				if (ui->username) {
+					snap.set(2, ui->username);
+				} else {
+					snap.set(2, "unauthenticated user");
+				}
+				if (ui->schemaname) {
+					snap.set(3, ui->schemaname);
+				}
+			}
+
+			if (sess->mirror==false) {
+				switch (sess->client_myds->client_addr->sa_family) {
+					case AF_INET:
+						if (sess->client_myds->addr.addr != NULL) {
+							snap.set(4, sess->client_myds->addr.addr);
+							sprintf(port, "%d", sess->client_myds->addr.port);
+							snap.set(5, port);
+						} else {
+							struct sockaddr_in *ipv4 = (struct sockaddr_in *)sess->client_myds->client_addr;
+							inet_ntop(sess->client_myds->client_addr->sa_family, &ipv4->sin_addr, buf, INET_ADDRSTRLEN);
+							snap.set(4, buf);
+							sprintf(port, "%d", ntohs(ipv4->sin_port));
+							snap.set(5, port);
+						}
+						break;
+					case AF_INET6:
+						if (sess->client_myds->addr.addr != NULL) {
+							snap.set(4, sess->client_myds->addr.addr);
+							sprintf(port, "%d", sess->client_myds->addr.port);
+							snap.set(5, port);
+						} else {
+							struct sockaddr_in6 *ipv6 = (struct sockaddr_in6 *)sess->client_myds->client_addr;
+							inet_ntop(sess->client_myds->client_addr->sa_family, &ipv6->sin6_addr, buf, INET6_ADDRSTRLEN);
+							snap.set(4, buf);
+							sprintf(port, "%d", ntohs(ipv6->sin6_port));
+							snap.set(5, port);
+						}
+						break;
+					default:
+						snap.set(4, "localhost");
+						break;
+				}
+			} else {
+				snap.set(4, "mirror_internal");
+			}
+			sprintf(buf,"%d", sess->current_hostgroup);
+			snap.set(6, buf);
+			if (sess->mybe && sess->mybe->server_myds && sess->mybe->server_myds->myconn) {
+				MySQL_Connection *mc=sess->mybe->server_myds->myconn;
+
+
+				struct sockaddr addr;
+				socklen_t addr_len=sizeof(struct sockaddr);
+				memset(&addr,0,addr_len);
+				int rc;
+				rc=getsockname(mc->fd, &addr, &addr_len);
+				if (rc==0) {
+					switch (addr.sa_family) {
+						case AF_INET: {
+							struct sockaddr_in *ipv4 = (struct sockaddr_in *)&addr;
+							inet_ntop(addr.sa_family, &ipv4->sin_addr, buf, INET_ADDRSTRLEN);
+							snap.set(7, buf);
+							sprintf(port, "%d", ntohs(ipv4->sin_port));
+							snap.set(8, port);
+							break;
+							}
+						case AF_INET6: {
+							struct sockaddr_in6 *ipv6 = (struct sockaddr_in6 *)&addr;
+							inet_ntop(addr.sa_family, &ipv6->sin6_addr, buf, INET6_ADDRSTRLEN);
+							snap.set(7, buf);
+							sprintf(port, "%d", ntohs(ipv6->sin6_port));
+							snap.set(8, port);
+							break;
+							}
+						default:
+							snap.set(7, "localhost");
+							break;
+					}
+				}
+
+				sprintf(buf,"%s", mc->parent->address);
+				snap.set(9, buf);
+				sprintf(buf,"%d", mc->parent->port);
+				snap.set(10, buf);
+				if (sess->CurrentQuery.stmt_info==NULL) { // text protocol
+					if (mc->query.length) {
+						snap.set(13, mc->query.ptr, mc->query.length);
+					}
+				} else { // prepared statement
+					MySQL_STMT_Global_info *si=sess->CurrentQuery.stmt_info;
+					if (si->query_length) {
+						snap.set(13, si->query, si->query_length);
+					}
+				}
+				sprintf(buf,"%d", mc->status_flags);
+				snap.set(14, buf);
+			}
+			switch (sess->status) {
+				case CONNECTING_SERVER:
+					snap.set(11, "Connect");
+					break;
+				case PROCESSING_QUERY:
+					if (sess->pause_until > sess->thread->curtime) {
+						snap.set(11, "Delay");
+					} else {
+						snap.set(11, "Query");
+					}
+					break;
+				case WAITING_CLIENT_DATA:
+					snap.set(11, "Sleep");
+					break;
+				case CHANGING_USER_SERVER:
+                                                snap.set(11, "Changing user server");
+                                                break;
+				case CHANGING_USER_CLIENT:
+					snap.set(11, "Change user client");
+					break;
+				case RESETTING_CONNECTION:
+                                                snap.set(11, "Resetting connection");
+                                                break;
+				case CHANGING_SCHEMA:
+					snap.set(11, "InitDB");
+					break;
+				case PROCESSING_STMT_EXECUTE:
+					snap.set(11, "Execute");
+					break;
+				case PROCESSING_STMT_PREPARE:
+					snap.set(11, "Prepare");
+					break;
+				case CONNECTING_CLIENT:
+                                                snap.set(11, "Connecting client");
+                                                break;
+				case PINGING_SERVER:
+                                                snap.set(11, "Pinging server");
+                                                break;
+				case WAITING_SERVER_DATA:
+                                                snap.set(11, "Waiting server data");
+                                                break;
+				case CHANGING_CHARSET:
+                                                snap.set(11, "Changing charset");
+                                                break;
+				case CHANGING_AUTOCOMMIT:
+                                                snap.set(11, "Changing autocommit");
+                                                break;
+				case SETTING_INIT_CONNECT:
+                                                snap.set(11, "Setting init connect");
+                                                break;
+/*
+				case SETTING_SQL_LOG_BIN:
+                                                snap.set(11, "Set log bin");
+                                                break;
+				case SETTING_SQL_MODE:
+                                                snap.set(11, "Set SQL mode");
+                                                break;
+				case SETTING_TIME_ZONE:
+                                                snap.set(11, "Set TZ");
+                                                break;
+*/
+				case SETTING_VARIABLE:
+					{
+						int idx = sess->changing_variable_idx;
+						if (idx < SQL_NAME_LAST_HIGH_WM) {
+							char buf[128];
+							sprintf(buf, "Setting variable %s", mysql_tracked_variables[idx].set_variable_name);
+							snap.set(11, buf);
+						} else {
+							snap.set(11, "Setting variable");
+						}
+					}
+                                                break;
+				case FAST_FORWARD:
+                                                snap.set(11, "Fast forward");
+                                                break;
+				case session_status___NONE:
+                                                snap.set(11, "None");
+                                                break;
+				default:
+					sprintf(buf,"%d", sess->status);
+					snap.set(11, buf);
+					break;
+			}
+			if (sess->mirror==false) {
+				int idx=sess->client_myds->poll_fds_idx;
+				unsigned long long last_sent=sess->thread->mypolls.last_sent[idx];
+				unsigned long long last_recv=sess->thread->mypolls.last_recv[idx];
+				unsigned long long last_time=(last_sent > last_recv ? last_sent : last_recv);
+				if (last_time>sess->thread->curtime) {
+					last_time=sess->thread->curtime;
+				}
+				sprintf(buf,"%llu", (sess->thread->curtime - last_time)/1000 );
+			} else {
+				// for mirror session we only consider the start time
+				sprintf(buf,"%llu", (sess->thread->curtime - sess->start_time)/1000 );
+			}
+			snap.set(12, buf);
+			if (extended) {
+				json j;
+				sess->generate_proxysql_internal_session_json(j);
+				if (extended == 2) {
+					std::string s = j.dump(4, ' ', false, json::error_handler_t::replace);
+					snap.set(15, s.c_str());
+				} else {
+					std::string s = j.dump(-1, ' ', false, json::error_handler_t::replace);
+					snap.set(15, s.c_str());
+				}
+			}
+		}
+	}
+}
+
+/**
+ * @brief Publishes a snapshot of the processlist, if 'mysql-show_processlist_snapshot_ms' is elapsed
+ *  since the previous one and the processlist was read recently.
+ * @details The snapshot is built without locks, only the swap of the published snapshot is protected by
+ *  'processlist_snapshot_mutex'.
+ */
+void MySQL_Thread::run_PublishProcesslistSnapshot() {
+	if (processlist_snapshot_read_time.load(std::memory_order_relaxed) + PROCESSLIST_SNAPSHOT_IDLE_US < curtime) {
+		// nobody is reading the processlist
+		return;
+	}
+	if (curtime < processlist_snapshot_time + (unsigned long long)mysql_thread___show_processlist_snapshot_ms * 1000) {
+		return;
+	}
+	processlist_snapshot_time=curtime;
+	std::shared_ptr<MySQL_Processlist_Snapshot> snap = std::make_shared<MySQL_Processlist_Snapshot>();
+	build_processlist_snapshot(*snap, processlist_snapshot_extended.load(std::memory_order_relaxed));
+	pthread_mutex_lock(&processlist_snapshot_mutex);
+	processlist_snapshot.swap(snap);
+	pthread_mutex_unlock(&processlist_snapshot_mutex);
+	// the previous snapshot is freed here , outside the mutex , unless still in use by the reader
+}
+
+/**
+ * @brief Returns the snapshot published by the thread, if not older than 'max_age' microseconds and
+ *  built with the same 'extended'. Otherwise an empty pointer.
+ * @details Also notifies the thread that the processlist is being read, so that it keeps publishing it.
+ */
+std::shared_ptr<MySQL_Processlist_Snapshot> MySQL_Thread::get_processlist_snapshot(int extended, unsigned long long now, unsigned long long max_age) {
+	std::shared_ptr<MySQL_Processlist_Snapshot> snap {};
+	processlist_snapshot_read_time.store(now, std::memory_order_relaxed);
+	processlist_snapshot_extended.store(extended, std::memory_order_relaxed);
+	pthread_mutex_lock(&processlist_snapshot_mutex);
+	snap=processlist_snapshot;
+	pthread_mutex_unlock(&processlist_snapshot_mutex);
+	if (snap && (snap->extended != extended || snap->time + max_age < now)) {
+		snap.reset();
+	}
+	return snap;
+}
+
+SQLite3_result * MySQL_Threads_Handler::SQL3_Processlist(const processlist_filter_t *filter) {
+	const int colnum=PROCESSLIST_COLUMNS;
 	proxy_debug(PROXY_DEBUG_MYSQL_CONNECTION, 4, "Dumping MySQL Processlist\n");
 	SQLite3_result *result=new SQLite3_result(colnum);
 	result->add_column_definition(SQLITE_TEXT,"ThreadID");
@@ -5077,6 +5647,9 @@ SQLite3_result * MySQL_Threads_Handler::SQL3_Processlist() {
 	}
 #endif // IDLE_THREADS
 
+	int extended=mysql_thread___show_processlist_extended;
+	unsigned long long snapshot_us=(unsigned long long)variables.show_processlist_snapshot_ms * 1000;
+	unsigned long long now=monotonic_time();
 	for (i=0;i<i2;i++) {
 		MySQL_Thread *thr=NULL;
 		if (i<num_threads && mysql_threads) {
@@ -5089,260 +5662,19 @@ SQLite3_result * MySQL_Threads_Handler::SQL3_Processlist() {
 #endif // IDLE_THREADS
 		}
 		if (thr==NULL) break; // quick exit, at least one thread is not ready
-		pthread_mutex_lock(&thr->thread_mutex);
-		unsigned int j;
-		for (j=0; j<thr->mysql_sessions->len; j++) {
-			MySQL_Session *sess=(MySQL_Session *)thr->mysql_sessions->pdata[j];
-			if (sess->client_myds) {
-				char buf[1024];
-				char **pta=(char **)malloc(sizeof(char *)*colnum);
-				sprintf(buf,"%d", i);
-				pta[0]=strdup(buf);
-				sprintf(buf,"%u", sess->thread_session_id);
-				pta[1]=strdup(buf);
-				MySQL_Connection_userinfo *ui=sess->client_myds->myconn->userinfo;
-				pta[2]=NULL;
-				pta[3]=NULL;
-				if (ui) {
-					if (ui->username) {
-						pta[2]=strdup(ui->username);
-					} else {
-						pta[2]=strdup("unauthenticated user");
-					}
-					if (ui->schemaname) {
-						pta[3]=strdup(ui->schemaname);
-					}
-				}
-
-				if (sess->mirror==false) {
-					switch (sess->client_myds->client_addr->sa_family) {
-						case AF_INET:
-							if (sess->client_myds->addr.addr != NULL) {
-								pta[4] = strdup(sess->client_myds->addr.addr);
-								sprintf(port, "%d", sess->client_myds->addr.port);
-								pta[5] = strdup(port);
-							} else {
-								struct sockaddr_in *ipv4 = (struct sockaddr_in *)sess->client_myds->client_addr;
-								inet_ntop(sess->client_myds->client_addr->sa_family, &ipv4->sin_addr, buf, INET_ADDRSTRLEN);
-								pta[4] = strdup(buf);
-								sprintf(port, "%d", ntohs(ipv4->sin_port));
-								pta[5] = strdup(port);
-							}
-							break;
-						case AF_INET6:
-							if (sess->client_myds->addr.addr != NULL) {
-								pta[4] = strdup(sess->client_myds->addr.addr);
-								sprintf(port, "%d", sess->client_myds->addr.port);
-								pta[5] = strdup(port);
-							} else {
-								struct sockaddr_in6 *ipv6 = (struct sockaddr_in6 *)sess->client_myds->client_addr;
-								inet_ntop(sess->client_myds->client_addr->sa_family, &ipv6->sin6_addr, buf, INET6_ADDRSTRLEN);
-								pta[4] = strdup(buf);
-								sprintf(port, "%d", ntohs(ipv6->sin6_port));
-								pta[5] = strdup(port);
-							}
-							break;
-						default:
-							pta[4] = strdup("localhost");
-							pta[5] = NULL;
-							break;
-					}
-				} else {
-					pta[4] = strdup("mirror_internal");
-					pta[5] = NULL;
-				}
-				sprintf(buf,"%d", sess->current_hostgroup);
-				pta[6]=strdup(buf);
-				if (sess->mybe && sess->mybe->server_myds && sess->mybe->server_myds->myconn) {
-					MySQL_Connection *mc=sess->mybe->server_myds->myconn;
-
-
-					struct sockaddr addr;
-					socklen_t addr_len=sizeof(struct sockaddr);
-					memset(&addr,0,addr_len);
-					int rc;
-					rc=getsockname(mc->fd, &addr, &addr_len);
-					if (rc==0) {
-						switch (addr.sa_family) {
-							case AF_INET: {
-								struct sockaddr_in *ipv4 = (struct sockaddr_in *)&addr;
-								inet_ntop(addr.sa_family, &ipv4->sin_addr, buf, INET_ADDRSTRLEN);
-								pta[7] = strdup(buf);
-								sprintf(port, "%d", ntohs(ipv4->sin_port));
-								pta[8] = strdup(port);
-								break;
-								}
-							case AF_INET6: {
-								struct sockaddr_in6 *ipv6 = (struct sockaddr_in6 *)&addr;
-								inet_ntop(addr.sa_family, &ipv6->sin6_addr, buf, INET6_ADDRSTRLEN);
-								pta[7] = strdup(buf);
-								sprintf(port, "%d", ntohs(ipv6->sin6_port));
-								pta[8] = strdup(port);
-								break;
-								}
-							default:
-								pta[7] = strdup("localhost");
-								pta[8] = NULL;
-								break;
-						}
-					} else {
-						pta[7]=NULL;
-						pta[8]=NULL;
-					}
-
-					sprintf(buf,"%s", mc->parent->address);
-					pta[9]=strdup(buf);
-					sprintf(buf,"%d", mc->parent->port);
-					pta[10]=strdup(buf);
-					if (sess->CurrentQuery.stmt_info==NULL) { // text protocol
-						if (mc->query.length) {
-							pta[13]=(char *)malloc(mc->query.length+1);
-							strncpy(pta[13],mc->query.ptr,mc->query.length);
-							pta[13][mc->query.length]='\0';
-						} else {
-							pta[13]=NULL;
-						}
-					} else { // prepared statement
-						MySQL_STMT_Global_info *si=sess->CurrentQuery.stmt_info;
-						if (si->query_length) {
-							pta[13]=(char *)malloc(si->query_length+1);
-							strncpy(pta[13],si->query,si->query_length);
-							pta[13][si->query_length]='\0';
-						} else {
-							pta[13]=NULL;
-						}
-					}
-					sprintf(buf,"%d", mc->status_flags);
-					pta[14]=strdup(buf);
-				} else {
-					pta[7]=NULL;
-					pta[8]=NULL;
-					pta[9]=NULL;
-					pta[10]=NULL;
-					pta[13]=NULL;
-					pta[14]=NULL;
-				}
-				switch (sess->status) {
-					case CONNECTING_SERVER:
-						pta[11]=strdup("Connect");
-						break;
-					case PROCESSING_QUERY:
-						if (sess->pause_until > sess->thread->curtime) {
-							pta[11]=strdup("Delay");
-						} else {
-							pta[11]=strdup("Query");
-						}
-						break;
-					case WAITING_CLIENT_DATA:
-						pta[11]=strdup("Sleep");
-						break;
-					case CHANGING_USER_SERVER:
-                                                pta[11]=strdup("Changing user server");
-                                                break;
-					case CHANGING_USER_CLIENT:
-						pta[11]=strdup("Change user client");
-						break;
-					case RESETTING_CONNECTION:
-                                                pta[11]=strdup("Resetting connection");
-                                                break;
-					case CHANGING_SCHEMA:
-						pta[11]=strdup("InitDB");
-						break;
-					case PROCESSING_STMT_EXECUTE:
-						pta[11]=strdup("Execute");
-						break;
-					case PROCESSING_STMT_PREPARE:
-						pta[11]=strdup("Prepare");
-						break;
-					case CONNECTING_CLIENT:
-                                                pta[11]=strdup("Connecting client");
-                                                break;
-					case PINGING_SERVER:
-                                                pta[11]=strdup("Pinging server");
-                                                break;
-					case WAITING_SERVER_DATA:
-                                                pta[11]=strdup("Waiting server data");
-                                                break;
-					case CHANGING_CHARSET:
-                                                pta[11]=strdup("Changing charset");
-                                                break;
-					case CHANGING_AUTOCOMMIT:
-                                                pta[11]=strdup("Changing autocommit");
-                                                break;
-					case SETTING_INIT_CONNECT:
-                                                pta[11]=strdup("Setting init connect");
-                                                break;
-/*
-					case SETTING_SQL_LOG_BIN:
-                                                pta[11]=strdup("Set log bin");
-                                                break;
-					case SETTING_SQL_MODE:
-                                                pta[11]=strdup("Set SQL mode");
-                                                break;
-					case SETTING_TIME_ZONE:
-                                                pta[11]=strdup("Set TZ");
-                                                break;
-*/
-					case SETTING_VARIABLE:
-						{
-							int idx = sess->changing_variable_idx;
-							if (idx < SQL_NAME_LAST_HIGH_WM) {
-								char buf[128];
-								sprintf(buf, "Setting variable %s", mysql_tracked_variables[idx].set_variable_name);
-								pta[11]=strdup(buf);
-							} else {
-								pta[11]=strdup("Setting variable");
-							}
-						}
-                                                break;
-					case FAST_FORWARD:
-                                                pta[11]=strdup("Fast forward");
-                                                break;
-					case session_status___NONE:
-                                                pta[11]=strdup("None");
-                                                break;
-					default:
-						sprintf(buf,"%d", sess->status);
-						pta[11]=strdup(buf);
-						break;
-				}
-				if (sess->mirror==false) {
-					int idx=sess->client_myds->poll_fds_idx;
-					unsigned long long last_sent=sess->thread->mypolls.last_sent[idx];
-					unsigned long long last_recv=sess->thread->mypolls.last_recv[idx];
-					unsigned long long last_time=(last_sent > last_recv ? last_sent : last_recv);
-					if (last_time>sess->thread->curtime) {
-						last_time=sess->thread->curtime;
-					}
-					sprintf(buf,"%llu", (sess->thread->curtime - last_time)/1000 );
-				} else {
-					// for mirror session we only consider the start time
-					sprintf(buf,"%llu", (sess->thread->curtime - sess->start_time)/1000 );
-				}
-				pta[12]=strdup(buf);
-
-				pta[15]=NULL;
-				if (mysql_thread___show_processlist_extended) {
-					json j;
-					sess->generate_proxysql_internal_session_json(j);
-					if (mysql_thread___show_processlist_extended == 2) {
-						std::string s = j.dump(4, ' ', false, json::error_handler_t::replace);
-						pta[15] = strdup(s.c_str());
-					} else {
-						std::string s = j.dump(-1, ' ', false, json::error_handler_t::replace);
-						pta[15] = strdup(s.c_str());
-					}
-				}
-				result->add_row(pta);
-				unsigned int k;
-				for (k=0; k<colnum; k++) {
-					if (pta[k])
-						free(pta[k]);
-				}
-				free(pta);
-			}
+		std::shared_ptr<MySQL_Processlist_Snapshot> snap {};
+		if (snapshot_us) {
+			// a snapshot published by the thread is used if recent enough , without stopping the thread
+			snap=thr->get_processlist_snapshot(extended, now, 2*snapshot_us);
 		}
-		pthread_mutex_unlock(&thr->thread_mutex);
+		if (!snap) {
+			// the thread is stopped only to copy the state of the sessions: the rows are created after
+			snap=std::make_shared<MySQL_Processlist_Snapshot>();
+			pthread_mutex_lock(&thr->thread_mutex);
+			thr->build_processlist_snapshot(*snap, extended);
+			pthread_mutex_unlock(&thr->thread_mutex);
+		}
+		snap->add_rows(result, i, filter);
 	}
 	return result;
 }
@@ -5747,12 +6079,40 @@ MySQL_Connection * MySQL_Thread::get_MyConn_local(unsigned int _hid, MySQL_Sessi
 	if (sess->client_myds == NULL) return NULL;
 	if (sess->client_myds->myconn == NULL) return NULL;
 	if (sess->client_myds->myconn->userinfo == NULL) return NULL;
+	MySQL_Connection *c=NULL;
+	if (cached_connections_shared) {
+		pthread_mutex_lock(&cached_connections_mutex);
+		c=find_MyConn_in_cache(cached_connections, _hid, sess, gtid_uuid, gtid_trxid, max_lag_ms);
+		cached_connections_avail.store(cached_connections->len, std::memory_order_relaxed);
+		pthread_mutex_unlock(&cached_connections_mutex);
+	} else if (cached_connections->len) {
+		c=find_MyConn_in_cache(cached_connections, _hid, sess, gtid_uuid, gtid_trxid, max_lag_ms);
+	}
+	if (c == NULL && mysql_thread___connpool_thread_cache_size) {
+		c=steal_MyConn_from_threads(_hid, sess, gtid_uuid, gtid_trxid, max_lag_ms);
+	}
+	return c;
+}
+
+
+/**
+ * @brief Searches a connections cache for a connection matching the session.
+ *
+ * The caller must hold the mutex of the thread owning the cache. Connections to servers that are no
+ * longer ONLINE are skipped: they are returned to the global pool by return_local_connections() .
+ * Status variables are always updated on the calling thread, also when searching the cache of another
+ * thread.
+ *
+ * @param cache The connections cache to search, either 'cached_connections' of this thread or of another one.
+ * @return The matching connection, removed from the cache, or NULL.
+ */
+MySQL_Connection * MySQL_Thread::find_MyConn_in_cache(PtrArray *cache, unsigned int _hid, MySQL_Session *sess, char *gtid_uuid, uint64_t gtid_trxid, int max_lag_ms) {
 	unsigned int i;
 	std::vector<MySrvC *> parents; // this is a vector of srvers that needs to be excluded in case gtid_uuid is used
 	MySQL_Connection *c=NULL;
-	for (i=0; i<cached_connections->len; i++) {
-		c=(MySQL_Connection *)cached_connections->index(i);
-		if (c->parent->myhgc->hid==_hid && sess->client_myds->myconn->match_tracked_options(c)) { // options are all identical
+	for (i=0; i<cache->len; i++) {
+		c=(MySQL_Connection *)cache->index(i);
+		if (c->parent->myhgc->hid==_hid && c->parent->get_status()==MYSQL_SERVER_STATUS_ONLINE && sess->client_myds->myconn->match_tracked_options(c)) { // options are all identical
 			if (
 				(gtid_uuid == NULL) || // gtid_uuid is not used
 				(gtid_uuid && find(parents.begin(), parents.end(), c->parent) == parents.end()) // the server is currently not excluded
@@ -5774,7 +6134,7 @@ MySQL_Connection * MySQL_Thread::get_MyConn_local(unsigned int _hid, MySQL_Sessi
 									bool gtid_found = false;
 									gtid_found = MyHGM->gtid_exists(mysrvc, gtid_uuid, gtid_trxid);
 									if (gtid_found) { // this server has the correct GTID
-										c=(MySQL_Connection *)cached_connections->remove_index_fast(i);
+										c=(MySQL_Connection *)cache->remove_index_fast(i);
 										return c;
 									} else {
 										parents.push_back(mysrvc); // stop evaluating this server
@@ -5788,7 +6148,7 @@ MySQL_Connection * MySQL_Thread::get_MyConn_local(unsigned int _hid, MySQL_Sessi
 									}
 								}
 								// return the connection
-								c=(MySQL_Connection *)cached_connections->remove_index_fast(i);
+								c=(MySQL_Connection *)cache->remove_index_fast(i);
 								return c;
 							}
 						}
@@ -5801,6 +6161,54 @@ MySQL_Connection * MySQL_Thread::get_MyConn_local(unsigned int _hid, MySQL_Sessi
 }
 
 
+/**
+ * @brief Takes a matching connection from the connections cache of another worker thread.
+ *
+ * Used only if mysql-connpool_thread_cache_size is not 0 , when the local cache has no matching
+ * connection. Threads are visited starting from a random one; threads without available connections
+ * are skipped without locking, and a thread whose cache is busy is skipped, so that a worker never
+ * waits for another one. A thread being destroyed waits for 'cached_connections_stealers' to drop
+ * to 0 before destroying its cache.
+ *
+ * @return The matching connection, removed from the cache of the other thread, or NULL.
+ */
+MySQL_Connection * MySQL_Thread::steal_MyConn_from_threads(unsigned int _hid, MySQL_Session *sess, char *gtid_uuid, uint64_t gtid_trxid, int max_lag_ms) {
+	if (GloMTH == NULL || GloMTH->mysql_threads == NULL || __sync_fetch_and_add(&glovars.shutdown,0)) {
+		return NULL;
+	}
+	unsigned int n=GloMTH->num_threads;
+	if (n < 2) {
+		return NULL;
+	}
+	MySQL_Connection *c=NULL;
+	__sync_fetch_and_add(&cached_connections_stealers,1);
+	// workers are destroyed only after shutdown_ is set
+	if (GloMTH->is_shutting_down() == false) {
+		unsigned int w=rand()%n;
+		for (unsigned int j=0; j<n && c == NULL; j++) {
+			MySQL_Thread *thr=GloMTH->mysql_threads[(w+j)%n].worker;
+			if (thr == NULL || thr == this || thr->cached_connections_avail.load(std::memory_order_relaxed) == 0) {
+				continue;
+			}
+			if (pthread_mutex_trylock(&thr->cached_connections_mutex)) {
+				continue;
+			}
+			// the cache may have become private after the check without lock
+			if (thr->cached_connections_avail.load(std::memory_order_relaxed)) {
+				c=find_MyConn_in_cache(thr->cached_connections, _hid, sess, gtid_uuid, gtid_trxid, max_lag_ms);
+				thr->cached_connections_avail.store(thr->cached_connections->len, std::memory_order_relaxed);
+			}
+			pthread_mutex_unlock(&thr->cached_connections_mutex);
+			if (c) {
+				proxy_debug(PROXY_DEBUG_MYSQL_CONNPOOL, 7, "Thread %p took MySQL_Connection %p from the cache of thread %p\n", this, c, thr);
+			}
+		}
+	}
+	__sync_fetch_and_sub(&cached_connections_stealers,1);
+	return c;
+}
+
+
 /**
  * @brief Pushes a MySQL connection to the local connection pool.
  * 
@@ -5821,7 +6229,14 @@ void MySQL_Thread::push_MyConn_local(MySQL_Connection *c) {
 	c->mysql->insert_id = 0;
 	if (mysrvc->get_status() == MYSQL_SERVER_STATUS_ONLINE) {
 		if (c->async_state_machine==ASYNC_IDLE) {
-			cached_connections->add(c);
+			if (cached_connections_shared) {
+				pthread_mutex_lock(&cached_connections_mutex);
+				cached_connections->add(c);
+				cached_connections_avail.store(cached_connections->len, std::memory_order_relaxed);
+				pthread_mutex_unlock(&cached_connections_mutex);
+			} else {
+				cached_connections->add(c);
+			}
 			return; // all went well
 		}
 	}
@@ -5830,19 +6245,45 @@ void MySQL_Thread::push_MyConn_local(MySQL_Connection *c) {
 
 
 /**
- * @brief Returns all locally cached MySQL connections to the global connection pool.
+ * @brief Returns the locally cached MySQL connections to the global connection pool.
  * 
- * This function is responsible for returning all locally cached MySQL connections to the global connection pool.
+ * This function is responsible for returning the locally cached MySQL connections to the global connection pool.
  * It checks if there are any cached connections available, and if so, it pushes them back to the global connection pool
- * managed by MySQL_Host_Group_Manager. After returning the connections, it clears the local cached connections pool.
+ * managed by MySQL_Host_Group_Manager, and removes them from the local cached connections pool.
+ *
+ * With mysql-connpool_thread_cache_size , the most recently cached connections are kept in the cache across loops,
+ * where they can be reused by the next sessions of this thread or taken by other threads. The cache is shared
+ * with the other threads until the next call, and private to this thread if 'keep' is 0 .
+ *
+ * @param keep The number of connections to keep in the cache. 0 returns all the connections.
  */
-void MySQL_Thread::return_local_connections() {
-	if (cached_connections->len==0) {
+void MySQL_Thread::return_local_connections(unsigned int keep) {
+	bool shared=(keep > 0);
+	if (cached_connections_shared == false && shared == false && cached_connections->len == 0) {
 		return;
 	}
-	MyHGM->push_MyConn_to_pool_array((MySQL_Connection **)cached_connections->pdata, cached_connections->len);
-	while (cached_connections->len) {
-		cached_connections->remove_index_fast(0);
+	std::vector<MySQL_Connection *> conns;
+	if (cached_connections_shared || shared) {
+		pthread_mutex_lock(&cached_connections_mutex);
+	}
+	unsigned int len=cached_connections->len;
+	if (len > keep) {
+		unsigned int to_return=len-keep;
+		MySQL_Connection **pdata=(MySQL_Connection **)cached_connections->pdata;
+		conns.assign(pdata, pdata+to_return);
+		// removing from the highest index, remove_index_fast() only moves kept connections
+		for (int i=to_return-1; i>=0; i--) {
+			cached_connections->remove_index_fast(i);
+		}
+	}
+	if (cached_connections_shared || shared) {
+		cached_connections_avail.store(shared ? cached_connections->len : 0, std::memory_order_relaxed);
+		pthread_mutex_unlock(&cached_connections_mutex);
+	}
+	cached_connections_shared=shared;
+	// the global pool is locked only after releasing the mutex of the cache
+	if (conns.size()) {
+		MyHGM->push_MyConn_to_pool_array(conns.data(), conns.size());
 	}
 }
 
@@ -5994,7 +6435,7 @@ bool MySQL_Thread::set_backend_to_be_skipped_if_frontend_is_slow(MySQL_Data_Stre
 		// but assuming that client isn't completely blocked, we will stop checking for data
 		// only at mysql_thread___threshold_resultset_size * 4
 		if (buffered_data > overflow_safe_multiply<4,unsigned int>(mysql_thread___threshold_resultset_size)) {
-			mypolls.fds[n].events = 0;
+			mypolls.set_events(n, 0);
 			return true;
 		}
 	}
@@ -6182,9 +6623,10 @@ void MySQL_Thread::configure_pollout(MySQL_Data_Stream *myds, unsigned int n) {
 		myds->set_pollout();
 	} else {
 		if (myds->DSS > STATE_MARIADB_BEGIN && myds->DSS < STATE_MARIADB_END) {
-			mypolls.fds[n].events = POLLIN;
+			short events = POLLIN;
 			if (mypolls.myds[n]->myconn->async_exit_status & MYSQL_WAIT_WRITE)
-				mypolls.fds[n].events |= POLLOUT;
+				events |= POLLOUT;
+			mypolls.set_events(n, events);
 		} else {
 			myds->set_pollout();
 		}
@@ -6195,7 +6637,7 @@ void MySQL_Thread::configure_pollout(MySQL_Data_Stream *myds, unsigned int n) {
 		}
 		if (myds->myds_type==MYDS_BACKEND) {
 			if (mysql_thread___throttle_ratio_server_to_client) {
-				mypolls.fds[n].events = 0;
+				mypolls.set_events(n, 0);
 			}
 		}
 	}
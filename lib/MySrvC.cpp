@@ -29,6 +29,9 @@ MySrvC::MySrvC(
 	queries_sent=0;
 	bytes_sent=0;
 	bytes_recv=0;
+	queries_in_flight=0;
+	latency_ewma_us=0;
+	latency_ewma_updated_at=0;
 	max_connections_used=0;
 	queries_gtid_sync=0;
 	time_last_detected_error=0;
@@ -39,7 +42,7 @@ MySrvC::MySrvC(
 	myhgc=NULL;
 	comment=strdup(_comment);
 	ConnectionsUsed=new MySrvConnList(this);
-	ConnectionsFree=new MySrvConnList(this);
+	ConnectionsFree=new MySrvConnList(this, true);
 }
 
 void MySrvC::connect_error(int err_num, bool get_mutex) {
@@ -130,6 +133,46 @@ void MySrvC::connect_error(int err_num, bool get_mutex) {
 	}
 }
 
+// time after which an idle peak EWMA is halved
+#define LATENCY_EWMA_DECAY_US	1000000
+
+/**
+ * @brief Updates the peak EWMA of the query latency with a new sample.
+ *
+ * A sample higher than the average replaces it immediately, while lower samples are averaged with a weight
+ * of 1/8 . Like the other counters of MySrvC it is updated without any mutex: a lost update is not relevant.
+ *
+ * @param latency_us The latency of a query, in microseconds.
+ * @param curtime The current monotonic time, in microseconds.
+ */
+void MySrvC::update_latency_ewma(unsigned long long latency_us, unsigned long long curtime) {
+	unsigned int ewma = get_latency_ewma_us(curtime);
+	if (latency_us > UINT_MAX) {
+		latency_us = UINT_MAX;
+	}
+	if (latency_us >= ewma) {
+		ewma = latency_us;
+	} else {
+		ewma -= (ewma - latency_us) >> 3;
+	}
+	latency_ewma_us = ewma;
+	latency_ewma_updated_at = curtime;
+}
+
+/**
+ * @brief Returns the peak EWMA of the query latency, decayed if the server didn't complete queries recently.
+ * @details The decay prevents a server from being excluded forever by LB_PEAK_EWMA after a latency spike.
+ */
+unsigned int MySrvC::get_latency_ewma_us(unsigned long long curtime) {
+	unsigned int ewma = latency_ewma_us;
+	unsigned long long updated_at = latency_ewma_updated_at;
+	if (ewma && curtime > updated_at + LATENCY_EWMA_DECAY_US) {
+		unsigned long long halvings = (curtime - updated_at) / LATENCY_EWMA_DECAY_US;
+		ewma = (halvings >= 32 ? 0 : ewma >> halvings);
+	}
+	return ewma;
+}
+
 void MySrvC::shun_and_killall() {
 	status=MYSQL_SERVER_STATUS_SHUNNED;
 	shunned_automatic=true;
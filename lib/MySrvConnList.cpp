@@ -17,17 +17,78 @@ MySQL_Connection *MySrvConnList::index(unsigned int _k) {
 	return (MySQL_Connection *)conns->index(_k);
 }
 
+void MySrvConnList::remove(MySQL_Connection *c) {
+	int i = -1;
+	i = (indexed ? (int)c->pool_index.idx : find_idx(c));
+	assert(i>=0);
+	remove(i);
+}
+
 MySQL_Connection * MySrvConnList::remove(int _k) {
-	return (MySQL_Connection *)conns->remove_index_fast(_k);
+	MySQL_Connection *c=(MySQL_Connection *)conns->remove_index_fast(_k);
+	if (indexed) {
+		index_remove(c);
+		if ((unsigned int)_k < conns->len) {
+			// remove_index_fast() moved the last connection into position _k
+			MySQL_Connection *moved=(MySQL_Connection *)conns->index(_k);
+			moved->pool_index.idx=_k;
+		}
+	}
+	return c;
 }
 
-MySrvConnList::MySrvConnList(MySrvC *_mysrvc) {
+MySrvConnList::MySrvConnList(MySrvC *_mysrvc, bool _indexed) {
 	mysrvc=_mysrvc;
+	indexed=_indexed;
 	conns=new PtrArray();
 }
 
 void MySrvConnList::add(MySQL_Connection *c) {
 	conns->add(c);
+	if (indexed) {
+		c->pool_index.idx=conns->len-1;
+		index_add(c);
+	}
+}
+
+/**
+ * @brief Adds a connection in front of the list of connections with the same fingerprint.
+ *
+ * The fingerprint is computed only here: a free connection isn't modified while it is in the list.
+ */
+void MySrvConnList::index_add(MySQL_Connection *c) {
+	uint64_t fp=c->get_pool_fingerprint();
+	c->pool_index.fingerprint=fp;
+	c->pool_index.prev=NULL;
+	c->pool_index.next=NULL;
+	std::unordered_map<uint64_t, MySQL_Connection *>::iterator it=fingerprints.find(fp);
+	if (it==fingerprints.end()) {
+		fingerprints.emplace(fp,c);
+	} else {
+		c->pool_index.next=it->second;
+		it->second->pool_index.prev=c;
+		it->second=c;
+	}
+}
+
+void MySrvConnList::index_remove(MySQL_Connection *c) {
+	MySQL_Connection *prev=c->pool_index.prev;
+	MySQL_Connection *next=c->pool_index.next;
+	if (next) {
+		next->pool_index.prev=prev;
+	}
+	if (prev) {
+		prev->pool_index.next=next;
+	} else {
+		// the connection is the first one with this fingerprint
+		if (next) {
+			fingerprints[c->pool_index.fingerprint]=next;
+		} else {
+			fingerprints.erase(c->pool_index.fingerprint);
+		}
+	}
+	c->pool_index.prev=NULL;
+	c->pool_index.next=NULL;
 }
 
 MySrvConnList::~MySrvConnList() {
@@ -36,6 +97,7 @@ MySrvConnList::~MySrvConnList() {
 		MySQL_Connection *conn=(MySQL_Connection *)conns->remove_index_fast(0);
 		delete conn;
 	}
+	fingerprints.clear();
 	delete conns;
 }
 
@@ -45,6 +107,7 @@ void MySrvConnList::drop_all_connections() {
 		MySQL_Connection *conn=(MySQL_Connection *)conns->remove_index_fast(0);
 		delete conn;
 	}
+	fingerprints.clear();
 }
 
 void MySrvConnList::get_random_MyConn_inner_search(unsigned int start, unsigned int end, unsigned int& conn_found_idx, unsigned int& connection_quality_level, unsigned int& number_of_matching_session_variables, const MySQL_Connection * client_conn) {
@@ -111,6 +174,37 @@ void MySrvConnList::get_random_MyConn_inner_search(unsigned int start, unsigned
 }
 
 
+/**
+ * @brief Finds in O(1) a connection that doesn't require CHANGE_USER, SET statements or INIT_DB.
+ *
+ * Only the connections with the same fingerprint of the client connection are verified, see
+ * MySQL_Connection::get_pool_fingerprint() .
+ *
+ * @param client_conn The client connection.
+ * @param number_of_matching_session_variables Set to the number of matching session variables and schema, if found.
+ * @return The index of the connection in 'conns', or -1 if not found.
+ */
+int MySrvConnList::find_perfect_MyConn_idx(const MySQL_Connection *client_conn, unsigned int& number_of_matching_session_variables) {
+	if (indexed == false || fingerprints.empty()) {
+		return -1;
+	}
+	std::unordered_map<uint64_t, MySQL_Connection *>::iterator it=fingerprints.find(client_conn->get_pool_fingerprint());
+	if (it==fingerprints.end()) {
+		return -1;
+	}
+	char *schema = client_conn->userinfo->schemaname;
+	for (MySQL_Connection *conn=it->second; conn; conn=conn->pool_index.next) {
+		if (conn->match_tracked_options(client_conn) && conn->requires_CHANGE_USER(client_conn)==false) {
+			unsigned int not_match = 0; // number of not matching session variables
+			unsigned int cnt_match = conn->number_of_matching_session_variables(client_conn, not_match);
+			if (not_match==0 && strcmp(conn->userinfo->schemaname,schema)==0) {
+				number_of_matching_session_variables = cnt_match + 1;
+				return (int)conn->pool_index.idx;
+			}
+		}
+	}
+	return -1;
+}
 
 MySQL_Connection * MySrvConnList::get_random_MyConn(MySQL_Session *sess, bool ff) {
 	MySQL_Connection * conn=NULL;
@@ -147,9 +241,15 @@ MySQL_Connection * MySrvConnList::get_random_MyConn(MySQL_Session *sess, bool ff
 		}
 		if (sess && sess->client_myds && sess->client_myds->myconn && sess->client_myds->myconn->userinfo) {
 			MySQL_Connection * client_conn = sess->client_myds->myconn;
-			get_random_MyConn_inner_search(i, l, conn_found_idx, connection_quality_level, number_of_matching_session_variables, client_conn);
-			if (connection_quality_level !=3 ) { // we didn't find the perfect connection
-				get_random_MyConn_inner_search(0, i, conn_found_idx, connection_quality_level, number_of_matching_session_variables, client_conn);
+			int perfect_idx = find_perfect_MyConn_idx(client_conn, number_of_matching_session_variables);
+			if (perfect_idx >= 0) {
+				conn_found_idx = perfect_idx;
+				connection_quality_level = 3;
+			} else {
+				get_random_MyConn_inner_search(i, l, conn_found_idx, connection_quality_level, number_of_matching_session_variables, client_conn);
+				if (connection_quality_level !=3 ) { // we didn't find the perfect connection
+					get_random_MyConn_inner_search(0, i, conn_found_idx, connection_quality_level, number_of_matching_session_variables, client_conn);
+				}
 			}
 			// connection_quality_level:
 			// 1 : tracked options are OK , but CHANGE USER is required
@@ -188,6 +288,9 @@ MySQL_Connection * MySrvConnList::get_random_MyConn(MySQL_Session *sess, bool ff
 						// if attributes.multiplex == true , STATUS_MYSQL_CONNECTION_NO_MULTIPLEX_HG is set to false. And vice-versa
 						conn->set_status(!conn->parent->myhgc->attributes.multiplex, STATUS_MYSQL_CONNECTION_NO_MULTIPLEX_HG);
 						__sync_fetch_and_add(&MyHGM->status.server_connections_created, 1);
+						if (mysql_thread___connection_prewarm_ms) {
+							mysrvc->myhgc->record_connection_demand(sess);
+						}
 						proxy_debug(PROXY_DEBUG_MYSQL_CONNPOOL, 7, "Returning MySQL Connection %p, server %s:%d\n", conn, conn->parent->address, conn->parent->port);
 					}
 					break;
@@ -202,16 +305,19 @@ MySQL_Connection * MySrvConnList::get_random_MyConn(MySQL_Session *sess, bool ff
 						// if attributes.multiplex == true , STATUS_MYSQL_CONNECTION_NO_MULTIPLEX_HG is set to false. And vice-versa
 						conn->set_status(!conn->parent->myhgc->attributes.multiplex, STATUS_MYSQL_CONNECTION_NO_MULTIPLEX_HG);
 						__sync_fetch_and_add(&MyHGM->status.server_connections_created, 1);
+						if (mysql_thread___connection_prewarm_ms) {
+							mysrvc->myhgc->record_connection_demand(sess);
+						}
 						proxy_debug(PROXY_DEBUG_MYSQL_CONNPOOL, 7, "Returning MySQL Connection %p, server %s:%d\n", conn, conn->parent->address, conn->parent->port);
 					} else {
-						conn=(MySQL_Connection *)conns->remove_index_fast(conn_found_idx);
+						conn=remove(conn_found_idx);
 					}
 					}
 					break;
 				case 2: // tracked options are OK , CHANGE USER is not required, but some SET statement or INIT_DB needs to be executed
 				case 3: // tracked options are OK , CHANGE USER is not required, and it seems that SET statements or INIT_DB ARE not required
 					// here we return the best connection we have, no matter if connection_quality_level is 2 or 3
-					conn=(MySQL_Connection *)conns->remove_index_fast(conn_found_idx);
+					conn=remove(conn_found_idx);
 					break;
 				default: // this should never happen
 					// LCOV_EXCL_START
@@ -220,7 +326,14 @@ MySQL_Connection * MySrvConnList::get_random_MyConn(MySQL_Session *sess, bool ff
 					// LCOV_EXCL_STOP
 			}
 		} else {
-			conn=(MySQL_Connection *)conns->remove_index_fast(i);
+			conn=remove(i);
+		}
+		if (conn->prewarmed) {
+			// the first use of a pre-warmed connection counts as demand, or pre-warming would stop itself
+			conn->prewarmed = false;
+			if (mysql_thread___connection_prewarm_ms) {
+				mysrvc->myhgc->record_connection_demand(sess);
+			}
 		}
 		proxy_debug(PROXY_DEBUG_MYSQL_CONNPOOL, 7, "Returning MySQL Connection %p, server %s:%d\n", conn, conn->parent->address, conn->parent->port);
 		return conn;
@@ -247,6 +360,9 @@ MySQL_Connection * MySrvConnList::get_random_MyConn(MySQL_Session *sess, bool ff
 			// if attributes.multiplex == true , STATUS_MYSQL_CONNECTION_NO_MULTIPLEX_HG is set to false. And vice-versa
 			conn->set_status(!conn->parent->myhgc->attributes.multiplex, STATUS_MYSQL_CONNECTION_NO_MULTIPLEX_HG);
 			__sync_fetch_and_add(&MyHGM->status.server_connections_created, 1);
+			if (mysql_thread___connection_prewarm_ms) {
+				_myhgc->record_connection_demand(sess);
+			}
 			proxy_debug(PROXY_DEBUG_MYSQL_CONNPOOL, 7, "Returning MySQL Connection %p, server %s:%d\n", conn, conn->parent->address, conn->parent->port);
 			return  conn;
 		}
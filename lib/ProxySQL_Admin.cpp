@@ -618,6 +618,7 @@ static char * admin_variables_names[]= {
 	(char *)"read_only",
 //	(char *)"hash_passwords",
 	(char *)"vacuum_stats",
+	(char *)"stats_virtual_tables",
 	(char *)"version",
 	(char *)"cluster_username",
 	(char *)"cluster_password",
@@ -3369,11 +3370,13 @@ bool ProxySQL_Admin::GenericRefreshStatistics(const char *query_no_space, unsign
 		//pthread_mutex_lock(&admin_mutex);
 		//ProxySQL_Admin *SPA=(ProxySQL_Admin *)pa;
 		if (stats_mysql_processlist)
-			stats___mysql_processlist();
+			stats___mysql_processlist(query_no_space);
+		// with 'admin-stats_virtual_tables' the virtual tables read the runtime structures directly
+		bool vtabs = variables.stats_virtual_tables;
 		if (stats_mysql_query_digest_reset) {
-			stats___mysql_query_digests_v2(true, stats_mysql_query_digest, false);
+			stats___mysql_query_digests_v2(true, (vtabs ? false : stats_mysql_query_digest), false);
 		} else {
-			if (stats_mysql_query_digest) {
+			if (stats_mysql_query_digest && vtabs == false) {
 				stats___mysql_query_digests_v2(false, false, false);
 			}
 		}
@@ -3385,12 +3388,12 @@ bool ProxySQL_Admin::GenericRefreshStatistics(const char *query_no_space, unsign
 		if (stats_mysql_connection_pool_reset) {
 			stats___mysql_connection_pool(true);
 		} else {
-			if (stats_mysql_connection_pool)
+			if (stats_mysql_connection_pool && vtabs == false)
 				stats___mysql_connection_pool(false);
 		}
 		if (stats_mysql_free_connections)
 			stats___mysql_free_connections();
-		if (stats_mysql_global)
+		if (stats_mysql_global && vtabs == false)
 			stats___mysql_global();
 		if (stats_memory_metrics)
 			stats___memory_metrics();
@@ -3947,7 +3950,9 @@ void admin_session_handler(MySQL_Session *sess, void *_pa, PtrSize_t *pkt) {
 				}
 				if (truncate_digest_table==true) {
 					ProxySQL_Admin *SPA=(ProxySQL_Admin *)pa;
-					SPA->admindb->execute("DELETE FROM stats.stats_mysql_query_digest");
+					if (SPA->variables.stats_virtual_tables == false) {
+						SPA->admindb->execute("DELETE FROM stats.stats_mysql_query_digest");
+					}
 					SPA->admindb->execute("DELETE FROM stats.stats_mysql_query_digest_reset");
 					SPA->vacuum_stats(true);
 					// purge the digest map, asynchronously, in single thread
@@ -5513,6 +5518,9 @@ void ProxySQL_Admin::vacuum_stats(bool is_admin) {
 		tmpdb = statsdb;
 	}
 	for (auto it = tablenames.begin(); it != tablenames.end(); it++) {
+		if (variables.stats_virtual_tables && proxysql_stats_vtab_supported(it->c_str())) {
+			continue;
+		}
 		s = "DELETE FROM ";
 		if (is_admin == true) s+= "stats.";
 		s += *it;
@@ -6002,6 +6010,7 @@ ProxySQL_Admin::ProxySQL_Admin() :
 	variables.mysql_show_processlist_extended = false;
 //	variables.hash_passwords=true;	// issue #676
 	variables.vacuum_stats=true;	// issue #1011
+	variables.stats_virtual_tables=false;
 	variables.admin_read_only=false;	// by default, the admin interface accepts writes
 	variables.admin_version=(char *)PROXYSQL_VERSION;
 	variables.cluster_username=strdup((char *)"");
@@ -6454,6 +6463,9 @@ bool ProxySQL_Admin::init(const bootstrap_info_t& bootstrap_info) {
 	//sqlite3_auto_extension( (void(*)(void))sqlite3_json_init);
 	statsdb=new SQLite3DB();
 	statsdb->open((char *)"file:mem_statsdb?mode=memory&cache=shared", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_FULLMUTEX);
+	// the stats virtual tables are read from both connections, see 'admin-stats_virtual_tables'
+	proxysql_stats_vtab_register(statsdb);
+	proxysql_stats_vtab_register(admindb);
 
 	// check if file exists , see #617
 	bool admindb_file_exists=Proxy_file_exists(GloVars.admindb);
@@ -7087,6 +7099,46 @@ void ProxySQL_Admin::check_and_build_standard_tables(SQLite3DB *db, std::vector<
 
 
 
+const char * ProxySQL_Admin::get_stats_table_def(const char *table_name) {
+	for (std::vector<table_def_t *>::iterator it=tables_defs_stats->begin(); it!=tables_defs_stats->end(); ++it) {
+		if (strcmp((*it)->table_name, table_name) == 0) {
+			return (*it)->table_def;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * @brief Replaces the stats tables supported by the module PROXYSQL_STATS_VTAB_MODULE with virtual tables,
+ *  or restores the regular tables.
+ * @param enable The new value of 'admin-stats_virtual_tables'.
+ * @return false if virtual tables aren't supported by the loaded SQLite3.
+ */
+bool ProxySQL_Admin::set_stats_virtual_tables(bool enable) {
+	if (enable && proxy_sqlite3_create_module_v2 == NULL) {
+		proxy_error("admin-stats_virtual_tables requires SQLite3 virtual tables, not available in the loaded SQLite3 plugin\n");
+		return false;
+	}
+	if (enable == variables.stats_virtual_tables) {
+		return true;
+	}
+	for (std::vector<table_def_t *>::iterator it=tables_defs_stats->begin(); it!=tables_defs_stats->end(); ++it) {
+		table_def_t *td=*it;
+		if (proxysql_stats_vtab_supported(td->table_name) == false) {
+			continue;
+		}
+		if (enable) {
+			std::string vtab_def = std::string("CREATE VIRTUAL TABLE ") + td->table_name + " USING " + PROXYSQL_STATS_VTAB_MODULE;
+			statsdb->build_table(td->table_name, (char *)vtab_def.c_str(), true);
+		} else {
+			statsdb->build_table(td->table_name, td->table_def, true);
+		}
+	}
+	variables.stats_virtual_tables = enable;
+	proxy_info("Stats virtual tables %s\n", (enable ? "enabled" : "disabled"));
+	return true;
+}
+
 void ProxySQL_Admin::insert_into_tables_defs(std::vector<table_def_t *> *tables_defs, const char *table_name, const char *table_def) {
 	table_def_t *td = new table_def_t;
 	td->table_name=strdup(table_name);
@@ -8523,6 +8575,9 @@ char * ProxySQL_Admin::get_variable(char *name) {
 	if (!strcasecmp(name,"vacuum_stats")) {
 		return strdup((variables.vacuum_stats ? "true" : "false"));
 	}
+	if (!strcasecmp(name,"stats_virtual_tables")) {
+		return strdup((variables.stats_virtual_tables ? "true" : "false"));
+	}
 	if (!strcasecmp(name,"checksum_mysql_query_rules")) {
 		return strdup((checksum_variables.checksum_mysql_query_rules ? "true" : "false"));
 	}
@@ -9016,6 +9071,15 @@ bool ProxySQL_Admin::set_variable(char *name, char *value, bool lock) {  // this
 		}
 		return false;
 	}
+	if (!strcasecmp(name,"stats_virtual_tables")) {
+		if (strcasecmp(value,"true")==0 || strcasecmp(value,"1")==0) {
+			return set_stats_virtual_tables(true);
+		}
+		if (strcasecmp(value,"false")==0 || strcasecmp(value,"0")==0) {
+			return set_stats_virtual_tables(false);
+		}
+		return false;
+	}
 	if (!strcasecmp(name,"restapi_enabled")) {
 		if (strcasecmp(value,"true")==0 || strcasecmp(value,"1")==0) {
 			variables.restapi_enabled=true;
@@ -9717,39 +9781,22 @@ void ProxySQL_Admin::p_update_stmt_metrics() {
 	}
 }
 
-void ProxySQL_Admin::stats___mysql_global() {
-	if (!GloMTH) return;
-	SQLite3_result * resultset=GloMTH->SQL3_GlobalStatus(true);
-	if (resultset==NULL) return;
-	statsdb->execute("BEGIN");
-	statsdb->execute("DELETE FROM stats_mysql_global");
-	char *a=(char *)"INSERT INTO stats_mysql_global VALUES (\"%s\",\"%s\")";
-	for (std::vector<SQLite3_row *>::iterator it = resultset->rows.begin() ; it != resultset->rows.end(); ++it) {
-		SQLite3_row *r=*it;
-		int arg_len=0;
-		for (int i=0; i<2; i++) {
-			arg_len+=strlen(r->fields[i]);
-		}
-		char *query=(char *)malloc(strlen(a)+arg_len+32);
-		sprintf(query,a,r->fields[0],r->fields[1]);
-		statsdb->execute(query);
-		free(query);
-	}
-	delete resultset;
-	resultset=NULL;
+/**
+ * @brief Collects the rows of 'stats_mysql_global' from the modules.
+ * @return A resultset with the columns 'Variable_Name' and 'Variable_Value', or NULL if the MySQL
+ *  module is not running. Shared by stats___mysql_global() and the 'stats_mysql_global' virtual table.
+ */
+SQLite3_result * ProxySQL_Admin::SQL3_mysql_global() {
+	if (!GloMTH) return NULL;
+	SQLite3_result * result=GloMTH->SQL3_GlobalStatus(true);
+	if (result==NULL) return NULL;
+	SQLite3_result * resultset=NULL;
 
 	resultset=MyHGM->SQL3_Get_ConnPool_Stats();
 	if (resultset) {
 		for (std::vector<SQLite3_row *>::iterator it = resultset->rows.begin() ; it != resultset->rows.end(); ++it) {
 			SQLite3_row *r=*it;
-			int arg_len=0;
-			for (int i=0; i<2; i++) {
-				arg_len+=strlen(r->fields[i]);
-			}
-			char *query=(char *)malloc(strlen(a)+arg_len+32);
-			sprintf(query,a,r->fields[0],r->fields[1]);
-			statsdb->execute(query);
-			free(query);
+			result->add_row(r->fields[0], r->fields[1], NULL);
 		}
 		delete resultset;
 		resultset=NULL;
@@ -9759,22 +9806,12 @@ void ProxySQL_Admin::stats___mysql_global() {
 	int current;
 	(*proxy_sqlite3_status)(SQLITE_STATUS_MEMORY_USED, &current, &highwater, 0);
 	char bu[32];
-	char *vn=NULL;
-	char *query=NULL;
-	vn=(char *)"SQLite3_memory_bytes";
 	sprintf(bu,"%d",current);
-	query=(char *)malloc(strlen(a)+strlen(vn)+strlen(bu)+16);
-	sprintf(query,a,vn,bu);
-	statsdb->execute(query);
-	free(query);
+	result->add_row("SQLite3_memory_bytes", bu, NULL);
 
 	unsigned long long connpool_mem=MyHGM->Get_Memory_Stats();
-	vn=(char *)"ConnPool_memory_bytes";
 	sprintf(bu,"%llu",connpool_mem);
-	query=(char *)malloc(strlen(a)+strlen(vn)+strlen(bu)+16);
-	sprintf(query,a,vn,bu);
-	statsdb->execute(query);
-	free(query);
+	result->add_row("ConnPool_memory_bytes", bu, NULL);
 
 	if (GloMyStmt) {
 		uint64_t stmt_client_active_unique = 0;
@@ -9784,55 +9821,24 @@ void ProxySQL_Admin::stats___mysql_global() {
 		uint64_t stmt_server_active_unique = 0;
 		uint64_t stmt_server_active_total = 0;
 		GloMyStmt->get_metrics(&stmt_client_active_unique,&stmt_client_active_total,&stmt_max_stmt_id,&stmt_cached,&stmt_server_active_unique,&stmt_server_active_total);
-		vn=(char *)"Stmt_Client_Active_Total";
 		sprintf(bu,"%lu",stmt_client_active_total);
-		query=(char *)malloc(strlen(a)+strlen(vn)+strlen(bu)+16);
-		sprintf(query,a,vn,bu);
-		statsdb->execute(query);
-		free(query);
-		vn=(char *)"Stmt_Client_Active_Unique";
+		result->add_row("Stmt_Client_Active_Total", bu, NULL);
 		sprintf(bu,"%lu",stmt_client_active_unique);
-		query=(char *)malloc(strlen(a)+strlen(vn)+strlen(bu)+16);
-		sprintf(query,a,vn,bu);
-		statsdb->execute(query);
-		free(query);
-		vn=(char *)"Stmt_Server_Active_Total";
+		result->add_row("Stmt_Client_Active_Unique", bu, NULL);
 		sprintf(bu,"%lu",stmt_server_active_total);
-		query=(char *)malloc(strlen(a)+strlen(vn)+strlen(bu)+16);
-		sprintf(query,a,vn,bu);
-		statsdb->execute(query);
-		free(query);
-		vn=(char *)"Stmt_Server_Active_Unique";
+		result->add_row("Stmt_Server_Active_Total", bu, NULL);
 		sprintf(bu,"%lu",stmt_server_active_unique);
-		query=(char *)malloc(strlen(a)+strlen(vn)+strlen(bu)+16);
-		sprintf(query,a,vn,bu);
-		statsdb->execute(query);
-		free(query);
-		vn=(char *)"Stmt_Max_Stmt_id";
+		result->add_row("Stmt_Server_Active_Unique", bu, NULL);
 		sprintf(bu,"%lu",stmt_max_stmt_id);
-		query=(char *)malloc(strlen(a)+strlen(vn)+strlen(bu)+16);
-		sprintf(query,a,vn,bu);
-		statsdb->execute(query);
-		free(query);
-		vn=(char *)"Stmt_Cached";
+		result->add_row("Stmt_Max_Stmt_id", bu, NULL);
 		sprintf(bu,"%lu",stmt_cached);
-		query=(char *)malloc(strlen(a)+strlen(vn)+strlen(bu)+16);
-		sprintf(query,a,vn,bu);
-		statsdb->execute(query);
-		free(query);
+		result->add_row("Stmt_Cached", bu, NULL);
 	}
 
 	if (GloQC && (resultset=GloQC->SQL3_getStats())) {
 		for (std::vector<SQLite3_row *>::iterator it = resultset->rows.begin() ; it != resultset->rows.end(); ++it) {
 			SQLite3_row *r=*it;
-			int arg_len=0;
-			for (int i=0; i<2; i++) {
-				arg_len+=strlen(r->fields[i]);
-			}
-			char *query=(char *)malloc(strlen(a)+arg_len+32);
-			sprintf(query,a,r->fields[0],r->fields[1]);
-			statsdb->execute(query);
-			free(query);
+			result->add_row(r->fields[0], r->fields[1], NULL);
 		}
 		delete resultset;
 		resultset=NULL;
@@ -9843,14 +9849,7 @@ void ProxySQL_Admin::stats___mysql_global() {
 		if (resultset) {
 			for (std::vector<SQLite3_row *>::iterator it = resultset->rows.begin() ; it != resultset->rows.end(); ++it) {
 				SQLite3_row *r=*it;
-				int arg_len=0;
-				for (int i=0; i<2; i++) {
-					arg_len+=strlen(r->fields[i]);
-				}
-				char *query=(char *)malloc(strlen(a)+arg_len+32);
-				sprintf(query,a,r->fields[0],r->fields[1]);
-				statsdb->execute(query);
-				free(query);
+				result->add_row(r->fields[0], r->fields[1], NULL);
 			}
 			delete resultset;
 			resultset=NULL;
@@ -9859,29 +9858,172 @@ void ProxySQL_Admin::stats___mysql_global() {
 
 	if (GloQPro) {
 		unsigned long long mu = GloQPro->get_new_req_conns_count();
-		vn=(char *)"new_req_conns_count";
 		sprintf(bu,"%llu",mu);
-		query=(char *)malloc(strlen(a)+strlen(vn)+strlen(bu)+16);
-		sprintf(query,a,vn,bu);
-		statsdb->execute(query);
-		free(query);
+		result->add_row("new_req_conns_count", bu, NULL);
 	}
-	{
-		vn=(char *)"mysql_listener_paused";
-		sprintf(bu, "%s", ( proxysql_mysql_paused==true ? "true" : "false") );
-		query=(char *)malloc(strlen(a)+strlen(vn)+strlen(bu)+16);
-		sprintf(query,a,vn,bu);
+	result->add_row("mysql_listener_paused", (proxysql_mysql_paused==true ? "true" : "false"), NULL);
+	return result;
+}
+
+void ProxySQL_Admin::stats___mysql_global() {
+	SQLite3_result * resultset=SQL3_mysql_global();
+	if (resultset==NULL) return;
+	statsdb->execute("BEGIN");
+	statsdb->execute("DELETE FROM stats_mysql_global");
+	char *a=(char *)"INSERT INTO stats_mysql_global VALUES (\"%s\",\"%s\")";
+	for (std::vector<SQLite3_row *>::iterator it = resultset->rows.begin() ; it != resultset->rows.end(); ++it) {
+		SQLite3_row *r=*it;
+		int arg_len=0;
+		for (int i=0; i<2; i++) {
+			arg_len+=strlen(r->fields[i]);
+		}
+		char *query=(char *)malloc(strlen(a)+arg_len+32);
+		sprintf(query,a,r->fields[0],r->fields[1]);
 		statsdb->execute(query);
 		free(query);
 	}
 	statsdb->execute("COMMIT");
+	delete resultset;
+}
+
+/**
+ * @brief Lowercases a query and replaces the content of its quoted strings and identifiers with '_', so
+ *  that keywords and separators can be searched without matching the text of a literal.
+ * @details The quotes are kept, and a doubled quote inside a literal is part of the literal. The masked
+ *  query has the same length of the original, so positions found in one are valid in the other.
+ *
+ * @param q The query.
+ * @param masked The masked query.
+ * @return false if a literal isn't terminated or contains a backslash, whose meaning is ambiguous.
+ */
+static bool processlist_mask_quoted(const std::string& q, std::string& masked) {
+	masked=q;
+	char quote=0;
+	for (size_t i=0; i<masked.size(); i++) {
+		char c=masked[i];
+		if (quote == 0) {
+			if (c == '\'' || c == '"' || c == '`') {
+				quote=c;
+			} else {
+				masked[i]=::tolower(c);
+			}
+			continue;
+		}
+		if (c == '\\') {
+			return false;
+		}
+		if (c == quote) {
+			if (i+1 < masked.size() && masked[i+1] == quote) {
+				masked[i]='_';
+				masked[++i]='_';
+			} else {
+				quote=0;
+			}
+			continue;
+		}
+		masked[i]='_';
+	}
+	return (quote == 0);
 }
 
-void ProxySQL_Admin::stats___mysql_processlist() {
+/**
+ * @brief Extracts from a query on stats_mysql_processlist the conditions that can be applied before the
+ *  rows are created.
+ * @details Only simple queries are considered: a single table, and a WHERE clause without OR, NOT or
+ *  parentheses. The terms ANDed in the WHERE clause that match one of the supported conditions are
+ *  extracted, the other ones are ignored: as SQLite evaluates again the whole WHERE clause, the filter
+ *  only needs to never exclude a row that the query would return. Keywords and separators are searched
+ *  outside of the quoted strings, see processlist_mask_quoted().
+ *
+ * @param query The query, with the whitespaces already normalized.
+ * @param filter The filter to fill.
+ * @param username Storage for the username referenced by 'filter'.
+ * @return true if at least a condition was extracted.
+ */
+static bool processlist_filter_from_query(const char *query, processlist_filter_t& filter, std::string& username) {
+	filter.session_id=0;
+	filter.hostgroup=INT_MIN;
+	filter.username=NULL;
+	filter.skip_sleeping=false;
+	if (query == NULL) {
+		return false;
+	}
+	std::string q { query };
+	std::string lq {};
+	if (processlist_mask_quoted(q, lq) == false) {
+		return false;
+	}
+	size_t from=lq.find(" from ");
+	if (from == std::string::npos || lq.find(" from ", from+1) != std::string::npos) {
+		return false;
+	}
+	if (lq.find(" union ") != std::string::npos || lq.find(" join ") != std::string::npos) {
+		return false;
+	}
+	size_t where=lq.find(" where ", from);
+	if (where == std::string::npos) {
+		return false;
+	}
+	std::string table=lq.substr(from+6, where-from-6);
+	if (table != "stats_mysql_processlist" && table != "stats.stats_mysql_processlist") {
+		return false;
+	}
+	size_t end=lq.size();
+	for (const char *kw : { " group by ", " order by ", " limit ", " having ", ";" }) {
+		size_t pos=lq.find(kw, where);
+		if (pos != std::string::npos && pos < end) {
+			end=pos;
+		}
+	}
+	std::string cond=q.substr(where+7, end-where-7);
+	std::string lcond=lq.substr(where+7, end-where-7);
+	if (lcond.find(" or ") != std::string::npos || lcond.find(" not ") != std::string::npos || lcond.find('(') != std::string::npos) {
+		return false;
+	}
+	// column names are case insensitive, while values are compared as SQLite does
+	re2::RE2::Options opts = re2::RE2::Options(RE2::Quiet);
+	re2::RE2 re_hostgroup("\\s*(?i:hostgroup)\\s*=\\s*(-?\\d+)\\s*", opts);
+	re2::RE2 re_session("\\s*(?i:sessionid)\\s*=\\s*(\\d+)\\s*", opts);
+	re2::RE2 re_user("\\s*(?i:user)\\s*=\\s*'([^']*)'\\s*", opts);
+	re2::RE2 re_sleep("\\s*(?i:command)\\s*(?:!=|<>)\\s*'Sleep'\\s*", opts);
+	bool found=false;
+	size_t pos=0;
+	while (pos <= cond.size()) {
+		size_t next=lcond.find(" and ", pos);
+		if (next == std::string::npos) {
+			next=cond.size();
+		}
+		std::string term=cond.substr(pos, next-pos);
+		int hg;
+		unsigned int sid;
+		std::string user;
+		if (re2::RE2::FullMatch(term, re_hostgroup, &hg)) {
+			filter.hostgroup=hg;
+			found=true;
+		} else if (re2::RE2::FullMatch(term, re_session, &sid)) {
+			filter.session_id=sid;
+			found=true;
+		} else if (re2::RE2::FullMatch(term, re_user, &user)) {
+			username=user;
+			filter.username=username.c_str();
+			found=true;
+		} else if (re2::RE2::FullMatch(term, re_sleep)) {
+			filter.skip_sleeping=true;
+			found=true;
+		}
+		pos=next+5;
+	}
+	return found;
+}
+
+void ProxySQL_Admin::stats___mysql_processlist(const char *query_no_space) {
 	int rc;
 	if (!GloMTH) return;
 	mysql_thread___show_processlist_extended = variables.mysql_show_processlist_extended;
-	SQLite3_result * resultset=GloMTH->SQL3_Processlist();
+	processlist_filter_t filter;
+	std::string filter_username {};
+	bool use_filter=processlist_filter_from_query(query_no_space, filter, filter_username);
+	SQLite3_result * resultset=GloMTH->SQL3_Processlist(use_filter ? &filter : NULL);
 	if (resultset==NULL) return;
 
 	sqlite3_stmt *statement1=NULL;
@@ -10013,9 +10155,20 @@ void ProxySQL_Admin::stats___mysql_connection_pool(bool _reset) {
 	if (!MyHGM) return;
 	SQLite3_result * resultset=MyHGM->SQL3_Connection_Pool(_reset);
 	if (resultset==NULL) return;
+	// with 'admin-stats_virtual_tables' only the reset table is a regular table
+	bool vtab = variables.stats_virtual_tables;
 	statsdb->execute("BEGIN");
-	statsdb->execute("DELETE FROM stats_mysql_connection_pool");
-	char *a=(char *)"INSERT INTO stats_mysql_connection_pool VALUES (\"%s\",\"%s\",\"%s\",\"%s\",\"%s\",\"%s\",\"%s\",\"%s\",\"%s\",\"%s\",\"%s\",\"%s\",\"%s\",\"%s\")";
+	if (vtab) {
+		statsdb->execute("DELETE FROM stats_mysql_connection_pool_reset");
+	} else {
+		statsdb->execute("DELETE FROM stats_mysql_connection_pool");
+	}
+	char *a=NULL;
+	if (vtab) {
+		a=(char *)"INSERT INTO stats_mysql_connection_pool_reset VALUES (\"%s\",\"%s\",\"%s\",\"%s\",\"%s\",\"%s\",\"%s\",\"%s\",\"%s\",\"%s\",\"%s\",\"%s\",\"%s\",\"%s\")";
+	} else {
+		a=(char *)"INSERT INTO stats_mysql_connection_pool VALUES (\"%s\",\"%s\",\"%s\",\"%s\",\"%s\",\"%s\",\"%s\",\"%s\",\"%s\",\"%s\",\"%s\",\"%s\",\"%s\",\"%s\")";
+	}
 	for (std::vector<SQLite3_row *>::iterator it = resultset->rows.begin() ; it != resultset->rows.end(); ++it) {
 		SQLite3_row *r=*it;
 		int arg_len=0;
@@ -10027,7 +10180,7 @@ void ProxySQL_Admin::stats___mysql_connection_pool(bool _reset) {
 		statsdb->execute(query);
 		free(query);
 	}
-	if (_reset) {
+	if (_reset && vtab == false) {
 		statsdb->execute("DELETE FROM stats_mysql_connection_pool_reset");
 		statsdb->execute("INSERT INTO stats_mysql_connection_pool_reset SELECT * FROM stats_mysql_connection_pool");
 	}
@@ -10343,6 +10496,10 @@ int ProxySQL_Admin::stats___save_mysql_query_digest_to_sqlite(
 	const bool reset, const bool copy, const SQLite3_result *resultset, const umap_query_digest *digest_umap,
 	const umap_query_digest_text *digest_text_umap
 ) {
+	if (reset == false && variables.stats_virtual_tables) {
+		// 'stats_mysql_query_digest' is a virtual table reading the digests map
+		return resultset ? resultset->rows_count : digest_umap->size();
+	}
 	statsdb->execute("BEGIN");
 	int rc;
 	sqlite3_stmt *statement1=NULL;
@@ -10351,7 +10508,9 @@ int ProxySQL_Admin::stats___save_mysql_query_digest_to_sqlite(
 	char *query32=NULL;
 	std::string query32s = "";
 	statsdb->execute("DELETE FROM stats_mysql_query_digest_reset");
-	statsdb->execute("DELETE FROM stats_mysql_query_digest");
+	if (variables.stats_virtual_tables == false) {
+		statsdb->execute("DELETE FROM stats_mysql_query_digest");
+	}
 	if (reset) {
 		query1=(char *)"INSERT INTO stats_mysql_query_digest_reset VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9, ?10, ?11, ?12, ?13, ?14)";
 		query32s = "INSERT INTO stats_mysql_query_digest_reset VALUES " + generate_multi_rows_query(32,14);
@@ -10451,7 +10610,7 @@ int ProxySQL_Admin::stats___save_mysql_query_digest_to_sqlite(
 	(*proxy_sqlite3_finalize)(statement1);
 	(*proxy_sqlite3_finalize)(statement32);
 	if (reset) {
-		if (copy) {
+		if (copy && variables.stats_virtual_tables == false) {
 			statsdb->execute("INSERT INTO stats_mysql_query_digest SELECT * FROM stats_mysql_query_digest_reset");
 		}
 	}
@@ -10469,6 +10628,12 @@ int ProxySQL_Admin::stats___mysql_query_digests(bool reset, bool copy) {
 		resultset=GloQPro->get_query_digests();
 	}
 	if (resultset==NULL) return 0;
+	if (reset == false && variables.stats_virtual_tables) {
+		// 'stats_mysql_query_digest' is a virtual table reading the digests map
+		int num_rows = resultset->rows_count;
+		delete resultset;
+		return num_rows;
+	}
 	statsdb->execute("BEGIN");
 	int rc;
 	sqlite3_stmt *statement1=NULL;
@@ -10479,7 +10644,9 @@ int ProxySQL_Admin::stats___mysql_query_digests(bool reset, bool copy) {
 	std::string query32s = "";
 	// ALWAYS delete from both tables
 	statsdb->execute("DELETE FROM stats_mysql_query_digest_reset");
-	statsdb->execute("DELETE FROM stats_mysql_query_digest");
+	if (variables.stats_virtual_tables == false) {
+		statsdb->execute("DELETE FROM stats_mysql_query_digest");
+	}
 
 	if (reset) {
 		query1=(char *)"INSERT INTO stats_mysql_query_digest_reset VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9, ?10, ?11, ?12, ?13, ?14)";
@@ -10546,7 +10713,7 @@ int ProxySQL_Admin::stats___mysql_query_digests(bool reset, bool copy) {
 	(*proxy_sqlite3_finalize)(statement32);
 
 	if (reset) {
-		if (copy) {
+		if (copy && variables.stats_virtual_tables == false) {
 			statsdb->execute("INSERT INTO stats_mysql_query_digest SELECT * FROM stats_mysql_query_digest_reset");
 		}
 	}
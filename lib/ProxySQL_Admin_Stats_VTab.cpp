@@ -0,0 +1,487 @@
+#include "MySQL_HostGroups_Manager.h"
+#include "proxysql_admin.h"
+#include "query_processor.h"
+#include "proxysql.h"
+#include "cpp.h"
+
+#include <string>
+#include <vector>
+
+/**
+ * @file ProxySQL_Admin_Stats_VTab.cpp
+ * @brief SQLite virtual tables reading the stats directly from the runtime structures.
+ * @details With 'admin-stats_virtual_tables=true' the tables 'stats_mysql_query_digest',
+ *  'stats_mysql_connection_pool' and 'stats_mysql_global' are virtual tables of the module
+ *  PROXYSQL_STATS_VTAB_MODULE. They aren't refreshed by GenericRefreshStatistics() anymore: the rows are
+ *  produced while SQLite scans the table, without DELETE and INSERT of all the entries.
+ *
+ *  The equality constraints on some columns, and LIMIT when SQLite passes it, are applied by the
+ *  virtual table before the rows reach SQLite:
+ *  - stats_mysql_query_digest : the digests map is read in place, see Query_Processor::get_query_digests_snapshot().
+ *    Filters on hostgroup, schemaname, username, client_address and digest.
+ *  - stats_mysql_connection_pool : filters on hostgroup, passed to MySQL_HostGroups_Manager::SQL3_Connection_Pool().
+ *  - stats_mysql_global : filters on Variable_Name.
+ *
+ *  The tables are read-only.
+ */
+
+extern ProxySQL_Admin *GloAdmin;
+extern Query_Processor *GloQPro;
+
+// bits of 'idxNum' for LIMIT and OFFSET, the lower bits are the columns with an equality constraint
+#define STATS_VTAB_IDX_LIMIT	(1 << 24)
+#define STATS_VTAB_IDX_OFFSET	(1 << 25)
+
+/**
+ * @brief An equality constraint applied by the virtual table.
+ */
+typedef struct {
+	int col;
+	sqlite3_int64 i;
+	std::string s;
+} stats_vtab_constraint_t;
+
+/**
+ * @brief The rows of a stats virtual table.
+ */
+class Stats_VTab_Rows {
+	public:
+	virtual ~Stats_VTab_Rows() {}
+	/**
+	 * @brief Moves to the next row. The first call moves to the first row.
+	 * @return false when there are no more rows.
+	 */
+	virtual bool next() = 0;
+	virtual sqlite3_int64 get_int(int col) = 0;
+	virtual const char * get_text(int col) = 0;
+};
+
+/**
+ * @brief Rows of a resultset already built by a module.
+ */
+class Stats_VTab_Resultset : public Stats_VTab_Rows {
+	private:
+	SQLite3_result *resultset;
+	int idx;
+	public:
+	Stats_VTab_Resultset(SQLite3_result *r) : resultset(r), idx(-1) {}
+	~Stats_VTab_Resultset() {
+		if (resultset) {
+			delete resultset;
+		}
+	}
+	bool next() {
+		if (resultset == NULL) {
+			return false;
+		}
+		idx++;
+		return idx < (int)resultset->rows.size();
+	}
+	sqlite3_int64 get_int(int col) {
+		const char *v = resultset->rows[idx]->fields[col];
+		return v ? atoll(v) : 0;
+	}
+	const char * get_text(int col) {
+		return resultset->rows[idx]->fields[col];
+	}
+};
+
+/**
+ * @brief Rows of 'stats_mysql_query_digest', read from the digests map without copying them.
+ */
+class Stats_VTab_Query_Digest : public Stats_VTab_Rows {
+	private:
+	const umap_query_digest *digest_umap;
+	const umap_query_digest_text *digest_text_umap;
+	umap_query_digest::const_iterator it;
+	bool started;
+	QP_query_digest_stats *qds;
+	// converts the monotonic times of first_seen and last_seen into seconds since epoch
+	time_t seen_base;
+	char digest[24];
+	public:
+	Stats_VTab_Query_Digest() : started(false), qds(NULL) {
+		std::pair<const umap_query_digest *, const umap_query_digest_text *> snapshot = GloQPro->get_query_digests_snapshot();
+		digest_umap = snapshot.first;
+		digest_text_umap = snapshot.second;
+		time_t __now;
+		time(&__now);
+		seen_base = __now - monotonic_time()/1000000;
+	}
+	~Stats_VTab_Query_Digest() {
+		GloQPro->release_query_digests_snapshot();
+	}
+	bool next() {
+		if (started == false) {
+			it = digest_umap->begin();
+			started = true;
+		} else {
+			++it;
+		}
+		if (it == digest_umap->end()) {
+			qds = NULL;
+			return false;
+		}
+		qds = (QP_query_digest_stats *)it->second;
+		return true;
+	}
+	sqlite3_int64 get_int(int col) {
+		switch (col) {
+			case 0: return qds->hid;
+			case 6: return qds->count_star;
+			case 7: return seen_base + qds->first_seen/1000000;
+			case 8: return seen_base + qds->last_seen/1000000;
+			case 9: return qds->sum_time;
+			case 10: return qds->min_time;
+			case 11: return qds->max_time;
+			case 12: return qds->rows_affected;
+			case 13: return qds->rows_sent;
+			default: return 0;
+		}
+	}
+	const char * get_text(int col) {
+		switch (col) {
+			case 1: return qds->schemaname;
+			case 2: return qds->username;
+			case 3: return qds->client_address;
+			case 4:
+				sprintf(digest, "0x%016llX", (long long unsigned int)qds->digest);
+				return digest;
+			case 5: return qds->get_digest_text(digest_text_umap);
+			default: return NULL;
+		}
+	}
+};
+
+static Stats_VTab_Rows * stats_vtab_open_query_digest(const std::vector<stats_vtab_constraint_t>& constraints) {
+	if (GloQPro == NULL) {
+		return new Stats_VTab_Resultset(NULL);
+	}
+	return new Stats_VTab_Query_Digest();
+}
+
+static Stats_VTab_Rows * stats_vtab_open_connection_pool(const std::vector<stats_vtab_constraint_t>& constraints) {
+	if (MyHGM == NULL) {
+		return new Stats_VTab_Resultset(NULL);
+	}
+	for (const stats_vtab_constraint_t& c : constraints) {
+		if (c.col == 0) {
+			int hid = c.i;
+			return new Stats_VTab_Resultset(MyHGM->SQL3_Connection_Pool(false, &hid));
+		}
+	}
+	return new Stats_VTab_Resultset(MyHGM->SQL3_Connection_Pool(false));
+}
+
+static Stats_VTab_Rows * stats_vtab_open_global(const std::vector<stats_vtab_constraint_t>& constraints) {
+	return new Stats_VTab_Resultset(GloAdmin->SQL3_mysql_global());
+}
+
+typedef struct {
+	const char *table_name;
+	// type of every column: 'I' returned as integer, 'T' as text
+	const char *columns;
+	// columns whose equality constraints are applied by the virtual table
+	uint32_t filter_columns;
+	Stats_VTab_Rows * (*open)(const std::vector<stats_vtab_constraint_t>& constraints);
+} stats_vtab_def_t;
+
+static const stats_vtab_def_t stats_vtab_defs[] = {
+	{ "stats_mysql_query_digest", "ITTTTTIIIIIIII", 0x1F, stats_vtab_open_query_digest },
+	{ "stats_mysql_connection_pool", "ITITIIIIIIIIII", 0x01, stats_vtab_open_connection_pool },
+	{ "stats_mysql_global", "TT", 0x01, stats_vtab_open_global },
+};
+
+static const stats_vtab_def_t * stats_vtab_find(const char *table_name) {
+	for (const stats_vtab_def_t& def : stats_vtab_defs) {
+		if (strcmp(def.table_name, table_name) == 0) {
+			return &def;
+		}
+	}
+	return NULL;
+}
+
+typedef struct {
+	sqlite3_vtab base;
+	const stats_vtab_def_t *def;
+} stats_vtab_t;
+
+struct stats_vtab_cursor_t {
+	sqlite3_vtab_cursor base;
+	const stats_vtab_def_t *def;
+	Stats_VTab_Rows *rows;
+	std::vector<stats_vtab_constraint_t> constraints;
+	// maximum number of rows to return, -1 for no limit
+	sqlite3_int64 max_rows;
+	sqlite3_int64 rownum;
+	bool eof;
+};
+
+static int stats_vtab_connect(sqlite3 *db, void *aux, int argc, const char * const *argv, sqlite3_vtab **vtab, char **err) {
+	// argv[2] is the name of the table
+	const stats_vtab_def_t *def = (argc >= 3 ? stats_vtab_find(argv[2]) : NULL);
+	const char *table_def = (def ? GloAdmin->get_stats_table_def(def->table_name) : NULL);
+	if (table_def == NULL) {
+		return SQLITE_ERROR;
+	}
+	int rc = (*proxy_sqlite3_declare_vtab)(db, table_def);
+	if (rc != SQLITE_OK) {
+		return rc;
+	}
+	stats_vtab_t *v = (stats_vtab_t *)calloc(1, sizeof(stats_vtab_t));
+	v->def = def;
+	*vtab = &v->base;
+	return SQLITE_OK;
+}
+
+static int stats_vtab_disconnect(sqlite3_vtab *vtab) {
+	free(vtab);
+	return SQLITE_OK;
+}
+
+static int stats_vtab_best_index(sqlite3_vtab *vtab, sqlite3_index_info *info) {
+	const stats_vtab_def_t *def = ((stats_vtab_t *)vtab)->def;
+	int col_constraint[32];
+	int limit = -1;
+	int offset = -1;
+	bool all_handled = true;
+	uint32_t idx_num = 0;
+	for (int i=0; i<32; i++) {
+		col_constraint[i] = -1;
+	}
+	for (int i=0; i<info->nConstraint; i++) {
+		const struct sqlite3_index_info::sqlite3_index_constraint& c = info->aConstraint[i];
+		if (c.usable == 0) {
+			all_handled = false;
+			continue;
+		}
+		if (c.op == SQLITE_INDEX_CONSTRAINT_LIMIT) {
+			limit = i;
+			continue;
+		}
+		if (c.op == SQLITE_INDEX_CONSTRAINT_OFFSET) {
+			offset = i;
+			continue;
+		}
+		if (c.op == SQLITE_INDEX_CONSTRAINT_EQ && c.iColumn >= 0 && (def->filter_columns & (1u << c.iColumn))
+			&& col_constraint[c.iColumn] == -1) {
+			const char *coll = (*proxy_sqlite3_vtab_collation)(info, i);
+			// text columns are compared as BINARY
+			if (def->columns[c.iColumn] == 'I' || coll == NULL || strcasecmp(coll, "BINARY") == 0) {
+				col_constraint[c.iColumn] = i;
+				idx_num |= (1u << c.iColumn);
+				continue;
+			}
+		}
+		all_handled = false;
+	}
+	// the arguments of xFilter follow the order of the columns
+	int argv_index = 0;
+	for (int col=0; col<32; col++) {
+		if (col_constraint[col] >= 0) {
+			info->aConstraintUsage[col_constraint[col]].argvIndex = ++argv_index;
+			info->aConstraintUsage[col_constraint[col]].omit = 1;
+		}
+	}
+	// LIMIT is used only if all the WHERE terms are applied here and SQLite doesn't need to sort the rows,
+	// otherwise the virtual table could stop before returning some of the rows needed.
+	// SQLite still applies LIMIT and OFFSET itself, so the rows are only capped at LIMIT+OFFSET.
+	if (limit >= 0 && all_handled && info->nOrderBy == 0) {
+		info->aConstraintUsage[limit].argvIndex = ++argv_index;
+		idx_num |= STATS_VTAB_IDX_LIMIT;
+		if (offset >= 0) {
+			info->aConstraintUsage[offset].argvIndex = ++argv_index;
+			idx_num |= STATS_VTAB_IDX_OFFSET;
+		}
+	}
+	info->idxNum = idx_num;
+	int filters = __builtin_popcount(idx_num & 0xFFFFFF);
+	info->estimatedCost = 1000000.0 / (1 + 10*filters);
+	info->estimatedRows = 1000000 / (1 + 10*filters);
+	return SQLITE_OK;
+}
+
+static int stats_vtab_open(sqlite3_vtab *vtab, sqlite3_vtab_cursor **cursor) {
+	stats_vtab_cursor_t *c = new stats_vtab_cursor_t();
+	c->def = ((stats_vtab_t *)vtab)->def;
+	c->rows = NULL;
+	c->max_rows = -1;
+	c->rownum = 0;
+	c->eof = true;
+	*cursor = &c->base;
+	return SQLITE_OK;
+}
+
+static int stats_vtab_close(sqlite3_vtab_cursor *cursor) {
+	stats_vtab_cursor_t *c = (stats_vtab_cursor_t *)cursor;
+	if (c->rows) {
+		delete c->rows;
+	}
+	delete c;
+	return SQLITE_OK;
+}
+
+/**
+ * @brief Checks the current row against the equality constraints.
+ */
+static bool stats_vtab_match(stats_vtab_cursor_t *c) {
+	for (const stats_vtab_constraint_t& f : c->constraints) {
+		if (c->def->columns[f.col] == 'I') {
+			if (c->rows->get_int(f.col) != f.i) {
+				return false;
+			}
+		} else {
+			const char *v = c->rows->get_text(f.col);
+			if (v == NULL || f.s != v) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+static int stats_vtab_next(sqlite3_vtab_cursor *cursor) {
+	stats_vtab_cursor_t *c = (stats_vtab_cursor_t *)cursor;
+	if (c->max_rows >= 0 && c->rownum >= c->max_rows) {
+		c->eof = true;
+		return SQLITE_OK;
+	}
+	while ((c->eof = !c->rows->next()) == false) {
+		if (stats_vtab_match(c)) {
+			c->rownum++;
+			break;
+		}
+	}
+	return SQLITE_OK;
+}
+
+/**
+ * @brief Converts the right side of an equality on an integer column as SQLite does.
+ * @return false if the value can't be equal to any integer.
+ */
+static bool stats_vtab_value_to_int(sqlite3_value *v, sqlite3_int64& i) {
+	int type = (*proxy_sqlite3_value_numeric_type)(v);
+	if (type == SQLITE_INTEGER) {
+		i = (*proxy_sqlite3_value_int64)(v);
+		return true;
+	}
+	if (type == SQLITE_FLOAT) {
+		double d = (*proxy_sqlite3_value_double)(v);
+		if (d >= -9.2e18 && d <= 9.2e18 && d == (double)(sqlite3_int64)d) {
+			i = (sqlite3_int64)d;
+			return true;
+		}
+	}
+	return false;
+}
+
+static int stats_vtab_filter(sqlite3_vtab_cursor *cursor, int idx_num, const char *idx_str, int argc, sqlite3_value **argv) {
+	stats_vtab_cursor_t *c = (stats_vtab_cursor_t *)cursor;
+	if (c->rows) {
+		delete c->rows;
+		c->rows = NULL;
+	}
+	c->constraints.clear();
+	c->max_rows = -1;
+	c->rownum = 0;
+	c->eof = true;
+	bool no_rows = false;
+	int a = 0;
+	for (int col=0; col<24 && a<argc; col++) {
+		if ((idx_num & (1 << col)) == 0) {
+			continue;
+		}
+		sqlite3_value *v = argv[a++];
+		stats_vtab_constraint_t f { col, 0, "" };
+		if (c->def->columns[col] == 'I') {
+			if (stats_vtab_value_to_int(v, f.i) == false) {
+				no_rows = true;
+			}
+		} else {
+			const unsigned char *s = NULL;
+			if ((*proxy_sqlite3_value_type)(v) != SQLITE_NULL) {
+				s = (*proxy_sqlite3_value_text)(v);
+			}
+			if (s == NULL) {
+				no_rows = true;
+			} else {
+				f.s = (const char *)s;
+			}
+		}
+		c->constraints.push_back(f);
+	}
+	if ((idx_num & STATS_VTAB_IDX_LIMIT) && a < argc) {
+		sqlite3_int64 limit = (*proxy_sqlite3_value_int64)(argv[a++]);
+		sqlite3_int64 offset = 0;
+		if ((idx_num & STATS_VTAB_IDX_OFFSET) && a < argc) {
+			offset = (*proxy_sqlite3_value_int64)(argv[a++]);
+		}
+		// a negative LIMIT means no limit
+		if (limit >= 0) {
+			c->max_rows = limit + (offset > 0 ? offset : 0);
+		}
+	}
+	if (no_rows || c->max_rows == 0) {
+		// a NULL or a value not comparable with the column: nothing to read
+		return SQLITE_OK;
+	}
+	c->rows = c->def->open(c->constraints);
+	return stats_vtab_next(cursor);
+}
+
+static int stats_vtab_eof(sqlite3_vtab_cursor *cursor) {
+	return ((stats_vtab_cursor_t *)cursor)->eof;
+}
+
+static int stats_vtab_column(sqlite3_vtab_cursor *cursor, sqlite3_context *ctx, int col) {
+	stats_vtab_cursor_t *c = (stats_vtab_cursor_t *)cursor;
+	if (c->def->columns[col] == 'I') {
+		(*proxy_sqlite3_result_int64)(ctx, c->rows->get_int(col));
+	} else {
+		const char *v = c->rows->get_text(col);
+		if (v) {
+			(*proxy_sqlite3_result_text)(ctx, v, -1, SQLITE_TRANSIENT);
+		} else {
+			(*proxy_sqlite3_result_null)(ctx);
+		}
+	}
+	return SQLITE_OK;
+}
+
+static int stats_vtab_rowid(sqlite3_vtab_cursor *cursor, sqlite3_int64 *rowid) {
+	*rowid = ((stats_vtab_cursor_t *)cursor)->rownum;
+	return SQLITE_OK;
+}
+
+static sqlite3_module stats_vtab_module = {
+	0,                       // iVersion
+	stats_vtab_connect,      // xCreate
+	stats_vtab_connect,      // xConnect
+	stats_vtab_best_index,   // xBestIndex
+	stats_vtab_disconnect,   // xDisconnect
+	stats_vtab_disconnect,   // xDestroy
+	stats_vtab_open,         // xOpen
+	stats_vtab_close,        // xClose
+	stats_vtab_filter,       // xFilter
+	stats_vtab_next,         // xNext
+	stats_vtab_eof,          // xEof
+	stats_vtab_column,       // xColumn
+	stats_vtab_rowid,        // xRowid
+	NULL,                    // xUpdate , read-only
+};
+
+bool proxysql_stats_vtab_register(SQLite3DB *db) {
+	if (proxy_sqlite3_create_module_v2 == NULL) {
+		return false;
+	}
+	int rc = (*proxy_sqlite3_create_module_v2)(db->get_db(), PROXYSQL_STATS_VTAB_MODULE, &stats_vtab_module, NULL, NULL);
+	if (rc != SQLITE_OK) {
+		proxy_error("Unable to register SQLite3 module %s: %s\n", PROXYSQL_STATS_VTAB_MODULE, (*proxy_sqlite3_errmsg)(db->get_db()));
+		return false;
+	}
+	return true;
+}
+
+bool proxysql_stats_vtab_supported(const char *table_name) {
+	return stats_vtab_find(table_name) != NULL;
+}
@@ -0,0 +1,239 @@
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include "ProxySQL_IO_Uring.h"
+#include "proxysql.h"
+
+#ifdef PROXYSQL_IO_URING
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif // PROXYSQL_IO_URING
+
+/**
+ * @file ProxySQL_IO_Uring.cpp
+ *
+ * These functions implement a small io_uring ring without depending on liburing.
+ * The ring is private to one thread: no locking is performed, and the memory barriers are only the
+ * ones required to share the submission and completion queues with the kernel.
+ */
+
+#ifdef PROXYSQL_IO_URING
+static int io_uring_setup(unsigned int entries, struct io_uring_params *p) {
+	return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int io_uring_enter(int fd, unsigned int to_submit, unsigned int min_complete, unsigned int flags) {
+	return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int io_uring_register(int fd, unsigned int opcode, void *arg, unsigned int nr_args) {
+	return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+#endif // PROXYSQL_IO_URING
+
+ProxySQL_IO_Uring::ProxySQL_IO_Uring() {
+	ring_fd=-1;
+	entries=0;
+	pending=0;
+	sqe_tail=0;
+	sq_ptr=NULL;
+	sq_ring_size=0;
+	sq_head=NULL;
+	sq_tail=NULL;
+	sq_mask=NULL;
+	sq_array=NULL;
+	sqes=NULL;
+	sqes_size=0;
+	cq_ptr=NULL;
+	cq_ring_size=0;
+	cq_head=NULL;
+	cq_tail=NULL;
+	cq_mask=NULL;
+	cqes=NULL;
+}
+
+ProxySQL_IO_Uring::~ProxySQL_IO_Uring() {
+#ifdef PROXYSQL_IO_URING
+	if (sqes) {
+		munmap(sqes, sqes_size);
+	}
+	if (cq_ptr && cq_ptr != sq_ptr) {
+		munmap(cq_ptr, cq_ring_size);
+	}
+	if (sq_ptr) {
+		munmap(sq_ptr, sq_ring_size);
+	}
+	if (ring_fd >= 0) {
+		close(ring_fd);
+	}
+#endif // PROXYSQL_IO_URING
+}
+
+/**
+ * @brief Creates the ring and maps its queues.
+ *
+ * @param _entries The number of entries of the submission queue , rounded by the kernel to a power of 2.
+ * @return true if the ring is ready to be used, false if io_uring is not available or doesn't support
+ *  IORING_OP_RECV. In this case the object is left disabled.
+ */
+bool ProxySQL_IO_Uring::init(unsigned int _entries) {
+#ifdef PROXYSQL_IO_URING
+	struct io_uring_params p;
+	memset(&p, 0, sizeof(p));
+	int fd=io_uring_setup(_entries, &p);
+	if (fd < 0) {
+		return false;
+	}
+	// IORING_OP_RECV requires Linux 5.6
+	size_t probe_len=sizeof(struct io_uring_probe) + 256*sizeof(struct io_uring_probe_op);
+	struct io_uring_probe *probe=(struct io_uring_probe *)malloc(probe_len);
+	memset(probe, 0, probe_len);
+	int rc=io_uring_register(fd, IORING_REGISTER_PROBE, probe, 256);
+	bool recv_supported=(rc == 0 && probe->last_op >= IORING_OP_RECV && (probe->ops[IORING_OP_RECV].flags & IO_URING_OP_SUPPORTED));
+	free(probe);
+	if (recv_supported == false) {
+		close(fd);
+		return false;
+	}
+
+	sq_ring_size=p.sq_off.array + p.sq_entries*sizeof(unsigned);
+	cq_ring_size=p.cq_off.cqes + p.cq_entries*sizeof(struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		if (cq_ring_size > sq_ring_size) {
+			sq_ring_size=cq_ring_size;
+		}
+		cq_ring_size=sq_ring_size;
+	}
+	sq_ptr=mmap(NULL, sq_ring_size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+	if (sq_ptr == MAP_FAILED) {
+		sq_ptr=NULL;
+		close(fd);
+		return false;
+	}
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		cq_ptr=sq_ptr;
+	} else {
+		cq_ptr=mmap(NULL, cq_ring_size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+		if (cq_ptr == MAP_FAILED) {
+			cq_ptr=NULL;
+			munmap(sq_ptr, sq_ring_size);
+			sq_ptr=NULL;
+			close(fd);
+			return false;
+		}
+	}
+	sqes_size=p.sq_entries*sizeof(struct io_uring_sqe);
+	sqes=(struct io_uring_sqe *)mmap(NULL, sqes_size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, fd, IORING_OFF_SQES);
+	if (sqes == MAP_FAILED) {
+		sqes=NULL;
+		if (cq_ptr != sq_ptr) {
+			munmap(cq_ptr, cq_ring_size);
+		}
+		cq_ptr=NULL;
+		munmap(sq_ptr, sq_ring_size);
+		sq_ptr=NULL;
+		close(fd);
+		return false;
+	}
+	sq_head=(unsigned *)((char *)sq_ptr + p.sq_off.head);
+	sq_tail=(unsigned *)((char *)sq_ptr + p.sq_off.tail);
+	sq_mask=(unsigned *)((char *)sq_ptr + p.sq_off.ring_mask);
+	sq_array=(unsigned *)((char *)sq_ptr + p.sq_off.array);
+	cq_head=(unsigned *)((char *)cq_ptr + p.cq_off.head);
+	cq_tail=(unsigned *)((char *)cq_ptr + p.cq_off.tail);
+	cq_mask=(unsigned *)((char *)cq_ptr + p.cq_off.ring_mask);
+	cqes=(struct io_uring_cqe *)((char *)cq_ptr + p.cq_off.cqes);
+	entries=p.sq_entries;
+	sqe_tail=*sq_tail;
+	ring_fd=fd;
+	return true;
+#else
+	return false;
+#endif // PROXYSQL_IO_URING
+}
+
+/**
+ * @brief Prepares a non blocking recv() , submitted by the next call of submit_and_wait().
+ *
+ * The buffer must remain valid until submit_and_wait() returns.
+ *
+ * @return false if the ring is disabled or full.
+ */
+bool ProxySQL_IO_Uring::prep_recv(int fd, void *buf, unsigned int len, uint64_t user_data) {
+#ifdef PROXYSQL_IO_URING
+	if (ring_fd < 0 || pending == entries) {
+		return false;
+	}
+	unsigned int idx=sqe_tail & *sq_mask;
+	struct io_uring_sqe *sqe=&sqes[idx];
+	memset(sqe, 0, sizeof(struct io_uring_sqe));
+	sqe->opcode=IORING_OP_RECV;
+	sqe->fd=fd;
+	sqe->addr=(uint64_t)(uintptr_t)buf;
+	sqe->len=len;
+	sqe->msg_flags=MSG_DONTWAIT;
+	sqe->user_data=user_data;
+	sq_array[idx]=idx;
+	sqe_tail++;
+	pending++;
+	return true;
+#else
+	return false;
+#endif // PROXYSQL_IO_URING
+}
+
+/**
+ * @brief Submits all the prepared requests and waits for their completion with a single io_uring_enter().
+ *
+ * For every completed request the callback is called with its user_data and its result, that is the
+ * return value of recv() or -errno. Requests that the kernel didn't accept are discarded without
+ * calling the callback.
+ *
+ * @return The number of completed requests.
+ */
+int ProxySQL_IO_Uring::submit_and_wait(void (*cb)(uint64_t user_data, int res, void *arg), void *arg) {
+#ifdef PROXYSQL_IO_URING
+	if (pending == 0) {
+		return 0;
+	}
+	__atomic_store_n(sq_tail, sqe_tail, __ATOMIC_RELEASE);
+	int submitted=io_uring_enter(ring_fd, pending, pending, IORING_ENTER_GETEVENTS);
+	if (submitted < 0) {
+		submitted=0;
+	}
+	if ((unsigned int)submitted < pending) {
+		// drop the requests not consumed by the kernel: their buffers are no longer reserved
+		sqe_tail=__atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+		__atomic_store_n(sq_tail, sqe_tail, __ATOMIC_RELEASE);
+	}
+	pending=0;
+	int done=0;
+	while (done < submitted) {
+		unsigned int head=*cq_head;
+		unsigned int tail=__atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+		if (head == tail) {
+			// requests are non blocking, this should only happen if interrupted
+			if (io_uring_enter(ring_fd, 0, submitted-done, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+				// LCOV_EXCL_START
+				proxy_error("io_uring_enter() failed: %s\n", strerror(errno));
+				assert(0);
+				// LCOV_EXCL_STOP
+			}
+			continue;
+		}
+		while (head != tail) {
+			struct io_uring_cqe *cqe=&cqes[head & *cq_mask];
+			cb(cqe->user_data, cqe->res, arg);
+			head++;
+			done++;
+		}
+		__atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+	}
+	return done;
+#else
+	return 0;
+#endif // PROXYSQL_IO_URING
+}
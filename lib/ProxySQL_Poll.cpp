@@ -7,6 +7,12 @@
 #include "proxysql_structs.h"
 #include <poll.h>
 #include "cpp.h"
+#ifdef IDLE_THREADS
+#include <sys/epoll.h>
+#endif // IDLE_THREADS
+
+// value of registered_events[] for an entry not yet added to the epoll instance
+#define POLL_EVENTS_NOT_REGISTERED	0xFFFFFFFF
 
 
 /**
@@ -30,6 +36,8 @@ void ProxySQL_Poll::shrink() {
 	myds=(MySQL_Data_Stream **)realloc(myds,new_size*sizeof(MySQL_Data_Stream *));
 	last_recv=(unsigned long long *)realloc(last_recv,new_size*sizeof(unsigned long long));
 	last_sent=(unsigned long long *)realloc(last_sent,new_size*sizeof(unsigned long long));
+	registered_events=(uint32_t *)realloc(registered_events,new_size*sizeof(uint32_t));
+	dirty=(unsigned char *)realloc(dirty,new_size*sizeof(unsigned char));
 	size=new_size;
 }
 
@@ -48,6 +56,8 @@ void ProxySQL_Poll::expand(unsigned int more) {
 		myds=(MySQL_Data_Stream **)realloc(myds,new_size*sizeof(MySQL_Data_Stream *));
 		last_recv=(unsigned long long *)realloc(last_recv,new_size*sizeof(unsigned long long));
 		last_sent=(unsigned long long *)realloc(last_sent,new_size*sizeof(unsigned long long));
+		registered_events=(uint32_t *)realloc(registered_events,new_size*sizeof(uint32_t));
+		dirty=(unsigned char *)realloc(dirty,new_size*sizeof(unsigned char));
 		size=new_size;
 	}
 }
@@ -69,6 +79,14 @@ ProxySQL_Poll::ProxySQL_Poll() {
 	myds=(MySQL_Data_Stream **)malloc(size*sizeof(MySQL_Data_Stream *));
 	last_recv=(unsigned long long *)malloc(size*sizeof(unsigned long long));
 	last_sent=(unsigned long long *)malloc(size*sizeof(unsigned long long));
+	registered_events=(uint32_t *)malloc(size*sizeof(uint32_t));
+	dirty=(unsigned char *)malloc(size*sizeof(unsigned char));
+	efd=-1;
+	fd_idx=NULL;
+	fd_idx_size=0;
+	epoll_events=NULL;
+	epoll_events_size=0;
+	ready_len=0;
 }
 
 /**
@@ -89,9 +107,159 @@ ProxySQL_Poll::~ProxySQL_Poll() {
 	free(fds);
 	free(last_recv);
 	free(last_sent);
+	free(registered_events);
+	free(dirty);
+	free(fd_idx);
+	free(epoll_events);
+	if (efd >= 0) {
+		close(efd);
+	}
 	delete loop_counters;
 }
 
+/**
+ * @brief Switches the ProxySQL_Poll object from poll() to epoll.
+ *
+ * This function creates the epoll instance used by wait() and indexes the file descriptors already
+ * present. The FDs are registered lazily, the first time wait() is called after they are added.
+ * epoll is used level-triggered, so the readiness reported by wait() has the same semantics of poll().
+ *
+ * @return true if epoll is enabled, false if the epoll instance can't be created and poll() is still used.
+ */
+bool ProxySQL_Poll::init_epoll() {
+#ifdef IDLE_THREADS
+	if (efd >= 0) {
+		return true;
+	}
+	efd=epoll_create1(EPOLL_CLOEXEC);
+	if (efd == -1) {
+		return false;
+	}
+	for (unsigned int i=0; i<len; i++) {
+		set_fd_idx(fds[i].fd, i);
+		registered_events[i]=POLL_EVENTS_NOT_REGISTERED;
+		dirty[i]=0;
+		set_dirty(i);
+	}
+	return true;
+#else
+	return false;
+#endif // IDLE_THREADS
+}
+
+/**
+ * @brief Records the index of a file descriptor (FD), growing the FD map if needed.
+ *
+ * @param fd The file descriptor (FD).
+ * @param i The index of the FD in fds , or -1 if the FD is removed.
+ */
+void ProxySQL_Poll::set_fd_idx(int fd, int i) {
+	if (fd < 0) return;
+	if ((unsigned int)fd >= fd_idx_size) {
+		unsigned int new_size=l_near_pow_2(fd+1);
+		fd_idx=(int *)realloc(fd_idx,new_size*sizeof(int));
+		for (unsigned int j=fd_idx_size; j<new_size; j++) {
+			fd_idx[j]=-1;
+		}
+		fd_idx_size=new_size;
+	}
+	fd_idx[fd]=i;
+}
+
+/**
+ * @brief Returns the index of a file descriptor (FD) in fds using the FD map.
+ *
+ * Only valid when epoll is enabled.
+ *
+ * @param fd The file descriptor (FD).
+ * @return The index of the FD, or -1 if the FD is not present.
+ */
+int ProxySQL_Poll::get_fd_idx(int fd) {
+	if (fd < 0 || (unsigned int)fd >= fd_idx_size) return -1;
+	return fd_idx[fd];
+}
+
+/**
+ * @brief Propagates to the epoll instance the events changed since the previous call.
+ *
+ * Only the entries marked dirty by add(), set_events() and remove_index_fast() are checked: their
+ * events are compared with the ones registered in the epoll instance, and epoll_ctl() is called only
+ * for the entries that were added or whose events changed. The cost is proportional to the number of
+ * entries changed since the previous call, not to the number of entries.
+ */
+void ProxySQL_Poll::epoll_sync() {
+#ifdef IDLE_THREADS
+	for (unsigned int i : dirty_idx) {
+		if (i >= len || dirty[i] == 0) {
+			continue;
+		}
+		dirty[i]=0;
+		uint32_t ev=(uint16_t)fds[i].events;
+		if (fds[i].fd < 0 || registered_events[i]==ev) {
+			continue;
+		}
+		struct epoll_event event;
+		memset(&event,0,sizeof(event));
+		event.events=ev;
+		event.data.fd=fds[i].fd;
+		int op=(registered_events[i]==POLL_EVENTS_NOT_REGISTERED ? EPOLL_CTL_ADD : EPOLL_CTL_MOD);
+		int rc=epoll_ctl(efd, op, fds[i].fd, &event);
+		if (rc == -1) {
+			// the FD may have been closed and reused without being removed from the epoll instance
+			if (op == EPOLL_CTL_ADD && errno == EEXIST) {
+				rc=epoll_ctl(efd, EPOLL_CTL_MOD, fds[i].fd, &event);
+			} else if (op == EPOLL_CTL_MOD && errno == ENOENT) {
+				rc=epoll_ctl(efd, EPOLL_CTL_ADD, fds[i].fd, &event);
+			}
+			if (rc == -1) {
+				proxy_error("epoll_ctl() failed for FD=%d, events=%d: %s\n", fds[i].fd, fds[i].events, strerror(errno));
+			}
+		}
+		// even on failure, to avoid calling epoll_ctl() at every loop
+		registered_events[i]=ev;
+	}
+	dirty_idx.clear();
+#endif // IDLE_THREADS
+}
+
+/**
+ * @brief Waits for events on the file descriptors (FDs) of the ProxySQL_Poll object.
+ *
+ * If epoll is not enabled this is equivalent to poll(). Otherwise, the events are synchronized with the
+ * epoll instance and epoll_wait() is called: 'revents' is set only for the ready FDs, that are also
+ * available in epoll_events. The caller is expected to reset 'revents' of all the entries before calling
+ * this function, as MySQL_Thread::ProcessAllMyDS_BeforePoll() does.
+ *
+ * @param timeout The timeout in milliseconds, same as poll().
+ * @return The number of ready FDs, or -1 on error, same as poll().
+ */
+int ProxySQL_Poll::wait(int timeout) {
+	ready_len=0;
+	if (efd < 0) {
+		return poll(fds, len, timeout);
+	}
+#ifdef IDLE_THREADS
+	epoll_sync();
+	if (epoll_events_size < size) {
+		epoll_events=(struct epoll_event *)realloc(epoll_events,size*sizeof(struct epoll_event));
+		epoll_events_size=size;
+	}
+	int rc=epoll_wait(efd, epoll_events, epoll_events_size, timeout);
+	if (rc > 0) {
+		ready_len=rc;
+		for (unsigned int k=0; k<ready_len; k++) {
+			int i=get_fd_idx(epoll_events[k].data.fd);
+			if (i >= 0) {
+				fds[i].revents=(short)(epoll_events[k].events & 0xFFFF);
+			}
+		}
+	}
+	return rc;
+#else
+	return -1;
+#endif // IDLE_THREADS
+}
+
 /**
  * @brief Adds a new file descriptor (FD) and its associated MySQL_Data_Stream to the ProxySQL_Poll object.
  * 
@@ -117,6 +285,12 @@ void ProxySQL_Poll::add(uint32_t _events, int _fd, MySQL_Data_Stream *_myds, uns
 	}
 	last_recv[len]=monotonic_time();
 	last_sent[len]=sent_time;
+	registered_events[len]=POLL_EVENTS_NOT_REGISTERED;
+	dirty[len]=0;
+	if (efd >= 0) {
+		set_fd_idx(_fd, len);
+		set_dirty(len);
+	}
 	len++;
 }
 
@@ -131,6 +305,23 @@ void ProxySQL_Poll::add(uint32_t _events, int _fd, MySQL_Data_Stream *_myds, uns
 void ProxySQL_Poll::remove_index_fast(unsigned int i) {
 	if ((int)i==-1) return;
 	myds[i]->poll_fds_idx=-1; // this prevents further delete
+#ifdef IDLE_THREADS
+	if (efd >= 0) {
+		// if the FD was closed and reused by a newer entry, the map points to the newer entry
+		if (get_fd_idx(fds[i].fd)==(int)i) {
+			if (registered_events[i]!=POLL_EVENTS_NOT_REGISTERED) {
+				struct epoll_event event;
+				memset(&event,0,sizeof(event));
+				// errors are ignored: closing the FD already removed it from the epoll instance
+				epoll_ctl(efd, EPOLL_CTL_DEL, fds[i].fd, &event);
+			}
+			set_fd_idx(fds[i].fd, -1);
+		}
+		if (i != (len-1) && get_fd_idx(fds[len-1].fd)==(int)(len-1)) {
+			set_fd_idx(fds[len-1].fd, i);
+		}
+	}
+#endif // IDLE_THREADS
 	if (i != (len-1)) {
 		myds[i]=myds[len-1];
 		fds[i].fd=fds[len-1].fd;
@@ -139,7 +330,13 @@ void ProxySQL_Poll::remove_index_fast(unsigned int i) {
 		myds[i]->poll_fds_idx=i;  // fix a serious bug
 		last_recv[i]=last_recv[len-1];
 		last_sent[i]=last_sent[len-1];
+		registered_events[i]=registered_events[len-1];
+		dirty[i]=0;
+		if (dirty[len-1] && efd >= 0) {
+			set_dirty(i);
+		}
 	}
+	dirty[len-1]=0;
 	len--;
 	if ( ( len>MIN_POLL_LEN ) && ( size > len*MIN_POLL_DELETE_RATIO ) ) {
 		shrink();
@@ -78,6 +78,24 @@ void QP_query_digest_stats::add_time(
 	}
 	last_seen=n;
 }
+void QP_query_digest_stats::add_stats(const QP_query_digest_stats *qds) {
+	count_star += qds->count_star;
+	sum_time += qds->sum_time;
+	rows_affected += qds->rows_affected;
+	rows_sent += qds->rows_sent;
+	if (qds->min_time && (qds->min_time < min_time || min_time==0)) {
+		min_time = qds->min_time;
+	}
+	if (qds->max_time > max_time) {
+		max_time = qds->max_time;
+	}
+	if (qds->first_seen && (qds->first_seen < first_seen || first_seen==0)) {
+		first_seen = qds->first_seen;
+	}
+	if (qds->last_seen > last_seen) {
+		last_seen = qds->last_seen;
+	}
+}
 QP_query_digest_stats::~QP_query_digest_stats() {
 	if (digest_text) {
 		free(digest_text);
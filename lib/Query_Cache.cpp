@@ -7,6 +7,7 @@
 //#include "SpookyV2.h"
 #include "prometheus_helpers.h"
 #include "MySQL_Protocol.h"
+#include "lz4.h"
 
 #define THR_UPDATE_CNT(__a, __b, __c, __d) \
 	do {\
@@ -37,7 +38,91 @@ extern MySQL_Threads_Handler *GloMTH;
 
 typedef btree::btree_map<uint64_t, QC_entry_t *> BtMap_cache;
 
-class KV_BtreeArray {
+#define QC_SKETCH_DEPTH 4
+#define QC_SKETCH_WIDTH 65536 // must be a power of 2
+#define QC_SKETCH_MAX_COUNT 15
+#define QC_CLOCK_MAX_FREQ 3
+#define QC_EVICTION_MAX_STEPS 4096 // entries examined by a single make_room()
+// memory accounted for each entry besides its value, see get_data_size()
+#define QC_ENTRY_OVERHEAD (sizeof(QC_entry_t)+sizeof(QC_entry_t *)*2+sizeof(uint64_t)*2)
+
+// values shorter than this are never compressed
+#define QC_COMPRESSION_MIN_LENGTH 512
+
+// memory used by the value of the entry, compressed or not
+static inline uint32_t QC_entry_size(const QC_entry_t *entry) {
+	return (entry->compressed_length ? entry->compressed_length : entry->length);
+}
+
+// Approximate access frequency of the keys, used by QUERY_CACHE_EVICTION_TINYLFU.
+// It is a count-min sketch of QC_SKETCH_DEPTH rows of small saturating counters.
+// Counters are updated without locking: a lost increment only makes the estimate
+// slightly lower. age() halves all the counters so that old popularity fades away
+class QC_frequency_sketch {
+	private:
+	uint8_t *counters;
+	static uint64_t index(uint64_t key, int row) {
+		static const uint64_t seeds[QC_SKETCH_DEPTH] = { 0xc3a5c85c97cb3127ULL, 0xb492b66fbe98f273ULL, 0x9ae16a3b2f90404fULL, 0xcbf29ce484222325ULL };
+		return row * QC_SKETCH_WIDTH + (((key ^ seeds[row]) * 0x9E3779B97F4A7C15ULL) >> 48) % QC_SKETCH_WIDTH;
+	}
+	public:
+	uint64_t samples; // records since the last age()
+	QC_frequency_sketch() {
+		counters = (uint8_t *)calloc(QC_SKETCH_DEPTH * QC_SKETCH_WIDTH, sizeof(uint8_t));
+		samples = 0;
+	}
+	~QC_frequency_sketch() {
+		free(counters);
+	}
+	void record(uint64_t key) {
+		for (int r = 0; r < QC_SKETCH_DEPTH; r++) {
+			uint8_t *c = &counters[index(key, r)];
+			if (*c < QC_SKETCH_MAX_COUNT) (*c)++;
+		}
+	}
+	unsigned int estimate(uint64_t key) {
+		unsigned int e = QC_SKETCH_MAX_COUNT;
+		for (int r = 0; r < QC_SKETCH_DEPTH; r++) {
+			unsigned int c = counters[index(key, r)];
+			if (c < e) e = c;
+		}
+		return e;
+	}
+	void age() {
+		for (unsigned int i = 0; i < QC_SKETCH_DEPTH * QC_SKETCH_WIDTH; i++) {
+			counters[i] >>= 1;
+		}
+	}
+};
+
+// TinyLFU admission: the candidate replaces the victim only if it has a higher estimated
+// frequency per byte. The '+1' lets a never seen candidate replace a never read victim
+static bool QC_admit(QC_frequency_sketch *sketch, uint64_t key, uint32_t length, QC_entry_t *victim) {
+	uint64_t cand = (uint64_t)(sketch->estimate(key) + 1) * QC_entry_size(victim);
+	uint64_t vict = (uint64_t)(sketch->estimate(victim->key) + 1) * length;
+	return cand > vict;
+}
+
+// A shard of the Query Cache
+class KV_Store {
+	public:
+	virtual ~KV_Store() {};
+	virtual uint64_t get_data_size() = 0;
+	virtual void purge_some(unsigned long long, bool) = 0;
+	virtual int cnt() = 0;
+	virtual bool replace(uint64_t key, QC_entry_t *entry) = 0;
+	// the entry returned can't be freed until release() is called
+	virtual QC_entry_t *lookup(uint64_t key) = 0;
+	virtual void release(QC_entry_t *entry) = 0;
+	virtual void empty() = 0;
+	// Evicts entries with a CLOCK sweep until 'bytes' are freed, for QUERY_CACHE_EVICTION_TINYLFU.
+	// Expired entries are always evicted. Any other victim is evicted only if the candidate
+	// 'key' of 'length' bytes is estimated more valuable per byte, otherwise '*rejected' is set.
+	// Returns the number of bytes freed, counting 'entry_overhead' for each entry
+	virtual uint64_t make_room(uint64_t bytes, uint64_t entry_overhead, uint64_t key, uint32_t length, unsigned long long now_ms, QC_frequency_sketch *sketch, bool *rejected) = 0;
+};
+
+class KV_BtreeArray : public KV_Store {
 	private:
 #ifdef PROXYSQL_QC_PTHREAD_MUTEX
 	pthread_rwlock_t lock;
@@ -50,6 +135,7 @@ class KV_BtreeArray {
 	uint64_t purgeIdx;
 	bool __insert(uint64_t, void *);
 	uint64_t freeable_memory;
+	uint64_t clock_hand; // index in ptrArray
 	public:
 	uint64_t tottopurge;
 	KV_BtreeArray();
@@ -59,7 +145,37 @@ class KV_BtreeArray {
 	int cnt();
 	bool replace(uint64_t key, QC_entry_t *entry);
 	QC_entry_t *lookup(uint64_t key);
+	void release(QC_entry_t *entry);
+	void empty();
+	uint64_t make_room(uint64_t bytes, uint64_t entry_overhead, uint64_t key, uint32_t length, unsigned long long now_ms, QC_frequency_sketch *sketch, bool *rejected);
+};
+
+// Readers never lock: they traverse the bucket chains while their epoch slot is published.
+// Writers and purging serialize on 'mutex'. Entries unlinked from the table are retired with
+// the current epoch, and freed once no reader has a published epoch lower or equal to it.
+// The number of buckets is fixed at creation, entries are chained through QC_entry_t::next
+class KV_LockFreeHashTable : public KV_Store {
+	private:
+	pthread_mutex_t mutex;
+	QC_entry_t **buckets;
+	uint64_t buckets_mask;
+	int entries;
+	std::vector<std::pair<uint64_t, QC_entry_t *>> retired;
+	uint64_t retired_entries; // retired.size() , readable without the mutex
+	uint64_t clock_hand; // bucket index
+	void retire(QC_entry_t *entry);
+	uint64_t reclaim(uint64_t entry_overhead);
+	public:
+	KV_LockFreeHashTable(unsigned int num_buckets);
+	~KV_LockFreeHashTable();
+	uint64_t get_data_size();
+	void purge_some(unsigned long long, bool);
+	int cnt();
+	bool replace(uint64_t key, QC_entry_t *entry);
+	QC_entry_t *lookup(uint64_t key);
+	void release(QC_entry_t *entry);
 	void empty();
+	uint64_t make_room(uint64_t bytes, uint64_t entry_overhead, uint64_t key, uint32_t length, unsigned long long now_ms, QC_frequency_sketch *sketch, bool *rejected);
 };
 
 __thread uint64_t __thr_cntSet=0;
@@ -70,9 +186,12 @@ __thread uint64_t __thr_dataOUT=0;
 __thread uint64_t __thr_num_entries=0;
 __thread uint64_t __thr_num_deleted=0;
 __thread uint64_t __thr_size_values=0;
+__thread uint64_t __thr_sketch_samples=0;
 //__thread uint64_t __thr_freeable_memory=0;
 
 #define DEFAULT_SQC_size  4*1024*1024
+#define QC_LOCKFREE_MIN_BUCKETS 1024
+#define QC_LOCKFREE_TOTAL_BUCKETS 524288
 
 
 static uint64_t Glo_cntSet=0;
@@ -84,10 +203,15 @@ static uint64_t Glo_dataOUT=0;
 static uint64_t Glo_cntPurge=0;
 static uint64_t Glo_size_values=0;
 static uint64_t Glo_total_freed_memory;
+static uint64_t Glo_cntEvicted=0;
+static uint64_t Glo_cntAdmissionRejected=0;
+static uint64_t Glo_cntGetStale=0;
+static uint64_t Glo_cntSetCompressed=0;
 
 KV_BtreeArray::KV_BtreeArray() {
 	freeable_memory=0;
 	tottopurge=0;
+	clock_hand=0;
 #ifdef PROXYSQL_QC_PTHREAD_MUTEX
 	pthread_rwlock_init(&lock, NULL);
 #else
@@ -109,8 +233,10 @@ KV_BtreeArray::~KV_BtreeArray() {
 };
 
 
+// overhead of the entries of this shard only, the values are accounted in Glo_size_values.
+// ptrArray also holds the replaced entries not purged yet
 uint64_t KV_BtreeArray::get_data_size() {
-	uint64_t r = __sync_fetch_and_add(&Glo_num_entries,0) * (sizeof(QC_entry_t)+sizeof(QC_entry_t *)*2+sizeof(uint64_t)*2); // +  __sync_fetch_and_add(&Glo_size_values,0) ;
+	uint64_t r = (uint64_t)__sync_fetch_and_add(&ptrArray->len,0) * QC_ENTRY_OVERHEAD;
 	return r;
 };
 
@@ -144,7 +270,7 @@ void KV_BtreeArray::purge_some(unsigned long long QCnow_ms, bool aggressive) {
 		} else { // no aggresssive purging , legacy algorithm
 			if (qce->expire_ms==EXPIRE_DROPIT || qce->expire_ms<QCnow_ms) {
 				ret++;
-				_size+=qce->length;
+				_size+=QC_entry_size(qce);
 			}
 		}
 	}
@@ -199,7 +325,7 @@ void KV_BtreeArray::purge_some(unsigned long long QCnow_ms, bool aggressive) {
 					bt_map.erase(lookup);
 				}
 				i--;
-				freed_memory+=qce->length;
+				freed_memory+=QC_entry_size(qce);
 				removed_entries++;
 				free(qce->value);
 				free(qce);
@@ -230,7 +356,7 @@ bool KV_BtreeArray::replace(uint64_t key, QC_entry_t *entry) {
 	spin_wrlock(&lock);
 #endif
 	THR_UPDATE_CNT(__thr_cntSet,Glo_cntSet,1,1);
-	THR_UPDATE_CNT(__thr_size_values,Glo_size_values,entry->length,1);
+	THR_UPDATE_CNT(__thr_size_values,Glo_size_values,QC_entry_size(entry),1);
 	THR_UPDATE_CNT(__thr_dataIN,Glo_dataIN,entry->length,1);
 	THR_UPDATE_CNT(__thr_num_entries,Glo_num_entries,1,1);
 
@@ -274,6 +400,10 @@ QC_entry_t * KV_BtreeArray::lookup(uint64_t key) {
 	return entry;
 };
 
+void KV_BtreeArray::release(QC_entry_t *entry) {
+	__sync_fetch_and_sub(&entry->ref_count,1);
+};
+
 void KV_BtreeArray::empty() {
 #ifdef PROXYSQL_QC_PTHREAD_MUTEX
 	pthread_rwlock_wrlock(&lock);
@@ -296,6 +426,305 @@ void KV_BtreeArray::empty() {
 #endif
 };
 
+uint64_t KV_BtreeArray::make_room(uint64_t bytes, uint64_t entry_overhead, uint64_t key, uint32_t length, unsigned long long now_ms, QC_frequency_sketch *sketch, bool *rejected) {
+	uint64_t removed_entries=0;
+	uint64_t evicted_entries=0;
+	uint64_t freed_memory=0;
+#ifdef PROXYSQL_QC_PTHREAD_MUTEX
+	pthread_rwlock_wrlock(&lock);
+#else
+	spin_wrlock(&lock);
+#endif
+	for (unsigned int steps=0; steps<QC_EVICTION_MAX_STEPS && ptrArray->len && freed_memory+removed_entries*entry_overhead<bytes; steps++) {
+		if (clock_hand >= ptrArray->len) {
+			clock_hand=0;
+		}
+		QC_entry_t *qce=(QC_entry_t *)ptrArray->index(clock_hand);
+		if (__sync_fetch_and_add(&qce->ref_count,0)>1) { // currently in use
+			clock_hand++;
+			continue;
+		}
+		if (qce->expire_ms!=EXPIRE_DROPIT && qce->expire_ms>=now_ms) {
+			if (qce->clock_freq) { // accessed since the last sweep, second chance
+				qce->clock_freq--;
+				clock_hand++;
+				continue;
+			}
+			if (QC_admit(sketch, key, length, qce)==false) {
+				*rejected=true;
+				break;
+			}
+			evicted_entries++;
+		}
+		// the last entry is moved at clock_hand, that is examined next
+		qce=(QC_entry_t *)ptrArray->remove_index_fast(clock_hand);
+		btree::btree_map<uint64_t, QC_entry_t *>::iterator lookup;
+		lookup = bt_map.find(qce->key);
+		if (lookup != bt_map.end() && lookup->second==qce) { // replaced entries are no longer in bt_map
+			bt_map.erase(lookup);
+		}
+		freed_memory+=QC_entry_size(qce);
+		removed_entries++;
+		free(qce->value);
+		free(qce);
+	}
+#ifdef PROXYSQL_QC_PTHREAD_MUTEX
+	pthread_rwlock_unlock(&lock);
+#else
+	spin_wrunlock(&lock);
+#endif
+	THR_DECREASE_CNT(__thr_num_deleted,Glo_num_entries,removed_entries,1);
+	if (removed_entries) {
+		__sync_fetch_and_add(&Glo_total_freed_memory,freed_memory);
+		__sync_fetch_and_sub(&Glo_size_values,freed_memory);
+		__sync_fetch_and_add(&Glo_cntPurge,removed_entries);
+		__sync_fetch_and_add(&Glo_cntEvicted,evicted_entries);
+	}
+	return freed_memory+removed_entries*entry_overhead;
+};
+
+struct QC_epoch_slot_t {
+	volatile uint64_t epoch; // 0 when the thread isn't reading the Query Cache
+	QC_epoch_slot_t *next;
+	char pad[64 - sizeof(uint64_t) - sizeof(QC_epoch_slot_t *)]; // one slot per cache line
+};
+
+static volatile uint64_t QC_global_epoch = 1;
+static QC_epoch_slot_t * volatile QC_epoch_slots = NULL; // one per thread, never freed
+__thread QC_epoch_slot_t * __thr_epoch_slot = NULL;
+
+static QC_epoch_slot_t * QC_get_epoch_slot() {
+	if (__thr_epoch_slot == NULL) {
+		QC_epoch_slot_t *slot = NULL;
+		if (posix_memalign((void **)&slot, 64, sizeof(QC_epoch_slot_t))) {
+			// LCOV_EXCL_START
+			assert(0);
+			// LCOV_EXCL_STOP
+		}
+		slot->epoch = 0;
+		do {
+			slot->next = QC_epoch_slots;
+		} while (__sync_bool_compare_and_swap(&QC_epoch_slots, slot->next, slot) == false);
+		__thr_epoch_slot = slot;
+	}
+	return __thr_epoch_slot;
+}
+
+// lowest epoch that a reader may still be using
+static uint64_t QC_min_active_epoch() {
+	uint64_t min_epoch = __sync_fetch_and_add(&QC_global_epoch,0);
+	for (QC_epoch_slot_t *slot = QC_epoch_slots; slot != NULL; slot = slot->next) {
+		uint64_t e = __atomic_load_n(&slot->epoch, __ATOMIC_ACQUIRE);
+		if (e && e < min_epoch) {
+			min_epoch = e;
+		}
+	}
+	return min_epoch;
+}
+
+KV_LockFreeHashTable::KV_LockFreeHashTable(unsigned int num_buckets) {
+	pthread_mutex_init(&mutex, NULL);
+	buckets = (QC_entry_t **)calloc(num_buckets, sizeof(QC_entry_t *));
+	buckets_mask = num_buckets - 1; // num_buckets is a power of 2
+	entries = 0;
+	retired_entries = 0;
+	clock_hand = 0;
+};
+
+KV_LockFreeHashTable::~KV_LockFreeHashTable() {
+	proxy_debug(PROXY_DEBUG_QUERY_CACHE, 3, "Size of KV_LockFreeHashTable:%d , retired:%lu\n", cnt(), retired.size());
+	empty();
+	// no readers are left at this point
+	for (auto& r : retired) {
+		free(r.second->value);
+		free(r.second);
+	}
+	retired.clear();
+	free(buckets);
+	pthread_mutex_destroy(&mutex);
+};
+
+// overhead of the entries of this shard only, including the retired entries not freed yet
+uint64_t KV_LockFreeHashTable::get_data_size() {
+	uint64_t r = ((uint64_t)__sync_fetch_and_add(&entries,0) + __sync_fetch_and_add(&retired_entries,0)) * QC_ENTRY_OVERHEAD;
+	return r;
+};
+
+int KV_LockFreeHashTable::cnt() {
+	return __sync_fetch_and_add(&entries,0);
+};
+
+// caller must hold the mutex, and the entry must be already unlinked
+void KV_LockFreeHashTable::retire(QC_entry_t *entry) {
+	entry->expire_ms=EXPIRE_DROPIT;
+	uint64_t e = __sync_fetch_and_add(&QC_global_epoch,1);
+	retired.push_back(std::make_pair(e, entry));
+	__sync_fetch_and_add(&retired_entries,1);
+	entries--;
+};
+
+// caller must hold the mutex.
+// Returns the number of bytes freed, counting 'entry_overhead' for each entry
+uint64_t KV_LockFreeHashTable::reclaim(uint64_t entry_overhead) {
+	if (retired.empty()) return 0;
+	uint64_t min_epoch = QC_min_active_epoch();
+	uint64_t removed_entries=0;
+	uint64_t freed_memory=0;
+	for (size_t i = 0; i < retired.size(); ) {
+		if (retired[i].first < min_epoch) {
+			QC_entry_t *qce = retired[i].second;
+			retired[i] = retired.back();
+			retired.pop_back();
+			freed_memory+=QC_entry_size(qce);
+			removed_entries++;
+			free(qce->value);
+			free(qce);
+		} else {
+			i++;
+		}
+	}
+	THR_DECREASE_CNT(__thr_num_deleted,Glo_num_entries,removed_entries,1);
+	if (removed_entries) {
+		__sync_fetch_and_sub(&retired_entries,removed_entries);
+		__sync_fetch_and_add(&Glo_total_freed_memory,freed_memory);
+		__sync_fetch_and_sub(&Glo_size_values,freed_memory);
+		__sync_fetch_and_add(&Glo_cntPurge,removed_entries);
+	}
+	return freed_memory+removed_entries*entry_overhead;
+};
+
+bool KV_LockFreeHashTable::replace(uint64_t key, QC_entry_t *entry) {
+	QC_entry_t **head = &buckets[(key >> 32) & buckets_mask];
+	pthread_mutex_lock(&mutex);
+	THR_UPDATE_CNT(__thr_cntSet,Glo_cntSet,1,1);
+	THR_UPDATE_CNT(__thr_size_values,Glo_size_values,QC_entry_size(entry),1);
+	THR_UPDATE_CNT(__thr_dataIN,Glo_dataIN,entry->length,1);
+	THR_UPDATE_CNT(__thr_num_entries,Glo_num_entries,1,1);
+	entry->ref_count=1;
+	for (QC_entry_t **pp = head; *pp != NULL; pp = &(*pp)->next) {
+		QC_entry_t *old = *pp;
+		if (old->key == key) {
+			// readers already on 'old' can still follow old->next
+			__atomic_store_n(pp, old->next, __ATOMIC_RELEASE);
+			retire(old);
+			break;
+		}
+	}
+	entry->next = *head;
+	__atomic_store_n(head, entry, __ATOMIC_RELEASE);
+	entries++;
+	pthread_mutex_unlock(&mutex);
+	return true;
+};
+
+QC_entry_t * KV_LockFreeHashTable::lookup(uint64_t key) {
+	QC_epoch_slot_t *slot = QC_get_epoch_slot();
+	THR_UPDATE_CNT(__thr_cntGet,Glo_cntGet,1,1);
+	__atomic_store_n(&slot->epoch, __atomic_load_n(&QC_global_epoch, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+	__sync_synchronize(); // the epoch must be visible before reading the buckets
+	QC_entry_t *entry = __atomic_load_n(&buckets[(key >> 32) & buckets_mask], __ATOMIC_ACQUIRE);
+	while (entry != NULL && entry->key != key) {
+		entry = __atomic_load_n(&entry->next, __ATOMIC_ACQUIRE);
+	}
+	if (entry == NULL) {
+		__atomic_store_n(&slot->epoch, 0, __ATOMIC_RELEASE);
+	}
+	return entry;
+};
+
+void KV_LockFreeHashTable::release(QC_entry_t *entry) {
+	__atomic_store_n(&__thr_epoch_slot->epoch, 0, __ATOMIC_RELEASE);
+};
+
+void KV_LockFreeHashTable::empty() {
+	pthread_mutex_lock(&mutex);
+	for (uint64_t i = 0; i <= buckets_mask; i++) {
+		QC_entry_t *qce = buckets[i];
+		__atomic_store_n(&buckets[i], (QC_entry_t *)NULL, __ATOMIC_RELEASE);
+		while (qce) {
+			QC_entry_t *next = qce->next;
+			retire(qce);
+			qce = next;
+		}
+	}
+	pthread_mutex_unlock(&mutex);
+};
+
+void KV_LockFreeHashTable::purge_some(unsigned long long QCnow_ms, bool aggressive) {
+	unsigned long long access_ms_lower_mark=0;
+	pthread_mutex_lock(&mutex);
+	if (aggressive) {
+		unsigned long long access_ms_min=0;
+		unsigned long long access_ms_max=0;
+		for (uint64_t i = 0; i <= buckets_mask; i++) {
+			for (QC_entry_t *qce = buckets[i]; qce != NULL; qce = qce->next) {
+				if (access_ms_min==0 || access_ms_min > qce->access_ms) access_ms_min = qce->access_ms;
+				if (access_ms_max==0 || access_ms_max < qce->access_ms) access_ms_max = qce->access_ms;
+			}
+		}
+		access_ms_lower_mark=access_ms_min+(access_ms_max-access_ms_min)*0.1; // same as KV_BtreeArray::purge_some()
+	}
+	for (uint64_t i = 0; i <= buckets_mask; i++) {
+		QC_entry_t **pp = &buckets[i];
+		while (*pp != NULL) {
+			QC_entry_t *qce = *pp;
+			bool drop_entry = (qce->expire_ms==EXPIRE_DROPIT || qce->expire_ms<QCnow_ms);
+			if (aggressive && qce->access_ms < access_ms_lower_mark) {
+				drop_entry = true;
+			}
+			if (drop_entry) {
+				__atomic_store_n(pp, qce->next, __ATOMIC_RELEASE);
+				retire(qce);
+			} else {
+				pp = &qce->next;
+			}
+		}
+	}
+	reclaim(QC_ENTRY_OVERHEAD);
+	pthread_mutex_unlock(&mutex);
+};
+
+// Entries are retired until 'bytes' are pending, but only the bytes actually released by reclaim()
+// are returned: a retired entry still in use by a reader keeps its memory
+uint64_t KV_LockFreeHashTable::make_room(uint64_t bytes, uint64_t entry_overhead, uint64_t key, uint32_t length, unsigned long long now_ms, QC_frequency_sketch *sketch, bool *rejected) {
+	uint64_t evicted_entries=0;
+	uint64_t retired_bytes=0;
+	unsigned int steps=0;
+	pthread_mutex_lock(&mutex);
+	while (steps<QC_EVICTION_MAX_STEPS && entries && retired_bytes<bytes && *rejected==false) {
+		QC_entry_t **pp = &buckets[clock_hand];
+		steps++;
+		while (*pp != NULL && retired_bytes<bytes) {
+			QC_entry_t *qce = *pp;
+			steps++;
+			if (qce->expire_ms!=EXPIRE_DROPIT && qce->expire_ms>=now_ms) {
+				if (qce->clock_freq) { // accessed since the last sweep, second chance
+					qce->clock_freq--;
+					pp = &qce->next;
+					continue;
+				}
+				if (QC_admit(sketch, key, length, qce)==false) {
+					*rejected=true;
+					break;
+				}
+				evicted_entries++;
+			}
+			__atomic_store_n(pp, qce->next, __ATOMIC_RELEASE);
+			retired_bytes+=QC_entry_size(qce)+entry_overhead;
+			retire(qce);
+		}
+		if (retired_bytes<bytes && *rejected==false) { // the bucket is completed
+			clock_hand = (clock_hand + 1) & buckets_mask;
+		}
+	}
+	uint64_t freed=reclaim(entry_overhead);
+	pthread_mutex_unlock(&mutex);
+	if (evicted_entries) {
+		__sync_fetch_and_add(&Glo_cntEvicted,evicted_entries);
+	}
+	return freed;
+};
+
 using metric_name = std::string;
 using metric_help = std::string;
 using metric_tags = std::map<std::string, std::string>;
@@ -401,7 +830,7 @@ qc_metrics_map = std::make_tuple(
 uint64_t Query_Cache::get_data_size_total() {
 	uint64_t r=0;
 	int i;
-	for (i=0; i<SHARED_QUERY_CACHE_HASH_TABLES; i++) {
+	for (i=0; i<size; i++) {
 		r+=KVs[i]->get_data_size();
 	}
 	r += __sync_fetch_and_add(&Glo_size_values,0);
@@ -425,11 +854,38 @@ Query_Cache::Query_Cache() {
 		perror("Incompatible debugging version");
 		exit(EXIT_FAILURE);
 	}
-	for (int i=0; i<SHARED_QUERY_CACHE_HASH_TABLES; i++) {
-		KVs[i]=new KV_BtreeArray();
+	engine=QUERY_CACHE_ENGINE_BTREE;
+	size=SHARED_QUERY_CACHE_HASH_TABLES;
+	eviction_policy=QUERY_CACHE_EVICTION_TTL;
+	if (GloMTH) {
+		engine=GloMTH->get_variable_int((char *)"query_cache_engine");
+		size=GloMTH->get_variable_int((char *)"query_cache_shards");
+		eviction_policy=GloMTH->get_variable_int((char *)"query_cache_eviction_policy");
+	}
+	for (int p=0; p<QUERY_CACHE_EVICTION_POLICIES; p++) {
+		policy_cntGet[p]=0;
+		policy_cntGetOK[p]=0;
 	}
+	policy_base_cntGet=0;
+	policy_base_cntGetOK=0;
+	sketch=new QC_frequency_sketch();
+	KVs=(KV_Store **)malloc(sizeof(KV_Store *)*size);
+	if (engine==QUERY_CACHE_ENGINE_LOCKFREE) {
+		// about QC_LOCKFREE_TOTAL_BUCKETS buckets in total, as a power of 2 for each shard
+		unsigned int num_buckets = QC_LOCKFREE_MIN_BUCKETS;
+		while (num_buckets * size < QC_LOCKFREE_TOTAL_BUCKETS) {
+			num_buckets *= 2;
+		}
+		for (int i=0; i<size; i++) {
+			KVs[i]=new KV_LockFreeHashTable(num_buckets);
+		}
+	} else {
+		for (int i=0; i<size; i++) {
+			KVs[i]=new KV_BtreeArray();
+		}
+	}
+	proxy_info("Query Cache initialized with engine %s and %d shards\n", (engine==QUERY_CACHE_ENGINE_LOCKFREE ? "lockfree" : "btree"), size);
 	QCnow_ms=monotonic_time()/1000;
-	size=SHARED_QUERY_CACHE_HASH_TABLES;
 	shutdown=0;
 	purge_loop_time=DEFAULT_purge_loop_time;
 	purge_total_time=DEFAULT_purge_total_time;
@@ -458,12 +914,50 @@ void Query_Cache::print_version() {
 };
 
 Query_Cache::~Query_Cache() {
-	unsigned int i;
-	for (i=0; i<SHARED_QUERY_CACHE_HASH_TABLES; i++) {
+	int i;
+	for (i=0; i<size; i++) {
 		delete KVs[i];
 	}
+	free(KVs);
+	delete sketch;
 };
 
+// Called by the purge thread only. GET counters collected so far are attributed to the
+// previous policy, so that hit ratios can be compared between policies
+void Query_Cache::set_eviction_policy(int policy) {
+	if (policy == eviction_policy) return;
+	uint64_t cntGet=__sync_fetch_and_add(&Glo_cntGet,0);
+	uint64_t cntGetOK=__sync_fetch_and_add(&Glo_cntGetOK,0);
+	policy_cntGet[eviction_policy] += cntGet - policy_base_cntGet;
+	policy_cntGetOK[eviction_policy] += cntGetOK - policy_base_cntGetOK;
+	policy_base_cntGet=cntGet;
+	policy_base_cntGetOK=cntGetOK;
+	proxy_info("Query Cache eviction policy changed from %d to %d\n", eviction_policy, policy);
+	__sync_lock_test_and_set(&eviction_policy, policy);
+}
+
+// Makes room for a new value of 'vl' bytes within max_memory_size, evicting from the
+// shard of the new entry first and then from the following ones.
+// Returns false if the new entry should not be stored
+bool Query_Cache::admit(unsigned int shard, uint64_t hk, uint32_t vl, unsigned long long curtime_ms) {
+	uint64_t entry_overhead=QC_ENTRY_OVERHEAD; // see get_data_size()
+	uint64_t needed=vl+entry_overhead;
+	if (needed > max_memory_size) {
+		return false;
+	}
+	uint64_t used=get_data_size_total();
+	if (used + needed <= max_memory_size) {
+		return true;
+	}
+	uint64_t to_free=used + needed - max_memory_size;
+	bool rejected=false;
+	for (int n=0; n<size && to_free && rejected==false; n++) {
+		uint64_t freed=KVs[(shard+n)%size]->make_room(to_free, entry_overhead, hk, vl, curtime_ms, sketch, &rejected);
+		to_free = (freed >= to_free ? 0 : to_free - freed);
+	}
+	return (to_free==0);
+}
+
 const int eof_to_ok_dif = static_cast<const int>(- (sizeof(mysql_hdr) + 5) + 2);
 const int ok_to_eof_dif = static_cast<const int>(+ (sizeof(mysql_hdr) + 5) - 2);
 
@@ -642,16 +1136,25 @@ unsigned char* ok_to_eof_packet(QC_entry_t* entry) {
 	return result;
 }
 
-unsigned char * Query_Cache::get(uint64_t user_hash, const unsigned char *kp, const uint32_t kl, uint32_t *lv, unsigned long long curtime_ms, unsigned long long cache_ttl, bool deprecate_eof_active) {
+// If 'wait_refresh' is not NULL, it is set to true when the entry is expired and another client is
+// already refreshing it: the caller can wait up to query_cache_refresh_wait_ms and call get() again
+unsigned char * Query_Cache::get(uint64_t user_hash, const unsigned char *kp, const uint32_t kl, uint32_t *lv, unsigned long long curtime_ms, unsigned long long cache_ttl, bool deprecate_eof_active, bool *wait_refresh) {
 	unsigned char *result=NULL;
 
 	uint64_t hk=SpookyHash::Hash64(kp, kl, user_hash);
-	unsigned char i=hk%SHARED_QUERY_CACHE_HASH_TABLES;
+	unsigned int i=hk%size;
+
+	bool tinylfu=(eviction_policy==QUERY_CACHE_EVICTION_TINYLFU);
+	if (tinylfu) {
+		sketch->record(hk);
+		THR_UPDATE_CNT(__thr_sketch_samples,sketch->samples,1,64);
+	}
 
 	QC_entry_t *entry=KVs[i]->lookup(hk);
 
 	if (entry!=NULL) {
 		unsigned long long t=curtime_ms;
+		bool serve=false;
 		if (entry->expire_ms > t && entry->create_ms + cache_ttl > t) {
 			if (
 				mysql_thread___query_cache_soft_ttl_pct && !entry->refreshing &&
@@ -665,25 +1168,80 @@ unsigned char * Query_Cache::get(uint64_t user_hash, const unsigned char *kp, co
 				// soft_ttl_pct with value 0 and 100 disables the functionality.
 				entry->refreshing = true;
 			} else {
-				THR_UPDATE_CNT(__thr_cntGetOK,Glo_cntGetOK,1,1);
-				THR_UPDATE_CNT(__thr_dataOUT,Glo_dataOUT,entry->length,1);
-
-				if (deprecate_eof_active && entry->column_eof_pkt_offset) {
-					result = eof_to_ok_packet(entry);
-					*lv = entry->length + eof_to_ok_dif;
-				} else if (!deprecate_eof_active && entry->ok_pkt_offset){
-					result = ok_to_eof_packet(entry);
-					*lv = entry->length + ok_to_eof_dif;
-				} else {
-					result = (unsigned char *)malloc(entry->length);
-					memcpy(result, entry->value, entry->length);
-					*lv = entry->length;
+				serve=true;
+			}
+		} else if (
+			entry->expire_ms!=EXPIRE_DROPIT &&
+			(mysql_thread___query_cache_stale_grace_ms || mysql_thread___query_cache_refresh_wait_ms)
+		) {
+			// The entry is expired. Only one client hits the backend to refresh it: while the
+			// refresh is in process, other clients keep using the expired entry for up to
+			// query_cache_stale_grace_ms , or wait for the new entry for up to
+			// query_cache_refresh_wait_ms . A refresh that didn't complete within both
+			// intervals (query failed, resultset not cacheable) is taken over by the next client.
+			unsigned long long expired_ms = entry->create_ms + cache_ttl;
+			if (entry->expire_ms < expired_ms) expired_ms = entry->expire_ms;
+			unsigned long long grace_ms = mysql_thread___query_cache_stale_grace_ms;
+			unsigned long long wait_ms = mysql_thread___query_cache_refresh_wait_ms;
+			unsigned long long refresh_ms = __sync_fetch_and_add(&entry->refresh_ms,0);
+			bool refresher = false;
+			if (refresh_ms == 0 || t > refresh_ms + (grace_ms > wait_ms ? grace_ms : wait_ms)) {
+				refresher = __sync_bool_compare_and_swap(&entry->refresh_ms, refresh_ms, t);
+			}
+			if (refresher == false) {
+				if (expired_ms + grace_ms > t) {
+					serve=true;
+					__sync_fetch_and_add(&Glo_cntGetStale,1);
+				} else if (wait_ms && wait_refresh) {
+					*wait_refresh=true;
 				}
+			}
+		}
+		if (serve) {
+			THR_UPDATE_CNT(__thr_cntGetOK,Glo_cntGetOK,1,1);
+			THR_UPDATE_CNT(__thr_dataOUT,Glo_dataOUT,entry->length,1);
+
+			// for compressed entries, the conversions below work on a decompressed copy
+			QC_entry_t dentry;
+			QC_entry_t *rentry = entry;
+			unsigned char *decompressed = NULL;
+			if (entry->compressed_length) {
+				decompressed = (unsigned char *)malloc(entry->length);
+				int rc = LZ4_decompress_safe(entry->value, (char *)decompressed, entry->compressed_length, entry->length);
+				if (rc != (int)entry->length) {
+					// LCOV_EXCL_START
+					proxy_error("Failed to decompress Query Cache entry: %d\n", rc);
+					assert(0);
+					// LCOV_EXCL_STOP
+				}
+				dentry = *entry;
+				dentry.value = (char *)decompressed;
+				rentry = &dentry;
+			}
 
-				if (t > entry->access_ms) entry->access_ms=t;
+			if (deprecate_eof_active && rentry->column_eof_pkt_offset) {
+				result = eof_to_ok_packet(rentry);
+				*lv = entry->length + eof_to_ok_dif;
+			} else if (!deprecate_eof_active && rentry->ok_pkt_offset){
+				result = ok_to_eof_packet(rentry);
+				*lv = entry->length + ok_to_eof_dif;
+			} else if (decompressed) {
+				result = decompressed; // already a private copy
+				decompressed = NULL;
+				*lv = entry->length;
+			} else {
+				result = (unsigned char *)malloc(entry->length);
+				memcpy(result, entry->value, entry->length);
+				*lv = entry->length;
 			}
+			if (decompressed) {
+				free(decompressed);
+			}
+
+			if (t > entry->access_ms) entry->access_ms=t;
+			if (tinylfu && entry->clock_freq < QC_CLOCK_MAX_FREQ) entry->clock_freq++;
 		}
-		__sync_fetch_and_sub(&entry->ref_count,1);
+		KVs[i]->release(entry);
 	}
 	return result;
 }
@@ -697,6 +1255,10 @@ bool Query_Cache::set(uint64_t user_hash, const unsigned char *kp, uint32_t kl,
 	entry->row_eof_pkt_offset=0;
 	entry->ok_pkt_offset=0;
 	entry->refreshing=false;
+	entry->refresh_ms=0;
+	entry->compressed_length=0;
+	entry->next=NULL;
+	entry->clock_freq=0;
 
 	// Find the first EOF location
 	unsigned char* it = vp;
@@ -763,14 +1325,40 @@ bool Query_Cache::set(uint64_t user_hash, const unsigned char *kp, uint32_t kl,
 		}
 	}
 
-	entry->value=(char *)malloc(vl);
-	memcpy(entry->value,vp,vl);
+	entry->value=NULL;
+	if (mysql_thread___query_cache_compression && vl >= QC_COMPRESSION_MIN_LENGTH) {
+		// the value is stored compressed only if it saves at least 1/8 of the memory
+		int bound=LZ4_compressBound(vl);
+		char *cbuf=(char *)malloc(bound);
+		int clen=LZ4_compress_default((const char *)vp, cbuf, vl, bound);
+		if (clen > 0 && (uint32_t)clen < vl - vl/8) {
+			entry->value=(char *)realloc(cbuf, clen);
+			entry->compressed_length=clen;
+			__sync_fetch_and_add(&Glo_cntSetCompressed,1);
+		} else {
+			free(cbuf);
+		}
+	}
+	uint64_t hk=SpookyHash::Hash64(kp, kl, user_hash);
+	unsigned int i=hk%size;
+	if (eviction_policy==QUERY_CACHE_EVICTION_TINYLFU) {
+		if (admit(i, hk, QC_entry_size(entry), curtime_ms)==false) {
+			__sync_fetch_and_add(&Glo_cntAdmissionRejected,1);
+			if (entry->value) {
+				free(entry->value);
+			}
+			free(entry);
+			return false;
+		}
+	}
+	if (entry->value==NULL) {
+		entry->value=(char *)malloc(vl);
+		memcpy(entry->value,vp,vl);
+	}
 	entry->self=entry;
 	entry->create_ms=create_ms;
 	entry->access_ms=curtime_ms;
 	entry->expire_ms=expire_ms;
-	uint64_t hk=SpookyHash::Hash64(kp, kl, user_hash);
-	unsigned char i=hk%SHARED_QUERY_CACHE_HASH_TABLES;
 	entry->key=hk;
 	KVs[i]->replace(hk, entry);
 
@@ -780,7 +1368,7 @@ bool Query_Cache::set(uint64_t user_hash, const unsigned char *kp, uint32_t kl,
 uint64_t Query_Cache::flush() {
 	int i;
 	uint64_t total_count=0;
-	for (i=0; i<SHARED_QUERY_CACHE_HASH_TABLES; i++) {
+	for (i=0; i<size; i++) {
 		total_count+=KVs[i]->cnt();
 		KVs[i]->empty();
 	}
@@ -795,6 +1383,7 @@ void * Query_Cache::purgeHash_thread(void *) {
 	set_thread_name("QueryCachePurge");
 	mysql_thr->refresh_variables();
 	max_memory_size = (uint64_t) mysql_thread___query_cache_size_MB*1024*1024;
+	set_eviction_policy(mysql_thread___query_cache_eviction_policy);
 	while (shutdown==0) {
 		usleep(purge_loop_time);
 		unsigned long long t=monotonic_time()/1000;
@@ -805,12 +1394,24 @@ void * Query_Cache::purgeHash_thread(void *) {
 				MySQL_Monitor__thread_MySQL_Thread_Variables_version=glover;
 				mysql_thr->refresh_variables();
 				max_memory_size = (uint64_t) mysql_thread___query_cache_size_MB*1024*1024;
+				set_eviction_policy(mysql_thread___query_cache_eviction_policy);
 			}
 		}
+		bool tinylfu=(eviction_policy==QUERY_CACHE_EVICTION_TINYLFU);
+		if (tinylfu && __sync_fetch_and_add(&sketch->samples,0) >= QC_SKETCH_WIDTH*10) {
+			__sync_fetch_and_sub(&sketch->samples, QC_SKETCH_WIDTH*10);
+			sketch->age();
+		}
 		unsigned int curr_pct=current_used_memory_pct();
 		if (curr_pct < purge_threshold_pct_min ) continue;
-		for (i=0; i<SHARED_QUERY_CACHE_HASH_TABLES; i++) {
-			KVs[i]->purge_some(QCnow_ms, (curr_pct > purge_threshold_pct_max));
+		// expired entries can still be served, or refreshed, for a while
+		unsigned long long expired_ms=QCnow_ms;
+		unsigned long long keep_ms=mysql_thread___query_cache_stale_grace_ms;
+		if (keep_ms < (unsigned long long)mysql_thread___query_cache_refresh_wait_ms) keep_ms=mysql_thread___query_cache_refresh_wait_ms;
+		if (expired_ms > keep_ms) expired_ms-=keep_ms;
+		for (i=0; i<(unsigned int)size; i++) {
+			// with QUERY_CACHE_EVICTION_TINYLFU memory is already bounded by set(), only expired entries are purged
+			KVs[i]->purge_some(expired_ms, (tinylfu==false && curr_pct > purge_threshold_pct_max));
 		}
 	}
 	delete mysql_thr;
@@ -874,6 +1475,52 @@ SQLite3_result * Query_Cache::SQL3_getStats() {
 		pta[1]=buf;
 		result->add_row(pta);
 	}
+	{ // Glo_cntGetStale
+		pta[0]=(char *)"Query_Cache_count_GET_STALE";
+		sprintf(buf,"%lu", Glo_cntGetStale);
+		pta[1]=buf;
+		result->add_row(pta);
+	}
+	{ // Glo_cntSetCompressed
+		pta[0]=(char *)"Query_Cache_count_SET_COMPRESSED";
+		sprintf(buf,"%lu", Glo_cntSetCompressed);
+		pta[1]=buf;
+		result->add_row(pta);
+	}
+	{ // eviction_policy
+		pta[0]=(char *)"Query_Cache_eviction_policy";
+		sprintf(buf,"%s", (eviction_policy==QUERY_CACHE_EVICTION_TINYLFU ? "tinylfu" : "ttl"));
+		pta[1]=buf;
+		result->add_row(pta);
+	}
+	{ // Glo_cntEvicted
+		pta[0]=(char *)"Query_Cache_Evicted";
+		sprintf(buf,"%lu", Glo_cntEvicted);
+		pta[1]=buf;
+		result->add_row(pta);
+	}
+	{ // Glo_cntAdmissionRejected
+		pta[0]=(char *)"Query_Cache_Admission_Rejected";
+		sprintf(buf,"%lu", Glo_cntAdmissionRejected);
+		pta[1]=buf;
+		result->add_row(pta);
+	}
+	{ // hit ratio of GET for each eviction policy, as percentage
+		const char *names[QUERY_CACHE_EVICTION_POLICIES] = { "Query_Cache_hit_ratio_ttl", "Query_Cache_hit_ratio_tinylfu" };
+		int cur_policy=eviction_policy;
+		for (int p=0; p<QUERY_CACHE_EVICTION_POLICIES; p++) {
+			uint64_t cntGet=policy_cntGet[p];
+			uint64_t cntGetOK=policy_cntGetOK[p];
+			if (p==cur_policy) {
+				cntGet += __sync_fetch_and_add(&Glo_cntGet,0) - policy_base_cntGet;
+				cntGetOK += __sync_fetch_and_add(&Glo_cntGetOK,0) - policy_base_cntGetOK;
+			}
+			pta[0]=(char *)names[p];
+			sprintf(buf,"%.2f", (cntGet ? (double)cntGetOK*100/cntGet : 0.0));
+			pta[1]=buf;
+			result->add_row(pta);
+		}
+	}
 	free(pta);
 	return result;
 }
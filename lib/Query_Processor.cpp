@@ -1,8 +1,10 @@
 #include <iostream>     // std::cout
 #include <algorithm>    // std::sort
 #include <vector>       // std::vector
+#include <atomic>
 #include "re2/re2.h"
 #include "re2/regexp.h"
+#include "re2/set.h"
 #include "proxysql.h"
 #include "cpp.h"
 
@@ -52,6 +54,21 @@ struct __RE2_objects_t {
 
 typedef struct __RE2_objects_t re2_t;
 
+// Multi-pattern matcher for all the rules sharing the same flagIN, see 'mysql-query_processor_regex_set'.
+// 'set1' holds every 'match_digest' and 'set2' every 'match_pattern': a single scan of the digest
+// text (or of the query) returns all the rules whose regex matches, in place of one match per rule.
+struct __RE2_set_objects_t {
+	re2::RE2::Set *set1;
+	re2::RE2::Set *set2;
+	int size1;
+	int size2;
+	// set if the DFA exceeded its memory budget, rules fallback to their own regex.
+	// The sets are shared by all the threads through the rules snapshot, and any of them can set it
+	std::atomic<bool> disabled;
+};
+
+typedef struct __RE2_set_objects_t re2_set_t;
+
 static bool rules_sort_comp_function (QP_rule_t * a, QP_rule_t * b) { return (a->rule_id < b->rule_id); }
 
 
@@ -87,13 +104,13 @@ static unsigned long long mem_used_rule(QP_rule_t *qr) {
 	return s;
 }
 
-static re2_t * compile_query_rule(QP_rule_t *qr, int i) {
+static re2_t * compile_query_rule(QP_rule_t *qr, int i, int regex_engine) {
 	re2_t *r=(re2_t *)malloc(sizeof(re2_t));
 	r->opt1=NULL;
 	r->re1=NULL;
 	r->opt2=NULL;
 	r->re2=NULL;
-	if (mysql_thread___query_processor_regex==2) {
+	if (regex_engine==2) {
 		r->opt2=new re2::RE2::Options(RE2::Quiet);
 		if ((qr->re_modifiers & QP_RE_MOD_CASELESS) == QP_RE_MOD_CASELESS) {
 			r->opt2->set_case_sensitive(false);
@@ -117,6 +134,268 @@ static re2_t * compile_query_rule(QP_rule_t *qr, int i) {
 	return r;
 };
 
+static void __delete_regex_sets(std::unordered_map<int, re2_set_t *> *rss) {
+	if (rss==NULL) return;
+	for (std::unordered_map<int, re2_set_t *>::iterator it=rss->begin(); it!=rss->end(); ++it) {
+		re2_set_t *rs=it->second;
+		if (rs->set1) { delete rs->set1; rs->set1=NULL; }
+		if (rs->set2) { delete rs->set2; rs->set2=NULL; }
+		delete rs;
+	}
+	delete rss;
+}
+
+static int add_to_regex_set(re2_set_t *rs, int i, QP_rule_t *qr) {
+	re2::RE2::Set **set = (i==1 ? &rs->set1 : &rs->set2);
+	if (*set==NULL) {
+		re2::RE2::Options opt2(RE2::Quiet);
+		*set=new re2::RE2::Set(opt2, RE2::UNANCHORED);
+	}
+	std::string pattern = (i==1 ? qr->match_digest : qr->match_pattern);
+	if ((qr->re_modifiers & QP_RE_MOD_CASELESS) == QP_RE_MOD_CASELESS) {
+		// all the patterns of a set share the same options, caseless is applied inline
+		pattern = "(?i)" + pattern;
+	}
+	int idx=(*set)->Add(pattern, NULL);
+	if (idx >= 0) {
+		if (i==1) rs->size1++; else rs->size2++;
+	}
+	return idx;
+}
+
+// Compiles one 'RE2::Set' per flagIN for all the 'match_digest' and one for all the 'match_pattern'
+// of the supplied rules, storing in every rule the index of its regexes inside the sets.
+// Rules whose regex can't be part of a set keep index -1 and are evaluated with their own regex.
+static std::unordered_map<int, re2_set_t *> * compile_query_rules_regex_sets(std::vector<QP_rule_t *> *qrs) {
+	std::unordered_map<int, re2_set_t *> *rss = new std::unordered_map<int, re2_set_t *>();
+	for (std::vector<QP_rule_t *>::iterator it=qrs->begin(); it!=qrs->end(); ++it) {
+		QP_rule_t *qr=*it;
+		if (qr->match_digest==NULL && qr->match_pattern==NULL) continue;
+		re2_set_t *rs=NULL;
+		std::unordered_map<int, re2_set_t *>::iterator it2=rss->find(qr->flagIN);
+		if (it2==rss->end()) {
+			rs=new re2_set_t();
+			rs->set1=NULL;
+			rs->set2=NULL;
+			rs->size1=0;
+			rs->size2=0;
+			rs->disabled=false;
+			rss->insert(std::make_pair(qr->flagIN, rs));
+		} else {
+			rs=it2->second;
+		}
+		if (qr->match_digest) {
+			qr->regex_set_idx1=add_to_regex_set(rs, 1, qr);
+		}
+		if (qr->match_pattern) {
+			qr->regex_set_idx2=add_to_regex_set(rs, 2, qr);
+		}
+	}
+	for (std::unordered_map<int, re2_set_t *>::iterator it=rss->begin(); it!=rss->end(); ++it) {
+		re2_set_t *rs=it->second;
+		if (rs->set1 && rs->set1->Compile()==false) {
+			proxy_error("Unable to compile the match_digest regex set for flagIN %d, rules will be matched one by one\n", it->first);
+			delete rs->set1;
+			rs->set1=NULL;
+		}
+		if (rs->set2 && rs->set2->Compile()==false) {
+			proxy_error("Unable to compile the match_pattern regex set for flagIN %d, rules will be matched one by one\n", it->first);
+			delete rs->set2;
+			rs->set2=NULL;
+		}
+	}
+	for (std::vector<QP_rule_t *>::iterator it=qrs->begin(); it!=qrs->end(); ++it) {
+		QP_rule_t *qr=*it;
+		std::unordered_map<int, re2_set_t *>::iterator it2=rss->find(qr->flagIN);
+		if (it2==rss->end()) continue;
+		if (it2->second->set1==NULL) qr->regex_set_idx1=-1;
+		if (it2->second->set2==NULL) qr->regex_set_idx2=-1;
+	}
+	return rss;
+}
+
+// Lazily computed results of the regex sets for the query being processed. Results are computed
+// on first use for each flagIN, and are reused by all the following rules with the same flagIN.
+struct regex_set_matches_t {
+	std::unordered_map<int, re2_set_t *> *rss;
+	re2_set_t *rs;
+	int flagIN;
+	int status[2]; // 0: not computed yet, 1: computed, -1: not available
+	std::vector<char> *matches[2];
+	std::vector<int> *idxs;
+
+	regex_set_matches_t(std::unordered_map<int, re2_set_t *> *_rss) {
+		static thread_local std::vector<char> m1;
+		static thread_local std::vector<char> m2;
+		static thread_local std::vector<int> v;
+		rss=_rss;
+		rs=NULL;
+		flagIN=-1;
+		status[0]=0;
+		status[1]=0;
+		matches[0]=&m1;
+		matches[1]=&m2;
+		idxs=&v;
+	}
+	/**
+	 * @brief Returns if the regex with index 'idx' in set 'i' (1 for 'match_digest', 2 for 'match_pattern')
+	 *  of 'flagIN' matches 'text'.
+	 * @return 1 on match, 0 on no match, -1 if the set can't be used and the rule regex must be used instead.
+	 */
+	int match(int _flagIN, int i, const char *text, int idx) {
+		if (rs==NULL || flagIN!=_flagIN) {
+			std::unordered_map<int, re2_set_t *>::iterator it=rss->find(_flagIN);
+			if (it==rss->end()) return -1;
+			rs=it->second;
+			flagIN=_flagIN;
+			status[0]=0;
+			status[1]=0;
+		}
+		if (status[i-1]==0) {
+			re2::RE2::Set *set=(i==1 ? rs->set1 : rs->set2);
+			status[i-1]=-1;
+			if (set && rs->disabled.load(std::memory_order_relaxed)==false) {
+				re2::RE2::Set::ErrorInfo err;
+				bool rc=set->Match(text, idxs, &err);
+				if (rc==false && err.kind!=re2::RE2::Set::kNoError) {
+					proxy_warning("Regex set for flagIN %d failed with error %d, rules will be matched one by one\n", flagIN, err.kind);
+					rs->disabled.store(true, std::memory_order_relaxed);
+				} else {
+					std::vector<char> *m=matches[i-1];
+					m->assign((i==1 ? rs->size1 : rs->size2), 0);
+					for (std::vector<int>::iterator it=idxs->begin(); it!=idxs->end(); ++it) {
+						(*m)[*it]=1;
+					}
+					status[i-1]=1;
+				}
+			}
+		}
+		if (status[i-1]==1) {
+			return (*matches[i-1])[idx];
+		}
+		return -1;
+	}
+};
+
+// Per-thread index over the rules table, partitioning the rules by flagIN, username and schemaname.
+// Rules without username (or schemaname) are indexed with an empty one, as they match any value.
+// Every list holds the positions of the rules in the rules table, in the same order of the table.
+struct QP_rules_index_t {
+	khash_t(khStrInt) *map; // "<flagIN><rand_del><username><rand_del><schemaname>" -> position in 'lists'
+	char *keys;
+	std::vector<std::vector<unsigned int>> lists;
+};
+
+static void __delete_rules_index(QP_rules_index_t *ri) {
+	if (ri==NULL) return;
+	if (ri->map) {
+		kh_destroy(khStrInt, ri->map);
+	}
+	if (ri->keys) {
+		free(ri->keys);
+	}
+	delete ri;
+}
+
+static size_t rules_index_key_len(const char *rand_del, const char *u, const char *s) {
+	return strlen(u)+strlen(s)+2*strlen(rand_del)+12; // 12 is enough for flagIN and NULL
+}
+
+static void rules_index_key(char *buf, const char *rand_del, int flagIN, const char *u, const char *s) {
+	sprintf(buf, "%d%s%s%s%s", flagIN, rand_del, u, rand_del, s);
+}
+
+static QP_rules_index_t * build_query_rules_index(std::vector<QP_rule_t *> *qrs, const char *rand_del) {
+	QP_rules_index_t *ri=new QP_rules_index_t();
+	ri->map=kh_init(khStrInt);
+	ri->keys=NULL;
+	size_t tot_size=0;
+	for (std::vector<QP_rule_t *>::iterator it=qrs->begin(); it!=qrs->end(); ++it) {
+		QP_rule_t *qr=*it;
+		tot_size+=rules_index_key_len(rand_del, (qr->username ? qr->username : ""), (qr->schemaname ? qr->schemaname : ""));
+	}
+	if (tot_size==0) {
+		return ri;
+	}
+	// all the keys are stored in a single buffer, khash only keeps pointers to them
+	ri->keys=(char *)malloc(tot_size);
+	char *ptr=ri->keys;
+	unsigned int pos=0;
+	for (std::vector<QP_rule_t *>::iterator it=qrs->begin(); it!=qrs->end(); ++it, pos++) {
+		QP_rule_t *qr=*it;
+		rules_index_key(ptr, rand_del, qr->flagIN, (qr->username ? qr->username : ""), (qr->schemaname ? qr->schemaname : ""));
+		int ret;
+		khiter_t k=kh_put(khStrInt, ri->map, ptr, &ret);
+		if (ret==0) {
+			// key already present
+			ri->lists[kh_value(ri->map, k)].push_back(pos);
+		} else {
+			kh_value(ri->map, k)=ri->lists.size();
+			ri->lists.push_back(std::vector<unsigned int>(1, pos));
+			ptr+=strlen(ptr)+1;
+		}
+	}
+	return ri;
+}
+
+// Iterates, in rule order, the rules that may match a given flagIN, username and schemaname: these are
+// the union of at most four lists of the index, the exact and wildcard values of username and schemaname.
+struct QP_rules_cursor_t {
+	const std::vector<unsigned int> *lists[4];
+	size_t idx[4];
+	int n;
+
+	void init(QP_rules_index_t *ri, const char *rand_del, int flagIN, const char *u, const char *s, unsigned int from) {
+		n=0;
+		if (ri==NULL || ri->keys==NULL) return;
+		const char *us[4] = { u, u, "", "" };
+		const char *ss[4] = { s, "", s, "" };
+		char keybuf[256];
+		char *keybuf_ptr=keybuf;
+		size_t keylen=rules_index_key_len(rand_del, u, s);
+		if (keylen > sizeof(keybuf)) {
+			keybuf_ptr=(char *)malloc(keylen);
+		}
+		for (int i=0; i<4; i++) {
+			if ((i==1 && s[0]==0) || (i==2 && u[0]==0) || (i==3 && (u[0]==0 || s[0]==0))) {
+				continue; // same key of a previous combination
+			}
+			rules_index_key(keybuf_ptr, rand_del, flagIN, us[i], ss[i]);
+			khiter_t k=kh_get(khStrInt, ri->map, keybuf_ptr);
+			if (k!=kh_end(ri->map)) {
+				const std::vector<unsigned int> *l=&ri->lists[kh_val(ri->map, k)];
+				size_t j=std::lower_bound(l->begin(), l->end(), from) - l->begin();
+				if (j < l->size()) {
+					lists[n]=l;
+					idx[n]=j;
+					n++;
+				}
+			}
+		}
+		if (keylen > sizeof(keybuf)) {
+			free(keybuf_ptr);
+		}
+	}
+	// returns the position of the next rule, or -1 if there are no more rules
+	int next() {
+		int ret=-1;
+		int m=-1;
+		for (int i=0; i<n; i++) {
+			if (idx[i] < lists[i]->size()) {
+				int p=(*lists[i])[idx[i]];
+				if (ret==-1 || p < ret) {
+					ret=p;
+					m=i;
+				}
+			}
+		}
+		if (m>=0) {
+			idx[m]++;
+		}
+		return ret;
+	}
+};
+
 static void __delete_query_rule(QP_rule_t *qr) {
 	proxy_debug(PROXY_DEBUG_MYSQL_QUERY_PROCESSOR, 5, "Deleting rule in %p : rule_id:%d, active:%d, username=%s, schemaname=%s, flagIN:%d, %smatch_pattern=\"%s\", flagOUT:%d replace_pattern=\"%s\", destination_hostgroup:%d, apply:%d\n", qr, qr->rule_id, qr->active, qr->username, qr->schemaname, qr->flagIN, (qr->negate_match_pattern ? "(!)" : "") , qr->match_pattern, qr->flagOUT, qr->replace_pattern, qr->destination_hostgroup, qr->apply);
 	if (qr->username)
@@ -169,7 +448,7 @@ static void __delete_query_rule(QP_rule_t *qr) {
 // delete all the query rules in a Query Processor Table
 // Note that this function is called by:
 //  - GloQPro with &rules (generic table). In Query_Processor destrutor.
-//  - Each mysql thread with _thr_SQP_rules (per thread table). During destruction or rules recreation.
+//  - Query_Processor with the rules of a QP_rules_snapshot_t , when the last reference to the snapshot is released.
 //  - ProxySQL_Admin at 'load_mysql_variables_to_runtime', during global rules recreation. For this case, the
 //    function is used outside the 'Query_Processor' due to flow present in 'load_mysql_variables_to_runtime'
 //    of freeing the previous resources associated to the 'query_rules' and 'query_rules_fast_routing' out of
@@ -185,11 +464,81 @@ void __reset_rules(std::vector<QP_rule_t *> * qrs) {
 	qrs->clear();
 }
 
+// Immutable copy of the active query rules, compiled once in Query_Processor::commit() and shared by all
+// the mysql threads. Each thread holds a reference to the snapshot it is using, and the snapshot is freed
+// when the last reference is released: either by commit() publishing a newer one, or by a thread that
+// passed a quiescent point (refresh in process_mysql_query(), update_query_processor_stats() or end_thread())
+struct QP_rules_snapshot_t {
+	unsigned int version;
+	int refcnt;
+	std::vector<QP_rule_t *> rules; // only active rules, each with 'parent' pointing to the global rule. They own the hits
+	std::unordered_map<int, re2_set_t *> * regex_sets;
+	QP_rules_index_t * rules_index;
+	// copy of 'rules_fast_routing', only when query_rules_fast_routing_algorithm=1
+	khash_t(khStrInt) * rules_fast_routing;
+	char * rules_fast_routing___keys_values;
+};
+
+static void acquire_rules_snapshot(QP_rules_snapshot_t *snap) {
+	if (snap==NULL) return;
+	__sync_add_and_fetch(&snap->refcnt,1);
+}
+
+static void release_rules_snapshot(QP_rules_snapshot_t *snap) {
+	if (snap==NULL) return;
+	if (__sync_sub_and_fetch(&snap->refcnt,1) > 0) return;
+	proxy_debug(PROXY_DEBUG_MYSQL_QUERY_PROCESSOR, 4, "Freeing Query Rules snapshot with version=%d\n", snap->version);
+	__reset_rules(&snap->rules);
+	__delete_regex_sets(snap->regex_sets);
+	__delete_rules_index(snap->rules_index);
+	if (snap->rules_fast_routing) {
+		kh_destroy(khStrInt, snap->rules_fast_routing);
+	}
+	if (snap->rules_fast_routing___keys_values) {
+		free(snap->rules_fast_routing___keys_values);
+	}
+	delete snap;
+}
+
 // per thread variables
 __thread unsigned int _thr_SQP_version;
-__thread std::vector<QP_rule_t *> * _thr_SQP_rules;
-__thread khash_t(khStrInt) * _thr_SQP_rules_fast_routing;
-__thread char * _thr___rules_fast_routing___keys_values;
+__thread QP_rules_snapshot_t * _thr_SQP_snapshot;
+// per thread hits of the rules in _thr_SQP_snapshot , indexed by rule position
+__thread unsigned long long * _thr_SQP_rules_hits;
+
+// Digests accumulated by a single mysql thread. The owning thread is the only writer: 'mutex' is
+// contended only while the maps are swapped out to be merged into the global 'digest_umap'
+struct QP_digest_buffer_t {
+	pthread_mutex_t mutex;
+	umap_query_digest digest_umap;
+	umap_query_digest_text digest_text_umap;
+};
+__thread QP_digest_buffer_t * _thr_digest_buffer;
+
+// Moves the entries of 'src' into 'dst', aggregating the stats of the digests present in both maps
+static void merge_query_digests(
+	umap_query_digest& dst, umap_query_digest_text& dst_text, umap_query_digest& src, umap_query_digest_text& src_text
+) {
+	for (const auto& element : src) {
+		std::unordered_map<uint64_t, void *>::iterator it = dst.find(element.first);
+		QP_query_digest_stats *qds = (QP_query_digest_stats *)element.second;
+		if (it != dst.end()) {
+			// found
+			QP_query_digest_stats *qds_equal = (QP_query_digest_stats *)it->second;
+			qds_equal->add_stats(qds);
+			delete qds;
+		} else {
+			dst.insert(element);
+		}
+	}
+	src.clear();
+	for (const auto& element : src_text) {
+		if (dst_text.insert(element).second == false) {
+			free(element.second);
+		}
+	}
+	src_text.clear();
+}
 __thread Command_Counter * _thr_commands_counters[MYSQL_COM_QUERY___NONE];
 
 Query_Processor::Query_Processor() {
@@ -215,6 +564,10 @@ Query_Processor::Query_Processor() {
 
 	pthread_rwlock_init(&rwlock, NULL);
 	pthread_rwlock_init(&digest_rwlock, NULL);
+	pthread_mutex_init(&digest_buffers_mutex, NULL);
+	pthread_mutex_init(&digest_snapshot_mutex, NULL);
+	pthread_cond_init(&digest_snapshot_cond, NULL);
+	digest_snapshot_refs = 0;
 	version=0;
 	rules_mem_used=0;
 	for (int i=0; i<MYSQL_COM_QUERY___NONE; i++) commands_counters[i]=new Command_Counter(i);
@@ -293,6 +646,7 @@ Query_Processor::Query_Processor() {
 	rules_fast_routing = nullptr;
 	rules_fast_routing___keys_values = NULL;
 	rules_fast_routing___keys_values___size = 0;
+	rules_snapshot = NULL;
 	new_req_conns_count = 0;
 	if (GloMTH) {
 		query_rules_fast_routing_algorithm = GloMTH->get_variable_int("query_rules_fast_routing_algorithm");
@@ -301,6 +655,8 @@ Query_Processor::Query_Processor() {
 
 Query_Processor::~Query_Processor() {
 	for (int i=0; i<MYSQL_COM_QUERY___NONE; i++) delete commands_counters[i];
+	release_rules_snapshot(rules_snapshot);
+	rules_snapshot = NULL;
 	__reset_rules(&rules);
 	if (rules_fast_routing) {
 		kh_destroy(khStrInt, rules_fast_routing);
@@ -310,6 +666,12 @@ Query_Processor::~Query_Processor() {
 		rules_fast_routing___keys_values = NULL;
 		rules_fast_routing___keys_values___size = 0;
 	}
+	merge_digest_buffers();
+	for (std::vector<QP_digest_buffer_t *>::iterator it=digest_buffers.begin(); it!=digest_buffers.end(); ++it) {
+		pthread_mutex_destroy(&(*it)->mutex);
+		delete *it;
+	}
+	digest_buffers.clear();
 	for (std::unordered_map<uint64_t, void *>::iterator it=digest_umap.begin(); it!=digest_umap.end(); ++it) {
 		QP_query_digest_stats *qds=(QP_query_digest_stats *)it->second;
 		delete qds;
@@ -341,32 +703,66 @@ Query_Processor::~Query_Processor() {
 	}
 };
 
-// This function is called by each thread when it starts. It create a Query Processor Table for each thread
+// This function is called by each thread when it starts. The thread acquires a Query Rules snapshot on demand
 void Query_Processor::init_thread() {
 	proxy_debug(PROXY_DEBUG_MYSQL_QUERY_PROCESSOR, 4, "Initializing Per-Thread Query Processor Table with version=0\n");
 	_thr_SQP_version=0;
-	_thr_SQP_rules=new std::vector<QP_rule_t *>;
-	// per-thread 'rules_fast_routing' structures are created on demand
-	_thr_SQP_rules_fast_routing = nullptr;
-	_thr___rules_fast_routing___keys_values = NULL;
+	_thr_SQP_snapshot=NULL;
+	_thr_SQP_rules_hits=NULL;
 	for (int i=0; i<MYSQL_COM_QUERY___NONE; i++) _thr_commands_counters[i] = new Command_Counter(i);
 };
 
 
+void Query_Processor::init_thread_digest_buffer() {
+	QP_digest_buffer_t *db = new QP_digest_buffer_t();
+	pthread_mutex_init(&db->mutex, NULL);
+	pthread_mutex_lock(&digest_buffers_mutex);
+	digest_buffers.push_back(db);
+	pthread_mutex_unlock(&digest_buffers_mutex);
+	_thr_digest_buffer = db;
+}
+
 void Query_Processor::end_thread() {
 	proxy_debug(PROXY_DEBUG_MYSQL_QUERY_PROCESSOR, 4, "Destroying Per-Thread Query Processor Table with version=%d\n", _thr_SQP_version);
-	__reset_rules(_thr_SQP_rules);
-	delete _thr_SQP_rules;
-	if (_thr_SQP_rules_fast_routing) {
-		kh_destroy(khStrInt, _thr_SQP_rules_fast_routing);
-	}
-	if (_thr___rules_fast_routing___keys_values) {
-		free(_thr___rules_fast_routing___keys_values);
-		_thr___rules_fast_routing___keys_values = NULL;
+	if (_thr_digest_buffer) {
+		QP_digest_buffer_t *db = _thr_digest_buffer;
+		pthread_mutex_lock(&digest_buffers_mutex);
+		digest_buffers.erase(std::remove(digest_buffers.begin(), digest_buffers.end(), db), digest_buffers.end());
+		pthread_mutex_unlock(&digest_buffers_mutex);
+		pthread_rwlock_wrlock(&digest_rwlock);
+		merge_query_digests(digest_umap, digest_text_umap, db->digest_umap, db->digest_text_umap);
+		pthread_rwlock_unlock(&digest_rwlock);
+		pthread_mutex_destroy(&db->mutex);
+		delete db;
+		_thr_digest_buffer = NULL;
+	}
+	release_rules_snapshot(_thr_SQP_snapshot);
+	_thr_SQP_snapshot=NULL;
+	if (_thr_SQP_rules_hits) {
+		free(_thr_SQP_rules_hits);
+		_thr_SQP_rules_hits=NULL;
 	}
 	for (int i=0; i<MYSQL_COM_QUERY___NONE; i++) delete _thr_commands_counters[i];
 };
 
+// Replaces the thread's Query Rules snapshot with the current one.
+// Caller must hold the read lock
+void Query_Processor::refresh_thread_rules_snapshot() {
+	_thr_SQP_version=__sync_add_and_fetch(&version,0);
+	if (_thr_SQP_snapshot != rules_snapshot) {
+		acquire_rules_snapshot(rules_snapshot);
+		release_rules_snapshot(_thr_SQP_snapshot);
+		_thr_SQP_snapshot = rules_snapshot;
+	}
+	if (_thr_SQP_rules_hits) {
+		free(_thr_SQP_rules_hits);
+		_thr_SQP_rules_hits=NULL;
+	}
+	if (_thr_SQP_snapshot && _thr_SQP_snapshot->rules.size()) {
+		_thr_SQP_rules_hits=(unsigned long long *)calloc(_thr_SQP_snapshot->rules.size(), sizeof(unsigned long long));
+	}
+}
+
 void Query_Processor::print_version() {
 	fprintf(stderr,"Standard Query Processor rev. %s -- %s -- %s\n", QUERY_PROCESSOR_VERSION, __FILE__, __TIMESTAMP__);
 };
@@ -439,6 +835,8 @@ QP_rule_t * Query_Processor::new_query_rule(int rule_id, bool active, char *user
 	newQR->comment=(comment ? strdup(comment) : NULL); // see issue #643
 	newQR->regex_engine1=NULL;
 	newQR->regex_engine2=NULL;
+	newQR->regex_set_idx1=-1;
+	newQR->regex_set_idx2=-1;
 	newQR->hits=0;
 
 	newQR->client_addr_wildcard_position = -1; // not existing by default
@@ -558,10 +956,100 @@ void Query_Processor::sort(bool lock) {
 		pthread_rwlock_unlock(&rwlock);
 };
 
-// when commit is called, the version number is increased and the this will trigger the mysql threads to get a new Query Processor Table
-// The operation is asynchronous
+// Builds an immutable copy of the active rules: regexes, regex sets, rules index and, when
+// query_rules_fast_routing_algorithm=1, 'rules_fast_routing' are created only once for all the threads.
+// Caller must hold the write lock
+QP_rules_snapshot_t * Query_Processor::build_rules_snapshot() {
+	int regex_engine = 1;
+	bool regex_set = false;
+	if (GloMTH) {
+		regex_engine = GloMTH->get_variable_int((char *)"query_processor_regex");
+		regex_set = GloMTH->get_variable_int((char *)"query_processor_regex_set");
+	}
+	QP_rules_snapshot_t *snap = new QP_rules_snapshot_t();
+	snap->version = version + 1;
+	snap->refcnt = 1; // reference owned by 'rules_snapshot'
+	snap->regex_sets = NULL;
+	snap->rules_index = NULL;
+	snap->rules_fast_routing = nullptr;
+	snap->rules_fast_routing___keys_values = NULL;
+	QP_rule_t *qr1;
+	QP_rule_t *qr2;
+	for (std::vector<QP_rule_t *>::iterator it=rules.begin(); it!=rules.end(); ++it) {
+		qr1=*it;
+		if (qr1->active) {
+			proxy_debug(PROXY_DEBUG_MYSQL_QUERY_PROCESSOR, 4, "Copying Query Rule id: %d\n", qr1->rule_id);
+			char buf[20];
+			if (qr1->digest) { // not 0
+				sprintf(buf,"0x%016llX", (long long unsigned int)qr1->digest);
+			}
+			std::string re_mod;
+			re_mod="";
+			if ((qr1->re_modifiers & QP_RE_MOD_CASELESS) == QP_RE_MOD_CASELESS) re_mod = "CASELESS";
+			if ((qr1->re_modifiers & QP_RE_MOD_GLOBAL) == QP_RE_MOD_GLOBAL) {
+				if (re_mod.length()) {
+					re_mod = re_mod + ",";
+				}
+				re_mod = re_mod + "GLOBAL";
+			}
+			qr2=new_query_rule(qr1->rule_id, qr1->active, qr1->username, qr1->schemaname, qr1->flagIN,
+				qr1->client_addr, qr1->proxy_addr, qr1->proxy_port,
+				( qr1->digest ? buf : NULL ) ,
+				qr1->match_digest, qr1->match_pattern, qr1->negate_match_pattern, (char *)re_mod.c_str(),
+				qr1->flagOUT, qr1->replace_pattern, qr1->destination_hostgroup,
+				qr1->cache_ttl, qr1->cache_empty_result, qr1->cache_timeout,
+				qr1->reconnect, qr1->timeout, qr1->retries, qr1->delay,
+				qr1->next_query_flagIN, qr1->mirror_flagOUT, qr1->mirror_hostgroup,
+				qr1->error_msg, qr1->OK_msg, qr1->sticky_conn, qr1->multiplex,
+				qr1->gtid_from_hostgroup,
+				qr1->log, qr1->apply,
+				qr1->attributes,
+				qr1->comment);
+			qr2->parent=qr1;	// pointer to the global rule. The hits are counted in the copy, see get_stats_query_rules()
+			if (qr2->match_digest) {
+				proxy_debug(PROXY_DEBUG_MYSQL_QUERY_PROCESSOR, 4, "Compiling regex for rule_id: %d, match_digest: %s\n", qr2->rule_id, qr2->match_digest);
+				qr2->regex_engine1=(void *)compile_query_rule(qr2,1,regex_engine);
+			}
+			if (qr2->match_pattern) {
+				proxy_debug(PROXY_DEBUG_MYSQL_QUERY_PROCESSOR, 4, "Compiling regex for rule_id: %d, match_pattern: %s\n", qr2->rule_id, qr2->match_pattern);
+				qr2->regex_engine2=(void *)compile_query_rule(qr2,2,regex_engine);
+			}
+			snap->rules.push_back(qr2);
+		}
+	}
+	if (regex_engine==2 && regex_set) {
+		// RE2::Set supports only RE2 syntax: multi-pattern matching isn't available with PCRE
+		proxy_debug(PROXY_DEBUG_MYSQL_QUERY_PROCESSOR, 4, "Compiling regex sets for %lu rules\n", snap->rules.size());
+		snap->regex_sets = compile_query_rules_regex_sets(&snap->rules);
+	}
+	snap->rules_index = build_query_rules_index(&snap->rules, rand_del);
+	if (this->query_rules_fast_routing_algorithm == 1 && rules_fast_routing___keys_values___size) {
+		snap->rules_fast_routing = kh_init(khStrInt); // create a hashtable
+		snap->rules_fast_routing___keys_values = (char *)malloc(rules_fast_routing___keys_values___size);
+		memcpy(snap->rules_fast_routing___keys_values, rules_fast_routing___keys_values, rules_fast_routing___keys_values___size);
+		char *ptr = snap->rules_fast_routing___keys_values;
+		while (ptr < snap->rules_fast_routing___keys_values + rules_fast_routing___keys_values___size) {
+			char *ptr2 = ptr+strlen(ptr)+1;
+			int destination_hostgroup = atoi(ptr2);
+			int ret;
+			khiter_t k = kh_put(khStrInt, snap->rules_fast_routing, ptr, &ret); // add the key
+			kh_value(snap->rules_fast_routing, k) = destination_hostgroup; // set the value of the key
+			ptr = ptr2+strlen(ptr2)+1;
+		}
+	}
+	return snap;
+}
+
+// when commit is called, a new Query Rules snapshot is published and the version number is increased:
+// this will trigger the mysql threads to switch to the new snapshot. The operation is asynchronous.
+// Caller must hold the write lock
 void Query_Processor::commit() {
+	QP_rules_snapshot_t *snap = build_rules_snapshot();
+	QP_rules_snapshot_t *prev_snap = rules_snapshot;
+	rules_snapshot = snap;
 	__sync_add_and_fetch(&version,1);
+	// threads still using the previous snapshot hold their own reference
+	release_rules_snapshot(prev_snap);
 	proxy_debug(PROXY_DEBUG_MYSQL_QUERY_PROCESSOR, 4, "Increasing version number to %d - all threads will notice this and refresh their rules\n", version);
 };
 
@@ -597,9 +1085,11 @@ SQLite3_result * Query_Processor::get_stats_query_rules() {
 	QP_rule_t *qr1;
 	result->add_column_definition(SQLITE_TEXT,"rule_id");
 	result->add_column_definition(SQLITE_TEXT,"hits");
-	for (std::vector<QP_rule_t *>::iterator it=rules.begin(); it!=rules.end(); ++it) {
-		qr1=*it;
-		if (qr1->active) {
+	// the threads update the hits of the rules in the current snapshot: it has only the active rules, in the
+	// same order of 'rules' , and it is replaced only when the rules are reloaded, resetting the hits
+	if (rules_snapshot) {
+		for (std::vector<QP_rule_t *>::iterator it=rules_snapshot->rules.begin(); it!=rules_snapshot->rules.end(); ++it) {
+			qr1=*it;
 			QP_rule_text_hitsonly *qt=new QP_rule_text_hitsonly(qr1);
 			proxy_debug(PROXY_DEBUG_MYSQL_QUERY_PROCESSOR, 4, "Dumping Query Rule id: %d\n", qr1->rule_id);
 			result->add_row(qt->pta);
@@ -873,13 +1363,46 @@ void * purge_query_digests_parallel(void *_arg) {
 	return NULL;
 }
 
+void Query_Processor::merge_digest_buffers() {
+	umap_query_digest digest_umap_aux;
+	umap_query_digest_text digest_text_umap_aux;
+	pthread_mutex_lock(&digest_buffers_mutex);
+	for (std::vector<QP_digest_buffer_t *>::iterator it=digest_buffers.begin(); it!=digest_buffers.end(); ++it) {
+		QP_digest_buffer_t *db = *it;
+		umap_query_digest du;
+		umap_query_digest_text dtu;
+		// the thread owning the buffer is blocked only for the swap
+		pthread_mutex_lock(&db->mutex);
+		db->digest_umap.swap(du);
+		db->digest_text_umap.swap(dtu);
+		pthread_mutex_unlock(&db->mutex);
+		merge_query_digests(digest_umap_aux, digest_text_umap_aux, du, dtu);
+	}
+	pthread_mutex_unlock(&digest_buffers_mutex);
+	if (digest_umap_aux.size() || digest_text_umap_aux.size()) {
+		pthread_rwlock_wrlock(&digest_rwlock);
+		merge_query_digests(digest_umap, digest_text_umap, digest_umap_aux, digest_text_umap_aux);
+		pthread_rwlock_unlock(&digest_rwlock);
+	}
+}
+
+void Query_Processor::wait_query_digests_snapshot() {
+	pthread_mutex_lock(&digest_snapshot_mutex);
+	while (digest_snapshot_refs > 0) {
+		pthread_cond_wait(&digest_snapshot_cond, &digest_snapshot_mutex);
+	}
+}
+
 unsigned long long Query_Processor::purge_query_digests(bool async_purge, bool parallel, char **msg) {
 	unsigned long long ret = 0;
+	wait_query_digests_snapshot();
+	merge_digest_buffers();
 	if (async_purge) {
 		ret = purge_query_digests_async(msg);
 	} else {
 		ret = purge_query_digests_sync(parallel);
 	}
+	pthread_mutex_unlock(&digest_snapshot_mutex);
 	return ret;
 }
 
@@ -964,6 +1487,8 @@ unsigned long long Query_Processor::purge_query_digests_sync(bool parallel) {
 
 unsigned long long Query_Processor::get_query_digests_total_size() {
 	unsigned long long ret=0;
+	wait_query_digests_snapshot();
+	merge_digest_buffers();
 	pthread_rwlock_rdlock(&digest_rwlock);
 	size_t map_size = digest_umap.size();
 	ret += sizeof(QP_query_digest_stats)*map_size;
@@ -1014,9 +1539,48 @@ unsigned long long Query_Processor::get_query_digests_total_size() {
 #endif
 
 	pthread_rwlock_unlock(&digest_rwlock);
+	pthread_mutex_unlock(&digest_snapshot_mutex);
 	return ret;
 }
 
+std::pair<const umap_query_digest *, const umap_query_digest_text *> Query_Processor::get_query_digests_snapshot() {
+	pthread_mutex_lock(&digest_snapshot_mutex);
+	if (digest_snapshot_refs == 0) {
+		merge_digest_buffers();
+		pthread_rwlock_wrlock(&digest_rwlock);
+		digest_umap.swap(digest_snapshot_umap);
+		digest_text_umap.swap(digest_snapshot_text_umap);
+		pthread_rwlock_unlock(&digest_rwlock);
+	}
+	digest_snapshot_refs++;
+	pthread_mutex_unlock(&digest_snapshot_mutex);
+	return { &digest_snapshot_umap, &digest_snapshot_text_umap };
+}
+
+void Query_Processor::release_query_digests_snapshot() {
+	pthread_mutex_lock(&digest_snapshot_mutex);
+	assert(digest_snapshot_refs > 0);
+	digest_snapshot_refs--;
+	if (digest_snapshot_refs == 0) {
+		// as in get_query_digests_v2(): the digests collected while the snapshot was read are merged
+		// into it without holding the lock, then the snapshot becomes again the main map
+		umap_query_digest digest_umap_aux;
+		umap_query_digest_text digest_text_umap_aux;
+		pthread_rwlock_wrlock(&digest_rwlock);
+		digest_umap.swap(digest_umap_aux);
+		digest_text_umap.swap(digest_text_umap_aux);
+		pthread_rwlock_unlock(&digest_rwlock);
+		merge_query_digests(digest_snapshot_umap, digest_snapshot_text_umap, digest_umap_aux, digest_text_umap_aux);
+		pthread_rwlock_wrlock(&digest_rwlock);
+		digest_umap.swap(digest_snapshot_umap);
+		digest_text_umap.swap(digest_snapshot_text_umap);
+		merge_query_digests(digest_umap, digest_text_umap, digest_snapshot_umap, digest_snapshot_text_umap);
+		pthread_rwlock_unlock(&digest_rwlock);
+		pthread_cond_broadcast(&digest_snapshot_cond);
+	}
+	pthread_mutex_unlock(&digest_snapshot_mutex);
+}
+
 std::pair<SQLite3_result *, int> Query_Processor::get_query_digests_v2(const bool use_resultset) {
 	proxy_debug(PROXY_DEBUG_MYSQL_QUERY_PROCESSOR, 4, "Dumping current query digest\n");
 	SQLite3_result *result = NULL;
@@ -1025,6 +1589,9 @@ std::pair<SQLite3_result *, int> Query_Processor::get_query_digests_v2(const boo
 	// threads write in the other map. We need to lock while swapping.
 	umap_query_digest digest_umap_aux, digest_umap_aux_2;
 	umap_query_digest_text digest_text_umap_aux, digest_text_umap_aux_2;
+	// the digests in a snapshot are not in digest_umap , see get_query_digests_snapshot()
+	wait_query_digests_snapshot();
+	merge_digest_buffers();
 	pthread_rwlock_wrlock(&digest_rwlock);
 	digest_umap.swap(digest_umap_aux);
 	digest_text_umap.swap(digest_text_umap_aux);
@@ -1112,24 +1679,7 @@ std::pair<SQLite3_result *, int> Query_Processor::get_query_digests_v2(const boo
 
 	// Once we do the swap, we merge the content of the first auxiliary maps
 	// in the main maps and clear the content of the auxiliary maps.
-	for (const auto& element : digest_umap_aux_2) {
-		uint64_t digest = element.first;
-		QP_query_digest_stats *qds = (QP_query_digest_stats *)element.second;
-		std::unordered_map<uint64_t, void *>::iterator it = digest_umap_aux.find(digest);
-		if (it != digest_umap_aux.end()) {
-			// found
-			QP_query_digest_stats *qds_equal = (QP_query_digest_stats *)it->second;
-			qds_equal->add_time(
-				qds->min_time, qds->last_seen, qds->rows_affected, qds->rows_sent, qds->count_star
-			);
-			delete qds;
-		} else {
-			digest_umap_aux.insert(element);
-		}
-	}
-	digest_text_umap_aux.insert(digest_text_umap_aux_2.begin(), digest_text_umap_aux_2.end());
-	digest_umap_aux_2.clear();
-	digest_text_umap_aux_2.clear();
+	merge_query_digests(digest_umap_aux, digest_text_umap_aux, digest_umap_aux_2, digest_text_umap_aux_2);
 
 	// Once we finish merging the main maps and the first auxiliary maps, we
 	// lock and swap the main maps with the second auxiliary maps. Then, we
@@ -1137,25 +1687,9 @@ std::pair<SQLite3_result *, int> Query_Processor::get_query_digests_v2(const boo
 	// content of the auxiliary maps.
 	pthread_rwlock_wrlock(&digest_rwlock);
 	digest_umap_aux.swap(digest_umap);
-	for (const auto& element : digest_umap_aux) {
-		uint64_t digest = element.first;
-		QP_query_digest_stats *qds = (QP_query_digest_stats *)element.second;
-		std::unordered_map<uint64_t, void *>::iterator it = digest_umap.find(digest);
-		if (it != digest_umap.end()) {
-			// found
-			QP_query_digest_stats *qds_equal = (QP_query_digest_stats *)it->second;
-			qds_equal->add_time(
-				qds->min_time, qds->last_seen, qds->rows_affected, qds->rows_sent, qds->count_star
-			);
-			delete qds;
-		} else {
-			digest_umap.insert(element);
-		}
-	}
-	digest_text_umap.insert(digest_text_umap_aux.begin(), digest_text_umap_aux.end());
+	merge_query_digests(digest_umap, digest_text_umap, digest_umap_aux, digest_text_umap_aux);
 	pthread_rwlock_unlock(&digest_rwlock);
-	digest_umap_aux.clear();
-	digest_text_umap_aux.clear();
+	pthread_mutex_unlock(&digest_snapshot_mutex);
 
 	std::pair<SQLite3_result *, int> res{result, num_rows};
 	return res;
@@ -1164,6 +1698,8 @@ std::pair<SQLite3_result *, int> Query_Processor::get_query_digests_v2(const boo
 SQLite3_result * Query_Processor::get_query_digests() {
 	proxy_debug(PROXY_DEBUG_MYSQL_QUERY_PROCESSOR, 4, "Dumping current query digest\n");
 	SQLite3_result *result = NULL;
+	wait_query_digests_snapshot();
+	merge_digest_buffers();
 	pthread_rwlock_rdlock(&digest_rwlock);
 	unsigned long long curtime1;
 	unsigned long long curtime2;
@@ -1219,6 +1755,7 @@ SQLite3_result * Query_Processor::get_query_digests() {
 		}
 	}
 	pthread_rwlock_unlock(&digest_rwlock);
+	pthread_mutex_unlock(&digest_snapshot_mutex);
 	if (map_size >= DIGEST_STATS_FAST_MINSIZE) {
 		curtime2=monotonic_time();
 		curtime1 = curtime1/1000;
@@ -1234,10 +1771,13 @@ std::pair<SQLite3_result *, int> Query_Processor::get_query_digests_reset_v2(
 	SQLite3_result *result = NULL;
 	umap_query_digest digest_umap_aux;
 	umap_query_digest_text digest_text_umap_aux;
+	wait_query_digests_snapshot();
+	merge_digest_buffers();
 	pthread_rwlock_wrlock(&digest_rwlock);
 	digest_umap.swap(digest_umap_aux);
 	digest_text_umap.swap(digest_text_umap_aux);
 	pthread_rwlock_unlock(&digest_rwlock);
+	pthread_mutex_unlock(&digest_snapshot_mutex);
 	int num_rows = 0;
 	unsigned long long curtime1;
 	unsigned long long curtime2;
@@ -1346,14 +1886,19 @@ std::pair<SQLite3_result *, int> Query_Processor::get_query_digests_reset_v2(
 }
 
 void Query_Processor::get_query_digests_reset(umap_query_digest *uqd, umap_query_digest_text *uqdt) {
+	wait_query_digests_snapshot();
+	merge_digest_buffers();
 	pthread_rwlock_wrlock(&digest_rwlock);
 	digest_umap.swap(*uqd);
 	digest_text_umap.swap(*uqdt);
 	pthread_rwlock_unlock(&digest_rwlock);
+	pthread_mutex_unlock(&digest_snapshot_mutex);
 }
 
 SQLite3_result * Query_Processor::get_query_digests_reset() {
 	SQLite3_result *result = NULL;
+	wait_query_digests_snapshot();
+	merge_digest_buffers();
 	pthread_rwlock_wrlock(&digest_rwlock);
 	unsigned long long curtime1;
 	unsigned long long curtime2;
@@ -1426,6 +1971,7 @@ SQLite3_result * Query_Processor::get_query_digests_reset() {
 	}
 	digest_text_umap.erase(digest_text_umap.begin(),digest_text_umap.end());
 	pthread_rwlock_unlock(&digest_rwlock);
+	pthread_mutex_unlock(&digest_snapshot_mutex);
 	if (map_size >= DIGEST_STATS_FAST_MINSIZE) {
 		curtime2=monotonic_time();
 		curtime1 = curtime1/1000;
@@ -1486,95 +2032,21 @@ Query_Processor_Output * Query_Processor::process_mysql_query(MySQL_Session *ses
 		len = qi->stmt_info->query_length;
 	}
 	if (__sync_add_and_fetch(&version,0) > _thr_SQP_version) {
-		// update local rules;
+		// switch to the new rules snapshot
 		proxy_debug(PROXY_DEBUG_MYSQL_QUERY_PROCESSOR, 4, "Detected a changed in version. Global:%d , local:%d . Refreshing...\n", version, _thr_SQP_version);
 		pthread_rwlock_rdlock(&rwlock);
-		_thr_SQP_version=__sync_add_and_fetch(&version,0);
-		__reset_rules(_thr_SQP_rules);
-		QP_rule_t *qr1;
-		QP_rule_t *qr2;
-		for (std::vector<QP_rule_t *>::iterator it=rules.begin(); it!=rules.end(); ++it) {
-			qr1=*it;
-			if (qr1->active) {
-				proxy_debug(PROXY_DEBUG_MYSQL_QUERY_PROCESSOR, 4, "Copying Query Rule id: %d\n", qr1->rule_id);
-				char buf[20];
-				if (qr1->digest) { // not 0
-					sprintf(buf,"0x%016llX", (long long unsigned int)qr1->digest);
-				}
-				std::string re_mod;
-				re_mod="";
-				if ((qr1->re_modifiers & QP_RE_MOD_CASELESS) == QP_RE_MOD_CASELESS) re_mod = "CASELESS";
-				if ((qr1->re_modifiers & QP_RE_MOD_GLOBAL) == QP_RE_MOD_GLOBAL) {
-					if (re_mod.length()) {
-						re_mod = re_mod + ",";
-					}
-					re_mod = re_mod + "GLOBAL";
-				}
-				qr2=new_query_rule(qr1->rule_id, qr1->active, qr1->username, qr1->schemaname, qr1->flagIN,
-					qr1->client_addr, qr1->proxy_addr, qr1->proxy_port,
-					( qr1->digest ? buf : NULL ) ,
-					qr1->match_digest, qr1->match_pattern, qr1->negate_match_pattern, (char *)re_mod.c_str(),
-					qr1->flagOUT, qr1->replace_pattern, qr1->destination_hostgroup,
-					qr1->cache_ttl, qr1->cache_empty_result, qr1->cache_timeout,
-					qr1->reconnect, qr1->timeout, qr1->retries, qr1->delay,
-					qr1->next_query_flagIN, qr1->mirror_flagOUT, qr1->mirror_hostgroup,
-					qr1->error_msg, qr1->OK_msg, qr1->sticky_conn, qr1->multiplex,
-					qr1->gtid_from_hostgroup,
-					qr1->log, qr1->apply,
-					qr1->attributes,
-					qr1->comment);
-				qr2->parent=qr1;	// pointer to parent to speed up parent update (hits)
-				if (qr2->match_digest) {
-					proxy_debug(PROXY_DEBUG_MYSQL_QUERY_PROCESSOR, 4, "Compiling regex for rule_id: %d, match_digest: %s\n", qr2->rule_id, qr2->match_digest);
-					qr2->regex_engine1=(void *)compile_query_rule(qr2,1);
-				}
-				if (qr2->match_pattern) {
-					proxy_debug(PROXY_DEBUG_MYSQL_QUERY_PROCESSOR, 4, "Compiling regex for rule_id: %d, match_pattern: %s\n", qr2->rule_id, qr2->match_pattern);
-					qr2->regex_engine2=(void *)compile_query_rule(qr2,2);
-				}
-				_thr_SQP_rules->push_back(qr2);
-			}
-		}
-		if (this->query_rules_fast_routing_algorithm == 1) {
-			if (_thr_SQP_rules_fast_routing) {
-				kh_destroy(khStrInt, _thr_SQP_rules_fast_routing);
-				_thr_SQP_rules_fast_routing = nullptr;
-			}
-			if (_thr___rules_fast_routing___keys_values) {
-				free(_thr___rules_fast_routing___keys_values);
-				_thr___rules_fast_routing___keys_values = NULL;
-			}
-			if (rules_fast_routing___keys_values___size) {
-				_thr_SQP_rules_fast_routing = kh_init(khStrInt); // create a hashtable
-				_thr___rules_fast_routing___keys_values = (char *)malloc(rules_fast_routing___keys_values___size);
-				memcpy(_thr___rules_fast_routing___keys_values, rules_fast_routing___keys_values, rules_fast_routing___keys_values___size);
-				char *ptr = _thr___rules_fast_routing___keys_values;
-				while (ptr < _thr___rules_fast_routing___keys_values + rules_fast_routing___keys_values___size) {
-					char *ptr2 = ptr+strlen(ptr)+1;
-					int destination_hostgroup = atoi(ptr2);
-					int ret;
-					khiter_t k = kh_put(khStrInt, _thr_SQP_rules_fast_routing, ptr, &ret); // add the key
-					kh_value(_thr_SQP_rules_fast_routing, k) = destination_hostgroup; // set the value of the key
-					ptr = ptr2+strlen(ptr2)+1;
-				}
-			}
-		} else {
-			if (_thr_SQP_rules_fast_routing) {
-				kh_destroy(khStrInt, _thr_SQP_rules_fast_routing);
-				_thr_SQP_rules_fast_routing = nullptr;
-			}
-			if (_thr___rules_fast_routing___keys_values) {
-				free(_thr___rules_fast_routing___keys_values);
-				_thr___rules_fast_routing___keys_values = nullptr;
-			}
-		}
-		//for (std::unordered_map<std::string, int>::iterator it = rules_fast_routing.begin(); it != rules_fast_routing.end(); ++it) {
-		//	_thr_SQP_rules_fast_routing->insert(
-		//}
+		refresh_thread_rules_snapshot();
 		pthread_rwlock_unlock(&rwlock);
 	}
+	// the snapshot is immutable and stays valid until this thread releases it
+	QP_rules_snapshot_t *snap = _thr_SQP_snapshot;
 	QP_rule_t *qr = NULL;
 	re2_t *re2p;
+	regex_set_matches_t rsm(snap ? snap->regex_sets : NULL);
+	QP_rules_cursor_t rules_cursor;
+	int rule_pos;
+	const char *rc_username = sess->client_myds->myconn->userinfo->username;
+	const char *rc_schemaname = sess->client_myds->myconn->userinfo->schemaname;
 	int flagIN=0;
 	ret->next_query_flagIN=-1; // reset
 	if (sess->next_query_flagIN >= 0) {
@@ -1595,9 +2067,13 @@ Query_Processor_Output * Query_Processor::process_mysql_query(MySQL_Session *ses
 			goto __exit_process_mysql_query;
 		}
 	}
+	if (rc_username == NULL) rc_username = "";
+	if (rc_schemaname == NULL) rc_schemaname = "";
 __internal_loop:
-	for (std::vector<QP_rule_t *>::iterator it=_thr_SQP_rules->begin(); it!=_thr_SQP_rules->end(); ++it) {
-		qr=*it;
+	// only the rules with matching flagIN, username and schemaname are visited
+	rules_cursor.init(snap ? snap->rules_index : NULL, rand_del, flagIN, rc_username, rc_schemaname, 0);
+	while ((rule_pos = rules_cursor.next()) >= 0) {
+		qr=snap->rules[rule_pos];
 		if (qr->flagIN != flagIN) {
 			proxy_debug(PROXY_DEBUG_MYSQL_QUERY_PROCESSOR, 6, "query rule %d has no matching flagIN\n", qr->rule_id);
 			continue;
@@ -1668,8 +2144,14 @@ __internal_loop:
 			re2p=(re2_t *)qr->regex_engine1;
 			if (qr->match_digest) {
 				bool rc;
+				int rsm_rc=-1;
+				if (qr->regex_set_idx1 >= 0) {
+					rsm_rc=rsm.match(flagIN, 1, qp->digest_text, qr->regex_set_idx1);
+				}
 				// we always match on original query
-				if (re2p->re2) {
+				if (rsm_rc >= 0) {
+					rc=rsm_rc;
+				} else if (re2p->re2) {
 					rc=RE2::PartialMatch(qp->digest_text,*re2p->re2);
 				} else {
 					rc=re2p->re1->PartialMatch(qp->digest_text);
@@ -1694,7 +2176,13 @@ __internal_loop:
 				}
 			} else {
 				// we never rewrote the query
-				if (re2p->re2) {
+				int rsm_rc=-1;
+				if (qr->regex_set_idx2 >= 0) {
+					rsm_rc=rsm.match(flagIN, 2, query, qr->regex_set_idx2);
+				}
+				if (rsm_rc >= 0) {
+					rc=rsm_rc;
+				} else if (re2p->re2) {
 					rc=RE2::PartialMatch(query,*re2p->re2);
 				} else {
 					rc=re2p->re1->PartialMatch(query);
@@ -1707,7 +2195,7 @@ __internal_loop:
 		}
 
 		// if we arrived here, we have a match
-		qr->hits++; // this is done without atomic function because it updates only the local variables
+		_thr_SQP_rules_hits[rule_pos]++; // this is done without atomic function because it updates only the local variables
 		bool set_flagOUT=false;
 		if (qr->flagOUT_weights_total > 0) {
 			int rnd = random() % qr->flagOUT_weights_total;
@@ -1846,6 +2334,8 @@ __internal_loop:
 				reiterate--;
 				goto __internal_loop;
 			}
+			// the following rules are evaluated against the new flagIN
+			rules_cursor.init(snap->rules_index, rand_del, flagIN, rc_username, rc_schemaname, rule_pos+1);
 		}
 	}
 
@@ -1858,9 +2348,9 @@ __exit_process_mysql_query:
 
 		int dst_hg = -1;
 
-		if (_thr_SQP_rules_fast_routing != nullptr) {
+		if (snap != NULL && snap->rules_fast_routing != nullptr) {
 			proxy_debug(PROXY_DEBUG_MYSQL_QUERY_PROCESSOR, 7, "Searching thread-local 'rules_fast_routing' hashmap with: user='%s', schema='%s', and flagIN='%d'\n", u, s, flagIN);
-			dst_hg = search_rules_fast_routing_dest_hg(&_thr_SQP_rules_fast_routing, u, s, flagIN, false);
+			dst_hg = search_rules_fast_routing_dest_hg(&snap->rules_fast_routing, u, s, flagIN, false);
 		} else if (rules_fast_routing != nullptr) {
 			proxy_debug(PROXY_DEBUG_MYSQL_QUERY_PROCESSOR, 7, "Searching global 'rules_fast_routing' hashmap with: user='%s', schema='%s', and flagIN='%d'\n", u, s, flagIN);
 			// NOTE: A pointer to the member 'this->rules_fast_routing' is required, since the value of the
@@ -2005,24 +2495,38 @@ void Query_Processor::update_query_processor_stats() {
 	// Note:
 	// this function is called by each thread to update global query statistics
 	//
-	// As an extra safety, it checks that the version didn't change
-	// Yet, if version changed doesn't perfomr any rules update
-	//
-	// It acquires a read lock to ensure that the rules table doesn't change
-	// Yet, because it has to update vales, it uses atomic operations
+	// The hits are added to the rules of the thread's snapshot, that stays valid until the thread releases
+	// it: no lock is required. Because other threads share the snapshot, it uses atomic operations
+	// If the version changed, the thread switches to the new snapshot releasing the stale one (quiescent
+	// point): the hits of the stale snapshot are no longer reported, as the rules were reloaded
 	proxy_debug(PROXY_DEBUG_MYSQL_QUERY_PROCESSOR, 8, "Updating query rules statistics\n");
-	pthread_rwlock_rdlock(&rwlock);
-	if (__sync_add_and_fetch(&version,0) == _thr_SQP_version) {
-		QP_rule_t *qr;
-		for (std::vector<QP_rule_t *>::iterator it=_thr_SQP_rules->begin(); it!=_thr_SQP_rules->end(); ++it) {
-			qr=*it;
-			if (qr->active && qr->hits) {
-				__sync_fetch_and_add(&qr->parent->hits,qr->hits);
-				qr->hits=0;
+	if (_thr_SQP_snapshot && _thr_SQP_rules_hits) {
+		for (unsigned int i=0; i<_thr_SQP_snapshot->rules.size(); i++) {
+			if (_thr_SQP_rules_hits[i]) {
+				__sync_fetch_and_add(&_thr_SQP_snapshot->rules[i]->hits,_thr_SQP_rules_hits[i]);
+				_thr_SQP_rules_hits[i]=0;
 			}
 		}
 	}
-	pthread_rwlock_unlock(&rwlock);
+	if (__sync_add_and_fetch(&version,0) != _thr_SQP_version) {
+		pthread_rwlock_rdlock(&rwlock);
+		refresh_thread_rules_snapshot();
+		pthread_rwlock_unlock(&rwlock);
+	}
+	if (_thr_digest_buffer) {
+		// the buffered digests are merged into the global map unless it is in use: Admin merges all
+		// the buffers before reading it, so this thread doesn't need to wait
+		if (pthread_rwlock_trywrlock(&digest_rwlock) == 0) {
+			umap_query_digest du;
+			umap_query_digest_text dtu;
+			pthread_mutex_lock(&_thr_digest_buffer->mutex);
+			_thr_digest_buffer->digest_umap.swap(du);
+			_thr_digest_buffer->digest_text_umap.swap(dtu);
+			pthread_mutex_unlock(&_thr_digest_buffer->mutex);
+			merge_query_digests(digest_umap, digest_text_umap, du, dtu);
+			pthread_rwlock_unlock(&digest_rwlock);
+		}
+	}
 	for (int i=0; i<MYSQL_COM_QUERY___NONE; i++) {
 		for (int j=0; j<13; j++) {
 			if (_thr_commands_counters[i]->counters[j]) {
@@ -2127,7 +2631,17 @@ unsigned long long Query_Processor::query_parser_update_counters(MySQL_Session *
 }
 
 void Query_Processor::update_query_digest(SQP_par_t *qp, int hid, MySQL_Connection_userinfo *ui, unsigned long long t, unsigned long long n, MySQL_STMT_Global_info *_stmt_info, MySQL_Session *sess) {
-	pthread_rwlock_wrlock(&digest_rwlock);
+	// threads with a digests buffer don't contend for the global map
+	QP_digest_buffer_t *db = _thr_digest_buffer;
+	umap_query_digest *gu = &digest_umap;
+	umap_query_digest_text *gtu = &digest_text_umap;
+	if (db) {
+		pthread_mutex_lock(&db->mutex);
+		gu = &db->digest_umap;
+		gtu = &db->digest_text_umap;
+	} else {
+		pthread_rwlock_wrlock(&digest_rwlock);
+	}
 	QP_query_digest_stats *qds;
 
 	unsigned long long rows_affected = 0;
@@ -2139,8 +2653,8 @@ void Query_Processor::update_query_digest(SQP_par_t *qp, int hid, MySQL_Connecti
 	}
 
 	std::unordered_map<uint64_t, void *>::iterator it;
-	it=digest_umap.find(qp->digest_total);
-	if (it != digest_umap.end()) {
+	it=gu->find(qp->digest_total);
+	if (it != gu->end()) {
 		// found
 		qds=(QP_query_digest_stats *)it->second;
 		qds->add_time(t,n, rows_affected,rows_sent);
@@ -2167,7 +2681,7 @@ void Query_Processor::update_query_digest(SQP_par_t *qp, int hid, MySQL_Connecti
 			qds=new QP_query_digest_stats(ui->username, ui->schemaname, _stmt_info->digest, dt, hid, ca);
 		}
 		qds->add_time(t,n, rows_affected,rows_sent);
-		digest_umap.insert(std::make_pair(qp->digest_total,(void *)qds));
+		gu->insert(std::make_pair(qp->digest_total,(void *)qds));
 		if (mysql_thread___query_digests_normalize_digest_text==true) {
 			uint64_t dig = 0;
 			if (_stmt_info==NULL) {
@@ -2176,8 +2690,8 @@ void Query_Processor::update_query_digest(SQP_par_t *qp, int hid, MySQL_Connecti
 				dig = _stmt_info->digest;
 			}
 			std::unordered_map<uint64_t, char *>::iterator it2;
-			it2=digest_text_umap.find(dig);
-			if (it2 != digest_text_umap.end()) {
+			it2=gtu->find(dig);
+			if (it2 != gtu->end()) {
 				// found
 			} else {
 				if (_stmt_info==NULL) {
@@ -2185,12 +2699,16 @@ void Query_Processor::update_query_digest(SQP_par_t *qp, int hid, MySQL_Connecti
 				} else {
 					dt = strdup(_stmt_info->digest_text);
 				}
-				digest_text_umap.insert(std::make_pair(dig,dt));
+				gtu->insert(std::make_pair(dig,dt));
 			}
 		}
 	}
 
-	pthread_rwlock_unlock(&digest_rwlock);
+	if (db) {
+		pthread_mutex_unlock(&db->mutex);
+	} else {
+		pthread_rwlock_unlock(&digest_rwlock);
+	}
 }
 
 char * Query_Processor::get_digest_text(SQP_par_t *qp) {
@@ -2929,7 +3447,6 @@ SQLite3_result* Query_Processor::load_fast_routing(const fast_routing_hashmap_t&
 	SQLite3_result* _rules_resultset = fast_routing_hashmap.rules_resultset;
 
 	if (_rules_fast_routing && _rules_resultset) {
-		unsigned int nt = GloMTH->num_threads;
 		// Replace map structures, assumed to be previously reset
 		this->rules_fast_routing___keys_values = fast_routing_hashmap.rules_fast_routing___keys_values;
 		this->rules_fast_routing___keys_values___size = fast_routing_hashmap.rules_fast_routing___keys_values___size;
@@ -2937,12 +3454,12 @@ SQLite3_result* Query_Processor::load_fast_routing(const fast_routing_hashmap_t&
 		// Update global memory stats
 		rules_mem_used += rules_fast_routing___keys_values___size; // global
 		if (this->query_rules_fast_routing_algorithm == 1) {
-			rules_mem_used += rules_fast_routing___keys_values___size * nt; // per-thread
+			rules_mem_used += rules_fast_routing___keys_values___size; // shared by all threads through the rules snapshot
 		}
 		khint_t map_size = kh_size(_rules_fast_routing);
 		rules_mem_used += map_size * ((sizeof(int) + sizeof(char *) + 4 )); // not sure about memory overhead
 		if (this->query_rules_fast_routing_algorithm == 1) {
-			rules_mem_used += map_size * ((sizeof(int) + sizeof(char *) + 4 )) * nt; // not sure about memory overhead
+			rules_mem_used += map_size * ((sizeof(int) + sizeof(char *) + 4 )); // not sure about memory overhead
 		}
 	}
 
@@ -426,7 +426,13 @@ MySQL_Connection::MySQL_Connection() {
 	myds=NULL;
 	inserted_into_pool=0;
 	reusable=false;
+	prewarmed=false;
 	parent=NULL;
+	query_sent_at=0;
+	pool_index.fingerprint=0;
+	pool_index.idx=0;
+	pool_index.prev=NULL;
+	pool_index.next=NULL;
 	userinfo=new MySQL_Connection_userinfo();
 	fd=-1;
 	status_flags=0;
@@ -480,6 +486,10 @@ MySQL_Connection::MySQL_Connection() {
 
 MySQL_Connection::~MySQL_Connection() {
 	proxy_debug(PROXY_DEBUG_MYSQL_CONNPOOL, 4, "Destroying MySQL_Connection %p\n", this);
+	if (query_sent_at && parent) {
+		// the connection is destroyed while running a query
+		__sync_fetch_and_sub(&parent->queries_in_flight,1);
+	}
 	if (options.server_version) free(options.server_version);
 	if (options.init_connect) free(options.init_connect);
 	if (options.ldap_user_variable) free(options.ldap_user_variable);
@@ -725,6 +735,67 @@ unsigned int MySQL_Connection::number_of_matching_session_variables(const MySQL_
 }
 
 
+/**
+ * @brief Computes a fingerprint of the state compared when searching a connection in the connection pool.
+ *
+ * The fingerprint covers username, schema, the tracked client flags (see match_tracked_options()) and
+ * all the session variables , with the exception of SQL_CHARACTER_ACTION that
+ * number_of_matching_session_variables() doesn't compare.
+ * A backend connection that doesn't require CHANGE_USER, nor SET statements or INIT_DB for a client
+ * connection (connection_quality_level 3 in MySrvConnList::get_random_MyConn() ) has the same fingerprint
+ * of the client connection. The opposite isn't guaranteed, so connections with the same fingerprint must
+ * still be verified.
+ *
+ * @return The fingerprint of the connection.
+ */
+uint64_t MySQL_Connection::get_pool_fingerprint() const {
+	SpookyHash myhash;
+	uint64_t hash1;
+	uint64_t hash2;
+	myhash.Init(17,5);
+	const char *username = userinfo->username ? userinfo->username : "";
+	const char *schemaname = userinfo->schemaname ? userinfo->schemaname : "";
+	// the terminating null character is hashed as separator
+	myhash.Update(username,strlen(username)+1);
+	myhash.Update(schemaname,strlen(schemaname)+1);
+	uint32_t cf = options.client_flag & (CLIENT_FOUND_ROWS | CLIENT_MULTI_STATEMENTS | CLIENT_MULTI_RESULTS | CLIENT_IGNORE_SPACE);
+	myhash.Update(&cf,sizeof(cf));
+	for (auto i = 0; i < SQL_NAME_LAST_LOW_WM; i++) {
+		if (i != SQL_CHARACTER_ACTION) {
+			myhash.Update(&var_hash[i],sizeof(uint32_t));
+		}
+	}
+	for (const uint32_t idx : dynamic_variables_idx) {
+		myhash.Update(&idx,sizeof(idx));
+		myhash.Update(&var_hash[idx],sizeof(uint32_t));
+	}
+	myhash.Final(&hash1,&hash2);
+	return hash1;
+}
+
+/**
+ * @brief Accounts a query sent to the backend in MySrvC::queries_in_flight .
+ */
+void MySQL_Connection::backend_query_started() {
+	if (query_sent_at == 0) {
+		__sync_fetch_and_add(&parent->queries_in_flight,1);
+	}
+	query_sent_at=monotonic_time();
+}
+
+/**
+ * @brief Accounts the completion of a query sent with backend_query_started() , and updates the
+ *  latency of the server used by the load balancing algorithms.
+ */
+void MySQL_Connection::backend_query_completed() {
+	if (query_sent_at) {
+		unsigned long long now=monotonic_time();
+		__sync_fetch_and_sub(&parent->queries_in_flight,1);
+		parent->update_latency_ewma(now-query_sent_at, now);
+		query_sent_at=0;
+	}
+}
+
 bool MySQL_Connection::match_tracked_options(const MySQL_Connection *c) {
 	uint32_t cf1 = options.client_flag; // own client flags
 	uint32_t cf2 = c->options.client_flag; // other client flags
@@ -771,7 +842,12 @@ void MySQL_Connection::connect_start_SetCharset() {
 	const char *csname = NULL;
 	/* Take client character set and use it to connect to backend */
 	if (myds && myds->sess) {
-		csname = mysql_variables.client_get_value(myds->sess, SQL_CHARACTER_SET);
+		if (myds->sess->client_myds) {
+			csname = mysql_variables.client_get_value(myds->sess, SQL_CHARACTER_SET);
+		} else {
+			// connection pre-warmed without a client: the character set was chosen by MyHGC::new_prewarmed_MyConn()
+			csname = variables[SQL_CHARACTER_SET].value;
+		}
 	}
 
 	const MARIADB_CHARSET_INFO * c = NULL;
@@ -827,6 +903,9 @@ void MySQL_Connection::connect_start_SetClientFlag(unsigned long& client_flags)
 						client_flags |= CLIENT_IGNORE_SPACE;
 					}
 				}
+			} else {
+				// connection pre-warmed without a client: the flags were chosen by MyHGC::new_prewarmed_MyConn()
+				client_flags |= options.client_flag & (CLIENT_FOUND_ROWS | CLIENT_MULTI_STATEMENTS | CLIENT_MULTI_RESULTS | CLIENT_IGNORE_SPACE);
 			}
 		}
 	}
@@ -1370,6 +1449,7 @@ handler_again:
 		case ASYNC_QUERY_START:
 			real_query_start();
 			__sync_fetch_and_add(&parent->queries_sent,1);
+			backend_query_started();
 			__sync_fetch_and_add(&parent->bytes_sent,query.length);
 			statuses.questions++;
 			myds->sess->thread->status_variables.stvar[st_var_queries_backends_bytes_sent]+=query.length;
@@ -1439,6 +1519,7 @@ handler_again:
 			PROXY_TRACE2();
 			stmt_execute_start();
 			__sync_fetch_and_add(&parent->queries_sent,1);
+			backend_query_started();
 			__sync_fetch_and_add(&parent->bytes_sent,query.stmt_meta->size);
 			myds->sess->thread->status_variables.stvar[st_var_queries_backends_bytes_sent]+=query.stmt_meta->size;
 			myds->bytes_info.bytes_sent += query.stmt_meta->size;
@@ -1552,6 +1633,7 @@ handler_again:
 			break;
 		case ASYNC_STMT_EXECUTE_END:
 			PROXY_TRACE2();
+			backend_query_completed();
 			{
 				if (query.stmt_result) {
 					unsigned long long total_size=0;
@@ -1771,6 +1853,7 @@ handler_again:
 			break;
 		case ASYNC_QUERY_END:
 			PROXY_TRACE2();
+			backend_query_completed();
 			if (mysql) {
 				int _myerrno=mysql_errno(mysql);
 				if (_myerrno == 0) {
@@ -1,6 +1,7 @@
 #include "proxysql.h"
 #include "cpp.h"
 #include <zlib.h>
+#include <sys/uio.h>
 #ifndef UNIX_PATH_MAX
 #define UNIX_PATH_MAX    108
 #endif 
@@ -323,6 +324,8 @@ MySQL_Data_Stream::MySQL_Data_Stream() {
 	kill_type=0;
 	connect_tries=0;
 	poll_fds_idx=-1;
+	io_ring_recv_rc=0;
+	io_ring_recv_ready=false;
 	resultset_length=0;
 
 	revents = 0;
@@ -578,7 +581,15 @@ int MySQL_Data_Stream::read_from_net() {
 	int s=queue_available(queueIN);
 
 	if (encrypted == false) {
-		if (pkts_recv) {
+		if (io_ring_recv_ready) {
+			// the data was already read by MySQL_Thread::ProcessAllMyDS_BatchedReads()
+			io_ring_recv_ready=false;
+			r = io_ring_recv_rc;
+			if (r < 0) {
+				errno = -r;
+				r = -1;
+			}
+		} else if (pkts_recv) {
 			r = recv(fd, queue_w_ptr(queueIN), s, 0);
 		} else {
 			if (queueIN.partial == 0) {
@@ -716,6 +727,49 @@ int MySQL_Data_Stream::read_from_net() {
 	return r;
 }
 
+/**
+ * @brief Checks if the next read_from_net() would call recv() directly on the socket.
+ *
+ * Only these reads can be performed in advance by MySQL_Thread through io_uring: reads performed by
+ * the MariaDB client library, SSL reads and the reads of the first packet are excluded.
+ *
+ * @param _revents The events returned by poll for this data stream.
+ */
+bool MySQL_Data_Stream::io_ring_recv_eligible(short _revents) {
+	if (io_ring_recv_ready || encrypted || pkts_recv == 0 || (_revents & POLLIN) == 0) {
+		return false;
+	}
+	if (DSS > STATE_MARIADB_BEGIN && DSS < STATE_MARIADB_END) {
+		return false;
+	}
+	if (myds_type == MYDS_BACKEND) {
+		if (sess == NULL || sess->status != FAST_FORWARD) {
+			return false;
+		}
+	} else if (myds_type != MYDS_FRONTEND) {
+		return false;
+	}
+	return queue_available(queueIN) > 0;
+}
+
+/**
+ * @brief Prepares in the io_uring ring the recv() that read_from_net() would perform.
+ *
+ * @return false if the ring is full.
+ */
+bool MySQL_Data_Stream::io_ring_prep_recv(ProxySQL_IO_Uring *ring) {
+	return ring->prep_recv(fd, queue_w_ptr(queueIN), queue_available(queueIN), (uint64_t)(uintptr_t)this);
+}
+
+/**
+ * @brief Completion callback for ProxySQL_IO_Uring::submit_and_wait() , stores the result for read_from_net().
+ */
+void MySQL_Data_Stream::io_ring_recv_completed(uint64_t user_data, int res, void *arg) {
+	MySQL_Data_Stream *myds=(MySQL_Data_Stream *)(uintptr_t)user_data;
+	myds->io_ring_recv_rc=res;
+	myds->io_ring_recv_ready=true;
+}
+
 int MySQL_Data_Stream::write_to_net() {
     int bytes_io=0;
 	int s = queue_data(queueOUT);
@@ -836,45 +890,45 @@ bool MySQL_Data_Stream::available_data_out() {
 }
 
 void MySQL_Data_Stream::remove_pollout() {
-	struct pollfd *_pollfd;
-	_pollfd=&mypolls->fds[poll_fds_idx];
-	_pollfd->events = 0;
+	mypolls->set_events(poll_fds_idx, 0);
 }
 
 void MySQL_Data_Stream::set_pollout() {
-	struct pollfd *_pollfd;
-	_pollfd=&mypolls->fds[poll_fds_idx];
+	short events;
 	if (DSS > STATE_MARIADB_BEGIN && DSS < STATE_MARIADB_END) {
-		_pollfd->events = myconn->wait_events;
+		events = myconn->wait_events;
 	} else {
-		_pollfd->events = POLLIN;
+		events = POLLIN;
 		//if (PSarrayOUT->len || available_data_out() || queueOUT.partial || (encrypted && !SSL_is_init_finished(ssl))) {
 		if (PSarrayOUT->len || available_data_out() || queueOUT.partial) {
-			_pollfd->events |= POLLOUT;
+			events |= POLLOUT;
 		}
 		if (encrypted) {
 			if (ssl_write_len || wbio_ssl->num_write > wbio_ssl->num_read) {
-				_pollfd->events |= POLLOUT;
+				events |= POLLOUT;
 			} else {
 				if (!SSL_is_init_finished(ssl)) {
 					//proxy_info("SSL_is_init_finished NOT completed\n");
 					if (do_ssl_handshake() == SSLSTATUS_FAIL) {
 						//proxy_info("SSL_is_init_finished failed!!\n");
+						mypolls->set_events(poll_fds_idx, events);
 						shut_soft();
 						return;
 					}
 					if (!SSL_is_init_finished(ssl)) {
 						//proxy_info("SSL_is_init_finished yet NOT completed\n");
+						mypolls->set_events(poll_fds_idx, events);
 						return;
 					}
-					_pollfd->events |= POLLOUT;
+					events |= POLLOUT;
 				} else {
 					//proxy_info("SSL_is_init_finished completed\n");
 				}
 			}
 		}
 	}
-	proxy_debug(PROXY_DEBUG_NET,1,"Session=%p, DataStream=%p -- Setting poll events %d for FD %d , DSS=%d , myconn=%p\n", sess, this, _pollfd->events , fd, DSS, myconn);
+	mypolls->set_events(poll_fds_idx, events);
+	proxy_debug(PROXY_DEBUG_NET,1,"Session=%p, DataStream=%p -- Setting poll events %d for FD %d , DSS=%d , myconn=%p\n", sess, this, events , fd, DSS, myconn);
 }
 
 int MySQL_Data_Stream::write_to_net_poll() {
@@ -1533,6 +1587,90 @@ int MySQL_Data_Stream::array2buffer_full() {
 	return rc; 
 }
 
+/**
+ * @brief Sends the packets in PSarrayOUT directly to the socket, with a single writev() for up to
+ *  ARRAY2NET_MAX_IOV packets.
+ * @details Used if 'mysql-use_writev' is enabled, to avoid copying the resultsets into queueOUT before
+ *  sending them. It is a no-op if queueOUT isn't empty, to preserve the order of the data, or if the
+ *  packets need to be processed before being sent (SSL or compression), or if there is less than
+ *  QUEUE_T_DEFAULT_SIZE bytes to send: small packets are better coalesced into queueOUT.
+ *  If a packet is only partially sent, it becomes the packet in progress of queueOUT, and its remaining
+ *  bytes are copied by array2buffer() as usual.
+ * @return The number of bytes sent.
+ */
+int MySQL_Data_Stream::array2net() {
+	if (encrypted || active==0 || net_failure || fd < 0 || poll_fds_idx < 0) {
+		return 0;
+	}
+	if (queue_data(queueOUT) || queueOUT.partial) {
+		return 0;
+	}
+	// compression could be enabled once the packets of the handshake are sent
+	if (DSS==STATE_CLIENT_AUTH_OK || myconn==NULL || myconn->get_status(STATUS_MYSQL_CONNECTION_COMPRESSION)==true) {
+		return 0;
+	}
+	int ret=0;
+	while (PSarrayOUT->len) {
+		struct iovec iov[ARRAY2NET_MAX_IOV];
+		unsigned int n = (PSarrayOUT->len < ARRAY2NET_MAX_IOV ? PSarrayOUT->len : ARRAY2NET_MAX_IOV);
+		size_t to_send=0;
+		for (unsigned int i=0; i<n; i++) {
+			PtrSize_t *pkt=PSarrayOUT->index(i);
+			iov[i].iov_base=pkt->ptr;
+			iov[i].iov_len=pkt->size;
+			to_send+=pkt->size;
+		}
+		if (to_send < QUEUE_T_DEFAULT_SIZE) {
+			break;
+		}
+		struct msghdr msg;
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov=iov;
+		msg.msg_iovlen=n;
+#ifdef __APPLE__
+		ssize_t bytes_io = sendmsg(fd, &msg, 0);
+#else
+		ssize_t bytes_io = sendmsg(fd, &msg, MSG_NOSIGNAL);
+#endif
+		proxy_debug(PROXY_DEBUG_NET, 7, "Session=%p, Datastream=%p: sendmsg() wrote %ld bytes of %lu in FD %d\n", sess, this, (long)bytes_io, to_send, fd);
+		if (bytes_io <= 0) {
+			// errors are handled by write_to_net()
+			break;
+		}
+		if (queueOUT.pkt.ptr) {
+			add_to_data_packet_history_without_alloc(data_packets_history_OUT,queueOUT.pkt.ptr,queueOUT.pkt.size);
+			queueOUT.pkt.ptr=NULL;
+		}
+		size_t left=bytes_io;
+		unsigned int idx=0;
+		while (idx<n && left >= iov[idx].iov_len) {
+			PtrSize_t *pkt=PSarrayOUT->index(idx);
+			left-=pkt->size;
+			add_to_data_packet_history_without_alloc(data_packets_history_OUT,pkt->ptr,pkt->size);
+			pkts_sent+=1;
+			idx++;
+		}
+		if (left) {
+			// the rest of this packet is copied into queueOUT by array2buffer()
+			memcpy(&queueOUT.pkt,PSarrayOUT->index(idx), sizeof(PtrSize_t));
+			queueOUT.partial=left;
+			idx++;
+		}
+		PSarrayOUT->remove_index_range(0,idx);
+		ret+=bytes_io;
+		if (mypolls) mypolls->last_sent[poll_fds_idx]=sess->thread->curtime;
+		bytes_info.bytes_sent+=bytes_io;
+		if (myds_type == MYDS_FRONTEND && sess && sess->thread) {
+			sess->thread->status_variables.stvar[st_var_queries_frontends_bytes_sent] += bytes_io;
+		}
+		if ((size_t)bytes_io < to_send) {
+			// the socket buffer is full
+			break;
+		}
+	}
+	return ret;
+}
+
 int MySQL_Data_Stream::assign_fd_from_mysql_conn() {
 	assert(myconn);
 	//proxy_debug(PROXY_DEBUG_MYSQL_CONNECTION, 5, "Sess=%p, myds=%p, oldFD=%d, newFD=%d\n", this->sess, this, fd, myconn->myconn.net.fd);
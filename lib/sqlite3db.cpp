@@ -979,6 +979,17 @@ void SQLite3DB::LoadPlugin(const char *plugin_name) {
 	proxy_sqlite3_prepare_v2 = NULL;
 	proxy_sqlite3_open_v2 = NULL;
 	proxy_sqlite3_exec = NULL;
+	proxy_sqlite3_create_module_v2 = NULL;
+	proxy_sqlite3_declare_vtab = NULL;
+	proxy_sqlite3_vtab_collation = NULL;
+	proxy_sqlite3_result_int64 = NULL;
+	proxy_sqlite3_result_text = NULL;
+	proxy_sqlite3_result_null = NULL;
+	proxy_sqlite3_value_type = NULL;
+	proxy_sqlite3_value_numeric_type = NULL;
+	proxy_sqlite3_value_int64 = NULL;
+	proxy_sqlite3_value_double = NULL;
+	proxy_sqlite3_value_text = NULL;
 	if (plugin_name) {
 		int fd = -1;
 		fd = ::open(plugin_name, O_RDONLY);
@@ -1057,6 +1068,17 @@ void SQLite3DB::LoadPlugin(const char *plugin_name) {
 		proxy_sqlite3_prepare_v2 = sqlite3_prepare_v2;
 		proxy_sqlite3_open_v2 = sqlite3_open_v2;
 		proxy_sqlite3_exec = sqlite3_exec;
+		proxy_sqlite3_create_module_v2 = sqlite3_create_module_v2;
+		proxy_sqlite3_declare_vtab = sqlite3_declare_vtab;
+		proxy_sqlite3_vtab_collation = sqlite3_vtab_collation;
+		proxy_sqlite3_result_int64 = sqlite3_result_int64;
+		proxy_sqlite3_result_text = sqlite3_result_text;
+		proxy_sqlite3_result_null = sqlite3_result_null;
+		proxy_sqlite3_value_type = sqlite3_value_type;
+		proxy_sqlite3_value_numeric_type = sqlite3_value_numeric_type;
+		proxy_sqlite3_value_int64 = sqlite3_value_int64;
+		proxy_sqlite3_value_double = sqlite3_value_double;
+		proxy_sqlite3_value_text = sqlite3_value_text;
 		proxy_info("Loaded built-in SQLite3\n");
 	}
 	assert(proxy_sqlite3_config);
@@ -1085,6 +1107,7 @@ void SQLite3DB::LoadPlugin(const char *plugin_name) {
 	assert(proxy_sqlite3_prepare_v2);
 	assert(proxy_sqlite3_open_v2);
 	assert(proxy_sqlite3_exec);
+	// the virtual tables functions are optional: without them Admin keeps using regular stats tables
 	{
 		/* moved here, so if needed by multiple modules it applies to all of them */
 		int i=(*proxy_sqlite3_config)(SQLITE_CONFIG_URI, 1);
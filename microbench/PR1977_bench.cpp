@@ -1,6 +1,11 @@
 #include <cstdio>
 #include <cstdlib>
+#include <cmath>
+#include <ctime>
 #include <iostream>
+#include <queue>
+#include <vector>
+#include <algorithm>
 
 __thread unsigned int g_seed;
 
@@ -34,6 +39,157 @@ struct cpu_timer
 };
 
 
+/*
+ * Comparison of the load balancing algorithms of MyHGC::get_random_MySrvC() .
+ * Selection functions mirror lib/MyHGC.cpp . Servers have uneven speed: the simulation sends
+ * requests with Poisson arrivals, and the latency of a request grows with the requests in flight on
+ * the chosen server. Both the cost of the selection and the resulting latency percentiles are reported.
+ */
+
+enum { LB_WEIGHTED_RANDOM = 0, LB_POWER_OF_TWO_CHOICES, LB_LEAST_OUTSTANDING_QUERIES, LB_PEAK_EWMA, LB_ALGORITHM__END };
+const char *lb_names[] = { "weighted random", "power of two choices", "least outstanding queries", "peak EWMA" };
+
+#define LB_NSRV	8
+#define LB_NREQ	2000000
+#define LB_SLOTS	4	// requests a server runs in parallel without slowing down
+#define LB_EWMA_DECAY_US	1000000
+
+struct sim_srv {
+	unsigned int weight;
+	double service_us; // latency of a request on an idle server
+	unsigned int queries_in_flight;
+	unsigned int latency_ewma_us;
+	unsigned long long latency_ewma_updated_at;
+};
+
+unsigned int get_latency_ewma_us(sim_srv *s, unsigned long long curtime) {
+	unsigned int ewma = s->latency_ewma_us;
+	if (ewma && curtime > s->latency_ewma_updated_at + LB_EWMA_DECAY_US) {
+		unsigned long long halvings = (curtime - s->latency_ewma_updated_at) / LB_EWMA_DECAY_US;
+		ewma = (halvings >= 32 ? 0 : ewma >> halvings);
+	}
+	return ewma;
+}
+
+void update_latency_ewma(sim_srv *s, unsigned long long latency_us, unsigned long long curtime) {
+	unsigned int ewma = get_latency_ewma_us(s, curtime);
+	if (latency_us >= ewma) {
+		ewma = latency_us;
+	} else {
+		ewma -= (ewma - latency_us) >> 3;
+	}
+	s->latency_ewma_us = ewma;
+	s->latency_ewma_updated_at = curtime;
+}
+
+inline sim_srv * weighted_random(sim_srv *srvs, int n, unsigned int sum) {
+	unsigned int k = (sum > 32768 ? rand()%sum : fastrand()%sum) + 1;
+	unsigned int New_sum = 0;
+	for (int j=0; j<n; j++) {
+		New_sum += srvs[j].weight;
+		if (k <= New_sum) {
+			return &srvs[j];
+		}
+	}
+	return NULL;
+}
+
+inline double get_load(sim_srv *s, int algorithm, unsigned long long curtime) {
+	double load = (double)(s->queries_in_flight + 1) / s->weight;
+	if (algorithm == LB_PEAK_EWMA) {
+		load *= (double)(get_latency_ewma_us(s, curtime) + 1);
+	}
+	return load;
+}
+
+sim_srv * lb_choose(sim_srv *srvs, int n, unsigned int sum, int algorithm, unsigned long long curtime) {
+	switch (algorithm) {
+		case LB_POWER_OF_TWO_CHOICES:
+		case LB_PEAK_EWMA:
+			{
+				sim_srv *a = weighted_random(srvs, n, sum);
+				sim_srv *b = weighted_random(srvs, n, sum);
+				if (a == b && n > 1) {
+					b = weighted_random(srvs, n, sum);
+				}
+				return (get_load(b, algorithm, curtime) < get_load(a, algorithm, curtime) ? b : a);
+			}
+		case LB_LEAST_OUTSTANDING_QUERIES:
+			{
+				sim_srv *best = NULL;
+				double min_load = 0;
+				int start = fastrand()%n;
+				for (int j=0; j<n; j++) {
+					sim_srv *s = &srvs[(start+j)%n];
+					double load = get_load(s, algorithm, curtime);
+					if (best == NULL || load < min_load) {
+						best = s;
+						min_load = load;
+					}
+				}
+				return best;
+			}
+		default:
+			return weighted_random(srvs, n, sum);
+	}
+}
+
+struct sim_completion {
+	unsigned long long at;
+	unsigned long long latency_us;
+	sim_srv *srv;
+	bool operator>(const sim_completion& o) const { return at > o.at; }
+};
+
+void lb_bench(int algorithm) {
+	sim_srv srvs[LB_NSRV];
+	unsigned int sum = 0;
+	double capacity = 0; // requests per microsecond served by all servers when not overloaded
+	for (int i=0; i<LB_NSRV; i++) {
+		srvs[i].weight = 1000;
+		// uneven replicas: one server is 5 times slower, two are 2 times slower
+		srvs[i].service_us = (i == 0 ? 5000 : (i < 3 ? 2000 : 1000));
+		srvs[i].queries_in_flight = 0;
+		srvs[i].latency_ewma_us = 0;
+		srvs[i].latency_ewma_updated_at = 0;
+		sum += srvs[i].weight;
+		capacity += LB_SLOTS / srvs[i].service_us;
+	}
+	// cost of the selection alone, with a static load
+	{
+		cpu_timer c;
+		for (int i=0; i<NLOOP; i++) {
+			lb_choose(srvs, LB_NSRV, sum, algorithm, i);
+		}
+		std::cerr << lb_names[algorithm] << ": " << NLOOP << " selections ran in \t";
+	}
+	// simulated latency at 70% of the total capacity
+	double mean_arrival_us = 1 / (capacity * 0.7);
+	std::priority_queue<sim_completion, std::vector<sim_completion>, std::greater<sim_completion>> completions;
+	std::vector<unsigned long long> latencies;
+	latencies.reserve(LB_NREQ);
+	double now = 0;
+	for (int r=0; r<LB_NREQ; r++) {
+		now += -log(drand48()) * mean_arrival_us;
+		unsigned long long curtime = now;
+		while (completions.empty() == false && completions.top().at <= curtime) {
+			const sim_completion& done = completions.top();
+			done.srv->queries_in_flight--;
+			update_latency_ewma(done.srv, done.latency_us, done.at);
+			completions.pop();
+		}
+		sim_srv *s = lb_choose(srvs, LB_NSRV, sum, algorithm, curtime);
+		double slowdown = (s->queries_in_flight < LB_SLOTS ? 1 : (double)(s->queries_in_flight + 1) / LB_SLOTS);
+		unsigned long long latency_us = s->service_us * slowdown * (0.5 + drand48());
+		s->queries_in_flight++;
+		completions.push({ curtime + latency_us, latency_us, s });
+		latencies.push_back(latency_us);
+	}
+	std::sort(latencies.begin(), latencies.end());
+	fprintf(stderr, "%s: latency p50 %llu us , p99 %llu us , p99.9 %llu us\n", lb_names[algorithm],
+		latencies[latencies.size()*50/100], latencies[latencies.size()*99/100], latencies[latencies.size()*999/1000]);
+}
+
 int main(int argc, char** argv) {
 	unsigned int * usedConns = NULL;
 	unsigned int * weights = NULL;
@@ -128,4 +284,8 @@ int main(int argc, char** argv) {
 		std::cerr << "DOUBLE test ran in \t";
 	}
 	}
+	std::cerr << std::endl << "Load balancing algorithms with " << LB_NSRV << " servers:" << std::endl;
+	for (int algorithm=LB_WEIGHTED_RANDOM; algorithm<LB_ALGORITHM__END; algorithm++) {
+		lb_bench(algorithm);
+	}
 }
@@ -0,0 +1,146 @@
+/**
+ * @file test_connection_prewarm-t.cpp
+ * @brief Checks that 'mysql-connection_prewarm_ms' creates backend connections ahead of demand.
+ * @details NUM_CONNS clients, plus one for every free connection already in the pool, open a transaction
+ *  at the same time, forcing the creation of at least NUM_CONNS new backend connections. The demand must be detected and new connections must be created in advance: this is
+ *  checked with 'Server_Connections_prewarmed'. The pre-warmed connections must connect successfully,
+ *  this is checked with the column 'ConnERR' of 'stats_mysql_connection_pool'.
+ */
+
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+
+#include <vector>
+#include <string>
+#include "mysql.h"
+
+#include "tap.h"
+#include "command_line.h"
+#include "utils.h"
+
+using std::string;
+using std::vector;
+
+#define NUM_CONNS 20
+
+long get_global_stat(MYSQL* admin, const char* name) {
+	const string q { string("SELECT variable_value FROM stats_mysql_global WHERE variable_name='") + name + "'" };
+	if (mysql_query(admin, q.c_str())) {
+		return -1;
+	}
+	MYSQL_RES* res = mysql_store_result(admin);
+	MYSQL_ROW row = mysql_fetch_row(res);
+	long val = row ? std::stol(row[0]) : -1;
+	mysql_free_result(res);
+	return val;
+}
+
+long get_pool_stat(MYSQL* admin, const char* column) {
+	const string q { string("SELECT IFNULL(SUM(") + column + "),0) FROM stats_mysql_connection_pool" };
+	if (mysql_query(admin, q.c_str())) {
+		return -1;
+	}
+	MYSQL_RES* res = mysql_store_result(admin);
+	MYSQL_ROW row = mysql_fetch_row(res);
+	long val = row ? std::stol(row[0]) : -1;
+	mysql_free_result(res);
+	return val;
+}
+
+int run_burst(const CommandLine& cl, long num_conns) {
+	vector<MYSQL*> conns {};
+	for (long i = 0; i < num_conns; i++) {
+		MYSQL* proxy = mysql_init(NULL);
+		if (!mysql_real_connect(proxy, cl.host, cl.username, cl.password, NULL, cl.port, NULL, 0)) {
+			fprintf(stderr, "File %s, line %d, Error: %s\n", __FILE__, __LINE__, mysql_error(proxy));
+			return EXIT_FAILURE;
+		}
+		conns.push_back(proxy);
+	}
+	// every open transaction holds a backend connection
+	for (MYSQL* proxy : conns) {
+		MYSQL_QUERY(proxy, "BEGIN");
+		MYSQL_QUERY(proxy, "SELECT 1");
+		mysql_free_result(mysql_store_result(proxy));
+	}
+	for (MYSQL* proxy : conns) {
+		MYSQL_QUERY(proxy, "COMMIT");
+		mysql_close(proxy);
+	}
+	return EXIT_SUCCESS;
+}
+
+int main(int argc, char** argv) {
+	CommandLine cl;
+
+	if (cl.getEnv()) {
+		diag("Failed to get the required environmental variables.");
+		return EXIT_FAILURE;
+	}
+
+	plan(2);
+
+	MYSQL* admin = mysql_init(NULL);
+	if (!mysql_real_connect(admin, cl.host, cl.admin_username, cl.admin_password, NULL, cl.admin_port, NULL, 0)) {
+		fprintf(stderr, "File %s, line %d, Error: %s\n", __FILE__, __LINE__, mysql_error(admin));
+		return EXIT_FAILURE;
+	}
+
+	string prewarm_ms {};
+	string free_connections_pct {};
+	if (
+		get_variable_value(admin, "mysql-connection_prewarm_ms", prewarm_ms) ||
+		get_variable_value(admin, "mysql-free_connections_pct", free_connections_pct)
+	) {
+		diag("Failed to get the current values of the variables");
+		return EXIT_FAILURE;
+	}
+
+	vector<string> admin_queries {
+		"SET mysql-connection_prewarm_ms=2000",
+		"SET mysql-free_connections_pct=100",
+		"LOAD MYSQL VARIABLES TO RUNTIME",
+	};
+	for (const string& q : admin_queries) {
+		diag("Running on Admin: %s", q.c_str());
+		MYSQL_QUERY(admin, q.c_str());
+	}
+
+	long prewarmed_before = get_global_stat(admin, "Server_Connections_prewarmed");
+	long errors_before = get_pool_stat(admin, "ConnERR");
+	// the free connections already in the pool are used before creating new ones
+	long conns_free = get_pool_stat(admin, "ConnFree");
+	diag("Free connections in the pool: %ld", conns_free);
+
+	if (run_burst(cl, NUM_CONNS + (conns_free > 0 ? conns_free : 0))) {
+		return exit_status();
+	}
+	diag("Sleeping few seconds so connections can be pre-warmed");
+	sleep(2);
+
+	long prewarmed_after = get_global_stat(admin, "Server_Connections_prewarmed");
+	long errors_after = get_pool_stat(admin, "ConnERR");
+
+	ok(
+		prewarmed_after > prewarmed_before,
+		"Connections should have been pre-warmed - Before: %ld, After: %ld",
+		prewarmed_before, prewarmed_after
+	);
+	ok(
+		errors_after == errors_before,
+		"Pre-warmed connections should connect without errors - Exp: %ld, Act: %ld",
+		errors_before, errors_after
+	);
+
+	const string restore_prewarm_ms { "SET mysql-connection_prewarm_ms=" + prewarm_ms };
+	const string restore_free_pct { "SET mysql-free_connections_pct=" + free_connections_pct };
+	MYSQL_QUERY(admin, restore_prewarm_ms.c_str());
+	MYSQL_QUERY(admin, restore_free_pct.c_str());
+	MYSQL_QUERY(admin, "LOAD MYSQL VARIABLES TO RUNTIME");
+
+	mysql_close(admin);
+
+	return exit_status();
+}
@@ -0,0 +1,149 @@
+/**
+ * @file test_digest_snapshot_save-t.cpp
+ * @brief Checks 'SAVE MYSQL DIGEST TO DISK' while 'stats_mysql_query_digest' is scanned as a virtual table.
+ * @details With 'admin-stats_virtual_tables' the scans of 'stats_mysql_query_digest' move the digests into a
+ *  snapshot until the scan ends. A thread keeps scanning the table from one Admin connection, while the main
+ *  thread generates NUM_DIGESTS digests and saves them to disk from another Admin connection. The test checks:
+ *   1. Every save writes all the digests to 'history_mysql_query_digest', also the ones in a snapshot.
+ *   2. The saved digests are reset: they don't reappear in 'stats_mysql_query_digest' after the scans.
+ */
+
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "mysql.h"
+
+#include "tap.h"
+#include "command_line.h"
+#include "utils.h"
+
+using std::string;
+using std::vector;
+
+#define NUM_DIGESTS	50
+#define ROUNDS	5
+
+std::atomic<bool> stop(false);
+std::atomic<long> scans(0);
+
+long get_count(MYSQL* admin, const char* q) {
+	if (mysql_query(admin, q)) {
+		fprintf(stderr, "File %s, line %d, Error: %s\n", __FILE__, __LINE__, mysql_error(admin));
+		return -1;
+	}
+	MYSQL_RES* res = mysql_store_result(admin);
+	MYSQL_ROW row = mysql_fetch_row(res);
+	long val = (row && row[0]) ? std::stol(row[0]) : -1;
+	mysql_free_result(res);
+	return val;
+}
+
+void scan_digests(const CommandLine& cl) {
+	MYSQL* admin = mysql_init(NULL);
+	if (!mysql_real_connect(admin, cl.host, cl.admin_username, cl.admin_password, NULL, cl.admin_port, NULL, 0)) {
+		fprintf(stderr, "File %s, line %d, Error: %s\n", __FILE__, __LINE__, mysql_error(admin));
+		return;
+	}
+	while (stop == false) {
+		if (get_count(admin, "SELECT COUNT(*) FROM stats_mysql_query_digest") < 0) {
+			break;
+		}
+		scans++;
+	}
+	mysql_close(admin);
+}
+
+int main(int argc, char** argv) {
+	CommandLine cl;
+
+	if (cl.getEnv()) {
+		diag("Failed to get the required environmental variables.");
+		return EXIT_FAILURE;
+	}
+
+	plan(ROUNDS + 1);
+
+	MYSQL* admin = mysql_init(NULL);
+	if (!mysql_real_connect(admin, cl.host, cl.admin_username, cl.admin_password, NULL, cl.admin_port, NULL, 0)) {
+		fprintf(stderr, "File %s, line %d, Error: %s\n", __FILE__, __LINE__, mysql_error(admin));
+		return EXIT_FAILURE;
+	}
+	MYSQL* proxy = mysql_init(NULL);
+	if (!mysql_real_connect(proxy, cl.host, cl.username, cl.password, NULL, cl.port, NULL, 0)) {
+		fprintf(stderr, "File %s, line %d, Error: %s\n", __FILE__, __LINE__, mysql_error(proxy));
+		return EXIT_FAILURE;
+	}
+
+	vector<string> admin_queries {
+		"SET admin-stats_virtual_tables='true'",
+		"LOAD ADMIN VARIABLES TO RUNTIME",
+		"SET mysql-query_digests='true'",
+		"LOAD MYSQL VARIABLES TO RUNTIME",
+		"TRUNCATE TABLE stats_mysql_query_digest",
+		"DELETE FROM history_mysql_query_digest",
+	};
+	for (const string& q : admin_queries) {
+		diag("Running on Admin: %s", q.c_str());
+		MYSQL_QUERY(admin, q.c_str());
+	}
+
+	std::thread scanner(scan_digests, std::cref(cl));
+
+	const char* count_history =
+		"SELECT COUNT(*) FROM history_mysql_query_digest WHERE digest_text LIKE 'SELECT ? AS snapshot_col_%'";
+	int err = 0;
+	for (int r = 0; r < ROUNDS && err == 0; r++) {
+		for (int i = 0; i < NUM_DIGESTS && err == 0; i++) {
+			const string q { "SELECT 1 AS snapshot_col_" + std::to_string(i) };
+			err = mysql_query(proxy, q.c_str());
+			if (err) {
+				fprintf(stderr, "File %s, line %d, Error: %s\n", __FILE__, __LINE__, mysql_error(proxy));
+			} else {
+				mysql_free_result(mysql_store_result(proxy));
+			}
+		}
+		if (err == 0) {
+			err = mysql_query(admin, "SAVE MYSQL DIGEST TO DISK");
+			if (err) {
+				fprintf(stderr, "File %s, line %d, Error: %s\n", __FILE__, __LINE__, mysql_error(admin));
+			}
+		}
+		if (err) {
+			break;
+		}
+		long saved = get_count(admin, count_history);
+		ok(
+			saved == (long)NUM_DIGESTS * (r + 1),
+			"All the digests should be saved while the table is scanned - Exp: %d, Act: %ld",
+			NUM_DIGESTS * (r + 1), saved
+		);
+	}
+
+	stop = true;
+	scanner.join();
+	diag("Scans of stats_mysql_query_digest completed: %ld", scans.load());
+	if (err) {
+		return exit_status();
+	}
+
+	long left = get_count(
+		admin, "SELECT COUNT(*) FROM stats_mysql_query_digest WHERE digest_text LIKE 'SELECT ? AS snapshot_col_%'"
+	);
+	ok(left == 0, "The saved digests should not reappear after the scans - Exp: 0, Act: %ld", left);
+
+	MYSQL_QUERY(admin, "LOAD ADMIN VARIABLES FROM DISK");
+	MYSQL_QUERY(admin, "LOAD ADMIN VARIABLES TO RUNTIME");
+	MYSQL_QUERY(admin, "LOAD MYSQL VARIABLES FROM DISK");
+	MYSQL_QUERY(admin, "LOAD MYSQL VARIABLES TO RUNTIME");
+
+	mysql_close(proxy);
+	mysql_close(admin);
+
+	return exit_status();
+}
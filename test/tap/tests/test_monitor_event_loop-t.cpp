@@ -0,0 +1,123 @@
+/**
+ * @file test_monitor_event_loop-t.cpp
+ * @brief Checks the checks scheduled by 'mysql-monitor_event_loop'.
+ * @details With the event loop enabled the ping, read_only and replication lag threads don't issue
+ *  checks, the MonitorSched thread does. The test checks that:
+ *   1. Pings are logged in 'monitor.mysql_server_ping_log' for the configured servers.
+ *   2. After adding a server that can't be reached, its failed pings are logged too.
+ *   3. The checks of the other servers keep being logged: failed checks don't stop the scheduler.
+ */
+
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+
+#include <vector>
+#include <string>
+#include "mysql.h"
+
+#include "tap.h"
+#include "command_line.h"
+#include "utils.h"
+
+using std::string;
+using std::vector;
+
+// hostgroup and port of the server that can't be reached
+#define UNREACHABLE_HG	1999
+#define UNREACHABLE_PORT	1
+// time waited for the checks to be performed and logged , in seconds
+#define CHECKS_WAIT	4
+
+long long get_value(MYSQL* admin, const string& q) {
+	if (mysql_query(admin, q.c_str())) {
+		fprintf(stderr, "File %s, line %d, Error: %s\n", __FILE__, __LINE__, mysql_error(admin));
+		return -1;
+	}
+	MYSQL_RES* res = mysql_store_result(admin);
+	MYSQL_ROW row = mysql_fetch_row(res);
+	long long val = (row && row[0]) ? std::stoll(row[0]) : 0;
+	mysql_free_result(res);
+	return val;
+}
+
+long long count_pings(MYSQL* admin, long long since_us, bool unreachable, bool errors) {
+	const string q {
+		"SELECT COUNT(*) FROM monitor.mysql_server_ping_log WHERE time_start_us > " + std::to_string(since_us) +
+		" AND port" + (unreachable ? "=" : "<>") + std::to_string(UNREACHABLE_PORT) +
+		" AND ping_error IS " + (errors ? "NOT NULL" : "NULL")
+	};
+	return get_value(admin, q);
+}
+
+long long last_ping_time(MYSQL* admin) {
+	return get_value(admin, "SELECT IFNULL(MAX(time_start_us),0) FROM monitor.mysql_server_ping_log");
+}
+
+int main(int argc, char** argv) {
+	CommandLine cl;
+
+	if (cl.getEnv()) {
+		diag("Failed to get the required environmental variables.");
+		return EXIT_FAILURE;
+	}
+
+	plan(3);
+
+	MYSQL* admin = mysql_init(NULL);
+	if (!mysql_real_connect(admin, cl.host, cl.admin_username, cl.admin_password, NULL, cl.admin_port, NULL, 0)) {
+		fprintf(stderr, "File %s, line %d, Error: %s\n", __FILE__, __LINE__, mysql_error(admin));
+		return EXIT_FAILURE;
+	}
+
+	vector<string> admin_queries {
+		"SET mysql-monitor_enabled='true'",
+		"SET mysql-monitor_event_loop='true'",
+		"SET mysql-monitor_ping_interval=500",
+		"SET mysql-monitor_connect_timeout=200",
+		"SET mysql-monitor_ping_timeout=200",
+		"LOAD MYSQL VARIABLES TO RUNTIME",
+	};
+	for (const string& q : admin_queries) {
+		diag("Running on Admin: %s", q.c_str());
+		MYSQL_QUERY(admin, q.c_str());
+	}
+
+	long long since_us = last_ping_time(admin);
+	diag("Sleeping %d seconds waiting for the pings", CHECKS_WAIT);
+	sleep(CHECKS_WAIT);
+	long long pings = count_pings(admin, since_us, false, false);
+	ok(pings > 0, "Pings should be scheduled by the event loop - Pings: %lld", pings);
+
+	const string add_server {
+		"INSERT INTO mysql_servers (hostgroup_id, hostname, port) VALUES (" + std::to_string(UNREACHABLE_HG) +
+		", '127.0.0.1', " + std::to_string(UNREACHABLE_PORT) + ")"
+	};
+	diag("Running on Admin: %s", add_server.c_str());
+	MYSQL_QUERY(admin, add_server.c_str());
+	MYSQL_QUERY(admin, "LOAD MYSQL SERVERS TO RUNTIME");
+
+	since_us = last_ping_time(admin);
+	diag("Sleeping %d seconds waiting for the failed pings", CHECKS_WAIT);
+	sleep(CHECKS_WAIT);
+	long long failed = count_pings(admin, since_us, true, true);
+	ok(failed > 0, "Failed pings of the unreachable server should be logged - Failed pings: %lld", failed);
+
+	// the checks following the failed ones
+	since_us = last_ping_time(admin);
+	diag("Sleeping %d seconds waiting for more pings", CHECKS_WAIT);
+	sleep(CHECKS_WAIT);
+	pings = count_pings(admin, since_us, false, false);
+	ok(pings > 0, "Pings should continue after the failed checks - Pings: %lld", pings);
+
+	const string del_server { "DELETE FROM mysql_servers WHERE hostgroup_id=" + std::to_string(UNREACHABLE_HG) };
+	MYSQL_QUERY(admin, del_server.c_str());
+	MYSQL_QUERY(admin, "LOAD MYSQL SERVERS TO RUNTIME");
+	MYSQL_QUERY(admin, "LOAD MYSQL VARIABLES FROM DISK");
+	MYSQL_QUERY(admin, "LOAD MYSQL VARIABLES TO RUNTIME");
+
+	mysql_close(admin);
+
+	return exit_status();
+}
@@ -0,0 +1,128 @@
+/**
+ * @file test_query_cache_compression-t.cpp
+ * @brief Checks that resultsets stored compressed in the query cache are returned unchanged.
+ * @details With 'mysql-query_cache_compression' enabled, a set of queries is executed twice: the
+ *  first time the resultset is retrieved from the backend and cached, the second time it is served
+ *  from the query cache. The two resultsets must be identical, and 'Query_Cache_count_SET_COMPRESSED'
+ *  must report the compressible resultsets.
+ */
+
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+
+#include <vector>
+#include <string>
+#include "mysql.h"
+
+#include "tap.h"
+#include "command_line.h"
+#include "utils.h"
+
+using std::string;
+using std::vector;
+
+const vector<string> test_queries {
+	"SELECT REPEAT('a', 10000)",
+	"SELECT REPEAT('abc', 1000), REPEAT('xyz', 1000) UNION ALL SELECT REPEAT('b', 3000), REPEAT('c', 3000)",
+	"SELECT 1", // too short to be compressed
+};
+
+int get_resultset(MYSQL* mysql, const string& query, vector<string>& rows) {
+	MYSQL_QUERY(mysql, query.c_str());
+	MYSQL_RES* res = mysql_store_result(mysql);
+	MYSQL_ROW row = nullptr;
+	unsigned int num_fields = mysql_num_fields(res);
+	while ((row = mysql_fetch_row(res))) {
+		unsigned long* lengths = mysql_fetch_lengths(res);
+		string r {};
+		for (unsigned int i = 0; i < num_fields; i++) {
+			r += string(row[i], lengths[i]) + "|";
+		}
+		rows.push_back(r);
+	}
+	mysql_free_result(res);
+	return EXIT_SUCCESS;
+}
+
+long get_qc_stat(MYSQL* admin, const char* name) {
+	const string q { string("SELECT variable_value FROM stats_mysql_global WHERE variable_name='") + name + "'" };
+	if (mysql_query(admin, q.c_str())) {
+		return -1;
+	}
+	MYSQL_RES* res = mysql_store_result(admin);
+	MYSQL_ROW row = mysql_fetch_row(res);
+	long val = row ? std::stol(row[0]) : -1;
+	mysql_free_result(res);
+	return val;
+}
+
+int main(int argc, char** argv) {
+	CommandLine cl;
+
+	if (cl.getEnv()) {
+		diag("Failed to get the required environmental variables.");
+		return EXIT_FAILURE;
+	}
+
+	plan(test_queries.size() + 1);
+
+	MYSQL* admin = mysql_init(NULL);
+	if (!mysql_real_connect(admin, cl.host, cl.admin_username, cl.admin_password, NULL, cl.admin_port, NULL, 0)) {
+		fprintf(stderr, "File %s, line %d, Error: %s\n", __FILE__, __LINE__, mysql_error(admin));
+		return EXIT_FAILURE;
+	}
+
+	vector<string> admin_queries {
+		"DELETE FROM mysql_query_rules",
+		"INSERT INTO mysql_query_rules (rule_id,active,match_digest,cache_ttl) VALUES (1,1,'^SELECT',60000)",
+		"LOAD MYSQL QUERY RULES TO RUNTIME",
+		"SET mysql-query_cache_compression='true'",
+		"LOAD MYSQL VARIABLES TO RUNTIME",
+		"PROXYSQL FLUSH QUERY CACHE",
+	};
+	for (const string& q : admin_queries) {
+		diag("Running on Admin: %s", q.c_str());
+		MYSQL_QUERY(admin, q.c_str());
+	}
+
+	long compressed_before = get_qc_stat(admin, "Query_Cache_count_SET_COMPRESSED");
+
+	MYSQL* proxy = mysql_init(NULL);
+	if (!mysql_real_connect(proxy, cl.host, cl.username, cl.password, NULL, cl.port, NULL, 0)) {
+		fprintf(stderr, "File %s, line %d, Error: %s\n", __FILE__, __LINE__, mysql_error(proxy));
+		return EXIT_FAILURE;
+	}
+
+	for (const string& q : test_queries) {
+		vector<string> backend_rows {};
+		vector<string> cached_rows {};
+		diag("Running query: %s", q.c_str());
+		if (get_resultset(proxy, q, backend_rows) || get_resultset(proxy, q, cached_rows)) {
+			return exit_status();
+		}
+		ok(
+			backend_rows.size() && backend_rows == cached_rows,
+			"Resultset from the query cache should be identical - Rows: %ld, Cached rows: %ld",
+			backend_rows.size(), cached_rows.size()
+		);
+	}
+	mysql_close(proxy);
+
+	long compressed_after = get_qc_stat(admin, "Query_Cache_count_SET_COMPRESSED");
+	ok(
+		compressed_after - compressed_before == 2,
+		"Only the compressible resultsets should be stored compressed - Exp: 2, Act: %ld",
+		compressed_after - compressed_before
+	);
+
+	MYSQL_QUERY(admin, "SET mysql-query_cache_compression='false'");
+	MYSQL_QUERY(admin, "LOAD MYSQL VARIABLES TO RUNTIME");
+	MYSQL_QUERY(admin, "DELETE FROM mysql_query_rules");
+	MYSQL_QUERY(admin, "LOAD MYSQL QUERY RULES TO RUNTIME");
+
+	mysql_close(admin);
+
+	return exit_status();
+}
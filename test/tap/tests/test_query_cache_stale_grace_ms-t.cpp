@@ -0,0 +1,251 @@
+/**
+ * @file test_query_cache_stale_grace_ms-t.cpp
+ * @brief This test checks that only one client refreshes an expired query cache entry when
+ *  'mysql-query_cache_stale_grace_ms' or 'mysql-query_cache_refresh_wait_ms' are set.
+ * @details A query rule caches "SELECT SLEEP(1)" for one second. Once the entry is expired,
+ *  NUM_THREADS clients send the same query at the same time:
+ *   1. With 'mysql-query_cache_stale_grace_ms', only one client should hit the hostgroup and
+ *      take 1 second, while the other clients receive the expired entry immediately.
+ *   2. With 'mysql-query_cache_refresh_wait_ms', only one client should hit the hostgroup, while
+ *      the other clients wait for the refreshed entry.
+ *  The hits are checked looking at the table "stats_mysql_query_digest".
+ */
+
+#include <unistd.h>
+#include <iostream>
+#include "mysql.h"
+#include <vector>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <map>
+
+#include "proxysql_utils.h"
+#include "command_line.h"
+#include "utils.h"
+#include "tap.h"
+
+using std::vector;
+using std::string;
+
+#define NUM_THREADS 8
+
+CommandLine cl;
+double timer_results[NUM_THREADS];
+
+const char * DUMMY_QUERY = (const char *)"SELECT SLEEP(1)";
+
+class timer {
+public:
+	std::chrono::time_point<std::chrono::high_resolution_clock> lastTime;
+	timer() : lastTime(std::chrono::high_resolution_clock::now()) {}
+	inline double elapsed() {
+		std::chrono::time_point<std::chrono::high_resolution_clock> thisTime = std::chrono::high_resolution_clock::now();
+		double deltaTime = std::chrono::duration<double>(thisTime-lastTime).count();
+		lastTime = thisTime;
+		return deltaTime;
+	}
+};
+
+void run_dummy_query(double* timer_result) {
+	MYSQL* proxy_mysql = mysql_init(NULL);
+
+	if (!mysql_real_connect(proxy_mysql, cl.host, cl.username, cl.password, NULL, cl.port, NULL, 0)) {
+		fprintf(stderr, "File %s, line %d, Error: %s\n", __FILE__, __LINE__, mysql_error(proxy_mysql));
+		*timer_result = -1.0;
+		return;
+	}
+
+	timer stopwatch;
+	int err = mysql_query(proxy_mysql, DUMMY_QUERY);
+	if (err) {
+		diag("Failed to executed query `%s`", DUMMY_QUERY);
+		*timer_result = -1.0;
+		mysql_close(proxy_mysql);
+		return;
+	}
+	*timer_result = stopwatch.elapsed();
+
+	MYSQL_RES* res = NULL;
+	res = mysql_store_result(proxy_mysql);
+	mysql_free_result(res);
+
+	mysql_close(proxy_mysql);
+}
+
+const string STATS_QUERY_DIGEST =
+	"SELECT hostgroup, SUM(count_star) FROM stats_mysql_query_digest "
+	"WHERE digest_text = 'SELECT SLEEP(?)' GROUP BY hostgroup";
+
+std::map<string, int> get_digest_stats_dummy_query(MYSQL* proxy_admin) {
+	diag("Running: %s", STATS_QUERY_DIGEST.c_str());
+	mysql_query(proxy_admin, STATS_QUERY_DIGEST.c_str());
+
+	std::map<string, int> stats {{"cache", 0}, {"hostgroups", 0}}; // {hostgroup, count_star}
+
+	MYSQL_RES* res = mysql_store_result(proxy_admin);
+
+	MYSQL_ROW row;
+	while ((row = mysql_fetch_row(res))) {
+		if (atoi(row[0]) == -1)
+			stats["cache"] += atoi(row[1]);
+		else
+			stats["hostgroups"] += atoi(row[1]);
+	}
+	diag("Queries hitting the cache:     %d", stats["cache"]);
+	diag("Queries NOT hitting the cache: %d", stats["hostgroups"]);
+	mysql_free_result(res);
+
+	return stats;
+}
+
+/**
+ * @brief Sends DUMMY_QUERY from NUM_THREADS clients at the same time.
+ * @return The number of clients that took 1 second or more, or -1 on error.
+ */
+int run_concurrent_clients() {
+	std::thread * mythreads[NUM_THREADS];
+
+	for (unsigned int i = 0; i < NUM_THREADS; i++) {
+		timer_results[i] = 0.0;
+		mythreads[i] = new std::thread(run_dummy_query, &timer_results[i]);
+	}
+	for (unsigned int i = 0; i < NUM_THREADS; i++) {
+		mythreads[i]->join();
+		delete mythreads[i];
+	}
+
+	int num_slow_clients = 0;
+	for (unsigned int i = 0; i < NUM_THREADS; i++) {
+		if (timer_results[i] == -1.0) {
+			return -1;
+		}
+		// count the clients that take 1 second or more by casting double to int
+		num_slow_clients += (int)timer_results[i];
+	}
+	return num_slow_clients;
+}
+
+int main(int argc, char** argv) {
+
+	if (cl.getEnv()) {
+		diag("Failed to get the required environmental variables.");
+		return EXIT_FAILURE;
+	}
+
+	plan(5);
+
+	MYSQL* proxy_admin = mysql_init(NULL);
+	if (!mysql_real_connect(proxy_admin, cl.host, cl.admin_username, cl.admin_password, NULL, cl.admin_port, NULL, 0)) {
+		fprintf(stderr, "File %s, line %d, Error: %s\n", __FILE__, __LINE__, mysql_error(proxy_admin));
+		return EXIT_FAILURE;
+	}
+
+	vector<string> admin_queries = {
+		"DELETE FROM mysql_query_rules",
+		"INSERT INTO mysql_query_rules (rule_id,active,match_digest,cache_ttl) VALUES (2,1,'^SELECT',1000)",
+		"LOAD MYSQL QUERY RULES TO RUNTIME",
+		"UPDATE global_variables SET variable_value=0 WHERE variable_name='mysql-query_cache_soft_ttl_pct'",
+		"UPDATE global_variables SET variable_value=5000 WHERE variable_name='mysql-query_cache_stale_grace_ms'",
+		"UPDATE global_variables SET variable_value=0 WHERE variable_name='mysql-query_cache_refresh_wait_ms'",
+		"LOAD MYSQL VARIABLES TO RUNTIME",
+		"PROXYSQL FLUSH QUERY CACHE",
+	};
+
+	for (const auto &query : admin_queries) {
+		diag("Running: %s", query.c_str());
+		MYSQL_QUERY(proxy_admin, query.c_str());
+	}
+
+	MYSQL* proxy_mysql = mysql_init(NULL);
+	if (!mysql_real_connect(proxy_mysql, cl.host, cl.username, cl.password, NULL, cl.port, NULL, 0)) {
+		fprintf(stderr, "File %s, line %d, Error: %s\n", __FILE__, __LINE__, mysql_error(proxy_mysql));
+		mysql_close(proxy_admin);
+		return EXIT_FAILURE;
+	}
+
+	diag("Running: %s", DUMMY_QUERY);
+	MYSQL_QUERY(proxy_mysql, DUMMY_QUERY); // We want to cache query "SELECT SLEEP(1)"
+
+	MYSQL_RES* res = NULL;
+	res = mysql_store_result(proxy_mysql);
+	mysql_free_result(res);
+	mysql_close(proxy_mysql);
+
+	// 1. stale-while-revalidate
+	diag("Sleeping until the cache entry is expired");
+	usleep(1500000);
+
+	std::map<string, int> stats_before = get_digest_stats_dummy_query(proxy_admin);
+	int num_slow_clients = run_concurrent_clients();
+	if (num_slow_clients == -1) {
+		fprintf(stderr, "File %s, line %d, Error: one or more threads finished with errors\n", __FILE__, __LINE__);
+		mysql_close(proxy_admin);
+		return EXIT_FAILURE;
+	}
+	std::map<string, int> stats_after = get_digest_stats_dummy_query(proxy_admin);
+
+	ok(
+		num_slow_clients == 1,
+		"Only one client should take 1 second to execute the query. "
+		"Number of clients that take more than 1 second - Exp:'%d', Act:'%d'",
+		1, num_slow_clients
+	);
+	ok(
+		stats_after["cache"] - stats_before["cache"] == NUM_THREADS - 1,
+		"Expired entry should have been served %d times. Number of hits - Exp:'%d', Act:'%d'",
+		NUM_THREADS - 1, NUM_THREADS - 1, stats_after["cache"] - stats_before["cache"]
+	);
+	ok(
+		stats_after["hostgroups"] - stats_before["hostgroups"] == 1,
+		"Hostgroups should have been hit once. Number of hits - Exp:'%d', Act:'%d'",
+		1, stats_after["hostgroups"] - stats_before["hostgroups"]
+	);
+
+	// 2. request coalescing
+	admin_queries = {
+		"UPDATE global_variables SET variable_value=0 WHERE variable_name='mysql-query_cache_stale_grace_ms'",
+		"UPDATE global_variables SET variable_value=5000 WHERE variable_name='mysql-query_cache_refresh_wait_ms'",
+		"LOAD MYSQL VARIABLES TO RUNTIME",
+	};
+	for (const auto &query : admin_queries) {
+		diag("Running: %s", query.c_str());
+		MYSQL_QUERY(proxy_admin, query.c_str());
+	}
+
+	diag("Sleeping until the refreshed cache entry is expired");
+	usleep(1500000);
+
+	stats_before = get_digest_stats_dummy_query(proxy_admin);
+	num_slow_clients = run_concurrent_clients();
+	if (num_slow_clients == -1) {
+		fprintf(stderr, "File %s, line %d, Error: one or more threads finished with errors\n", __FILE__, __LINE__);
+		mysql_close(proxy_admin);
+		return EXIT_FAILURE;
+	}
+	stats_after = get_digest_stats_dummy_query(proxy_admin);
+
+	ok(
+		stats_after["cache"] - stats_before["cache"] == NUM_THREADS - 1,
+		"Waiting clients should have received the refreshed entry. Number of hits - Exp:'%d', Act:'%d'",
+		NUM_THREADS - 1, stats_after["cache"] - stats_before["cache"]
+	);
+	ok(
+		stats_after["hostgroups"] - stats_before["hostgroups"] == 1,
+		"Hostgroups should have been hit once. Number of hits - Exp:'%d', Act:'%d'",
+		1, stats_after["hostgroups"] - stats_before["hostgroups"]
+	);
+
+	admin_queries = {
+		"UPDATE global_variables SET variable_value=0 WHERE variable_name='mysql-query_cache_refresh_wait_ms'",
+		"LOAD MYSQL VARIABLES TO RUNTIME",
+		"DELETE FROM mysql_query_rules",
+		"LOAD MYSQL QUERY RULES TO RUNTIME",
+	};
+	for (const auto &query : admin_queries) {
+		MYSQL_QUERY(proxy_admin, query.c_str());
+	}
+	mysql_close(proxy_admin);
+
+	return exit_status();
+}
@@ -0,0 +1,157 @@
+/**
+ * @file test_query_processor_regex_set-t.cpp
+ * @brief Checks that 'mysql-query_processor_regex_set' doesn't change which query rules are matched.
+ * @details The same set of queries is executed against the same set of rules, first with the
+ *  multi-pattern matcher disabled and then enabled. The hits reported by 'stats_mysql_query_rules'
+ *  for every rule must be identical in both cases. Rules cover 'match_digest', 'match_pattern',
+ *  'CASELESS', 'negate_match_pattern' and flagIN chaining.
+ *  SQLite3 Server is used as backend on hostgroups 1458 and 1459, IP 127.0.0.1 and port 6030.
+ */
+
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+
+#include <map>
+#include <vector>
+#include <string>
+#include "mysql.h"
+
+#include "tap.h"
+#include "command_line.h"
+#include "utils.h"
+
+using std::string;
+
+const char* username = "user_regex_set";
+const char* password = "pass_regex_set";
+
+std::vector<string> setup_queries {
+	"SET mysql-query_processor_regex=2",
+	"LOAD MYSQL VARIABLES TO RUNTIME",
+	"DELETE FROM mysql_servers WHERE hostgroup_id IN (1458,1459)",
+	"INSERT INTO mysql_servers (hostgroup_id, hostname, port, use_ssl) VALUES (1458, '127.0.0.1', 6030, 0),(1459, '127.0.0.1', 6030, 0)",
+	"LOAD MYSQL SERVERS TO RUNTIME",
+	"DELETE FROM mysql_users WHERE username='" + string(username) + "'",
+	"INSERT INTO mysql_users (username,password,default_hostgroup) VALUES ('" + string(username) + "','" + string(password) + "',1458)",
+	"LOAD MYSQL USERS TO RUNTIME",
+	"DELETE FROM mysql_query_rules",
+	"INSERT INTO mysql_query_rules (rule_id,active,username,match_pattern,re_modifiers,apply) VALUES (1,1,'" + string(username) + "','^SELECT 1','CASELESS',0)",
+	"INSERT INTO mysql_query_rules (rule_id,active,username,match_digest,negate_match_pattern,apply) VALUES (2,1,'" + string(username) + "','FROM',1,0)",
+	"INSERT INTO mysql_query_rules (rule_id,active,username,match_pattern,flagOUT,apply) VALUES (3,1,'" + string(username) + "','abc|xyz',1,0)",
+	"INSERT INTO mysql_query_rules (rule_id,active,username,flagIN,match_digest,destination_hostgroup,apply) VALUES (4,1,'" + string(username) + "',1,'^SELECT',1459,1)",
+	"INSERT INTO mysql_query_rules (rule_id,active,username,flagIN,match_pattern,re_modifiers,destination_hostgroup,apply) VALUES (5,1,'" + string(username) + "',1,'xyz','CASELESS',1458,1)",
+	"INSERT INTO mysql_query_rules (rule_id,active,username,match_pattern,destination_hostgroup,apply) VALUES (6,1,'" + string(username) + "','^select',1458,1)",
+	"INSERT INTO mysql_query_rules (rule_id,active,username,match_digest,destination_hostgroup,apply) VALUES (7,1,'" + string(username) + "','^SELECT',1459,1)",
+};
+
+std::vector<string> test_queries {
+	"SELECT 1",
+	"select 1",
+	"SELECT 'abc'",
+	"select 'xyz'",
+	"SELECT 'XYZ' FROM (SELECT 1)",
+	"SELECT 2",
+	"select 2 FROM (SELECT 'abc')",
+};
+
+int run_queries(MYSQL* my, const std::vector<string>& queries) {
+	for (const string& q : queries) {
+		diag("Running query: %s", q.c_str());
+		MYSQL_QUERY(my, q.c_str());
+		MYSQL_RES* res = mysql_store_result(my);
+		mysql_free_result(res);
+	}
+	return EXIT_SUCCESS;
+}
+
+int get_rules_hits(MYSQL* admin, std::map<long,long>& hits) {
+	MYSQL_QUERY(admin, "SELECT rule_id, hits FROM stats_mysql_query_rules ORDER BY rule_id");
+	MYSQL_RES* res = mysql_store_result(admin);
+	MYSQL_ROW row = nullptr;
+	while ((row = mysql_fetch_row(res))) {
+		hits[std::stol(row[0])] = std::stol(row[1]);
+	}
+	mysql_free_result(res);
+	return EXIT_SUCCESS;
+}
+
+int collect_hits(const CommandLine& cl, MYSQL* admin, bool regex_set, std::map<long,long>& hits) {
+	const string set_var { string("SET mysql-query_processor_regex_set=") + (regex_set ? "true" : "false") };
+	MYSQL_QUERY(admin, set_var.c_str());
+	MYSQL_QUERY(admin, "LOAD MYSQL VARIABLES TO RUNTIME");
+	// rules are recompiled, and their hits reset, only when loaded
+	MYSQL_QUERY(admin, "LOAD MYSQL QUERY RULES TO RUNTIME");
+
+	MYSQL* proxy = mysql_init(NULL);
+	if (!mysql_real_connect(proxy, cl.host, username, password, NULL, cl.port, NULL, 0)) {
+		fprintf(stderr, "File %s, line %d, Error: %s\n", __FILE__, __LINE__, mysql_error(proxy));
+		return EXIT_FAILURE;
+	}
+	for (int i = 0; i < 5; i++) {
+		if (run_queries(proxy, test_queries)) {
+			return EXIT_FAILURE;
+		}
+	}
+	mysql_close(proxy);
+
+	diag("Sleeping few seconds so query rules hits can be refreshed");
+	sleep(4);
+
+	return get_rules_hits(admin, hits);
+}
+
+int main(int argc, char** argv) {
+	CommandLine cl;
+
+	if (cl.getEnv()) {
+		diag("Failed to get the required environmental variables.");
+		return EXIT_FAILURE;
+	}
+
+	plan(2 + 7);
+
+	MYSQL* admin = mysql_init(NULL);
+	if (!mysql_real_connect(admin, cl.host, cl.admin_username, cl.admin_password, NULL, cl.admin_port, NULL, 0)) {
+		fprintf(stderr, "File %s, line %d, Error: %s\n", __FILE__, __LINE__, mysql_error(admin));
+		return EXIT_FAILURE;
+	}
+
+	for (const string& q : setup_queries) {
+		diag("Running on Admin: %s", q.c_str());
+		MYSQL_QUERY(admin, q.c_str());
+	}
+
+	std::map<long,long> hits_linear {};
+	std::map<long,long> hits_set {};
+
+	if (collect_hits(cl, admin, false, hits_linear)) {
+		return exit_status();
+	}
+	if (collect_hits(cl, admin, true, hits_set)) {
+		return exit_status();
+	}
+
+	ok(hits_linear.size() == 7, "All the rules should be reported - Exp: 7, Act: %ld", hits_linear.size());
+	ok(hits_set.size() == hits_linear.size(), "Same number of rules reported - Exp: %ld, Act: %ld", hits_linear.size(), hits_set.size());
+
+	for (const auto& rule_hits : hits_linear) {
+		long set_hits = hits_set.count(rule_hits.first) ? hits_set[rule_hits.first] : -1;
+		ok(
+			rule_hits.second == set_hits,
+			"Hits for rule_id %ld should match with and without regex set - Exp: %ld, Act: %ld",
+			rule_hits.first, rule_hits.second, set_hits
+		);
+	}
+
+	MYSQL_QUERY(admin, "SET mysql-query_processor_regex_set=false");
+	MYSQL_QUERY(admin, "SET mysql-query_processor_regex=1");
+	MYSQL_QUERY(admin, "LOAD MYSQL VARIABLES TO RUNTIME");
+	MYSQL_QUERY(admin, "DELETE FROM mysql_query_rules");
+	MYSQL_QUERY(admin, "LOAD MYSQL QUERY RULES TO RUNTIME");
+
+	mysql_close(admin);
+
+	return exit_status();
+}
@@ -0,0 +1,415 @@
+/**
+ * @file eventslog_benchmark.cpp
+ * @brief Compares the formats of the events log: write throughput, file size and read throughput.
+ * @details Synthetic query events are written in the three formats of 'mysql-eventslog_format':
+ *  - 1 : binary , one event after the other (encoded as MySQL_Event::write_query_format_1())
+ *  - 2 : JSON , one event per line (encoded as MySQL_Event::write_query_format_2_json())
+ *  - 3 : blocks of events stored by column and LZ4 compressed (MySQL_Logger_Block_Encoder)
+ *  The files are then read back: format 1 and 2 sequentially , format 3 with multiple threads.
+ *
+ *  Usage: eventslog_benchmark [-n events] [-d directory] [-t threads]
+ */
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "MySQL_Logger_Block.h"
+#include "../deps/json/json.hpp"
+
+using json = nlohmann::json;
+using namespace std;
+
+#define PROXYSQL_COM_QUERY	0
+// events are encoded in memory and written to the file in chunks of this size, as the events writer does
+#define WRITE_CHUNK_SIZE	(1024*1024)
+
+typedef struct {
+	string username;
+	string schemaname;
+	string client;
+	uint64_t hid;
+	string server;
+	uint32_t thread_id;
+	uint64_t start_time;
+	uint64_t end_time;
+	uint64_t affected_rows;
+	uint64_t rows_sent;
+	uint64_t query_digest;
+	string query;
+} bench_event_t;
+
+static const char *query_templates[] = {
+	"SELECT id, name, email, created_at FROM users WHERE id = %u",
+	"SELECT * FROM orders WHERE customer_id = %u AND status = 'shipped' ORDER BY created_at DESC LIMIT 10",
+	"UPDATE sessions SET last_seen = NOW() WHERE session_id = '%08x%08x'",
+	"INSERT INTO events (user_id, type, payload) VALUES (%u, 'click', '{\"page\":\"/item/%u\"}')",
+	"SELECT COUNT(*) FROM cart_items WHERE cart_id = %u",
+	"DELETE FROM tmp_tokens WHERE expires_at < %u",
+	"SELECT p.id, p.title, p.price FROM products p JOIN categories c ON c.id = p.category_id WHERE c.slug = 'cat-%u'",
+	"BEGIN",
+	"COMMIT",
+	"SELECT @@version_comment LIMIT 1",
+};
+
+static void generate_events(vector<bench_event_t>& evs, size_t n) {
+	mt19937_64 rng(42);
+	uint64_t t=1700000000ULL*1000000;
+	const size_t ntemplates=sizeof(query_templates)/sizeof(query_templates[0]);
+	evs.resize(n);
+	char buf[512];
+	for (size_t i=0; i<n; i++) {
+		bench_event_t& e=evs[i];
+		unsigned int r=rng();
+		e.username="app_user_" + to_string(r % 8);
+		e.schemaname="shop_" + to_string((r >> 4) % 4);
+		e.client="10.0.1." + to_string((r >> 8) % 200) + ":" + to_string(30000 + (r >> 16) % 2000);
+		e.hid=(r >> 12) % 3;
+		e.server="10.0.2." + to_string(10 + e.hid) + ":3306";
+		e.thread_id=(r >> 20) % 5000;
+		t+=rng() % 50;
+		e.start_time=t;
+		e.end_time=t + 100 + rng() % 5000;
+		size_t tmpl=rng() % ntemplates;
+		snprintf(buf, sizeof(buf), query_templates[tmpl], (unsigned)rng(), (unsigned)rng());
+		e.query=buf;
+		e.query_digest=0x9e3779b97f4a7c15ULL * (tmpl+1);
+		e.affected_rows=(tmpl == 2 || tmpl == 3 || tmpl == 5) ? rng() % 3 : 0;
+		e.rows_sent=(tmpl == 2 || tmpl == 3 || tmpl == 5) ? 0 : rng() % 20;
+	}
+}
+
+static uint8_t mysql_encode_length(uint64_t len, unsigned char *hd) {
+	if (len < 251) return 1;
+	if (len < 65536) { if (hd) { *hd=0xfc; }; return 3; }
+	if (len < 16777216) { if (hd) { *hd=0xfd; }; return 4; }
+	if (hd) { *hd=0xfe; }
+	return 9;
+}
+
+static void append_length(string& f, uint64_t val) {
+	unsigned char buf[9];
+	uint8_t len=mysql_encode_length(val, buf);
+	if (len == 1) {
+		buf[0]=(unsigned char)val;
+	} else {
+		memcpy(buf+1, &val, len-1);
+	}
+	f.append((char *)buf, len);
+}
+
+static void append_string(string& f, const string& s) {
+	append_length(f, s.size());
+	f.append(s);
+}
+
+static void encode_format_1(string& f, const bench_event_t& e) {
+	uint64_t total_bytes=0;
+	size_t pos=f.size();
+	f.append((char *)&total_bytes, sizeof(uint64_t));
+	f.push_back((char)PROXYSQL_COM_QUERY);
+	append_length(f, e.thread_id);
+	append_string(f, e.username);
+	append_string(f, e.schemaname);
+	append_string(f, e.client);
+	append_length(f, e.hid);
+	append_string(f, e.server);
+	append_length(f, e.start_time);
+	append_length(f, e.end_time);
+	append_length(f, e.affected_rows);
+	append_length(f, 0); // last_insert_id
+	append_length(f, e.rows_sent);
+	append_length(f, e.query_digest);
+	append_string(f, e.query);
+	total_bytes=f.size() - pos - sizeof(uint64_t);
+	memcpy(&f[pos], &total_bytes, sizeof(uint64_t));
+}
+
+static void encode_format_2(string& f, const bench_event_t& e) {
+	json j = {};
+	j["hostgroup_id"] = e.hid;
+	j["thread_id"] = e.thread_id;
+	j["event"] = "COM_QUERY";
+	j["username"] = e.username;
+	j["schemaname"] = e.schemaname;
+	j["client"] = e.client;
+	j["server"] = e.server;
+	j["rows_affected"] = e.affected_rows;
+	j["rows_sent"] = e.rows_sent;
+	j["query"] = e.query;
+	j["starttime_timestamp_us"] = e.start_time;
+	{
+		time_t timer=e.start_time/1000/1000;
+		struct tm tm_info;
+		localtime_r(&timer, &tm_info);
+		char buffer1[36];
+		char buffer2[64];
+		strftime(buffer1, 32, "%Y-%m-%d %H:%M:%S", &tm_info);
+		sprintf(buffer2, "%s.%06u", buffer1, (unsigned)(e.start_time%1000000));
+		j["starttime"] = buffer2;
+	}
+	j["endtime_timestamp_us"] = e.end_time;
+	{
+		time_t timer=e.end_time/1000/1000;
+		struct tm tm_info;
+		localtime_r(&timer, &tm_info);
+		char buffer1[36];
+		char buffer2[64];
+		strftime(buffer1, 32, "%Y-%m-%d %H:%M:%S", &tm_info);
+		sprintf(buffer2, "%s.%06u", buffer1, (unsigned)(e.end_time%1000000));
+		j["endtime"] = buffer2;
+	}
+	j["duration_us"] = e.end_time - e.start_time;
+	char digest_hex[20];
+	sprintf(digest_hex, "0x%016llX", (long long unsigned int)e.query_digest);
+	j["digest"] = digest_hex;
+	f.append(j.dump(-1, ' ', false, json::error_handler_t::replace));
+	f.push_back('\n');
+}
+
+static void encode_format_3(MySQL_Logger_Block_Encoder& block, string& f, const bench_event_t& e) {
+	mysql_logger_block_event_t ev;
+	ev.et=PROXYSQL_COM_QUERY;
+	ev.flags=MYSQL_LOGGER_BLOCK_FLAG_AFFECTED_ROWS|MYSQL_LOGGER_BLOCK_FLAG_ROWS_SENT;
+	ev.thread_id=e.thread_id;
+	ev.username=e.username.data();
+	ev.username_len=e.username.size();
+	ev.schemaname=e.schemaname.data();
+	ev.schemaname_len=e.schemaname.size();
+	ev.client=e.client.data();
+	ev.client_len=e.client.size();
+	ev.hid=e.hid;
+	ev.server=e.server.data();
+	ev.server_len=e.server.size();
+	ev.start_time=e.start_time;
+	ev.end_time=e.end_time;
+	ev.client_stmt_id=0;
+	ev.affected_rows=e.affected_rows;
+	ev.last_insert_id=0;
+	ev.rows_sent=e.rows_sent;
+	ev.query_digest=e.query_digest;
+	ev.query=e.query.data();
+	ev.query_len=e.query.size();
+	block.add(ev);
+	if (block.full()) {
+		block.encode(f);
+	}
+}
+
+static double elapsed(chrono::steady_clock::time_point start) {
+	return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * @brief Writes all the events in the given format.
+ * @return The elapsed time in seconds.
+ */
+static double write_file(const string& path, int format, const vector<bench_event_t>& evs) {
+	auto start=chrono::steady_clock::now();
+	fstream f;
+	f.open(path, ios::out | ios::binary | ios::trunc);
+	string buf {};
+	MySQL_Logger_Block_Encoder block;
+	vector<mysql_logger_block_index_entry_t> index {};
+	uint64_t offset=0;
+	if (format == 3) {
+		char hdr[MYSQL_LOGGER_BLOCK_FILE_HEADER_SIZE];
+		offset=mysql_logger_block_file_header(hdr);
+		f.write(hdr, offset);
+	}
+	for (size_t i=0; i<=evs.size(); i++) {
+		if (i < evs.size()) {
+			switch (format) {
+				case 1:
+					encode_format_1(buf, evs[i]);
+					break;
+				case 2:
+					encode_format_2(buf, evs[i]);
+					break;
+				default:
+					encode_format_3(block, buf, evs[i]);
+					break;
+			}
+		} else if (format == 3) {
+			block.encode(buf);
+		}
+		if (buf.size() >= WRITE_CHUNK_SIZE || (i == evs.size() && buf.size())) {
+			if (format == 3) {
+				size_t pos=0;
+				while (pos < buf.size()) {
+					mysql_logger_block_header_t bh;
+					memcpy(&bh, buf.data()+pos, sizeof(bh));
+					index.push_back({offset+pos, bh.events, 0, bh.min_start_time, bh.max_start_time});
+					pos+=sizeof(bh)+bh.compressed_len;
+				}
+			}
+			f.write(buf.data(), buf.size());
+			offset+=buf.size();
+			buf.clear();
+		}
+	}
+	if (format == 3) {
+		uint32_t magic=MYSQL_LOGGER_BLOCK_INDEX_MAGIC;
+		uint32_t entries=index.size();
+		f.write((char *)&magic, sizeof(uint32_t));
+		f.write((char *)&entries, sizeof(uint32_t));
+		f.write((char *)index.data(), entries*sizeof(mysql_logger_block_index_entry_t));
+		f.write((char *)&offset, sizeof(uint64_t));
+		f.write(MYSQL_LOGGER_BLOCK_TRAILER_MAGIC, 8);
+	}
+	f.close();
+	return elapsed(start);
+}
+
+static string read_all(const string& path) {
+	ifstream f(path, ios::in | ios::binary);
+	return string((istreambuf_iterator<char>(f)), istreambuf_iterator<char>());
+}
+
+/**
+ * @brief Reads all the events and sums their durations, so that every event is decoded.
+ * @return The elapsed time in seconds, including the read of the file.
+ */
+static double read_file(const string& path, int format, unsigned int threads, uint64_t& events, uint64_t& checksum) {
+	auto start=chrono::steady_clock::now();
+	string data=read_all(path);
+	events=0;
+	checksum=0;
+	if (format == 1) {
+		const unsigned char *p=(const unsigned char *)data.data();
+		const unsigned char *end=p+data.size();
+		while (p + sizeof(uint64_t) <= end) {
+			uint64_t len;
+			memcpy(&len, p, sizeof(uint64_t));
+			p+=sizeof(uint64_t);
+			const unsigned char *ev=p;
+			ev++; // event type
+			uint64_t v[14];
+			for (int c=0; c<13; c++) {
+				uint8_t l=1;
+				v[c]=*ev;
+				if (*ev == 0xfc) { l=3; v[c]=0; memcpy(&v[c], ev+1, 2); }
+				else if (*ev == 0xfd) { l=4; v[c]=0; memcpy(&v[c], ev+1, 3); }
+				else if (*ev == 0xfe) { l=9; memcpy(&v[c], ev+1, 8); }
+				ev+=l;
+				// username , schemaname , client , server
+				if (c == 1 || c == 2 || c == 3 || c == 5) {
+					ev+=v[c];
+				}
+			}
+			checksum+=v[7]-v[6];
+			events++;
+			p+=len;
+		}
+	} else if (format == 2) {
+		size_t pos=0;
+		while (pos < data.size()) {
+			size_t nl=data.find('\n', pos);
+			if (nl == string::npos) {
+				nl=data.size();
+			}
+			json j=json::parse(data.begin()+pos, data.begin()+nl);
+			checksum+=j["duration_us"].get<uint64_t>();
+			events++;
+			pos=nl+1;
+		}
+	} else {
+		vector<size_t> offsets {};
+		size_t pos=MYSQL_LOGGER_BLOCK_FILE_HEADER_SIZE;
+		while (pos + sizeof(mysql_logger_block_header_t) <= data.size()) {
+			mysql_logger_block_header_t hdr;
+			memcpy(&hdr, data.data()+pos, sizeof(hdr));
+			if (hdr.magic != MYSQL_LOGGER_BLOCK_MAGIC) {
+				break;
+			}
+			offsets.push_back(pos);
+			pos+=sizeof(hdr)+hdr.compressed_len;
+		}
+		atomic<uint64_t> t_events { 0 };
+		atomic<uint64_t> t_checksum { 0 };
+		vector<thread> workers {};
+		for (unsigned int t=0; t<threads; t++) {
+			workers.emplace_back([&, t]() {
+				MySQL_Logger_Block_Decoder dec;
+				uint64_t n=0, c=0;
+				for (size_t i=t; i<offsets.size(); i+=threads) {
+					mysql_logger_block_header_t hdr;
+					memcpy(&hdr, data.data()+offsets[i], sizeof(hdr));
+					if (dec.decode(hdr, data.data()+offsets[i]+sizeof(hdr))) {
+						for (const mysql_logger_block_event_t& ev : dec.events) {
+							c+=ev.end_time-ev.start_time;
+							n++;
+						}
+					}
+				}
+				t_events+=n;
+				t_checksum+=c;
+			});
+		}
+		for (thread& w : workers) {
+			w.join();
+		}
+		events=t_events;
+		checksum=t_checksum;
+	}
+	return elapsed(start);
+}
+
+int main(int argc, char **argv) {
+	size_t num_events=1000000;
+	string dir="/tmp";
+	unsigned int threads=thread::hardware_concurrency();
+	int opt;
+	while ((opt=getopt(argc, argv, "n:d:t:")) != -1) {
+		switch (opt) {
+			case 'n':
+				num_events=strtoull(optarg, NULL, 10);
+				break;
+			case 'd':
+				dir=optarg;
+				break;
+			case 't':
+				threads=atoi(optarg);
+				break;
+			default:
+				cerr << "Usage: " << argv[0] << " [-n events] [-d directory] [-t threads]" << endl;
+				return EXIT_FAILURE;
+		}
+	}
+	if (threads == 0) {
+		threads=1;
+	}
+
+	vector<bench_event_t> evs {};
+	generate_events(evs, num_events);
+	cout << "Events: " << num_events << " , reader threads for format 3: " << threads << endl;
+	printf("%-8s %14s %14s %12s %14s %14s\n", "format", "write ev/s", "file MB", "bytes/event", "read ev/s", "checksum");
+
+	uint64_t expected=0;
+	for (int format=1; format<=3; format++) {
+		string path=dir + "/eventslog_benchmark.format" + to_string(format);
+		double wt=write_file(path, format, evs);
+		struct stat st;
+		stat(path.c_str(), &st);
+		uint64_t read_events=0, checksum=0;
+		double rt=read_file(path, format, threads, read_events, checksum);
+		if (format == 1) {
+			expected=checksum;
+		}
+		printf("%-8d %14.0f %14.2f %12.1f %14.0f %14s\n", format, num_events/wt, st.st_size/1048576.0,
+			(double)st.st_size/num_events, read_events/rt,
+			(read_events == num_events && checksum == expected) ? "OK" : "MISMATCH");
+		unlink(path.c_str());
+	}
+	return EXIT_SUCCESS;
+}
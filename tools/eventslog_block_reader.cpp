@@ -0,0 +1,292 @@
+/**
+ * @file eventslog_block_reader.cpp
+ * @brief Reads an events log written with 'mysql-eventslog_format=3'.
+ * @details The file is mapped in memory and the blocks are decompressed and decoded by multiple
+ *  threads, while the output is printed in the order of the file. The location of the blocks is read
+ *  from the index at the end of the file, or found scanning the block headers if the file has no index
+ *  (for example the file still in use by ProxySQL).
+ *
+ *  Usage: eventslog_block_reader [-t threads] [-s start_us] [-e end_us] [-c] <file>
+ *   -t  number of decoding threads , default the number of CPUs
+ *   -s  only events with starttime >= start_us (microseconds since epoch)
+ *   -e  only events with starttime <= end_us (microseconds since epoch)
+ *   -c  only print the number of events
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "MySQL_Logger_Block.h"
+
+using namespace std;
+
+// number of blocks decoded by each thread before printing them
+#define BLOCKS_PER_THREAD	4
+
+enum log_event_type {
+	PROXYSQL_COM_QUERY,
+	PROXYSQL_MYSQL_AUTH_OK,
+	PROXYSQL_MYSQL_AUTH_ERR,
+	PROXYSQL_MYSQL_AUTH_CLOSE,
+	PROXYSQL_MYSQL_AUTH_QUIT,
+	PROXYSQL_MYSQL_CHANGE_USER_OK,
+	PROXYSQL_MYSQL_CHANGE_USER_ERR,
+	PROXYSQL_MYSQL_INITDB,
+	PROXYSQL_ADMIN_AUTH_OK,
+	PROXYSQL_ADMIN_AUTH_ERR,
+	PROXYSQL_ADMIN_AUTH_CLOSE,
+	PROXYSQL_ADMIN_AUTH_QUIT,
+	PROXYSQL_SQLITE_AUTH_OK,
+	PROXYSQL_SQLITE_AUTH_ERR,
+	PROXYSQL_SQLITE_AUTH_CLOSE,
+	PROXYSQL_SQLITE_AUTH_QUIT,
+	PROXYSQL_COM_STMT_EXECUTE,
+	PROXYSQL_COM_STMT_PREPARE
+};
+
+typedef struct {
+	uint64_t offset;
+	uint64_t min_start_time;
+	uint64_t max_start_time;
+} block_location_t;
+
+static uint64_t filter_start=0;
+static uint64_t filter_end=UINT64_MAX;
+static bool count_only=false;
+
+static void format_time(string& out, uint64_t t) {
+	char buffer[32];
+	char buffer2[48];
+	time_t timer=t/1000/1000;
+	struct tm tm_info;
+	localtime_r(&timer, &tm_info);
+	strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &tm_info);
+	snprintf(buffer2, sizeof(buffer2), "%s.%06u", buffer, (unsigned)(t%1000000));
+	out.append(buffer2);
+}
+
+/**
+ * @brief Prints the events in the same format of eventslog_reader_sample.
+ */
+static void format_event(string& out, const mysql_logger_block_event_t& ev) {
+	char buf[128];
+	out.append("ProxySQL LOG ");
+	switch (ev.et) {
+		case PROXYSQL_COM_STMT_EXECUTE:
+			out.append("COM_STMT_EXECUTE");
+			break;
+		case PROXYSQL_COM_STMT_PREPARE:
+			out.append("COM_STMT_PREPARE");
+			break;
+		default:
+			out.append("COM_QUERY");
+			break;
+	}
+	out.append(": thread_id=\"").append(to_string(ev.thread_id));
+	out.append("\" username=\"").append(ev.username, ev.username_len);
+	out.append("\" schemaname=\"").append(ev.schemaname, ev.schemaname_len);
+	out.append("\" client=\"").append(ev.client, ev.client_len).append("\"");
+	if (ev.hid == UINT64_MAX) {
+		out.append(" HID=NULL ");
+	} else {
+		out.append(" HID=").append(to_string(ev.hid));
+		out.append(" server=\"").append(ev.server, ev.server_len).append("\"");
+	}
+	out.append(" starttime=\"");
+	format_time(out, ev.start_time);
+	out.append("\" endtime=\"");
+	format_time(out, ev.end_time);
+	out.append("\" duration=").append(to_string(ev.end_time - ev.start_time)).append("us");
+	if (ev.et == PROXYSQL_COM_STMT_PREPARE || ev.et == PROXYSQL_COM_STMT_EXECUTE) {
+		out.append(" client_stmt_id=").append(to_string(ev.client_stmt_id));
+	}
+	out.append(" rows_affected=").append(to_string(ev.affected_rows));
+	out.append(" rows_sent=").append(to_string(ev.rows_sent));
+	snprintf(buf, sizeof(buf), " digest=\"0x%016llX\"\n", (long long unsigned int)ev.query_digest);
+	out.append(buf);
+	out.append(ev.query, ev.query_len);
+	out.push_back('\n');
+}
+
+/**
+ * @brief Finds the blocks of the file, from the index if present or scanning the headers.
+ * @return false if the file is not in the block format.
+ */
+static bool find_blocks(const char *map, size_t size, vector<block_location_t>& blocks) {
+	if (size < MYSQL_LOGGER_BLOCK_FILE_HEADER_SIZE || mysql_logger_block_check_file_header(map) == false) {
+		return false;
+	}
+	if (size >= MYSQL_LOGGER_BLOCK_FILE_HEADER_SIZE + MYSQL_LOGGER_BLOCK_TRAILER_SIZE + 2*sizeof(uint32_t)) {
+		const char *trailer=map + size - MYSQL_LOGGER_BLOCK_TRAILER_SIZE;
+		if (memcmp(trailer+8, MYSQL_LOGGER_BLOCK_TRAILER_MAGIC, 8) == 0) {
+			uint64_t index_offset;
+			uint32_t magic, entries;
+			memcpy(&index_offset, trailer, sizeof(uint64_t));
+			if (index_offset + 2*sizeof(uint32_t) <= size - MYSQL_LOGGER_BLOCK_TRAILER_SIZE) {
+				memcpy(&magic, map+index_offset, sizeof(uint32_t));
+				memcpy(&entries, map+index_offset+sizeof(uint32_t), sizeof(uint32_t));
+				const char *p=map+index_offset+2*sizeof(uint32_t);
+				if (magic == MYSQL_LOGGER_BLOCK_INDEX_MAGIC && p + (size_t)entries*sizeof(mysql_logger_block_index_entry_t) <= trailer) {
+					for (uint32_t i=0; i<entries; i++) {
+						mysql_logger_block_index_entry_t ie;
+						memcpy(&ie, p + i*sizeof(ie), sizeof(ie));
+						blocks.push_back({ie.offset, ie.min_start_time, ie.max_start_time});
+					}
+					return true;
+				}
+			}
+		}
+	}
+	// no index , the file is still in use or was not closed
+	size_t pos=MYSQL_LOGGER_BLOCK_FILE_HEADER_SIZE;
+	while (pos + sizeof(mysql_logger_block_header_t) <= size) {
+		mysql_logger_block_header_t hdr;
+		memcpy(&hdr, map+pos, sizeof(hdr));
+		if (hdr.magic != MYSQL_LOGGER_BLOCK_MAGIC || pos + sizeof(hdr) + hdr.compressed_len > size) {
+			// index or partially written block
+			break;
+		}
+		blocks.push_back({pos, hdr.min_start_time, hdr.max_start_time});
+		pos+=sizeof(hdr)+hdr.compressed_len;
+	}
+	return true;
+}
+
+int main(int argc, char **argv) {
+	unsigned int num_threads=thread::hardware_concurrency();
+	int opt;
+	while ((opt=getopt(argc, argv, "t:s:e:c")) != -1) {
+		switch (opt) {
+			case 't':
+				num_threads=atoi(optarg);
+				break;
+			case 's':
+				filter_start=strtoull(optarg, NULL, 10);
+				break;
+			case 'e':
+				filter_end=strtoull(optarg, NULL, 10);
+				break;
+			case 'c':
+				count_only=true;
+				break;
+			default:
+				cerr << "Usage: " << argv[0] << " [-t threads] [-s start_us] [-e end_us] [-c] <file>" << endl;
+				return EXIT_FAILURE;
+		}
+	}
+	if (optind != argc-1) {
+		cerr << "Usage: " << argv[0] << " [-t threads] [-s start_us] [-e end_us] [-c] <file>" << endl;
+		return EXIT_FAILURE;
+	}
+	if (num_threads == 0) {
+		num_threads=1;
+	}
+
+	const char *filename=argv[optind];
+	int fd=open(filename, O_RDONLY);
+	if (fd < 0) {
+		cerr << "Opening log file '" << filename << "' failed: " << strerror(errno) << endl;
+		return EXIT_FAILURE;
+	}
+	struct stat st;
+	fstat(fd, &st);
+	size_t size=st.st_size;
+	if (size == 0) {
+		cerr << "Log file '" << filename << "' is empty" << endl;
+		close(fd);
+		return EXIT_FAILURE;
+	}
+	const char *map=(const char *)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED) {
+		cerr << "Mapping log file '" << filename << "' failed: " << strerror(errno) << endl;
+		close(fd);
+		return EXIT_FAILURE;
+	}
+	madvise((void *)map, size, MADV_SEQUENTIAL);
+
+	vector<block_location_t> all_blocks {};
+	if (find_blocks(map, size, all_blocks) == false) {
+		cerr << "Log file '" << filename << "' is not in the block format (mysql-eventslog_format=3)" << endl;
+		munmap((void *)map, size);
+		close(fd);
+		return EXIT_FAILURE;
+	}
+	// the blocks outside the time range are skipped without being decompressed
+	vector<block_location_t> blocks {};
+	for (const block_location_t& b : all_blocks) {
+		if (b.max_start_time >= filter_start && b.min_start_time <= filter_end) {
+			blocks.push_back(b);
+		}
+	}
+
+	atomic<uint64_t> total_events { 0 };
+	atomic<bool> corrupted { false };
+	size_t batch=num_threads*BLOCKS_PER_THREAD;
+	vector<string> outputs(batch);
+	for (size_t first=0; first < blocks.size(); first+=batch) {
+		size_t last=min(first+batch, blocks.size());
+		vector<thread> workers {};
+		for (unsigned int t=0; t<num_threads; t++) {
+			workers.emplace_back([&, t]() {
+				MySQL_Logger_Block_Decoder dec;
+				for (size_t i=first+t; i<last; i+=num_threads) {
+					string& out=outputs[i-first];
+					out.clear();
+					mysql_logger_block_header_t hdr;
+					if (blocks[i].offset + sizeof(hdr) > size) {
+						corrupted=true;
+						continue;
+					}
+					memcpy(&hdr, map+blocks[i].offset, sizeof(hdr));
+					if (blocks[i].offset + sizeof(hdr) + hdr.compressed_len > size
+						|| dec.decode(hdr, map+blocks[i].offset+sizeof(hdr)) == false) {
+						corrupted=true;
+						continue;
+					}
+					uint64_t n=0;
+					for (const mysql_logger_block_event_t& ev : dec.events) {
+						if (ev.start_time < filter_start || ev.start_time > filter_end) {
+							continue;
+						}
+						n++;
+						if (count_only == false) {
+							format_event(out, ev);
+						}
+					}
+					total_events+=n;
+				}
+			});
+		}
+		for (thread& w : workers) {
+			w.join();
+		}
+		if (count_only == false) {
+			for (size_t i=first; i<last; i++) {
+				fwrite(outputs[i-first].data(), 1, outputs[i-first].size(), stdout);
+			}
+		}
+	}
+	if (count_only) {
+		cout << total_events << endl;
+	}
+
+	munmap((void *)map, size);
+	close(fd);
+	if (corrupted) {
+		cerr << "Log file '" << filename << "' contains corrupted blocks" << endl;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}